@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Engine/GameObject.h"
+#include "Engine/Scene.h"
+#include "Engine/Camera.h"
+#include "Engine/Mesh.h"
+#include "Engine/MeshIngest.h"
+#include "Engine/Picking.h"
+#include "Engine/SceneGenerator.h"
+#include "Engine/RenderDevice.h"
+#include "Engine/MemoryTracker.h"
+#include "Engine/Profiler.h"
+#include "Editor/MeshImporter.h"
+#include "Editor/SceneSerializator.h"
+
+// Times the engine's hot paths on synthetic scenes and writes the results as JSON, so runs can be compared over
+// time. Everything runs on a RecordingRenderDevice: no window or GL context is needed, and uploads cost what the
+// CPU side of them costs.
+//
+//   Benchmark [--objects 1000,10000] [--seed 1] [--meshes 16] [--sharing 0.99] [--detail 8] [--depth 1] [--fan-out 4]
+//             [--distribution Uniform|Clustered|Grid] [--static 0.5] [--min-time 0.25] [--filter text] [--out benchmark.json]
+//
+// --meshes caps the distinct meshes in a scene and is the number of meshes the mesh benchmarks load and save.
+// The MeshIngest benchmarks run each import kernel and its scalar baseline on arrays either side of
+// MeshIngest::kParallelThreshold; their name carries the vertex count and an operation is one vertex.
+//
+// Each benchmark repeats a sample (one pass over its work) until min-time seconds have gone by, and reports the
+// median, fastest and slowest sample per operation. The checksum depends only on the work done: the same seed and
+// settings give the same checksum on every run, so a changed one means the numbers are not comparable.
+
+using hrclock = std::chrono::steady_clock;
+
+namespace
+{
+	struct Options
+	{
+		std::vector<size_t> objects{ 1000, 10000 };
+		SceneGenerator::Settings scene;
+		double minTime = 0.25;
+		std::string filter;
+		std::string output = "benchmark.json";
+	};
+
+	struct Result
+	{
+		std::string name;
+		size_t objects = 0;
+		size_t operations = 0;	// per sample
+		size_t samples = 0;
+		double medianNs = 0;	// per operation
+		double minNs = 0;
+		double maxNs = 0;
+		size_t checksum = 0;
+	};
+
+	Options options;
+	std::vector<Result> results;
+
+	// sample() does one pass of operations and returns a checksum of what it did
+	void measure(const std::string& name, size_t objects, size_t operations, const std::function<size_t()>& sample)
+	{
+		if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+
+		Result result;
+		result.name = name;
+		result.objects = objects;
+		result.operations = std::max<size_t>(operations, 1);
+		result.checksum = sample();	// warm-up
+
+		std::vector<double> times;
+		const auto deadline = hrclock::now() + std::chrono::duration<double>(options.minTime);
+		while (times.size() < 5 || (hrclock::now() < deadline && times.size() < 10000)) {
+			const auto start = hrclock::now();
+			sample();
+			times.push_back(std::chrono::duration<double, std::nano>(hrclock::now() - start).count() / result.operations);
+		}
+		std::sort(times.begin(), times.end());
+		result.samples = times.size();
+		result.medianNs = times[times.size() / 2];
+		result.minNs = times.front();
+		result.maxNs = times.back();
+
+		std::printf("%-36s %8zu objects %12.1f ns/op (min %.1f, %zu samples)\n", name.c_str(), objects, result.medianNs, result.minNs, result.samples);
+		results.push_back(result);
+	}
+
+	void aimCamera(Camera& camera, double extent)
+	{
+		// Outside the cube looking at its centre, so part of the scene is in view and part is not
+		camera.zFar = extent * 2.0;
+		camera.transform().pos() = vec3(extent * 0.2, extent * 0.1, extent * 0.6);
+		camera.transform().lookAt(vec3(0));
+		camera.UpdateMainCamera();
+	}
+
+	void runMeshBenchmarks()
+	{
+		const auto& settings = options.scene;
+		std::vector<MeshCpuData> data;
+		for (size_t i = 0; i < settings.maxMeshes; ++i) data.push_back(SceneGenerator::generateMeshData(SceneGenerator::streamSeed(settings.seed, i), settings.meshDetail));
+
+		measure("Mesh::load", 0, data.size(), [&data]() {
+			size_t checksum = 0;
+			for (auto& mesh : data) {
+				Mesh loaded;
+				loaded.load(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+				checksum += loaded.numIndices();
+			}
+			return checksum;
+		});
+
+		auto meshes = SceneGenerator::generateMeshes(settings.seed, settings.maxMeshes, settings.meshDetail);
+		const auto path = (std::filesystem::temp_directory_path() / "maker_benchmark.mesh").string();
+		MeshImporter importer;
+		measure("MeshImporter::SaveMeshToFile", 0, meshes.size(), [&]() {
+			importer.SaveMeshToFile(meshes, path, "benchmark.fbx");
+			return static_cast<size_t>(std::filesystem::file_size(path));
+		});
+		measure("MeshImporter::LoadMeshFromFile", 0, meshes.size(), [&]() {
+			std::string fbxPath;
+			size_t checksum = 0;
+			for (const auto& mesh : importer.LoadMeshFromFile(path, fbxPath)) checksum += mesh->numVertices();
+			return checksum;
+		});
+		std::filesystem::remove(path);
+	}
+
+	void runIngestBenchmarks()
+	{
+		// Below the parallel threshold the kernels run on the calling thread; from twice it they split across threads
+		for (const size_t count : { size_t(1) << 10, size_t(1) << 14, MeshIngest::kParallelThreshold, size_t(1) << 18, size_t(1) << 20 }) {
+			std::vector<aiVector3D> source(count);
+			std::vector<aiColor4D> colors(count);
+			for (size_t i = 0; i < count; ++i) {
+				const float t = static_cast<float>(i) / count;
+				source[i] = aiVector3D(t * 10.0f - 5.0f, 1.0f - t, static_cast<float>(i % 7));
+				// A few out of range, so the saturation is exercised too
+				colors[i] = aiColor4D(t, 1.0f - t, t * 1.25f - 0.1f, 1.0f);
+			}
+			std::vector<glm::vec3> vec3s(count);
+			std::vector<glm::vec2> vec2s(count);
+			std::vector<glm::u8vec3> packed(count);
+			const size_t middle = count / 2;
+			const std::string suffix = " " + std::to_string(count) + "v";
+
+			auto copyVec3 = [&](auto kernel) {
+				return [&, kernel]() {
+					kernel(source.data(), vec3s.data(), count);
+					return static_cast<size_t>(vec3s[middle].x * 1000.0f + vec3s.back().z);
+				};
+			};
+			measure("MeshIngest::copyVec3" + suffix, 0, count, copyVec3(MeshIngest::copyVec3));
+			measure("MeshIngest::Scalar::copyVec3" + suffix, 0, count, copyVec3(MeshIngest::Scalar::copyVec3));
+
+			auto copyTexCoords = [&](auto kernel) {
+				return [&, kernel]() {
+					kernel(source.data(), vec2s.data(), count, true);
+					return static_cast<size_t>(vec2s[middle].x * 1000.0f - vec2s[middle].y * 1000.0f);
+				};
+			};
+			measure("MeshIngest::copyTexCoords" + suffix, 0, count, copyTexCoords(MeshIngest::copyTexCoords));
+			measure("MeshIngest::Scalar::copyTexCoords" + suffix, 0, count, copyTexCoords(MeshIngest::Scalar::copyTexCoords));
+
+			auto packColors = [&](auto kernel) {
+				return [&, kernel]() {
+					kernel(colors.data(), packed.data(), count);
+					return static_cast<size_t>(packed[middle].r) << 16 | static_cast<size_t>(packed[middle].g) << 8 | packed.back().b;
+				};
+			};
+			measure("MeshIngest::packColors" + suffix, 0, count, packColors(MeshIngest::packColors));
+			measure("MeshIngest::Scalar::packColors" + suffix, 0, count, packColors(MeshIngest::Scalar::packColors));
+
+			auto computeBounds = [&](auto kernel) {
+				return [&, kernel]() {
+					glm::vec3 min(0), max(0);
+					kernel(vec3s.data(), count, min, max);
+					return static_cast<size_t>((max.x - min.x) * 1000.0f + (max.z - min.z));
+				};
+			};
+			measure("MeshIngest::computeBounds" + suffix, 0, count, computeBounds(MeshIngest::computeBounds));
+			measure("MeshIngest::Scalar::computeBounds" + suffix, 0, count, computeBounds(MeshIngest::Scalar::computeBounds));
+		}
+	}
+
+	void runSceneBenchmarks(size_t objects)
+	{
+		auto settings = options.scene;
+		settings.objects = objects;
+		SceneManager::clearScene();
+		const auto generated = SceneGenerator::generate(scene, settings);
+		std::printf("Scene of %zu objects in %zu levels, %zu meshes, %zu static\n", generated.objects, generated.levels.size(),
+			generated.meshes.size(), generated.staticObjects);
+
+		std::vector<BoundingBox> boxes;
+		measure("GameObject::boundingBox", objects, objects, [&boxes]() {
+			boxes.clear();
+			for (const auto& go : scene.children()) boxes.push_back(go.boundingBox());
+			return boxes.size();
+		});
+		if (boxes.empty()) for (const auto& go : scene.children()) boxes.push_back(go.boundingBox());
+
+		// Not copied: a Frustum's plane pointers point into itself
+		Camera camera;
+		aimCamera(camera, settings.extent);
+		measure("Frustum::ContainsBBox", objects, boxes.size(), [&]() {
+			size_t visible = 0;
+			for (const auto& box : boxes) visible += camera.frustum.ContainsBBox(box) != FRUSTUM_OUT;
+			return visible;
+		});
+
+		// Clicks on a grid over the viewport; most rays miss everything and walk the whole list
+		const glm::ivec2 viewport(1280, 720);
+		const glm::mat4 projection = camera.projection();
+		const glm::mat4 view = camera.view();
+		constexpr int kClicks = 8;
+		measure("raycastFromMouseToGameObject", objects, kClicks * kClicks, [&]() {
+			size_t hits = 0;
+			for (int y = 0; y < kClicks; ++y) {
+				for (int x = 0; x < kClicks; ++x) {
+					const int mouseX = (2 * x + 1) * viewport.x / (2 * kClicks);
+					const int mouseY = (2 * y + 1) * viewport.y / (2 * kClicks);
+					hits += raycastFromMouseToGameObject(scene, mouseX, mouseY, projection, view, viewport) != nullptr;
+				}
+			}
+			return hits;
+		});
+
+		std::vector<Transform*> transforms;
+		for (auto& go : scene.getChildren()) transforms.push_back(&go.GetComponent<TransformComponent>()->transform());
+		measure("Transform::SetPosition", objects, transforms.size(), [&transforms]() {
+			for (size_t i = 0; i < transforms.size(); ++i) transforms[i]->SetPosition(vec3(double(i), 1.0, -double(i)));
+			return transforms.size();
+		});
+		measure("Transform::SetRotation", objects, transforms.size(), [&transforms]() {
+			for (size_t i = 0; i < transforms.size(); ++i) transforms[i]->SetRotation(vec3(double(i % 360), 45.0, 10.0));
+			return transforms.size();
+		});
+		measure("Transform::SetScale", objects, transforms.size(), [&transforms]() {
+			for (size_t i = 0; i < transforms.size(); ++i) transforms[i]->SetScale(vec3(1.0 + (i % 4) * 0.25));
+			return transforms.size();
+		});
+
+		// saveScene adds the scene's objects to gameObjectsOnScene every time, so the list is emptied per sample
+		const auto path = (std::filesystem::temp_directory_path() / "maker_benchmark.scene").string();
+		measure("SceneManager::saveScene", objects, objects, [&path]() {
+			SceneManager::saveScene(path);
+			SceneManager::gameObjectsOnScene.clear();
+			return static_cast<size_t>(std::filesystem::file_size(path));
+		});
+		measure("SceneManager::loadScene", objects, objects, [&path]() {
+			SceneManager::loadScene(path);
+			return scene.getChildren().size();
+		});
+		std::filesystem::remove(path);
+		SceneManager::clearScene();
+	}
+
+	bool writeJson(std::ostream& out)
+	{
+		const auto memory = MemoryTracker::processMemory();
+		const auto& settings = options.scene;
+		out << "{\n  \"seed\": " << settings.seed << ",\n  \"meshes\": " << settings.maxMeshes << ",\n  \"meshSharing\": " << settings.meshSharing
+			<< ",\n  \"meshDetail\": " << settings.meshDetail << ",\n  \"depth\": " << settings.depth << ",\n  \"fanOut\": " << settings.fanOut
+			<< ",\n  \"distribution\": \"" << SceneGenerator::distributionName(settings.distribution) << "\""
+			<< ",\n  \"staticFraction\": " << settings.staticFraction << ",\n  \"extent\": " << settings.extent
+			<< ",\n  \"minTime\": " << options.minTime << ",\n  \"threads\": " << std::thread::hardware_concurrency()
+#if defined(NDEBUG)
+			<< ",\n  \"build\": \"Release\""
+#else
+			<< ",\n  \"build\": \"Debug\""
+#endif
+			<< ",\n  \"peakResident\": " << memory.peakResident << ",\n  \"results\": [\n";
+		for (size_t i = 0; i < results.size(); ++i) {
+			const auto& result = results[i];
+			out << "    { \"name\": \"" << result.name << "\", \"objects\": " << result.objects << ", \"operations\": " << result.operations
+				<< ", \"samples\": " << result.samples << ", \"nsPerOp\": { \"median\": " << result.medianNs << ", \"min\": " << result.minNs
+				<< ", \"max\": " << result.maxNs << " }, \"checksum\": " << result.checksum << " }" << (i + 1 == results.size() ? "\n" : ",\n");
+		}
+		out << "  ]\n}\n";
+		return static_cast<bool>(out);
+	}
+
+	std::vector<size_t> parseCounts(const std::string& text)
+	{
+		std::vector<size_t> counts;
+		size_t begin = 0;
+		while (begin <= text.size()) {
+			const size_t end = std::min(text.find(',', begin), text.size());
+			if (end > begin) counts.push_back(std::strtoull(text.substr(begin, end - begin).c_str(), nullptr, 10));
+			begin = end + 1;
+		}
+		return counts;
+	}
+
+	bool parseArguments(int argc, char** argv)
+	{
+		options.scene.maxMeshes = 16;
+		options.scene.meshDetail = 8;
+		for (int i = 1; i < argc; ++i) {
+			const std::string argument = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+			if (!value) {
+				std::cerr << "Missing value for " << argument << std::endl;
+				return false;
+			}
+			if (argument == "--objects") options.objects = parseCounts(value);
+			else if (argument == "--seed") options.scene.seed = std::strtoull(value, nullptr, 10);
+			else if (argument == "--meshes") options.scene.maxMeshes = std::strtoull(value, nullptr, 10);
+			else if (argument == "--sharing") options.scene.meshSharing = std::strtod(value, nullptr);
+			else if (argument == "--detail") options.scene.meshDetail = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+			else if (argument == "--depth") options.scene.depth = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+			else if (argument == "--fan-out") options.scene.fanOut = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+			else if (argument == "--static") options.scene.staticFraction = std::strtod(value, nullptr);
+			else if (argument == "--distribution") {
+				int distribution = 0;
+				while (distribution < SceneGenerator::DistributionCount &&
+					SceneGenerator::distributionName(static_cast<SceneGenerator::Distribution>(distribution)) != std::string(value)) ++distribution;
+				if (distribution == SceneGenerator::DistributionCount) {
+					std::cerr << "Unknown distribution " << value << std::endl;
+					return false;
+				}
+				options.scene.distribution = static_cast<SceneGenerator::Distribution>(distribution);
+			}
+			else if (argument == "--min-time") options.minTime = std::strtod(value, nullptr);
+			else if (argument == "--filter") options.filter = value;
+			else if (argument == "--out") options.output = value;
+			else {
+				std::cerr << "Unknown argument " << argument << std::endl;
+				return false;
+			}
+			++i;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (!parseArguments(argc, argv)) return 1;
+
+	RenderDevice::install(std::make_unique<RecordingRenderDevice>());
+	// The markers stay in the measured code, as in the editor, but nothing is recorded
+	Profiler::getInstance().enabled = false;
+
+	runIngestBenchmarks();
+	runMeshBenchmarks();
+	for (size_t objects : options.objects) runSceneBenchmarks(objects);
+
+	std::ofstream out(options.output);
+	if (!out || !writeJson(out)) {
+		std::cerr << "Could not write " << options.output << std::endl;
+		return 1;
+	}
+	std::cout << "Results written to " << options.output << std::endl;
+	return 0;
+}
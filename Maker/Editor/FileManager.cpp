@@ -1,18 +1,33 @@
 #include "FileManager.h"
+#include "../Engine/MemoryTracker.h"
+#include "../Engine/Profiler.h"
+#include "../Engine/TextureCache.h"
+
+// What assimp holds for an imported scene, charged to the importer while the scene is alive
+static size_t importedSceneBytes(const aiScene* scene)
+{
+	if (!scene) return 0;
+	aiMemoryInfo info;
+	aiGetMemoryRequirements(scene, &info);
+	return info.total;
+}
 
 GameObject FileManager::LoadFile(const char* path)
 {
+	PROFILE_SCOPE("FileManager::LoadFile");
 	// Load file
 	std::string extension = getFileExtension(path);
 
 	if (extension == "obj" || extension == "fbx" || extension == "dae" || extension == "FBX") {
 		// Load Mesh
 		const aiScene* fbx_scene = aiImportFile(path, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_JoinIdenticalVertices | aiProcess_GenUVCoords | aiProcess_TransformUVCoords | aiProcess_FlipUVs);
+		TrackedBytes sceneMemory(MemoryTag::Importer, importedSceneBytes(fbx_scene));
 		MeshImporter meshImporter;
 		auto meshes = meshImporter.ImportMesh(*fbx_scene);
-		auto materials = meshImporter.createMaterialsFromFBX(*fbx_scene, path);
+		auto materials = meshImporter.createMaterialsFromFBX(*fbx_scene, path, meshes, true);
 		GameObject go = meshImporter.gameObjectFromNode(*fbx_scene, *fbx_scene->mRootNode, meshes, materials);
 		aiReleaseImport(fbx_scene);
+		sceneMemory.set(0);
 		for (int i = 0; i < meshImporter.meshGameObjects.size(); i++)
 		{
 			auto gameObject = meshImporter.meshGameObjects[i];
@@ -28,7 +43,12 @@ GameObject FileManager::LoadFile(const char* path)
 		}
 		std::string nameFile = getFileNameWithoutExtension(path);
 		const std::string finalPath = "Library/Meshes/" + nameFile + ".mesh";
-		meshImporter.SaveMeshToFile(meshes, finalPath.c_str(), path);
+		const auto offsets = meshImporter.SaveMeshToFile(meshes, finalPath.c_str(), path);
+		// Once cooked, the CPU copies can be read back from the .mesh file instead of staying resident
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			meshes[i]->setResidency(MeshResidency::ReloadOnDemand, MeshImporter::CookedMeshReloader(finalPath, offsets[i]));
+		}
 		go.meshPath = path;
 
 		// Set ID
@@ -44,12 +64,13 @@ GameObject FileManager::LoadFile(const char* path)
 
 void FileManager::ImportTexture(const char* path)
 {
+	PROFILE_SCOPE("FileManager::ImportTexture");
 	// Load Texture
-	auto imageTexture = std::make_shared<Image>();
-	imageTexture = textureImporter.ImportTexture(path);
-	std::string nameFile = getFileNameWithoutExtension(path);
-	const std::string finalPath = "Library/Textures/" + nameFile + ".tex";
-	textureImporter.SaveTextureToFile(imageTexture, finalPath.c_str());
+	auto imageTexture = TextureCache::getInstance().image(path, TextureCache::Cooked, [this](const std::string& file) { return textureImporter.ImportTexture(file); });
+	if (!imageTexture) return;
+	// Written again only when the source changed since it was last cooked
+	if (TextureImporter::IsCookedCurrent(path)) return;
+	textureImporter.SaveTextureToFile(imageTexture, TextureImporter::CookedPath(path));
 }
 
 void FileManager::LoadTexture(const char* path, GameObject& go)
@@ -61,11 +82,11 @@ void FileManager::LoadTexture(const char* path, GameObject& go)
 	auto material = std::make_shared<Material>();
 	if (extension == "tex")
 	{
-		imageTexture = textureImporter.LoadTextureFromFile(path);
+		imageTexture = TextureCache::getInstance().image(path, TextureCache::Streamed, TextureImporter::LoadTextureFromFile);
 	}
 	else if (extension == "png" || extension == "jpg" || extension == "jpeg" || extension == "bmp" || extension == "tga")
 	{
-		imageTexture->LoadTexture(path);
+		imageTexture = TextureCache::getInstance().image(path);
 	}
 	
 	go.texturePath = path;
@@ -79,6 +100,7 @@ void FileManager::LoadTexture(const char* path, GameObject& go)
 
 void FileManager::LoadCustomFile(const char* path, GameObject& go)
 {
+	PROFILE_SCOPE("FileManager::LoadCustomFile");
 	// Load file
 	std::string extension = getFileExtension(path);
 
@@ -88,8 +110,11 @@ void FileManager::LoadCustomFile(const char* path, GameObject& go)
 		std::string fbxPath;
 		auto meshes = meshImporter.LoadMeshFromFile(path, fbxPath);
 		const aiScene* fbx_scene = aiImportFile(fbxPath.c_str(), aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_JoinIdenticalVertices | aiProcess_GenUVCoords | aiProcess_TransformUVCoords | aiProcess_FlipUVs);
-		auto materials = meshImporter.createMaterialsFromFBX(*fbx_scene, fbxPath);
+		TrackedBytes sceneMemory(MemoryTag::Importer, importedSceneBytes(fbx_scene));
+		auto materials = meshImporter.createMaterialsFromFBX(*fbx_scene, fbxPath, meshes, false);
 		go = meshImporter.gameObjectFromNode(*fbx_scene, *fbx_scene->mRootNode, meshes, materials);
+		aiReleaseImport(fbx_scene);
+		sceneMemory.set(0);
 		for (int i = 0; i < meshImporter.meshGameObjects.size(); i++)
 		{
 			auto gameObject = meshImporter.meshGameObjects[i];
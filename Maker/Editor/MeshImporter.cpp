@@ -1,6 +1,13 @@
 #include "MeshImporter.h"
 #include <filesystem>
 #include "../Engine/BoundingBox.h"
+#include "../Engine/MeshIngest.h"
+#include "../Engine/Profiler.h"
+#include "../Engine/TextureCache.h"
+#include "../Engine/ImageDecoder.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -41,6 +48,7 @@ std::string removeLastPartOfPath(const std::string& path) {
 
 std::vector<std::shared_ptr<Mesh>> MeshImporter::ImportMesh(const aiScene& scene)
 {
+	PROFILE_SCOPE("MeshImporter::ImportMesh");
 	vector<shared_ptr<Mesh>> meshes;
 	for (unsigned int i = 0; i < scene.mNumMeshes; ++i) {
 		const aiMesh* fbx_mesh = scene.mMeshes[i];
@@ -53,22 +61,21 @@ std::vector<std::shared_ptr<Mesh>> MeshImporter::ImportMesh(const aiScene& scene
 			indices[j * 3 + 2] = fbx_mesh->mFaces[j].mIndices[2];
 		}
 
-		std::vector<glm::vec3> all_vertices;
-		for (unsigned int j = 0; j < fbx_mesh->mNumVertices; j++) {
-			all_vertices.push_back(glm::vec3(fbx_mesh->mVertices[j].x, fbx_mesh->mVertices[j].y, fbx_mesh->mVertices[j].z));
-		}
+		std::vector<glm::vec3> all_vertices(fbx_mesh->mNumVertices);
+		MeshIngest::copyVec3(fbx_mesh->mVertices, all_vertices.data(), all_vertices.size());
 
-		mesh_ptr->load(all_vertices.data(), all_vertices.size(), indices.data(), indices.size());
+		mesh_ptr->load(std::move(all_vertices), std::move(indices));
+		mesh_ptr->buildMeshlets();
 		if (fbx_mesh->HasTextureCoords(0)) {
 			vector<glm::vec2> texCoords(fbx_mesh->mNumVertices);
-			for (unsigned int j = 0; j < fbx_mesh->mNumVertices; ++j) texCoords[j] = glm::vec2(fbx_mesh->mTextureCoords[0][j].x, fbx_mesh->mTextureCoords[0][j].y);
-			mesh_ptr->loadTexCoords(texCoords.data(), texCoords.size());
+			MeshIngest::copyTexCoords(fbx_mesh->mTextureCoords[0], texCoords.data(), texCoords.size(), false);
+			mesh_ptr->loadTexCoords(std::move(texCoords));
 		}
 		if (fbx_mesh->HasNormals()) mesh_ptr->loadNormals(reinterpret_cast<glm::vec3*>(fbx_mesh->mNormals), fbx_mesh->mNumVertices);
 		if (fbx_mesh->HasVertexColors(0)) {
 			vector<glm::u8vec3> colors(fbx_mesh->mNumVertices);
-			for (unsigned int j = 0; j < fbx_mesh->mNumVertices; ++j) colors[j] = glm::u8vec3(fbx_mesh->mColors[0][j].r * 255, fbx_mesh->mColors[0][j].g * 255, fbx_mesh->mColors[0][j].b * 255);
-			mesh_ptr->loadColors(colors.data(), colors.size());
+			MeshIngest::packColors(fbx_mesh->mColors[0], colors.data(), colors.size());
+			mesh_ptr->loadColors(std::move(colors));
 		}
 		
 		meshes.push_back(mesh_ptr);
@@ -76,27 +83,106 @@ std::vector<std::shared_ptr<Mesh>> MeshImporter::ImportMesh(const aiScene& scene
 	return meshes;
 }
 
-std::vector<std::shared_ptr<Material>> MeshImporter::createMaterialsFromFBX(const aiScene& scene, const fs::path& basePath) {
+std::vector<std::shared_ptr<Material>> MeshImporter::createMaterialsFromFBX(const aiScene& scene, const fs::path& basePath, const vector<shared_ptr<Mesh>>& meshes, bool remapTexCoords) {
 
 	std::vector<std::shared_ptr<Material>> materials;
 	map<string, std::shared_ptr<Image>> images;
 
+	// Diffuse texture of every material ("" when it has none) and the distinct paths among them
+	vector<string> materialPaths(scene.mNumMaterials);
+	vector<string> texturePaths;
+	for (unsigned int i = 0; i < scene.mNumMaterials; ++i) {
+		if (scene.mMaterials[i]->GetTextureCount(aiTextureType_DIFFUSE) == 0) continue;
+		aiString texturePath;
+		scene.mMaterials[i]->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath);
+		materialPaths[i] = removeLastPartOfPath(basePath.string()) + fs::path(texturePath.C_Str()).filename().string();
+		if (std::find(texturePaths.begin(), texturePaths.end(), materialPaths[i]) == texturePaths.end()) texturePaths.push_back(materialPaths[i]);
+	}
+
+	// Small textures whose meshes never wrap their UVs share atlas pages; the rest keep their own texture
+	map<string, TextureAtlas::Placement> atlased;
+	vector<shared_ptr<Image>> pages;
+	if (useAtlas) {
+		vector<ImageDecoder::Job> jobs;
+		for (const auto& path : texturePaths) {
+			vector<unsigned char> encoded;
+			ImageDecoder::Info info;
+			if (!ImageDecoder::isSupported(path) || !ImageDecoder::readFile(path, encoded) || !ImageDecoder::probe(encoded.data(), encoded.size(), info)) continue;
+			if (!TextureAtlas::fitsSettings({ info.width, info.height, info.channels, encoded.data() }, atlasSettings)) continue;
+
+			bool unitUVs = true;
+			for (unsigned int m = 0; m < scene.mNumMeshes && m < meshes.size() && unitUVs; ++m) {
+				if (materialPaths[scene.mMeshes[m]->mMaterialIndex] != path) continue;
+				const auto& uvs = meshes[m]->texCoords();
+				unitUVs = TextureAtlas::fitsUnitSquare(uvs.data(), uvs.size());
+			}
+			if (unitUVs) jobs.emplace_back(path);
+		}
+		ImageDecoder::decodeFiles(jobs);
+
+		vector<TextureAtlas::Source> sources;
+		for (const auto& job : jobs) {
+			sources.push_back({ job.info.width, job.info.height, job.info.channels, job.ok ? job.pixels.data() : nullptr });
+		}
+		auto atlas = TextureAtlas::build(sources, atlasSettings);
+
+		for (size_t p = 0; p < atlas.pages.size(); ++p) {
+			const auto& page = atlas.pages[p];
+			const string name = basePath.filename().string() + " atlas " + std::to_string(p);
+			pages.push_back(TextureImporter::UploadTexture(textureImporter.CookPixels(name, page.pixels.data(), page.width, page.height, page.channels, page.mipLevels)));
+
+			size_t count = 0;
+			for (const auto& placement : atlas.placements) count += placement.packed && placement.page == p;
+			LOG_INFO(Log::Assets, "%s: %ux%u, %zu textures, %.1f%% occupied", name.c_str(), page.width, page.height, count, page.occupancy() * 100.0);
+		}
+		for (size_t j = 0; j < jobs.size(); ++j) {
+			if (atlas.placements[j].packed) atlased.emplace(jobs[j].path, atlas.placements[j]);
+		}
+
+		if (remapTexCoords) {
+			for (unsigned int m = 0; m < scene.mNumMeshes && m < meshes.size(); ++m) {
+				const auto atlas_itr = atlased.find(materialPaths[scene.mMeshes[m]->mMaterialIndex]);
+				if (atlas_itr == atlased.end()) continue;
+				auto uvs = meshes[m]->texCoords();
+				TextureAtlas::remapTexCoords(uvs.data(), uvs.size(), atlas_itr->second.uvScaleOffset);
+				meshes[m]->loadTexCoords(std::move(uvs));
+			}
+		}
+	}
+
+	// Decode and cook every other distinct diffuse texture in parallel up front; only the GL uploads below stay serial.
+	// Textures another model already has in the cache are not cooked again.
+	auto& cache = TextureCache::getInstance();
+	texturePaths.erase(std::remove_if(texturePaths.begin(), texturePaths.end(), [&atlased, &cache](const string& path) {
+		return atlased.count(path) > 0 || cache.find(path, TextureCache::Cooked);
+	}), texturePaths.end());
+	map<string, TextureImporter::CookedTexture> cooked;
+	auto cookedTextures = textureImporter.CookTextures(texturePaths);
+	for (auto& texture : cookedTextures) cooked.emplace(texture.path, std::move(texture));
+
 	for (unsigned int i = 0; i < scene.mNumMaterials; ++i) {
 		const auto* fbx_material = scene.mMaterials[i];
 		auto material = make_shared<Material>();
 
 		if (fbx_material->GetTextureCount(aiTextureType_DIFFUSE) > 0) {
-			aiString texturePath;
-			fbx_material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath);
-			const string textureFileName = fs::path(texturePath.C_Str()).filename().string();
-			const auto image_itr = images.find(textureFileName);
-			if (image_itr != images.end()) material->texture.setImage(image_itr->second);
+			const std::string& imagePath = materialPaths[i];
+			const auto atlas_itr = atlased.find(imagePath);
+			const auto image_itr = images.find(imagePath);
+			if (atlas_itr != atlased.end()) {
+				material->texture.setImage(pages[atlas_itr->second.page]);
+				material->texture.wrapMode = Texture::Clamp;
+			}
+			else if (image_itr != images.end()) material->texture.setImage(image_itr->second);
 			else {
-				std::string imagePath = removeLastPartOfPath(basePath.string()) + textureFileName;
-				auto image = std::make_shared<Image>();
-				image = textureImporter.ImportTexture(imagePath);
+				// Shared with every other model and material using the same file contents
+				auto image = cache.image(imagePath, TextureCache::Cooked, [this, &cooked](const std::string& path) {
+					const auto cooked_itr = cooked.find(path);
+					if (cooked_itr == cooked.end()) return textureImporter.ImportTexture(path);
+					return TextureImporter::UploadTexture(std::move(cooked_itr->second));
+				});
 				FileManager fileManager;
 				fileManager.ImportTexture(imagePath.c_str());
+				images[imagePath] = image;
 				material->texture.setImage(image);
 			}
 
@@ -182,8 +268,9 @@ GameObject MeshImporter::gameObjectFromNode(const aiScene& scene, const aiNode&
 
 // SaveMeshToFile function
 // SaveMeshToFile function
-void MeshImporter::SaveMeshToFile(const std::vector<std::shared_ptr<Mesh>>& meshes, const std::string& filePath, const std::string& fbxPath)
+std::vector<std::streamoff> MeshImporter::SaveMeshToFile(const std::vector<std::shared_ptr<Mesh>>& meshes, const std::string& filePath, const std::string& fbxPath)
 {
+	PROFILE_SCOPE("MeshImporter::SaveMeshToFile");
 	std::ofstream os(filePath, std::ios::binary);
 	if (!os.is_open()) {
 		throw std::runtime_error("Failed to open file for writing: " + filePath);
@@ -194,8 +281,12 @@ void MeshImporter::SaveMeshToFile(const std::vector<std::shared_ptr<Mesh>>& mesh
 	os.write(reinterpret_cast<const char*>(&fbxPathSize), sizeof(fbxPathSize));
 	os.write(fbxPath.c_str(), fbxPathSize);
 
+	std::vector<std::streamoff> offsets;
 	for (const auto& mesh : meshes) {
+		offsets.push_back(os.tellp());
 		MeshDTO dto(mesh);
+		// Arrays read back just for this are dropped again
+		mesh->trimCpuData();
 
 		// Save vertices
 		size_t vertexCount = dto.vertices.size();
@@ -229,15 +320,106 @@ void MeshImporter::SaveMeshToFile(const std::vector<std::shared_ptr<Mesh>>& mesh
 		os.write(reinterpret_cast<const char*>(&dto.boundingBoxMin), sizeof(glm::vec3));
 		os.write(reinterpret_cast<const char*>(&dto.boundingBoxMax), sizeof(glm::vec3));
 
+		// Save meshlets
+		size_t meshletCount = dto.meshlets.size();
+		os.write(reinterpret_cast<const char*>(&meshletCount), sizeof(meshletCount));
+		os.write(reinterpret_cast<const char*>(dto.meshlets.data()), meshletCount * sizeof(Meshlet));
+
+		os.write("Mlet", 4);
+
 		os.write("Mesh", 4);
 	}
 
 	os.close();
+	return offsets;
+}
+
+// Reads one mesh record written by SaveMeshToFile. Returns false at end of file or on a short read.
+bool MeshImporter::ReadCookedMesh(std::istream& is, MeshDTO& dto)
+{
+	// Load vertices
+	size_t vertexCount;
+	if (!is.read(reinterpret_cast<char*>(&vertexCount), sizeof(vertexCount))) return false;
+	dto.vertices.resize(vertexCount);
+	is.read(reinterpret_cast<char*>(dto.vertices.data()), vertexCount * sizeof(glm::vec3));
+
+	char vertex[4];
+	is.read(vertex, 4);
+
+	// Load indices
+	size_t indexCount;
+	is.read(reinterpret_cast<char*>(&indexCount), sizeof(indexCount));
+	dto.indices.resize(indexCount);
+	is.read(reinterpret_cast<char*>(dto.indices.data()), indexCount * sizeof(unsigned int));
+
+	char index[4];
+	is.read(index, 4);
+
+	// Load texture coordinates
+	size_t texCoordCount;
+	is.read(reinterpret_cast<char*>(&texCoordCount), sizeof(texCoordCount));
+	dto.texCoords.resize(texCoordCount);
+	is.read(reinterpret_cast<char*>(dto.texCoords.data()), texCoordCount * sizeof(glm::vec2));
+
+	char texCoord[4];
+	is.read(texCoord, 4);
+
+	// Load colors
+	size_t colorCount;
+	is.read(reinterpret_cast<char*>(&colorCount), sizeof(colorCount));
+	dto.colors.resize(colorCount);
+	is.read(reinterpret_cast<char*>(dto.colors.data()), colorCount * sizeof(glm::u8vec3));
+
+	char color[4];
+	is.read(color, 4);
+
+	// Load bounding box
+	is.read(reinterpret_cast<char*>(&dto.boundingBoxMin), sizeof(glm::vec3));
+	is.read(reinterpret_cast<char*>(&dto.boundingBoxMax), sizeof(glm::vec3));
+
+	// Files cooked before meshlets existed go straight to the "Mesh" tag
+	char buffer[4];
+	is.read(buffer, 4);
+	if (is && std::memcmp(buffer, "Mesh", 4) != 0) {
+		is.seekg(-4, std::ios::cur);
+
+		// Load meshlets
+		size_t meshletCount;
+		is.read(reinterpret_cast<char*>(&meshletCount), sizeof(meshletCount));
+		dto.meshlets.resize(meshletCount);
+		is.read(reinterpret_cast<char*>(dto.meshlets.data()), meshletCount * sizeof(Meshlet));
+
+		char meshlet[4];
+		is.read(meshlet, 4);
+
+		is.read(buffer, 4);
+	}
+	return static_cast<bool>(is);
+}
+
+// Re-reads the mesh whose record starts at offset in a cooked .mesh file, for meshes using MeshResidency::ReloadOnDemand
+// The file may have been re-cooked since; Mesh refuses a record that is not the one it loaded
+MeshReloader MeshImporter::CookedMeshReloader(const std::string& filePath, std::streamoff offset)
+{
+	return [filePath, offset](MeshCpuData& data) {
+		std::ifstream is(filePath, std::ios::binary);
+		if (!is.is_open() || !is.seekg(offset)) return false;
+
+		MeshDTO dto;
+		if (!ReadCookedMesh(is, dto)) return false;
+
+		data.vertices = std::move(dto.vertices);
+		data.indices = std::move(dto.indices);
+		data.texCoords = std::move(dto.texCoords);
+		data.colors = std::move(dto.colors);
+		return true;
+	};
 }
 
 // LoadMeshFromFile function
 std::vector<std::shared_ptr<Mesh>> MeshImporter::LoadMeshFromFile(const std::string& filePath, std::string& fbxPath)
 {
+	PROFILE_SCOPE("MeshImporter::LoadMeshFromFile");
 	std::ifstream is(filePath, std::ios::binary);
 	if (!is.is_open()) {
 		throw std::runtime_error("Failed to open file for reading: " + filePath);
@@ -251,61 +433,29 @@ std::vector<std::shared_ptr<Mesh>> MeshImporter::LoadMeshFromFile(const std::str
 
 	std::vector<std::shared_ptr<Mesh>> meshes;
 	while (is.peek() != EOF) {
+		const std::streamoff offset = is.tellg();
 		MeshDTO dto;
-
-		// Load vertices
-		size_t vertexCount;
-		is.read(reinterpret_cast<char*>(&vertexCount), sizeof(vertexCount));
-		dto.vertices.resize(vertexCount);
-		is.read(reinterpret_cast<char*>(dto.vertices.data()), vertexCount * sizeof(glm::vec3));
-
-		char vertex[4];
-		is.read(vertex, 4);
-
-		// Load indices
-		size_t indexCount;
-		is.read(reinterpret_cast<char*>(&indexCount), sizeof(indexCount));
-		dto.indices.resize(indexCount);
-		is.read(reinterpret_cast<char*>(dto.indices.data()), indexCount * sizeof(unsigned int));
-
-		char index[4];
-		is.read(index, 4);
-
-		// Load texture coordinates
-		size_t texCoordCount;
-		is.read(reinterpret_cast<char*>(&texCoordCount), sizeof(texCoordCount));
-		dto.texCoords.resize(texCoordCount);
-		is.read(reinterpret_cast<char*>(dto.texCoords.data()), texCoordCount * sizeof(glm::vec2));
-
-		char texCoord[4];
-		is.read(texCoord, 4);
-
-		// Load colors
-		size_t colorCount;
-		is.read(reinterpret_cast<char*>(&colorCount), sizeof(colorCount));
-		dto.colors.resize(colorCount);
-		is.read(reinterpret_cast<char*>(dto.colors.data()), colorCount * sizeof(glm::u8vec3));
-
-		char color[4];
-		is.read(color, 4);
-
-		// Load bounding box
-		is.read(reinterpret_cast<char*>(&dto.boundingBoxMin), sizeof(glm::vec3));
-		is.read(reinterpret_cast<char*>(&dto.boundingBoxMax), sizeof(glm::vec3));
+		if (!ReadCookedMesh(is, dto)) break;
 
 		auto mesh = std::make_shared<Mesh>();
-		mesh->load(dto.vertices.data(), dto.vertices.size(), dto.indices.data(), dto.indices.size());
+		mesh->load(std::move(dto.vertices), std::move(dto.indices));
 		if (!dto.texCoords.empty()) {
-			mesh->loadTexCoords(dto.texCoords.data(), dto.texCoords.size());
+			mesh->loadTexCoords(std::move(dto.texCoords));
 		}
 		if (!dto.colors.empty()) {
-			mesh->loadColors(dto.colors.data(), dto.colors.size());
+			mesh->loadColors(std::move(dto.colors));
+		}
+		if (!dto.meshlets.empty()) {
+			mesh->setMeshlets(std::move(dto.meshlets));
+		}
+		else {
+			mesh->buildMeshlets();
 		}
 
+		// The cooked file stays on disk, so the CPU copy can be dropped and read back when needed
+		mesh->setResidency(MeshResidency::ReloadOnDemand, CookedMeshReloader(filePath, offset));
 
 		meshes.push_back(mesh);
-		char buffer[4];
-		is.read(buffer, 4);
 	}
 	is.close();
 	return meshes;
@@ -412,12 +562,12 @@ std::istream& operator>>(std::istream& is, std::vector<std::shared_ptr<Mesh>>& m
 		is.read(reinterpret_cast<char*>(colors.data()), colorsSize * sizeof(glm::u8vec3));
 
 		// Load the mesh data
-		mesh->load(vertices.data(), vertices.size(), indices.data(), indices.size());
+		mesh->load(std::move(vertices), std::move(indices));
 		if (!texCoords.empty()) {
-			mesh->loadTexCoords(texCoords.data(), texCoords.size());
+			mesh->loadTexCoords(std::move(texCoords));
 		}
 		if (!colors.empty()) {
-			mesh->loadColors(colors.data(), colors.size());
+			mesh->loadColors(std::move(colors));
 		}
 
 		// Deserialize bounding box
@@ -490,7 +640,7 @@ GameObject MeshImporter::loadCustomFormat(const std::string& inputPath) {
 	}
 
 	auto mesh = std::make_shared<Mesh>();
-	mesh->load(vertices.data(), vertices.size(), indices.data(), indices.size());
+	mesh->load(std::move(vertices), std::move(indices));
 
 	GameObject go;
 	go.setMesh(mesh);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Engine/Mesh.h"
+#include "../Engine/TextureAtlas.h"
 #include <vector>
 #include <fstream>
 #include <glm/glm.hpp>
@@ -18,6 +19,8 @@
 using namespace std;
 namespace fs = std::filesystem;
 
+struct MeshDTO;
+
 class MeshImporter
 {
     TextureImporter textureImporter;
@@ -25,16 +28,23 @@ class MeshImporter
 
 public:
     std::vector<std::shared_ptr<GameObject>> meshGameObjects;
+    bool useAtlas = true;
+    TextureAtlas::Settings atlasSettings;
 	vec3 _translation;
 	vec3 _scale;
     glm::quat _rotation;
     
     std::vector<std::shared_ptr<Mesh>> ImportMesh(const aiScene& scene);
-	std::vector<std::shared_ptr<Material>> createMaterialsFromFBX(const aiScene& scene, const std::filesystem::path& basePath);
+    // Packs small textures into atlas pages and, with remapTexCoords, moves the meshes' UVs onto them. Meshes loaded
+    // back from a cooked .mesh already carry atlas UVs, so they pass false; packing is deterministic and lines up again.
+	std::vector<std::shared_ptr<Material>> createMaterialsFromFBX(const aiScene& scene, const std::filesystem::path& basePath, const vector<shared_ptr<Mesh>>& meshes, bool remapTexCoords);
     GameObject gameObjectFromNode(const aiScene& scene, const aiNode& node, const vector<shared_ptr<Mesh>>& meshes, const vector<shared_ptr<Material>>& materials);
 
-    void SaveMeshToFile(const std::vector<std::shared_ptr<Mesh>>& gameObjects, const std::string& filePath, const std::string& fbxPath);
+    // Returns where each mesh's record starts in the file, for CookedMeshReloader
+    std::vector<std::streamoff> SaveMeshToFile(const std::vector<std::shared_ptr<Mesh>>& gameObjects, const std::string& filePath, const std::string& fbxPath);
     std::vector<std::shared_ptr<Mesh>> LoadMeshFromFile(const std::string& filePath, std::string& fbxPath);
+    static bool ReadCookedMesh(std::istream& is, MeshDTO& dto);
+    static MeshReloader CookedMeshReloader(const std::string& filePath, std::streamoff offset);
 	std::string GetFBXPath(const std::string& filePath);
     static void saveAsCustomFormat(const GameObject& gameObject, const std::string& outputPath);
     static GameObject loadCustomFormat(const std::string& path);
@@ -53,6 +63,7 @@ struct MeshDTO {
     std::vector<glm::u8vec3> colors;
     glm::vec3 boundingBoxMin;
     glm::vec3 boundingBoxMax;
+    std::vector<Meshlet> meshlets;
 
     MeshDTO() = default;
 
@@ -65,6 +76,7 @@ struct MeshDTO {
         auto boundingBox = mesh->boundingBox();
         boundingBoxMin = boundingBox.min;
         boundingBoxMax = boundingBox.max;
+        meshlets = mesh->meshlets();
     }
 };
 
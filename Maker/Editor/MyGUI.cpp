@@ -15,7 +15,16 @@
 #include "Engine/GameObject.h"
 #include "SceneSerializator.h"
 #include "Engine/Camera.h"
+#include "Engine/TextureCache.h"
+#include "Engine/TextureStreamer.h"
+#include "Engine/StaticBatcher.h"
+#include "Engine/DebugDraw.h"
+#include "Engine/GeometryArena.h"
+#include "Engine/CachingRenderDevice.h"
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdlib>
 
 
 inline float sanitizeZero(float value, float epsilon = 1e-6f) {
@@ -37,8 +46,27 @@ std::string formatFloat(float value) {
     return str;
 }
 
+// ImGui's allocations, charged to MemoryTag::GUI; the size sits in a header in front of each block
+static constexpr size_t kGuiHeader = alignof(std::max_align_t);
+
+static void* guiAlloc(size_t size, void*) {
+    auto* block = static_cast<unsigned char*>(std::malloc(size + kGuiHeader));
+    if (!block) return nullptr;
+    *reinterpret_cast<size_t*>(block) = size;
+    MemoryTracker::getInstance().allocate(MemoryTag::GUI, size);
+    return block + kGuiHeader;
+}
+
+static void guiFree(void* ptr, void*) {
+    if (!ptr) return;
+    auto* block = static_cast<unsigned char*>(ptr) - kGuiHeader;
+    MemoryTracker::getInstance().release(MemoryTag::GUI, *reinterpret_cast<size_t*>(block));
+    std::free(block);
+}
+
 MyGUI::MyGUI(SDL_Window* window, void* context) {
     IMGUI_CHECKVERSION();
+    ImGui::SetAllocatorFunctions(guiAlloc, guiFree);
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
@@ -59,12 +87,160 @@ FileManager fileManager;
 GameObject* selectedGameObject = nullptr; // Define selectedGameObject
 
 
+static ImVec4 consoleColor(Log::Level level) {
+    switch (level) {
+    case Log::Trace:
+    case Log::Debug: return ImVec4(0.6f, 0.6f, 0.6f, 1.0f);
+    case Log::Warning: return ImVec4(1.0f, 0.8f, 0.3f, 1.0f);
+    case Log::Error: return ImVec4(1.0f, 0.4f, 0.4f, 1.0f);
+    default: return ImGui::GetStyleColorVec4(ImGuiCol_Text);
+    }
+}
+
 void MyGUI::renderConsoleWindow() {
     ImGui::SetNextWindowSize(ImVec2(480, 200), ImGuiCond_Appearing);
     ImGui::SetNextWindowPos(ImVec2(300, 450), ImGuiCond_Appearing);
     if (ImGui::Begin("Console", NULL)) {
-        for (const auto& message : Log::getInstance().logMessages) {
-            ImGui::TextUnformatted(message.c_str());
+        auto& log = Log::getInstance();
+        bool refilter = false;
+        ImGui::SetNextItemWidth(100);
+        if (ImGui::BeginCombo("Level", Log::levelName(static_cast<Log::Level>(consoleLevel)))) {
+            for (int level = 0; level < Log::LevelCount; ++level) {
+                if (ImGui::Selectable(Log::levelName(static_cast<Log::Level>(level)), level == consoleLevel)) {
+                    consoleLevel = level;
+                    refilter = true;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(100);
+        if (ImGui::BeginCombo("Category", consoleCategory < 0 ? "All" : Log::categoryName(static_cast<Log::Category>(consoleCategory)))) {
+            for (int category = -1; category < Log::CategoryCount; ++category) {
+                const char* name = category < 0 ? "All" : Log::categoryName(static_cast<Log::Category>(category));
+                if (ImGui::Selectable(name, category == consoleCategory)) {
+                    consoleCategory = category;
+                    refilter = true;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Clear")) log.clear();
+        ImGui::SameLine();
+        ImGui::Checkbox("Auto-scroll", &consoleAutoScroll);
+        if (log.dropped()) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("%zu dropped", log.dropped());
+        }
+        ImGui::Separator();
+
+        // Unfiltered, rows map straight onto the history; filtered, onto the matching lines, extended as more arrive
+        const bool filtered = consoleLevel > Log::Trace || consoleCategory >= 0;
+        const size_t first = log.firstLine();
+        if (filtered) {
+            if (refilter) {
+                consoleLines.clear();
+                consoleScanned = 0;
+            }
+            consoleScanned = log.match(consoleScanned, static_cast<Log::Level>(consoleLevel), consoleCategory, consoleLines);
+            consoleLines.erase(consoleLines.begin(), std::lower_bound(consoleLines.begin(), consoleLines.end(), first));
+        }
+        const size_t count = filtered ? consoleLines.size() : log.endLine() - first;
+
+        ImGui::BeginChild("Lines", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(count));
+        while (clipper.Step()) {
+            const size_t begin = clipper.DisplayStart;
+            const size_t rows = clipper.DisplayEnd - clipper.DisplayStart;
+            if (filtered) log.lines(consoleLines.data() + begin, rows, consoleVisible);
+            else log.lines(first + begin, rows, consoleVisible);
+            for (const auto& line : consoleVisible) {
+                ImGui::PushStyleColor(ImGuiCol_Text, consoleColor(line.level));
+                ImGui::Text("[%9.3f] %-7s %s", line.time / 1e9, Log::categoryName(line.category), line.text.c_str());
+                ImGui::PopStyleColor();
+            }
+        }
+        clipper.End();
+        if (consoleAutoScroll && ImGui::GetScrollY() >= ImGui::GetScrollMaxY()) ImGui::SetScrollHereY(1.0f);
+        ImGui::EndChild();
+    }
+    ImGui::End();
+}
+
+// Stable colour per scope name, so the same marker looks the same in every frame
+static ImU32 profileColor(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; c && *c; ++c) hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+    return IM_COL32(90 + hash % 140, 90 + (hash >> 8) % 140, 90 + (hash >> 16) % 140, 255);
+}
+
+void MyGUI::renderProfilerWindow() {
+    ImGui::SetNextWindowSize(ImVec2(720, 260), ImGuiCond_Appearing);
+    ImGui::SetNextWindowPos(ImVec2(300, 660), ImGuiCond_Appearing);
+    if (ImGui::Begin("Profiler", NULL)) {
+        auto& profiler = Profiler::getInstance();
+        bool recording = profiler.enabled;
+        if (ImGui::Checkbox("Record", &recording)) profiler.enabled = recording;
+        ImGui::SameLine();
+        ImGui::Checkbox("Pause view", &profilePaused);
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(120);
+        ImGui::SliderInt("Frames", &profileFrames, 1, 60);
+        ImGui::SameLine();
+        if (ImGui::Button("Export Chrome trace")) {
+            const bool written = profiler.exportChromeTrace("profile.json", profileFrames);
+            if (written) LOG_INFO(Log::Editor, "Profile written to profile.json");
+            else LOG_ERROR(Log::Editor, "Could not write profile.json");
+        }
+        if (!profilePaused) profileCapture = profiler.capture(profileFrames);
+
+        const auto& capture = profileCapture;
+        const double span = static_cast<double>(capture.end() - capture.begin());
+        if (capture.frames.size() < 2 || span <= 0) {
+            ImGui::TextUnformatted("No complete frames recorded yet");
+        }
+        else {
+            ImGui::Text("%.2f ms over %zu frames, %zu events lost to wrap-around", span / 1e6, capture.frames.size() - 1, capture.dropped);
+
+            // One lane per thread, one row per nesting depth; frame boundaries as vertical lines
+            ImDrawList* drawList = ImGui::GetWindowDrawList();
+            const float rowHeight = ImGui::GetTextLineHeight() + 2;
+            const float width = ImGui::GetContentRegionAvail().x;
+            for (const auto& track : capture.tracks) {
+                uint32_t depth = 0;
+                for (const auto& event : track.events) depth = std::max(depth, event.depth);
+                ImGui::TextUnformatted(track.name.c_str());
+                const ImVec2 origin = ImGui::GetCursorScreenPos();
+                const float height = (depth + 1) * rowHeight;
+                ImGui::PushID(static_cast<int>(track.thread));
+                ImGui::InvisibleButton("lane", ImVec2(std::max(width, 1.0f), height));
+                ImGui::PopID();
+                auto toX = [&](int64_t time) {
+                    const int64_t clamped = std::clamp(time, capture.begin(), capture.end());
+                    return origin.x + static_cast<float>((clamped - capture.begin()) / span) * width;
+                };
+
+                drawList->PushClipRect(origin, ImVec2(origin.x + width, origin.y + height), true);
+                for (int64_t frame : capture.frames) {
+                    drawList->AddLine(ImVec2(toX(frame), origin.y), ImVec2(toX(frame), origin.y + height), IM_COL32(255, 255, 255, 60));
+                }
+                for (const auto& event : track.events) {
+                    const float x0 = toX(event.start);
+                    const float x1 = std::max(toX(event.end), x0 + 1.0f);
+                    const ImVec2 min(x0, origin.y + event.depth * rowHeight);
+                    const ImVec2 max(x1, min.y + rowHeight - 1);
+                    drawList->AddRectFilled(min, max, profileColor(event.name));
+                    if (x1 - x0 > ImGui::CalcTextSize(event.name).x + 4) {
+                        drawList->AddText(ImVec2(x0 + 2, min.y + 1), IM_COL32(0, 0, 0, 255), event.name);
+                    }
+                    if (ImGui::IsMouseHoveringRect(min, max)) {
+                        ImGui::SetTooltip("%s\n%.3f ms", event.name, (event.end - event.start) / 1e6);
+                    }
+                }
+                drawList->PopClipRect();
+            }
         }
     }
     ImGui::End();
@@ -83,10 +259,55 @@ void MyGUI::renderConfigurationWindow() {
         fpsValues[fpsValuesOffset] = fps;
         fpsValuesOffset = (fpsValuesOffset + 1) % IM_ARRAYSIZE(fpsValues);
         ImGui::PlotLines("FPS", fpsValues, IM_ARRAYSIZE(fpsValues), fpsValuesOffset, "Frames Per Second", 0.0f, 120.0f, ImVec2(0, 80));
+        ImGui::Text("Frame time: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms", frameStats.p50, frameStats.p95, frameStats.p99, frameStats.max);
+        ImGui::Text("Busy: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms; %zu simulation steps dropped", frameStats.workP50, frameStats.workP95, frameStats.workP99, frameStats.droppedSteps);
 
         // Configuration for modules
         if (ImGui::CollapsingHeader("Renderer")) {
             // Add renderer configuration options here
+            ImGui::Text("Queued draws: %zu", renderStats.items);
+            ImGui::Text("Draw calls: %zu", renderStats.drawCalls);
+            ImGui::Text("Texture / mesh binds: %zu / %zu", renderStats.textureBinds, renderStats.meshBinds);
+            ImGui::Text("State changes: %zu", renderStats.stateChanges);
+            ImGui::Text("Redundant binds skipped: %zu", renderStats.skippedBinds);
+            ImGui::Text("Instanced draws: %zu (%zu instances)", renderStats.instancedDraws, renderStats.instances);
+            const auto& debugStats = DebugDraw::getInstance().stats();
+            ImGui::Text("Debug lines: %zu per frame, %zu cached, %zu draws", debugStats.frameLines, debugStats.cachedLines, debugStats.drawCalls);
+
+            const auto& batcher = StaticBatcher::getInstance();
+            ImGui::Separator();
+            ImGui::Text("Static batches: %zu (%zu objects, %zu from cache)", batcher.stats().batches, batcher.stats().objects, batcher.stats().cacheHits);
+            ImGui::Text("Last build: %.1f ms", batcher.stats().seconds * 1000.0);
+            if (ImGui::Button("Rebuild static batches")) {
+                StaticBatcher::getInstance().build(scene);
+            }
+
+            auto& arena = GeometryArena::getInstance();
+            const auto arenaStats = arena.stats();
+            ImGui::Separator();
+            ImGui::Text("Geometry arena: %.1f MB on the GPU, %zu grows, %zu compactions", arenaStats.gpuBytes / (1024.0 * 1024.0), arenaStats.grows, arenaStats.compactions);
+            ImGui::Text("Vertices: %zu / %zu in %zu meshes, %zu free blocks (%.0f%% fragmented)", arenaStats.vertices.used, arenaStats.vertices.capacity,
+                arenaStats.vertices.allocations, arenaStats.vertices.freeBlocks, arenaStats.vertices.fragmentation() * 100.0);
+            ImGui::Text("Indices: %zu / %zu, %zu free blocks (%.0f%% fragmented)", arenaStats.indices.used, arenaStats.indices.capacity,
+                arenaStats.indices.freeBlocks, arenaStats.indices.fragmentation() * 100.0);
+            if (ImGui::Button("Defragment geometry")) {
+                arena.defragment();
+            }
+
+            if (auto* cache = dynamic_cast<CachingRenderDevice*>(&RenderDevice::getInstance())) {
+                const auto& cacheStats = cache->lastFrame();
+                ImGui::Separator();
+                ImGui::Checkbox("Filter redundant GL state", &cache->enabled);
+                ImGui::Text("State calls: %zu issued, %zu skipped", cacheStats.totalIssued(), cacheStats.totalSkipped());
+                ImGui::Text("Draw calls: %zu, %zu triangles", cacheStats.drawCalls, cacheStats.triangles);
+                if (ImGui::TreeNode("Per kind")) {
+                    for (int kind = 0; kind < CachingRenderDevice::KindCount; ++kind) {
+                        ImGui::Text("%s: %zu / %zu", CachingRenderDevice::kindName(static_cast<CachingRenderDevice::Kind>(kind)),
+                            cacheStats.issued[kind], cacheStats.skipped[kind]);
+                    }
+                    ImGui::TreePop();
+                }
+            }
         }
         if (ImGui::CollapsingHeader("Window")) {
             // Add window configuration options here
@@ -95,13 +316,83 @@ void MyGUI::renderConfigurationWindow() {
             // Add input configuration options here
         }
         if (ImGui::CollapsingHeader("Textures")) {
-            // Add texture configuration options here
+            const auto& cache = TextureCache::getInstance();
+            ImGui::Text("Cached images: %zu", cache.residentImages());
+            ImGui::Text("Resident: %.2f MB", cache.residentBytes() / (1024.0 * 1024.0));
+            ImGui::Text("Hits / misses: %zu / %zu", cache.hits(), cache.misses());
+
+            auto& streamer = TextureStreamer::getInstance();
+            ImGui::Separator();
+            ImGui::Text("Streamed: %zu textures", streamer.textureCount());
+            ImGui::Text("Resident / requested: %.2f / %.2f MB", streamer.residentBytes() / (1024.0 * 1024.0), streamer.requestedBytes() / (1024.0 * 1024.0));
+            int budgetMB = static_cast<int>(streamer.settings.budgetBytes >> 20);
+            if (ImGui::SliderInt("Budget (MB)", &budgetMB, 16, 2048)) streamer.settings.budgetBytes = size_t(budgetMB) << 20;
+            if (ImGui::TreeNode("Per texture")) {
+                for (const auto& texture : streamer.stats()) {
+                    ImGui::Text("%ux%u  mip %u/%u (wants %u)  %.1f / %.1f KB%s", texture.width, texture.height,
+                        texture.residentLevel, texture.levelCount, texture.requestedLevel,
+                        texture.residentBytes / 1024.0, texture.requestedBytes / 1024.0, texture.streaming ? "  loading" : "");
+                }
+                ImGui::TreePop();
+            }
+        }
+
+        // Counters are cheap, the process figures are not: sample both twice a second while this window is open
+        if (memorySampledAt < 0 || ImGui::GetTime() - memorySampledAt > 0.5) {
+            memorySnapshot = MemoryTracker::getInstance().snapshot();
+            memorySampledAt = ImGui::GetTime();
+        }
+
+        if (ImGui::CollapsingHeader("Memory")) {
+            const auto& process = memorySnapshot.process;
+            const double MB = 1024.0 * 1024.0;
+            if (process.valid) {
+                ImGui::Text("Resident: %.2f MB (peak %.2f MB), private %.2f MB", process.resident / MB, process.peakResident / MB, process.privateBytes / MB);
+                const size_t tracked = memorySnapshot.cpuBytes();
+                ImGui::Text("Tracked: %.2f MB, untracked %.2f MB", tracked / MB, process.resident > tracked ? (process.resident - tracked) / MB : 0.0);
+            }
+            else {
+                ImGui::Text("Tracked: %.2f MB (no process figures on this platform)", memorySnapshot.cpuBytes() / MB);
+            }
+            auto showUsage = [MB](const char* name, const MemoryTracker::Usage& usage) {
+                const ImVec4 color = usage.overBudget() ? ImVec4(1.0f, 0.4f, 0.4f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+                ImGui::TextColored(color, "%s: %.2f MB (peak %.2f MB), %zu live / %zu allocations%s", name, usage.bytes / MB,
+                    usage.peak / MB, usage.live, usage.allocations, usage.overBudget() ? ", over budget" : "");
+            };
+            for (size_t tag = 0; tag < MemoryTracker::kTags; ++tag) {
+                showUsage(MemoryTracker::tagName(static_cast<MemoryTag>(tag)), memorySnapshot.cpu[tag]);
+            }
+            ImGui::Separator();
+            ImGui::Text("GPU: %.2f MB", memorySnapshot.gpuBytes() / MB);
+            for (size_t kind = 0; kind < MemoryTracker::kGpuKinds; ++kind) {
+                showUsage(MemoryTracker::gpuName(static_cast<GpuMemory>(kind)), memorySnapshot.gpu[kind]);
+            }
+
+            auto& tracker = MemoryTracker::getInstance();
+            if (ImGui::TreeNode("Budgets (MB, 0 for none)")) {
+                for (size_t tag = 0; tag < MemoryTracker::kTags; ++tag) {
+                    int budgetMB = static_cast<int>(tracker.budgets[tag] >> 20);
+                    if (ImGui::SliderInt(MemoryTracker::tagName(static_cast<MemoryTag>(tag)), &budgetMB, 0, 4096)) tracker.budgets[tag] = size_t(budgetMB) << 20;
+                }
+                for (size_t kind = 0; kind < MemoryTracker::kGpuKinds; ++kind) {
+                    const std::string label = std::string("GPU ") + MemoryTracker::gpuName(static_cast<GpuMemory>(kind));
+                    int budgetMB = static_cast<int>(tracker.gpuBudgets[kind] >> 20);
+                    if (ImGui::SliderInt(label.c_str(), &budgetMB, 0, 4096)) tracker.gpuBudgets[kind] = size_t(budgetMB) << 20;
+                }
+                ImGui::TreePop();
+            }
+            if (ImGui::Button("Dump to memory.json")) {
+                const bool written = tracker.dump("memory.json");
+                if (written) LOG_INFO(Log::Editor, "Memory report written to memory.json");
+                else LOG_ERROR(Log::Editor, "Could not write memory.json");
+            }
         }
 
         // Information output
         if (ImGui::CollapsingHeader("Information")) {
             // Memory consumption
-            ImGui::Text("%s", memoryUsage.c_str());
+            if (memorySnapshot.process.valid) ImGui::Text("Memory consumption: %.2f MB", memorySnapshot.process.resident / (1024.0 * 1024.0));
+            else ImGui::Text("Failed to get memory usage information.");
             // Hardware detection
             ImGui::Text("CPU Cores: %d", SDL_GetCPUCount());
             ImGui::Text("RAM: %d MB", SDL_GetSystemRAM());
@@ -233,7 +524,7 @@ void MyGUI::renderGameObjectNode(GameObject* gameObject)
 
     if (ImGui::BeginPopup(("GameObjectContextMenu" + std::to_string(reinterpret_cast<uintptr_t>(gameObject))).c_str())) {
         if (ImGui::MenuItem("Delete")) {
-            Log::getInstance().logMessage("Deleted GameObject: " + gameObject->GetName() + "(Just kidding, the function isn't implemented yet)");
+            LOG_WARNING(Log::Scene, "Deleted GameObject: %s(Just kidding, the function isn't implemented yet)", gameObject->GetName().c_str());
             // Add functionality here
         }
         if (ImGui::MenuItem("Rename")) {
@@ -607,6 +898,14 @@ void MyGUI::renderInspectorWindow()
             // Display the name of the selected GameObject
             ImGui::Text("Selected GameObject: %s", persistentSelectedGameObject->GetName().c_str());
             ImGui::Text("ID: %d", persistentSelectedGameObject->id);
+            // Static objects are merged into batches; the batches follow the flag right away
+            if (ImGui::Checkbox("Static", &persistentSelectedGameObject->isStatic)) {
+                StaticBatcher::getInstance().build(scene);
+            }
+            if (persistentSelectedGameObject->staticBatched) {
+                ImGui::SameLine();
+                ImGui::TextDisabled("(batched, transform changes need a rebuild)");
+            }
 
             ImGui::Separator();
 
@@ -623,6 +922,8 @@ void MyGUI::renderInspectorWindow()
                     ImGui::Text("Texture Info");
                     ImGui::Text("Texture Path: %s", persistentSelectedGameObject->texturePath.c_str());
                     ImGui::Text("Texture size: %d x %d", persistentSelectedGameObject->GetComponent<MeshLoader>()->GetImage()->width(), persistentSelectedGameObject->GetComponent<MeshLoader>()->GetImage()->height());
+                    const auto& image = *persistentSelectedGameObject->GetComponent<MeshLoader>()->GetImage();
+                    ImGui::Text("Texture memory: %.1f KB GPU, %.1f KB CPU", image.gpuBytes() / 1024.0, image.mips().pixels.capacity() / 1024.0);
 
                 }
                 else {
@@ -642,8 +943,7 @@ void MyGUI::renderInspectorWindow()
                     );
                     if (filePath) {
                         fileManager.LoadTexture(filePath, *persistentSelectedGameObject);
-                        Log::getInstance().logMessage("Loaded Texture from:");
-                        Log::getInstance().logMessage(filePath);
+                        LOG_INFO(Log::Assets, "Loaded Texture from: %s", filePath);
                     }
                 }
 
@@ -659,6 +959,9 @@ void MyGUI::renderInspectorWindow()
                 // Display Mesh Info
                 ImGui::Text("Mesh Info");
                 ImGui::Text("Mesh Path: %s", persistentSelectedGameObject->meshPath.c_str());
+                if (const auto mesh = persistentSelectedGameObject->GetComponent<MeshLoader>()->GetMesh()) {
+                    ImGui::Text("Mesh memory: %.1f KB GPU, %.1f KB CPU", mesh->gpuBytes() / 1024.0, mesh->cpuBytes() / 1024.0);
+                }
                 // Checkbox to toggle drawing normals
                 if (ImGui::Checkbox("Draw Normals", &persistentSelectedGameObject->GetComponent<MeshLoader>()->drawNormals)) {
                     // Handle draw normals checkbox
@@ -884,6 +1187,7 @@ void MyGUI::CheckForDuplicateNamesRecursive(GameObject& gameObject)
 }
 
 void MyGUI::render() {
+    PROFILE_SCOPE("GUI");
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL2_NewFrame();
     ImGui::NewFrame();
@@ -903,6 +1207,8 @@ void MyGUI::render() {
     //ImGui::ShowDemoWindow();
 	//render configuration window
 	renderConfigurationWindow();
+	//Profiler window, Comment the line below if you don't want the Profiler window to appear
+	renderProfilerWindow();
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
@@ -2,6 +2,11 @@
 
 #include "MyWindow.h"
 #include "Engine/Scene.h"
+#include "Engine/RenderQueue.h"
+#include "Engine/Log.h"
+#include "Engine/MemoryTracker.h"
+#include "Engine/Profiler.h"
+#include "Engine/FrameScheduler.h"
 #include <list>
 #include <string>
 #include <vector> // Include the vector header
@@ -32,6 +37,7 @@ public:
     void processEvent(const SDL_Event& event);
     void renderConsoleWindow();
     void renderAssetWindow();
+    void renderProfilerWindow();
     void renderGameObjectNode(GameObject* gameObject);
     std::queue<std::function<void()>> pendingOperations;
     void ManagePosition();
@@ -44,7 +50,20 @@ public:
 
     bool isSelectedFromWindow = false; // Add this flag
 
-    string memoryUsage;
+    // Console view: the history lines passing the filter (absolute indices) and how far the history has been scanned
+    int consoleLevel = Log::Trace;
+    int consoleCategory = -1;
+    bool consoleAutoScroll = true;
+    std::vector<size_t> consoleLines;
+    size_t consoleScanned = 0;
+    std::vector<Log::Line> consoleVisible;
+    MemoryTracker::Snapshot memorySnapshot;
+    double memorySampledAt = -1.0;
+    RenderQueue::FrameStats renderStats;
+    FrameScheduler::Stats frameStats;
+    Profiler::Capture profileCapture;
+    int profileFrames = 8;
+    bool profilePaused = false;
 private:
 
     
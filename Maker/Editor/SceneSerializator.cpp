@@ -8,7 +8,6 @@
 #include <string>
 #include <fstream>
 #include <sstream>
-#include "MyGui.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -125,7 +124,7 @@ void SceneManager::saveGameObject(std::ofstream& outFile, GameObject& go) {
 
         outFile.write(reinterpret_cast<const char*>(mesh.vertices().data()), vertexCount * sizeof(glm::vec3));
         outFile.write(reinterpret_cast<const char*>(mesh.indices().data()), indexCount * sizeof(unsigned int));
-        
+        mesh.trimCpuData();
 
     }
     else {
@@ -255,7 +254,7 @@ void SceneManager::loadScene(const std::string& filePath) {
                 
 
 
-                mesh->load(vertices.data(), vertices.size(), indices.data(), indices.size());
+                mesh->load(std::move(vertices), std::move(indices));
 				
 				
 				go.AddComponent<MeshLoader>()->SetMesh(mesh);
@@ -1,4 +1,12 @@
 #include "TextureImporter.h"
+#include "../Engine/ImageDecoder.h"
+#include "../Engine/Profiler.h"
+#include "../Engine/TextureCache.h"
+#include "../Engine/ThreadPool.h"
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <sstream>
 
 std::string TextureImporter::getFileExtension(const std::string& filePath)
 {
@@ -14,34 +22,138 @@ std::string TextureImporter::getFileExtension(const std::string& filePath)
 	return filePath.substr(dotPosition + 1);
 }
 
-std::shared_ptr<Image> TextureImporter::ImportTexture(const std::string& pathFile)
+TextureImporter::CookedTexture TextureImporter::CookTexture(const std::string& pathFile) const
 {
-	auto image = std::make_shared<Image>();
-	auto img = ilGenImage();
-	ilBindImage(img);
-	ilLoadImage((const wchar_t*)pathFile.c_str());
-
-	// Check if the image is a TGA file
-	std::string extension = getFileExtension(pathFile);
-	if (extension == "tga") {
-		iluFlipImage(); // Flip the image vertically
+	PROFILE_SCOPE("TextureImporter::CookTexture");
+	CookedTexture cooked;
+	cooked.path = pathFile;
+
+	ImageDecoder::Job job{ pathFile };
+	if (ImageDecoder::isSupported(pathFile)) {
+		ImageDecoder::decodeFile(job);
+	}
+	else {
+		// Formats stb does not read still go through DevIL, whose bound-image state allows one caller at a time
+		std::lock_guard<std::mutex> lock(Image::devilMutex());
+		auto img = ilGenImage();
+		ilBindImage(img);
+		if (ilLoadImage(std::filesystem::path(pathFile).c_str())) {
+			job.info.width = ilGetInteger(IL_IMAGE_WIDTH);
+			job.info.height = ilGetInteger(IL_IMAGE_HEIGHT);
+			job.info.channels = ilGetInteger(IL_IMAGE_CHANNELS);
+			job.pixels.assign(ilGetData(), ilGetData() + job.info.bytes());
+			job.ok = true;
+		}
+		ilDeleteImage(img);
+	}
+	if (!job.ok) return cooked;
+
+	return CookPixels(pathFile, job.pixels.data(), job.info.width, job.info.height, job.info.channels);
+}
+
+TextureImporter::CookedTexture TextureImporter::CookPixels(const std::string& name, const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels, unsigned int maxLevels) const
+{
+	CookedTexture cooked;
+	cooked.path = name;
+
+	// Cooking: build the whole mip chain on the CPU with the sharper filter, then block-compress it
+	cooked.mips = MipGen::build(pixels, width, height, channels, MipFilter::Kaiser, true, maxLevels);
+	const BlockFormat format = GLEW_EXT_texture_compression_s3tc ? BlockCompression::defaultFormat(channels) : BlockFormat::None;
+	if (format != BlockFormat::None) {
+		cooked.mips = BlockCompression::compress(cooked.mips, format, compressionQuality, &cooked.stats);
+	}
+	cooked.ok = !cooked.mips.empty();
+	cooked.memory.set(cooked.mips.pixels.capacity());
+	return cooked;
+}
+
+std::string TextureImporter::CookedPath(const std::string& sourcePath)
+{
+	// Sources of the same name in different folders get cooks of their own: the name carries a hash of the full path
+	std::error_code error;
+	std::filesystem::path fullPath = std::filesystem::weakly_canonical(sourcePath, error);
+	if (error) fullPath = std::filesystem::absolute(sourcePath, error).lexically_normal();
+	const std::string normalised = fullPath.generic_string();
+	std::ostringstream name;
+	name << "Library/Textures/" << std::filesystem::path(sourcePath).stem().string() << "-" << std::hex
+		<< TextureCache::hashBytes(normalised.data(), normalised.size()) << ".tex";
+	return name.str();
+}
+
+bool TextureImporter::IsCookedCurrent(const std::string& sourcePath)
+{
+	std::error_code error;
+	const auto cookedTime = std::filesystem::last_write_time(CookedPath(sourcePath), error);
+	if (error) return false;
+	const auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+	return !error && cookedTime >= sourceTime;
+}
+
+bool TextureImporter::LoadCooked(const std::string& sourcePath, CookedTexture& cooked)
+{
+	if (!IsCookedCurrent(sourcePath)) return false;
+	std::ifstream file(CookedPath(sourcePath), std::ios::binary);
+	MipChain mips;
+	if (!file || !TextureFile::read(file, mips)) return false;
+
+	cooked.path = sourcePath;
+	cooked.mips = std::move(mips);
+	cooked.ok = !cooked.mips.empty();
+	cooked.memory.set(cooked.mips.pixels.capacity());
+	return cooked.ok;
+}
+
+std::vector<TextureImporter::CookedTexture> TextureImporter::CookTextures(const std::vector<std::string>& paths) const
+{
+	PROFILE_SCOPE("TextureImporter::CookTextures");
+	std::vector<std::future<CookedTexture>> pending;
+	pending.reserve(paths.size());
+	for (const auto& path : paths) {
+		pending.push_back(ThreadPool::getInstance().submit([this, path]() {
+			// A cooked file newer than its source is read back as it is instead of being decoded and compressed again
+			CookedTexture cooked;
+			if (LoadCooked(path, cooked)) return cooked;
+			return CookTexture(path);
+		}));
 	}
 
-	auto width = ilGetInteger(IL_IMAGE_WIDTH);
-	auto height = ilGetInteger(IL_IMAGE_HEIGHT);
-	auto channels = ilGetInteger(IL_IMAGE_CHANNELS);
-	auto data = ilGetData();
+	std::vector<CookedTexture> cooked;
+	cooked.reserve(paths.size());
+	for (auto& result : pending) cooked.push_back(result.get());
+	return cooked;
+}
 
-	// Load image as a texture in VRAM
-	image->load(width, height, channels, data);
+std::shared_ptr<Image> TextureImporter::UploadTexture(CookedTexture&& cooked)
+{
+	PROFILE_SCOPE("TextureImporter::UploadTexture");
+	auto image = std::make_shared<Image>();
+	if (!cooked.ok) {
+		LOG_WARNING(Log::Assets, "Failed to decode %s", cooked.path.c_str());
+		return image;
+	}
 
-	// Now we can delete image from RAM
-	ilDeleteImage(img);
+	if (cooked.mips.format != BlockFormat::None && cooked.stats.rawBytes) {
+		const auto& stats = cooked.stats;
+		LOG_INFO(Log::Assets, "Compressed %s: %.1f MPix/s, PSNR %.1f dB, %zu KB -> %zu KB", cooked.path.c_str(),
+			stats.megapixelsPerSecond, stats.psnr, stats.rawBytes / 1024, stats.compressedBytes / 1024);
+	}
+	image->load(std::move(cooked.mips));
+	cooked.memory.set(0);
 	return image;
 }
 
+std::shared_ptr<Image> TextureImporter::ImportTexture(const std::string& pathFile)
+{
+	return UploadTexture(CookTexture(pathFile));
+}
+
 void TextureImporter::SaveTextureToFile(const std::shared_ptr<Image>& texture, const std::string& filePath)
 {
+	// Without a CPU copy there is nothing to write, and an empty file would replace a good one
+	if (!texture || texture->mips().empty()) {
+		LOG_WARNING(Log::Assets, "Not saving %s: the image has no CPU copy", filePath.c_str());
+		return;
+	}
 	std::ofstream os(filePath, std::ios::binary);
 	os << texture;
 }
@@ -56,43 +168,50 @@ void TextureImporter::saveAsCustomImage(const std::shared_ptr<Image>& image, con
 		throw std::runtime_error("Failed to open file for saving: " + outputPath);
 	}
 
-	uint32_t width = image->width();
-	uint32_t height = image->height();
-	uint32_t channels = image->channels();
-
-	// Serialize metadata
-	file.write(reinterpret_cast<const char*>(&width), sizeof(width));
-	file.write(reinterpret_cast<const char*>(&height), sizeof(height));
-	file.write(reinterpret_cast<const char*>(&channels), sizeof(channels));
+	if (image->mips().empty()) {
+		throw std::runtime_error("Image has no CPU copy to save: " + outputPath);
+	}
 
-	// Serialize raw image data
-	const auto& rawData = image->rawData();
-	file.write(reinterpret_cast<const char*>(rawData.data()), rawData.size());
+	// Header, level table and every mip level
+	TextureFile::write(file, image->mips());
 
 	file.close();
 }
 
 std::shared_ptr<Image> TextureImporter::LoadTextureFromFile(const std::string& filePath)
 {
-	std::ifstream is(filePath, std::ios::binary);
 	std::shared_ptr<Image> texture = std::make_shared<Image>();
-	is >> texture;
+	// Cooked files start with their coarse mips and stream finer ones as they are needed
+	StreamSource source;
+	if (StreamSource::fromFile(filePath, source) && TextureStreamer::getInstance().add(texture, std::move(source))) {
+		return texture;
+	}
+	// Older cooked layouts are uploaded whole; anything else is decoded as a source image
+	if (!TextureFile::load(filePath, *texture)) {
+		texture->LoadTexture(filePath);
+	}
 	return texture;
 }
 
 std::ostream& operator<<(std::ostream& os, const std::shared_ptr<Image>& img)
 {
-	ImageDTO dto(img);
-	os.write((const char*)&dto.width, sizeof(dto.width));
-	os.write((const char*)&dto.height, sizeof(dto.height));
-	os.write((const char*)&dto.channels, sizeof(dto.channels));
-	os.write(dto.data.data(), dto.data.size());
+	if (!TextureFile::write(os, img->mips())) os.setstate(std::ios::failbit);
 	return os;
 
 }
 
 std::istream& operator>>(std::istream& is, std::shared_ptr<Image>& img)
 {
+	const std::streampos start = is.tellg();
+	MipChain mips;
+	if (TextureFile::read(is, mips)) {
+		img->load(std::move(mips));
+		return is;
+	}
+
+	// Older single-level layout
+	is.clear();
+	is.seekg(start);
 	ImageDTO dto;
 	is.read((char*)&dto.width, sizeof(dto.width));
 	is.read((char*)&dto.height, sizeof(dto.height));
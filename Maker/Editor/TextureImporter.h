@@ -12,6 +12,9 @@
 #include <glm/gtx/quaternion.hpp>
 #include "../Engine/Log.h"
 #include "../Engine/Image.h"
+#include "../Engine/MemoryTracker.h"
+#include "../Engine/TextureFile.h"
+#include "../Engine/TextureStreamer.h"
 #include <IL/il.h>
 #include <IL/ilu.h>
 #include <IL/ilut.h>
@@ -20,6 +23,34 @@ class TextureImporter
 {
 	
 public:
+    // Decoded, mip-mapped and compressed on the CPU; safe to build on any thread
+    struct CookedTexture
+    {
+        std::string path;
+        MipChain mips;
+        BlockCompression::Stats stats;
+        bool ok = false;
+        // The mips, until UploadTexture hands them to an Image
+        TrackedBytes memory{ MemoryTag::Importer };
+    };
+
+    BlockQuality compressionQuality = BlockQuality::Normal;
+
+    CookedTexture CookTexture(const std::string& pathFile) const;
+    // Same for pixels already in memory (atlas pages); maxLevels as in MipGen::build
+    CookedTexture CookPixels(const std::string& name, const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels, unsigned int maxLevels = 0) const;
+    // Cooks every path on the ThreadPool; results keep the order of paths. Paths whose cooked file is current are
+    // read from it rather than cooked again.
+    std::vector<CookedTexture> CookTextures(const std::vector<std::string>& paths) const;
+    // Where FileManager keeps the cooked copy of a source texture: Library/Textures/<stem>-<hash of the full path>.tex
+    static std::string CookedPath(const std::string& sourcePath);
+    // The cooked copy exists and is no older than its source
+    static bool IsCookedCurrent(const std::string& sourcePath);
+    // The cooked copy's mips, when it is current
+    static bool LoadCooked(const std::string& sourcePath, CookedTexture& cooked);
+    // GL upload, main thread only
+    static std::shared_ptr<Image> UploadTexture(CookedTexture&& cooked);
+
     std::shared_ptr<Image> ImportTexture(const std::string& pathFile);
     void SaveTextureToFile(const std::shared_ptr<Image>& texture, const std::string& filePath);
     static std::shared_ptr<Image> LoadTextureFromFile(const std::string& filePath);
@@ -37,13 +68,11 @@ struct ImageDTO {
 
     ImageDTO() = default;
 
+    // Level 0 from the image's CPU copy; no GPU readback
     explicit ImageDTO(const std::shared_ptr<Image>& img) :
         width(img->width()),
         height(img->height()),
-        channels(img->channels()), data(width* height* channels) {
-
-        img->bind();
-        glGetTexImage(GL_TEXTURE_2D, 0, formatFromChannels(img->channels()), GL_UNSIGNED_BYTE, data.data());
+        channels(img->channels()), data(img->rawData().begin(), img->rawData().end()) {
     }
 };
 
@@ -19,6 +19,15 @@ using namespace std;
 #include <assimp/postprocess.h>
 #include "../Engine/Camera.h"
 #include "../Engine/Mesh.h"
+#include "../Engine/TextureCache.h"
+#include "../Engine/TextureStreamer.h"
+#include "../Engine/RenderQueue.h"
+#include "../Engine/StaticBatcher.h"
+#include "../Engine/DebugDraw.h"
+#include "../Engine/CachingRenderDevice.h"
+#include "../Engine/Profiler.h"
+#include "../Engine/Picking.h"
+#include "../Engine/FrameScheduler.h"
 #include <vector>
 #include <array>
 #include <chrono>
@@ -30,34 +39,15 @@ using namespace std;
 #include <SDL2/SDL_events.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include "Engine/log.h"
-#include <windows.h>
-#include <psapi.h>
-#include <iomanip>
-#include <sstream>
 #include "MeshImporter.h"
 
-void GetMemoryUsage(MyGUI& gui) {
-	PROCESS_MEMORY_COUNTERS_EX pmc;
-	if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
-		double privateUsageMB = pmc.PrivateUsage / (1024.0 * 1024.0);
-		std::stringstream ss;
-		ss << std::fixed << std::setprecision(2) << privateUsageMB;
-		gui.memoryUsage = "Memory consumption: " + ss.str() + " MB";
-	}
-	else {
-		gui.memoryUsage = "Failed to get memory usage information.";
-	}
-}
-
 
-using hrclock = chrono::high_resolution_clock;
 using u8vec4 = glm::u8vec4;
 using ivec2 = glm::ivec2;
 using vec3 = glm::dvec3;
 
 static const ivec2 WINDOW_SIZE(1280, 720);
 static const unsigned int FPS = 60;
-static const auto FRAME_DT = 1.0s / FPS;
 
 GameObject mainCamera("Main Camera");
 glm::dmat4 projectionMatrix;
@@ -143,117 +133,14 @@ glm::vec3 screenToWorldRay(int mouseX, int mouseY, int screenWidth, int screenHe
 	return ray_wor;
 }
 
-bool rayIntersectsBoundingBox(const glm::vec3& rayOrigin, const glm::vec3& rayDir, const BoundingBox& bbox) {
-	float tmin = (bbox.min.x - rayOrigin.x) / rayDir.x;
-	float tmax = (bbox.max.x - rayOrigin.x) / rayDir.x;
-
-	if (tmin > tmax) std::swap(tmin, tmax);
-
-	float tymin = (bbox.min.y - rayOrigin.y) / rayDir.y;
-	float tymax = (bbox.max.y - rayOrigin.y) / rayDir.y;
-
-	if (tymin > tymax) std::swap(tymin, tymax);
-
-	if ((tmin > tymax) || (tymin > tmax))
-		return false;
-
-	if (tymin > tmin)
-		tmin = tymin;
-
-	if (tymax < tmax)
-		tmax = tymax;
-
-	float tzmin = (bbox.min.z - rayOrigin.z) / rayDir.z;
-	float tzmax = (bbox.max.z - rayOrigin.z) / rayDir.z;
-
-	if (tzmin > tzmax) std::swap(tzmin, tzmax);
-
-	if ((tmin > tzmax) || (tzmin > tmax))
-		return false;
-
-	return true;
-}
-
-glm::vec3 getRayFromMouse(int mouseX, int mouseY, const glm::mat4& projection, const glm::mat4& view, const glm::ivec2& viewportSize) {
-	float x = (2.0f * mouseX) / viewportSize.x - 1.0f;
-	float y = 1.0f - (2.0f * mouseY) / viewportSize.y;
-	glm::vec4 rayClip = glm::vec4(x, y, -1.0f, 1.0f);
-
-	glm::vec4 rayEye = glm::inverse(projection) * rayClip;
-	rayEye = glm::vec4(rayEye.x, rayEye.y, -1.0f, 0.0f);
-
-	glm::vec3 rayWorld = glm::normalize(glm::vec3(glm::inverse(view) * rayEye));
-	return rayWorld;
-}
-
-GameObject* raycastFromMouseToGameObject(int mouseX, int mouseY, const glm::mat4& projection, const glm::mat4& view, const glm::ivec2& viewportSize) {
-	// Obtener el origen del rayo en coordenadas del mundo
-	glm::vec3 rayOrigin = glm::vec3(glm::inverse(view) * glm::vec4(0, 0, 0, 1));
-
-	// Obtener la direccin del rayo desde las coordenadas del ratn
-	glm::vec3 rayDirection = getRayFromMouse(mouseX, mouseY, projection, view, viewportSize);
-
-	GameObject* hitObject = nullptr;
-
-	// Iterar sobre todos los objetos en la escena
-	for (auto& go : scene.getChildren()) {
-		// Verificar si el rayo intersecta con el BoundingBox del objeto
-		if (rayIntersectsBoundingBox(rayOrigin, rayDirection, go.boundingBox())) {
-			hitObject = &go;
-			break;
-		}
-	}
-
-	// Si no se encuentra ningn objeto, hitObject ser nullptr
-	return hitObject;
-}
-
 static void drawFloorGrid(int size, double step) {
-	glBegin(GL_LINES);
-	for (double i = -size; i <= size; i += step) {
-		glVertex3d(i, 0, -size);
-		glVertex3d(i, 0, size);
-		glVertex3d(-size, 0, i);
-		glVertex3d(size, 0, i);
-	}
-	glEnd();
+	// Built once, then redrawn from its buffer every frame
+	DebugDraw::getInstance().grid(size, step, Colors::White);
 }
 
 void DrawFrustum(const Frustum& frustum)
 {
-	glColor3f(1, 1, 1);
-	glLineWidth(0.5);
-
-	// Draw near plane
-	glBegin(GL_LINE_LOOP);
-	glVertex3f(frustum.vertices[0].x, frustum.vertices[0].y, frustum.vertices[0].z);
-	glVertex3f(frustum.vertices[1].x, frustum.vertices[1].y, frustum.vertices[1].z);
-	glVertex3f(frustum.vertices[2].x, frustum.vertices[2].y, frustum.vertices[2].z);
-	glVertex3f(frustum.vertices[3].x, frustum.vertices[3].y, frustum.vertices[3].z);
-	glEnd();
-
-	// Draw far plane
-	glBegin(GL_LINE_LOOP);
-	glVertex3f(frustum.vertices[4].x, frustum.vertices[4].y, frustum.vertices[4].z);
-	glVertex3f(frustum.vertices[5].x, frustum.vertices[5].y, frustum.vertices[5].z);
-	glVertex3f(frustum.vertices[6].x, frustum.vertices[6].y, frustum.vertices[6].z);
-	glVertex3f(frustum.vertices[7].x, frustum.vertices[7].y, frustum.vertices[7].z);
-	glEnd();
-
-	// Draw lines connecting near and far planes
-	glBegin(GL_LINES);
-	glVertex3f(frustum.vertices[0].x, frustum.vertices[0].y, frustum.vertices[0].z);
-	glVertex3f(frustum.vertices[4].x, frustum.vertices[4].y, frustum.vertices[4].z);
-
-	glVertex3f(frustum.vertices[1].x, frustum.vertices[1].y, frustum.vertices[1].z);
-	glVertex3f(frustum.vertices[5].x, frustum.vertices[5].y, frustum.vertices[5].z);
-
-	glVertex3f(frustum.vertices[2].x, frustum.vertices[2].y, frustum.vertices[2].z);
-	glVertex3f(frustum.vertices[6].x, frustum.vertices[6].y, frustum.vertices[6].z);
-
-	glVertex3f(frustum.vertices[3].x, frustum.vertices[3].y, frustum.vertices[3].z);
-	glVertex3f(frustum.vertices[7].x, frustum.vertices[7].y, frustum.vertices[7].z);
-	glEnd();
+	DebugDraw::getInstance().frustum(frustum, Colors::White);
 }
 
 void configureCamera() {
@@ -269,20 +156,33 @@ void configureCamera() {
 	glLoadMatrixd(glm::value_ptr(viewMatrix));
 }
 
-void updateGameObjectAndChildren(GameObject& gameObject) {
-	// Draw the current game object
+// Draws of the frame, recorded while walking the scene and issued sorted once it is done
+static RenderQueue renderQueue;
 
-	GameObject testCamera;
+// The queue keeps a reference to the frustum until submit, so it has to be the scene's own camera, not a copy
+static const Frustum& cullingFrustum() {
+	const GameObject* testCamera = nullptr;
 	// Testing Frustum Culling
 	for (auto& child : scene.children()) {
 		if (child.name == "Test Camera")
 		{
-			testCamera = child;
+			testCamera = &child;
 		}
 	}
+	return testCamera ? testCamera->GetComponent<CameraComponent>()->camera().frustum : mainCamera.GetComponent<CameraComponent>()->camera().frustum;
+}
+
+static void markStatic(GameObject& gameObject) {
+	gameObject.isStatic = true;
+	for (auto& child : gameObject.getChildren()) markStatic(child);
+}
+
+void updateGameObjectAndChildren(GameObject& gameObject) {
+	// Queue the current game object
+	const Frustum& frustum = cullingFrustum();
 	
-	if (gameObject.HasComponent<MeshLoader>() && testCamera.GetComponent<CameraComponent>()->camera().frustum.ContainsBBox(gameObject.boundingBox()) == 1 || testCamera.GetComponent<CameraComponent>()->camera().frustum.ContainsBBox(gameObject.boundingBox()) == 2) {
-		gameObject.draw();
+	if (gameObject.HasComponent<MeshLoader>() && frustum.ContainsBBox(gameObject.boundingBox()) == 1 || frustum.ContainsBBox(gameObject.boundingBox()) == 2) {
+		gameObject.enqueue(renderQueue, frustum);
 	}
 	
 	if (gameObject.HasComponent<CameraComponent>() && gameObject.name != "Main Camera") {
@@ -299,6 +199,7 @@ void updateGameObjectAndChildren(GameObject& gameObject) {
 }
 
 void updateScene() {
+	PROFILE_SCOPE("Culling");
 	// Draw all top-level children of the scene
 	for (auto& child : scene.children()) {
 		updateGameObjectAndChildren(child);
@@ -306,11 +207,23 @@ void updateScene() {
 }
 
 static void display_func() {
+	PROFILE_SCOPE("Display");
+	// The UI drew with GL behind the device's back last frame, so the state cache starts over
+	if (auto* cache = dynamic_cast<CachingRenderDevice*>(&RenderDevice::getInstance())) cache->beginFrame();
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	configureCamera();
+	const auto& camera = mainCamera.GetComponent<CameraComponent>()->camera();
+	TextureStreamer::getInstance().beginFrame(camera.transform().pos(), camera.fov, WINDOW_SIZE.y);
 	drawFloorGrid(16, 0.25);
 
+	renderQueue.begin(viewMatrix);
 	updateScene();
+	StaticBatcher::getInstance().enqueue(renderQueue, cullingFrustum());
+	renderQueue.submit();
+	// Grid, frustums, bounds and normals queued while walking the scene, in one or two draws
+	DebugDraw::getInstance().flush(viewMatrix);
+	// Streams in the mips the frame just asked for and evicts what no longer fits the budget
+	TextureStreamer::getInstance().update();
 
 	//scene.drawDebug(scene);
 
@@ -616,10 +529,12 @@ bool isMouseOverGameObject(const GameObject& go, int mouseX, int mouseY) {
 }
 
 int main(int argc, char* argv[]) {
+	PROFILE_THREAD("Main");
 
-	Log::getInstance().logMessage("Hello World!");
-	Log::getInstance().logMessage("Hello World! 2");
-	Log::getInstance().logMessage("Hello World! 3");
+	Log::getInstance().setFile("Maker.log");
+	LOG_INFO(Log::General, "Hello World!");
+	LOG_INFO(Log::General, "Hello World! 2");
+	LOG_INFO(Log::General, "Hello World! 3");
 	ilInit();
 	iluInit();
 	ilutInit();
@@ -654,89 +569,127 @@ int main(int argc, char* argv[]) {
 	GameObject go;
 	FileManager fileManager;
 	go = fileManager.LoadFile("Library/Assets/street2.FBX");
+	// The street never moves: its objects are merged into static batches
+	markStatic(go);
 	scene.emplaceChild(go);
+	StaticBatcher::getInstance().build(scene);
 
 	SDL_EventState(SDL_DROPFILE, SDL_ENABLE);
 
-	while (window.isOpen()) {
-		projectionMatrix = mainCamera.GetComponent<CameraComponent>()->camera().projection();
-		viewMatrix = mainCamera.GetComponent<CameraComponent>()->camera().view();
-		GetMemoryUsage(gui);
-		const auto t0 = hrclock::now();
-		handleKeyboardInput();
-		display_func();
-		gui.render();
-		window.swapBuffers();
-		const auto t1 = hrclock::now();
-		const auto dt = t1 - t0;
-		if (dt < FRAME_DT) this_thread::sleep_for(FRAME_DT - dt);
+	// The simulation steps FPS times a second whatever the frame rate; frames are paced to FPS as well
+	FrameScheduler frameScheduler;
+	frameScheduler.settings.updateRate = FPS;
+	frameScheduler.settings.frameRate = FPS;
+	// Where the last step moved the camera from and to, so frames can draw it part of the way
+	vec3 cameraStepStart = mainCamera.GetComponent<CameraComponent>()->camera().transform().pos();
+	vec3 cameraStepEnd = cameraStepStart;
 
-		while (SDL_PollEvent(&event))
+	while (window.isOpen()) {
+		PROFILE_FRAME();
+		frameScheduler.beginFrame();
+		// Events first, so the update and the frame drawn after it see this frame's input
 		{
-			window.processEvent(event);
-			if (!window.isOpen()) break;
-			gui.processEvent(event);
-
-			switch (event.type) {
-			case SDL_DROPFILE:
-				dropped_filePath = event.drop.file;
-				extension = getFileExtension(dropped_filePath);
-
-				if (extension == "obj" || extension == "fbx" || extension == "dae") {
-					mesh->LoadFile(dropped_filePath);
-					GameObject go;
-					go.meshPath = dropped_filePath;
-					go.AddComponent<MeshLoader>()->SetMesh(mesh);
-					go.setMesh(mesh);
-					scene.emplaceChild(go);
-				}
-				else if (extension == "png" || extension == "jpg" || extension == "bmp") {
-					int mouseX, mouseY;
-					SDL_GetMouseState(&mouseX, &mouseY);
-					for (auto& child : scene.children()) {
-						if (isMouseOverGameObject(child, mouseX, mouseY)) {
-							imageTexture->LoadTexture(dropped_filePath);
-							go.texturePath = dropped_filePath;
-							texture->setImage(imageTexture);
-							child.GetComponent<MeshLoader>()->GetMesh()->deleteCheckerTexture();
-							child.GetComponent<MeshLoader>()->SetImage(imageTexture);
-							child.GetComponent<MeshLoader>()->SetTexture(texture);
-						}
+			PROFILE_SCOPE("Events");
+			while (SDL_PollEvent(&event))
+			{
+				window.processEvent(event);
+				if (!window.isOpen()) break;
+				gui.processEvent(event);
+
+				switch (event.type) {
+				case SDL_DROPFILE:
+					dropped_filePath = event.drop.file;
+					extension = getFileExtension(dropped_filePath);
+
+					if (extension == "obj" || extension == "fbx" || extension == "dae") {
+						mesh->LoadFile(dropped_filePath);
+						GameObject go;
+						go.meshPath = dropped_filePath;
+						go.AddComponent<MeshLoader>()->SetMesh(mesh);
+						go.setMesh(mesh);
+						scene.emplaceChild(go);
 					}
-
-				}
-				else {
-					std::cerr << "Unsupported file extension: " << extension << std::endl;
-				}
-				SDL_free(dropped_filePath);
-				//Hasta aqu
-				break;
-			case SDL_MOUSEBUTTONDOWN:
-				if (event.button.button == SDL_BUTTON_LEFT) {
-					int mouseX, mouseY;
-					SDL_GetMouseState(&mouseX, &mouseY);
-					if (mouseX > 300 && mouseX < 900)
-					{
-						// Convertir las coordenadas del ratn a coordenadas del mundo
-						selectedGameObject = raycastFromMouseToGameObject(event.button.x, event.button.y, projectionMatrix, viewMatrix, WINDOW_SIZE);
+					else if (extension == "png" || extension == "jpg" || extension == "bmp") {
+						int mouseX, mouseY;
+						SDL_GetMouseState(&mouseX, &mouseY);
+						for (auto& child : scene.children()) {
+							if (isMouseOverGameObject(child, mouseX, mouseY)) {
+								// A fresh Texture per drop, so earlier drops keep their image; the pixels themselves are shared via the cache
+								texture = TextureCache::getInstance().texture(dropped_filePath);
+								if (!texture) break;
+								imageTexture = texture->image();
+								go.texturePath = dropped_filePath;
+								child.GetComponent<MeshLoader>()->GetMesh()->deleteCheckerTexture();
+								child.GetComponent<MeshLoader>()->SetImage(imageTexture);
+								child.GetComponent<MeshLoader>()->SetTexture(texture);
+							}
+						}
 
 					}
+					else {
+						std::cerr << "Unsupported file extension: " << extension << std::endl;
+					}
+					SDL_free(dropped_filePath);
+					//Hasta aqu
+					break;
+				case SDL_MOUSEBUTTONDOWN:
+					if (event.button.button == SDL_BUTTON_LEFT) {
+						int mouseX, mouseY;
+						SDL_GetMouseState(&mouseX, &mouseY);
+						if (mouseX > 300 && mouseX < 900)
+						{
+							// Convertir las coordenadas del ratn a coordenadas del mundo
+							selectedGameObject = raycastFromMouseToGameObject(event.button.x, event.button.y, projectionMatrix, viewMatrix, WINDOW_SIZE);
+
+						}
 					
 					
+					}
+				case SDL_MOUSEBUTTONUP:
+					mouseButton_func(event.button.button, event.button.state, event.button.x, event.button.y);
+					break;
+				case SDL_MOUSEMOTION:
+					mouseMotion_func(event.motion.x, event.motion.y);
+					break;
+
+				case SDL_MOUSEWHEEL:
+					mouseWheel_func(event.wheel.y);
+					break;
 				}
-			case SDL_MOUSEBUTTONUP:
-				mouseButton_func(event.button.button, event.button.state, event.button.x, event.button.y);
-				break;
-			case SDL_MOUSEMOTION:
-				mouseMotion_func(event.motion.x, event.motion.y);
-				break;
-
-			case SDL_MOUSEWHEEL:
-				mouseWheel_func(event.wheel.y);
-				break;
+			}
+		}
+		if (!window.isOpen()) break;
+
+		auto& cameraPosition = mainCamera.GetComponent<CameraComponent>()->camera().transform().pos();
+		{
+			PROFILE_SCOPE("Update");
+			while (frameScheduler.step()) {
+				cameraStepStart = cameraPosition;
+				handleKeyboardInput();
+				scene.Update(frameScheduler.deltaTime());
+				cameraStepEnd = cameraPosition;
 			}
 		}
 
+		// Drawn alpha of the way through the last step, then put back where the simulation left it; only the step's
+		// own movement is blended, mouse moves since then show as they are
+		const vec3 simulatedPosition = cameraPosition;
+		cameraPosition -= (cameraStepEnd - cameraStepStart) * (1.0 - frameScheduler.alpha());
+		projectionMatrix = mainCamera.GetComponent<CameraComponent>()->camera().projection();
+		viewMatrix = mainCamera.GetComponent<CameraComponent>()->camera().view();
+		display_func();
+		gui.renderStats = renderQueue.stats();
+		gui.frameStats = frameScheduler.stats();
+		gui.render();
+		cameraPosition = simulatedPosition;
+		{
+			PROFILE_SCOPE("Swap buffers");
+			window.swapBuffers();
+		}
+		{
+			PROFILE_SCOPE("Frame wait");
+			frameScheduler.endFrame();
+		}
 	}
 
 	return EXIT_SUCCESS;
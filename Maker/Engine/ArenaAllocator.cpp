@@ -0,0 +1,135 @@
+#include "ArenaAllocator.h"
+#include <algorithm>
+
+ArenaAllocator::ArenaAllocator(size_t capacity)
+{
+	grow(capacity);
+}
+
+void ArenaAllocator::eraseFree(std::map<size_t, size_t>::iterator itr)
+{
+	auto range = _freeBySize.equal_range(itr->second);
+	for (auto bySize = range.first; bySize != range.second; ++bySize) {
+		if (bySize->second == itr->first) {
+			_freeBySize.erase(bySize);
+			break;
+		}
+	}
+	_freeByOffset.erase(itr);
+}
+
+void ArenaAllocator::insertFree(size_t offset, size_t size)
+{
+	// Merge with the free blocks on either side
+	auto next = _freeByOffset.lower_bound(offset);
+	if (next != _freeByOffset.end() && offset + size == next->first) {
+		size += next->second;
+		eraseFree(next);
+	}
+	auto prev = _freeByOffset.lower_bound(offset);
+	if (prev != _freeByOffset.begin()) {
+		--prev;
+		if (prev->first + prev->second == offset) {
+			offset = prev->first;
+			size += prev->second;
+			eraseFree(prev);
+		}
+	}
+
+	_freeByOffset.emplace(offset, size);
+	_freeBySize.emplace(size, offset);
+}
+
+ArenaAllocator::Handle ArenaAllocator::allocate(size_t size)
+{
+	if (size == 0) return kInvalid;
+
+	const auto fit = _freeBySize.lower_bound(size);
+	if (fit == _freeBySize.end()) return kInvalid;
+
+	const size_t offset = fit->second;
+	const size_t blockSize = fit->first;
+	_freeBySize.erase(fit);
+	_freeByOffset.erase(offset);
+	if (blockSize > size) {
+		_freeByOffset.emplace(offset + size, blockSize - size);
+		_freeBySize.emplace(blockSize - size, offset + size);
+	}
+
+	Handle handle;
+	if (!_freeHandles.empty()) {
+		handle = _freeHandles.back();
+		_freeHandles.pop_back();
+	}
+	else {
+		_blocks.emplace_back();
+		handle = static_cast<Handle>(_blocks.size());
+	}
+	_blocks[handle - 1] = { offset, size, true };
+	_used += size;
+	return handle;
+}
+
+void ArenaAllocator::free(Handle handle)
+{
+	if (!valid(handle)) return;
+
+	Block& block = _blocks[handle - 1];
+	insertFree(block.offset, block.size);
+	_used -= block.size;
+	block = Block();
+	_freeHandles.push_back(handle);
+}
+
+void ArenaAllocator::grow(size_t capacity)
+{
+	if (capacity <= _capacity) return;
+	const size_t old = _capacity;
+	_capacity = capacity;
+	insertFree(old, capacity - old);
+}
+
+std::vector<ArenaAllocator::Move> ArenaAllocator::compact()
+{
+	std::vector<Block*> live;
+	for (auto& block : _blocks) {
+		if (block.live) live.push_back(&block);
+	}
+	std::sort(live.begin(), live.end(), [](const Block* a, const Block* b) { return a->offset < b->offset; });
+
+	std::vector<Move> moves;
+	size_t cursor = 0;
+	for (Block* block : live) {
+		// Neighbours that were contiguous before stay contiguous after, so they go in one copy
+		if (!moves.empty() && moves.back().from + moves.back().size == block->offset && moves.back().to + moves.back().size == cursor) {
+			moves.back().size += block->size;
+		}
+		else {
+			moves.push_back({ block->offset, cursor, block->size });
+		}
+		block->offset = cursor;
+		cursor += block->size;
+	}
+
+	_freeByOffset.clear();
+	_freeBySize.clear();
+	if (cursor < _capacity) {
+		_freeByOffset.emplace(cursor, _capacity - cursor);
+		_freeBySize.emplace(_capacity - cursor, cursor);
+	}
+	return moves;
+}
+
+ArenaAllocator::Stats ArenaAllocator::stats() const
+{
+	Stats stats;
+	stats.capacity = _capacity;
+	stats.used = _used;
+	stats.allocations = _blocks.size() - _freeHandles.size();
+	stats.freeBlocks = _freeByOffset.size();
+	for (const auto& [offset, size] : _freeByOffset) {
+		stats.freeSpace += size;
+		stats.largestFree = std::max(stats.largestFree, size);
+	}
+	return stats;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Sub-allocates ranges of [0, capacity) in abstract units (vertices, indices, bytes). Free space is tracked twice:
+// by offset, so a freed range merges with its neighbours, and by size, so allocation takes the smallest block that
+// fits. Callers hold handles rather than offsets, which lets compact() slide allocations together; the returned
+// moves tell the owner of the actual storage what to copy where. No GL in here.
+class ArenaAllocator
+{
+public:
+	using Handle = uint32_t;
+	static constexpr Handle kInvalid = 0;
+
+	struct Move
+	{
+		size_t from;
+		size_t to;
+		size_t size;
+	};
+
+	struct Stats
+	{
+		size_t capacity = 0;
+		size_t used = 0;
+		size_t allocations = 0;
+		size_t freeSpace = 0;
+		size_t freeBlocks = 0;
+		size_t largestFree = 0;
+
+		// 0 when all free space is one block, approaching 1 as it splinters
+		double fragmentation() const { return freeSpace ? 1.0 - static_cast<double>(largestFree) / freeSpace : 0.0; }
+	};
+
+	explicit ArenaAllocator(size_t capacity = 0);
+
+	// kInvalid when size is 0 or no free block is large enough
+	Handle allocate(size_t size);
+	void free(Handle handle);
+
+	size_t offset(Handle handle) const { return _blocks[handle - 1].offset; }
+	size_t size(Handle handle) const { return _blocks[handle - 1].size; }
+	bool valid(Handle handle) const { return handle != kInvalid && handle <= _blocks.size() && _blocks[handle - 1].live; }
+
+	size_t capacity() const { return _capacity; }
+	// Adds space at the end; existing offsets do not change
+	void grow(size_t capacity);
+	// Packs every allocation towards offset 0, keeping their order, and leaves one free block at the end.
+	// Moves are in ascending order with neighbours that shift together merged, so copying them front to back
+	// into fresh storage reproduces the new layout.
+	std::vector<Move> compact();
+	// True when there is at most one free block and it runs to the end
+	bool isCompact() const { return _freeByOffset.empty() || (_freeByOffset.size() == 1 && _freeByOffset.begin()->first + _freeByOffset.begin()->second == _capacity); }
+
+	Stats stats() const;
+
+private:
+	struct Block
+	{
+		size_t offset = 0;
+		size_t size = 0;
+		bool live = false;
+	};
+
+	size_t _capacity = 0;
+	size_t _used = 0;
+	std::vector<Block> _blocks;				// indexed by handle - 1
+	std::vector<Handle> _freeHandles;
+	std::map<size_t, size_t> _freeByOffset;			// offset -> size
+	std::multimap<size_t, size_t> _freeBySize;		// size -> offset
+
+	void insertFree(size_t offset, size_t size);
+	void eraseFree(std::map<size_t, size_t>::iterator itr);
+};
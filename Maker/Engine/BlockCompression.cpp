@@ -0,0 +1,407 @@
+#include "BlockCompression.h"
+#include "MipChain.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace BlockCompression
+{
+	// Blocks encoded per thread at minimum; small mips stay on the calling thread
+	static constexpr size_t kMinBlocksPerChunk = 256;
+
+	using Block = unsigned char[16][4];
+
+	BlockFormat defaultFormat(unsigned int channels)
+	{
+		switch (channels) {
+		case 3: return BlockFormat::BC1;
+		case 4: return BlockFormat::BC3;
+		default: return BlockFormat::None;
+		}
+	}
+
+	size_t blockBytes(BlockFormat format)
+	{
+		switch (format) {
+		case BlockFormat::BC1: return 8;
+		case BlockFormat::BC3: return 16;
+		case BlockFormat::BC5: return 16;
+		default: return 0;
+		}
+	}
+
+	size_t compressedSize(unsigned int width, unsigned int height, BlockFormat format)
+	{
+		return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+	}
+
+	static void fetchBlock(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels, unsigned int bx, unsigned int by, Block block)
+	{
+		for (unsigned int y = 0; y < 4; ++y) {
+			for (unsigned int x = 0; x < 4; ++x) {
+				const unsigned int sx = std::min(bx * 4 + x, width - 1);
+				const unsigned int sy = std::min(by * 4 + y, height - 1);
+				const unsigned char* p = pixels + (static_cast<size_t>(sy) * width + sx) * channels;
+				unsigned char* t = block[y * 4 + x];
+				switch (channels) {
+				case 1: t[0] = t[1] = t[2] = p[0]; t[3] = 255; break;
+				case 2: t[0] = p[0]; t[1] = p[1]; t[2] = 0; t[3] = 255; break;
+				case 3: t[0] = p[0]; t[1] = p[1]; t[2] = p[2]; t[3] = 255; break;
+				default: t[0] = p[0]; t[1] = p[1]; t[2] = p[2]; t[3] = p[3]; break;
+				}
+			}
+		}
+	}
+
+	// --- BC1 colour block ---
+
+	static uint16_t to565(const float c[3])
+	{
+		const int r = std::clamp(static_cast<int>(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		const int g = std::clamp(static_cast<int>(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		const int b = std::clamp(static_cast<int>(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	static void from565(uint16_t v, int c[3])
+	{
+		const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+		c[0] = (r << 3) | (r >> 2);
+		c[1] = (g << 2) | (g >> 4);
+		c[2] = (b << 3) | (b >> 2);
+	}
+
+	static void colorPalette(uint16_t c0, uint16_t c1, int palette[4][3])
+	{
+		from565(c0, palette[0]);
+		from565(c1, palette[1]);
+		for (int k = 0; k < 3; ++k) {
+			if (c0 > c1) {
+				palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+				palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+			}
+			else {
+				palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+				palette[3][k] = 0;
+			}
+		}
+	}
+
+	// Picks the nearest palette entry for every texel; returns the total squared error
+	static int colorIndices(const Block block, uint16_t c0, uint16_t c1, uint32_t& indices)
+	{
+		int palette[4][3];
+		colorPalette(c0, c1, palette);
+		indices = 0;
+		int total = 0;
+		for (int i = 0; i < 16; ++i) {
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 4; ++p) {
+				const int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+				const int error = dr * dr + dg * dg + db * db;
+				if (error < bestError) { bestError = error; best = p; }
+			}
+			indices |= static_cast<uint32_t>(best) << (2 * i);
+			total += bestError;
+		}
+		return total;
+	}
+
+	static void principalAxisEndpoints(const Block block, float lo[3], float hi[3])
+	{
+		float mean[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; ++i) for (int k = 0; k < 3; ++k) mean[k] += block[i][k];
+		for (float& m : mean) m /= 16.0f;
+
+		float cov[6] = { 0, 0, 0, 0, 0, 0 }; // xx xy xz yy yz zz
+		for (int i = 0; i < 16; ++i) {
+			const float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+			cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+			cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+		}
+
+		// Power iteration for the dominant eigenvector
+		float axis[3] = { 1, 1, 1 };
+		for (int it = 0; it < 8; ++it) {
+			const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+			const float len = std::sqrt(x * x + y * y + z * z);
+			if (len < 1e-6f) break;
+			axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+		}
+
+		float minProj = 0, maxProj = 0;
+		for (int i = 0; i < 16; ++i) {
+			const float proj = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+			minProj = std::min(minProj, proj);
+			maxProj = std::max(maxProj, proj);
+		}
+		for (int k = 0; k < 3; ++k) {
+			lo[k] = mean[k] + axis[k] * minProj;
+			hi[k] = mean[k] + axis[k] * maxProj;
+		}
+	}
+
+	static void boundingBoxEndpoints(const Block block, float lo[3], float hi[3])
+	{
+		for (int k = 0; k < 3; ++k) {
+			lo[k] = 255; hi[k] = 0;
+			for (int i = 0; i < 16; ++i) {
+				lo[k] = std::min(lo[k], float(block[i][k]));
+				hi[k] = std::max(hi[k], float(block[i][k]));
+			}
+			// pull the ends in a little, the interpolated entries then cover the interior better
+			const float inset = (hi[k] - lo[k]) / 16.0f;
+			lo[k] += inset;
+			hi[k] -= inset;
+		}
+	}
+
+	// Given the current indices, solves for the two endpoints that minimise the squared error
+	static bool refineEndpoints(const Block block, uint32_t indices, float lo[3], float hi[3])
+	{
+		static const float weight0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0, bb = 0, ab = 0, ax[3] = { 0, 0, 0 }, bx[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; ++i) {
+			const float a = weight0[(indices >> (2 * i)) & 3], b = 1 - a;
+			aa += a * a; bb += b * b; ab += a * b;
+			for (int k = 0; k < 3; ++k) { ax[k] += a * block[i][k]; bx[k] += b * block[i][k]; }
+		}
+		const float det = aa * bb - ab * ab;
+		if (std::abs(det) < 1e-6f) return false;
+		for (int k = 0; k < 3; ++k) {
+			hi[k] = std::clamp((ax[k] * bb - bx[k] * ab) / det, 0.0f, 255.0f);
+			lo[k] = std::clamp((bx[k] * aa - ax[k] * ab) / det, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	static void writeColorBlock(uint16_t c0, uint16_t c1, uint32_t indices, unsigned char* out)
+	{
+		std::memcpy(out, &c0, 2);
+		std::memcpy(out + 2, &c1, 2);
+		std::memcpy(out + 4, &indices, 4);
+	}
+
+	// Encodes in four-colour mode (c0 > c1); equal endpoints degenerate to a solid block
+	static int encodeColorEndpoints(const Block block, const float lo[3], const float hi[3], uint16_t& c0, uint16_t& c1, uint32_t& indices)
+	{
+		c0 = to565(hi);
+		c1 = to565(lo);
+		if (c0 < c1) std::swap(c0, c1);
+		if (c0 == c1) {
+			indices = 0;
+			int palette[4][3];
+			colorPalette(c0, c1, palette);
+			int error = 0;
+			for (int i = 0; i < 16; ++i) for (int k = 0; k < 3; ++k) error += (block[i][k] - palette[0][k]) * (block[i][k] - palette[0][k]);
+			return error;
+		}
+		return colorIndices(block, c0, c1, indices);
+	}
+
+	static void encodeColorBlock(const Block block, BlockQuality quality, unsigned char* out)
+	{
+		float lo[3], hi[3];
+		if (quality == BlockQuality::Fast) boundingBoxEndpoints(block, lo, hi);
+		else principalAxisEndpoints(block, lo, hi);
+
+		uint16_t c0, c1;
+		uint32_t indices;
+		int error = encodeColorEndpoints(block, lo, hi, c0, c1, indices);
+
+		if (quality == BlockQuality::High) {
+			for (int it = 0; it < 2 && error > 0; ++it) {
+				if (!refineEndpoints(block, indices, lo, hi)) break;
+				uint16_t r0, r1;
+				uint32_t refined;
+				const int refinedError = encodeColorEndpoints(block, lo, hi, r0, r1, refined);
+				if (refinedError >= error) break;
+				error = refinedError; c0 = r0; c1 = r1; indices = refined;
+			}
+		}
+		writeColorBlock(c0, c1, indices, out);
+	}
+
+	static void decodeColorBlock(const unsigned char* in, Block block)
+	{
+		uint16_t c0, c1;
+		uint32_t indices;
+		std::memcpy(&c0, in, 2);
+		std::memcpy(&c1, in + 2, 2);
+		std::memcpy(&indices, in + 4, 4);
+		int palette[4][3];
+		colorPalette(c0, c1, palette);
+		for (int i = 0; i < 16; ++i) {
+			const int p = (indices >> (2 * i)) & 3;
+			for (int k = 0; k < 3; ++k) block[i][k] = static_cast<unsigned char>(palette[p][k]);
+		}
+	}
+
+	// --- BC4 single-channel block (BC3 alpha, BC5 halves) ---
+
+	static void channelPalette(int a0, int a1, int palette[8])
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1) {
+			for (int i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+		}
+		else {
+			for (int i = 1; i < 5; ++i) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	static void encodeChannelBlock(const Block block, int channel, unsigned char* out)
+	{
+		int mn = 255, mx = 0;
+		for (int i = 0; i < 16; ++i) {
+			mn = std::min<int>(mn, block[i][channel]);
+			mx = std::max<int>(mx, block[i][channel]);
+		}
+
+		out[0] = static_cast<unsigned char>(mx);
+		out[1] = static_cast<unsigned char>(mn);
+		uint64_t bits = 0;
+		if (mx != mn) {
+			int palette[8];
+			channelPalette(mx, mn, palette);
+			for (int i = 0; i < 16; ++i) {
+				int best = 0, bestError = INT32_MAX;
+				for (int p = 0; p < 8; ++p) {
+					const int error = std::abs(block[i][channel] - palette[p]);
+					if (error < bestError) { bestError = error; best = p; }
+				}
+				bits |= static_cast<uint64_t>(best) << (3 * i);
+			}
+		}
+		for (int b = 0; b < 6; ++b) out[2 + b] = static_cast<unsigned char>(bits >> (8 * b));
+	}
+
+	static void decodeChannelBlock(const unsigned char* in, int channel, Block block)
+	{
+		int palette[8];
+		channelPalette(in[0], in[1], palette);
+		uint64_t bits = 0;
+		for (int b = 0; b < 6; ++b) bits |= static_cast<uint64_t>(in[2 + b]) << (8 * b);
+		for (int i = 0; i < 16; ++i) block[i][channel] = static_cast<unsigned char>(palette[(bits >> (3 * i)) & 7]);
+	}
+
+	// --- levels ---
+
+	std::vector<unsigned char> encode(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels, BlockFormat format, BlockQuality quality)
+	{
+		const unsigned int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		const size_t bytes = blockBytes(format);
+		std::vector<unsigned char> out(compressedSize(width, height, format));
+		if (out.empty()) return out;
+
+		parallelFor(blocksY, std::max<size_t>(1, kMinBlocksPerChunk / blocksX), [&](size_t begin, size_t end) {
+			Block block;
+			for (size_t by = begin; by < end; ++by) {
+				for (unsigned int bx = 0; bx < blocksX; ++bx) {
+					fetchBlock(pixels, width, height, channels, bx, static_cast<unsigned int>(by), block);
+					unsigned char* dst = out.data() + (by * blocksX + bx) * bytes;
+					switch (format) {
+					case BlockFormat::BC1:
+						encodeColorBlock(block, quality, dst);
+						break;
+					case BlockFormat::BC3:
+						encodeChannelBlock(block, 3, dst);
+						encodeColorBlock(block, quality, dst + 8);
+						break;
+					case BlockFormat::BC5:
+						encodeChannelBlock(block, 0, dst);
+						encodeChannelBlock(block, 1, dst + 8);
+						break;
+					default:
+						break;
+					}
+				}
+			}
+		});
+		return out;
+	}
+
+	void decode(const unsigned char* blocks, unsigned int width, unsigned int height, BlockFormat format, unsigned int channels, unsigned char* pixels)
+	{
+		const unsigned int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		const size_t bytes = blockBytes(format);
+		for (unsigned int by = 0; by < blocksY; ++by) {
+			for (unsigned int bx = 0; bx < blocksX; ++bx) {
+				Block block = {};
+				for (auto& t : block) t[3] = 255;
+				const unsigned char* src = blocks + (static_cast<size_t>(by) * blocksX + bx) * bytes;
+				switch (format) {
+				case BlockFormat::BC1: decodeColorBlock(src, block); break;
+				case BlockFormat::BC3: decodeChannelBlock(src, 3, block); decodeColorBlock(src + 8, block); break;
+				case BlockFormat::BC5: decodeChannelBlock(src, 0, block); decodeChannelBlock(src + 8, 1, block); break;
+				default: break;
+				}
+
+				for (unsigned int y = 0; y < 4 && by * 4 + y < height; ++y) {
+					for (unsigned int x = 0; x < 4 && bx * 4 + x < width; ++x) {
+						unsigned char* p = pixels + ((static_cast<size_t>(by) * 4 + y) * width + bx * 4 + x) * channels;
+						const unsigned char* t = block[y * 4 + x];
+						for (unsigned int c = 0; c < channels; ++c) p[c] = t[channels == 1 ? 0 : c];
+					}
+				}
+			}
+		}
+	}
+
+	static double psnr(const unsigned char* a, const unsigned char* b, size_t count)
+	{
+		double sum = 0;
+		for (size_t i = 0; i < count; ++i) {
+			const double d = double(a[i]) - double(b[i]);
+			sum += d * d;
+		}
+		if (sum == 0) return 99.0;
+		return 10.0 * std::log10(255.0 * 255.0 / (sum / count));
+	}
+
+	MipChain compress(const MipChain& raw, BlockFormat format, BlockQuality quality, Stats* stats)
+	{
+		if (format == BlockFormat::None || raw.format != BlockFormat::None || raw.empty()) return raw;
+
+		const auto t0 = std::chrono::high_resolution_clock::now();
+
+		MipChain result;
+		result.width = raw.width;
+		result.height = raw.height;
+		result.channels = raw.channels;
+		result.srgb = raw.srgb;
+		result.format = format;
+
+		size_t texels = 0;
+		for (size_t i = 0; i < raw.levels.size(); ++i) {
+			const MipLevel& src = raw.levels[i];
+			const auto blocks = encode(raw.level(i), src.width, src.height, raw.channels, format, quality);
+			result.levels.push_back({ src.width, src.height, result.pixels.size(), blocks.size() });
+			result.pixels.insert(result.pixels.end(), blocks.begin(), blocks.end());
+			texels += static_cast<size_t>(src.width) * src.height;
+		}
+
+		const auto t1 = std::chrono::high_resolution_clock::now();
+
+		if (stats) {
+			stats->seconds = std::chrono::duration<double>(t1 - t0).count();
+			stats->megapixelsPerSecond = stats->seconds > 0 ? texels / 1e6 / stats->seconds : 0;
+			stats->rawBytes = raw.pixels.size();
+			stats->compressedBytes = result.pixels.size();
+
+			const MipLevel& base = raw.levels[0];
+			std::vector<unsigned char> decoded(base.size);
+			decode(result.level(0), base.width, base.height, format, raw.channels, decoded.data());
+			stats->psnr = psnr(raw.level(0), decoded.data(), decoded.size());
+		}
+		return result;
+	}
+}
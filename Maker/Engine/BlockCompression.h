@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct MipChain;
+
+enum class BlockFormat
+{
+	None,	// raw 8-bit pixels
+	BC1,	// RGB, 4 bpp (DXT1)
+	BC3,	// RGBA, 8 bpp (DXT5): BC1 colour plus an interpolated alpha block
+	BC5,	// two independent channels, 8 bpp (RGTC2); meant for normal maps and other two-channel data
+};
+
+enum class BlockQuality
+{
+	Fast,	// endpoints from the block's bounding box
+	Normal,	// endpoints along the block's principal axis
+	High,	// principal axis plus least-squares endpoint refinement
+};
+
+// CPU encoder for the GPU block formats. Blocks are 4x4 texels; edge blocks repeat the last row/column.
+// Block rows are spread across threads.
+namespace BlockCompression
+{
+	struct Stats
+	{
+		double seconds = 0;
+		double megapixelsPerSecond = 0;
+		double psnr = 0;	// level 0, over the source channels; 99 for a lossless result
+		size_t rawBytes = 0;
+		size_t compressedBytes = 0;
+	};
+
+	// BC1 for RGB, BC3 for RGBA, nothing for one- and two-channel images
+	BlockFormat defaultFormat(unsigned int channels);
+
+	size_t blockBytes(BlockFormat format);
+	size_t compressedSize(unsigned int width, unsigned int height, BlockFormat format);
+
+	// Encodes one level of 8-bit pixels with 1 to 4 channels
+	std::vector<unsigned char> encode(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels, BlockFormat format, BlockQuality quality);
+
+	// Decodes to tightly packed 8-bit pixels with the given channel count (for checking quality)
+	void decode(const unsigned char* blocks, unsigned int width, unsigned int height, BlockFormat format, unsigned int channels, unsigned char* pixels);
+
+	// Encodes every level of a raw chain; the result's levels hold compressed payloads
+	MipChain compress(const MipChain& raw, BlockFormat format, BlockQuality quality, Stats* stats = nullptr);
+}
@@ -1,20 +1,34 @@
-#include <GL/glew.h>
 #include "BufferObject.h"
+#include "MemoryTracker.h"
 
+static GpuMemory gpuKind(RenderDevice::Buffer target)
+{
+	return target == RenderDevice::Buffer::Index ? GpuMemory::IndexBuffers : GpuMemory::VertexBuffers;
+}
 
-BufferObject::BufferObject(BufferObject&& other) noexcept : _id(other._id), _target(other._target)
+
+BufferObject::BufferObject(BufferObject&& other) noexcept : _id(other._id), _target(other._target), _gpuBytes(other._gpuBytes)
 {
 	other._id = 0;
-	other._target = 0;
+	other._gpuBytes = 0;
+}
+
+void BufferObject::setGpuBytes(size_t bytes)
+{
+	auto& tracker = MemoryTracker::getInstance();
+	if (_gpuBytes) tracker.releaseGpu(gpuKind(_target), _gpuBytes);
+	if (bytes) tracker.allocateGpu(gpuKind(_target), bytes);
+	_gpuBytes = bytes;
 }
 
 void BufferObject::unload()
 {
 	if (_id != 0)
 	{
-		glDeleteBuffers(1, &_id);
+		RenderDevice::getInstance().deleteBuffer(_id);
 	}
 	_id = 0;
+	setGpuBytes(0);
 }
 
 BufferObject::~BufferObject()
@@ -24,27 +38,48 @@ BufferObject::~BufferObject()
 
 void BufferObject::bind() const
 {
-	glBindBuffer(_target, _id);
+	RenderDevice::getInstance().bindBuffer(_target, _id);
 }
 
 void BufferObject::loadData(const void* data, size_t size)
 {
-	_target = GL_ARRAY_BUFFER;
+	auto& device = RenderDevice::getInstance();
+	setGpuBytes(0);
+	_target = RenderDevice::Buffer::Vertex;
 	if (_id == 0)
 	{
-		glGenBuffers(1, &_id);
+		_id = device.createBuffer();
 	}
-	glBindBuffer(_target, _id);
-	glBufferData(_target, size, data, GL_STATIC_DRAW);
+	device.bindBuffer(_target, _id);
+	device.bufferData(_target, size, data, RenderDevice::Usage::Static);
+	setGpuBytes(size);
 }
 
 void BufferObject::loadIndices(const unsigned int* indices, size_t num_indices)
 {
-	_target = GL_ELEMENT_ARRAY_BUFFER;
+	auto& device = RenderDevice::getInstance();
+	setGpuBytes(0);
+	_target = RenderDevice::Buffer::Index;
 	if (_id == 0)
 	{
-		glGenBuffers(1, &_id);
+		_id = device.createBuffer();
 	}
-	glBindBuffer(_target, _id);
-	glBufferData(_target, num_indices * sizeof(unsigned int), indices, GL_STATIC_DRAW);
-}
\ No newline at end of file
+	device.bindBuffer(_target, _id);
+	device.bufferData(_target, num_indices * sizeof(unsigned int), indices, RenderDevice::Usage::Static);
+	setGpuBytes(num_indices * sizeof(unsigned int));
+}
+
+void BufferObject::streamData(const void* data, size_t size)
+{
+	auto& device = RenderDevice::getInstance();
+	setGpuBytes(0);
+	_target = RenderDevice::Buffer::Vertex;
+	if (_id == 0)
+	{
+		_id = device.createBuffer();
+	}
+	device.bindBuffer(_target, _id);
+	device.bufferData(_target, size, nullptr, RenderDevice::Usage::Stream);
+	device.bufferData(_target, size, data, RenderDevice::Usage::Stream);
+	setGpuBytes(size);
+}
@@ -1,14 +1,25 @@
 #pragma once
+#include <cstddef>
+#include "RenderDevice.h"
+
 class BufferObject
 {
 	unsigned int _id = 0;
-	int _target = 0;
+	RenderDevice::Buffer _target = RenderDevice::Buffer::Vertex;
+	size_t _gpuBytes = 0;
+
+	// Moves the charge in the MemoryTracker over to the current target and size
+	void setGpuBytes(size_t bytes);
 
 public:
 	unsigned int id() const { return _id; }
-	int target() const { return _target; }
+	RenderDevice::Buffer target() const { return _target; }
+	// Size of the storage last handed to the device
+	size_t gpuBytes() const { return _gpuBytes; }
 	void loadData(const void* data, size_t size);
 	void loadIndices(const unsigned int* indices, size_t num_indices);
+	// Per-frame data: the old storage is orphaned so the upload never waits on draws still reading it
+	void streamData(const void* data, size_t size);
 	void unload();
 	void bind() const;
 
@@ -0,0 +1,266 @@
+#include "CachingRenderDevice.h"
+#include <numeric>
+
+const char* CachingRenderDevice::kindName(Kind kind)
+{
+	switch (kind) {
+	case BufferBinds: return "Buffer binds";
+	case TextureBinds: return "Texture binds";
+	case Samplers: return "Sampler settings";
+	case Enables: return "Enables";
+	case Arrays: return "Client arrays";
+	case Pointers: return "Array pointers";
+	case Attributes: return "Attributes";
+	case CurrentColor: return "Colour";
+	case LineWidths: return "Line width";
+	case Programs: return "Programs";
+	default: return "";
+	}
+}
+
+size_t CachingRenderDevice::Stats::totalIssued() const
+{
+	return std::accumulate(issued.begin(), issued.end(), size_t(0));
+}
+
+size_t CachingRenderDevice::Stats::totalSkipped() const
+{
+	return std::accumulate(skipped.begin(), skipped.end(), size_t(0));
+}
+
+bool CachingRenderDevice::Pointer::operator==(const Pointer& other) const
+{
+	return known && other.known && buffer == other.buffer && components == other.components && type == other.type &&
+		stride == other.stride && offset == other.offset;
+}
+
+CachingRenderDevice::CachingRenderDevice(std::unique_ptr<RenderDevice> device) :
+	_device(std::move(device))
+{
+	invalidate();
+}
+
+void CachingRenderDevice::invalidate()
+{
+	_buffers.fill(kUnknown);
+	_texture = kUnknown;
+	_program = kUnknown;
+	_capabilities.fill(-1);
+	_arrays.fill(-1);
+	_pointers.fill(Pointer());
+	_attributes.fill(AttributeState());
+	_colorKnown = false;
+	_lineWidthKnown = false;
+}
+
+void CachingRenderDevice::beginFrame()
+{
+	_lastFrame = _frame;
+	_frame = Stats();
+	invalidate();
+}
+
+bool CachingRenderDevice::issue(Kind kind, bool redundant)
+{
+	if (redundant && enabled) {
+		++_frame.skipped[kind];
+		return false;
+	}
+	++_frame.issued[kind];
+	return true;
+}
+
+void CachingRenderDevice::deleteBuffer(unsigned int id)
+{
+	_device->deleteBuffer(id);
+	// GL unbinds a deleted buffer from every binding point and array of the context, and may hand the name out again
+	for (auto& bound : _buffers) {
+		if (bound == id) bound = 0;
+	}
+	for (auto& pointer : _pointers) {
+		if (pointer.buffer == id) pointer.known = false;
+	}
+	for (auto& attribute : _attributes) {
+		if (attribute.pointer.buffer == id) attribute.pointer.known = false;
+	}
+}
+
+void CachingRenderDevice::bindBuffer(Buffer target, unsigned int id)
+{
+	auto& bound = _buffers[static_cast<int>(target)];
+	if (!issue(BufferBinds, bound == id)) return;
+	_device->bindBuffer(target, id);
+	bound = id;
+}
+
+void CachingRenderDevice::deleteTexture(unsigned int id)
+{
+	_device->deleteTexture(id);
+	if (_texture == id) _texture = 0;
+	_samplers.erase(id);
+}
+
+void CachingRenderDevice::bindTexture(unsigned int id)
+{
+	if (!issue(TextureBinds, _texture == id)) return;
+	_device->bindTexture(id);
+	_texture = id;
+}
+
+void CachingRenderDevice::textureSampler(Wrap wrap, Filter minFilter, Filter magFilter)
+{
+	// Without knowing which texture is bound there is nothing to compare against or to remember it for
+	const bool known = _texture != kUnknown && _texture != 0;
+	auto found = known ? _samplers.find(_texture) : _samplers.end();
+	const bool redundant = found != _samplers.end() &&
+		found->second.wrap == wrap && found->second.minFilter == minFilter && found->second.magFilter == magFilter;
+	if (!issue(Samplers, redundant)) return;
+	_device->textureSampler(wrap, minFilter, magFilter);
+	if (known) _samplers[_texture] = { wrap, minFilter, magFilter };
+}
+
+void CachingRenderDevice::enable(Capability capability)
+{
+	auto& known = _capabilities[static_cast<int>(capability)];
+	if (!issue(Enables, known == 1)) return;
+	_device->enable(capability);
+	known = 1;
+}
+
+void CachingRenderDevice::disable(Capability capability)
+{
+	auto& known = _capabilities[static_cast<int>(capability)];
+	if (!issue(Enables, known == 0)) return;
+	_device->disable(capability);
+	known = 0;
+}
+
+bool CachingRenderDevice::isEnabled(Capability capability)
+{
+	// Answering from the shadow also saves a round trip to the driver
+	auto& known = _capabilities[static_cast<int>(capability)];
+	if (known < 0 || !enabled) known = _device->isEnabled(capability) ? 1 : 0;
+	return known == 1;
+}
+
+void CachingRenderDevice::enableArray(ClientArray array)
+{
+	auto& known = _arrays[static_cast<int>(array)];
+	if (!issue(Arrays, known == 1)) return;
+	_device->enableArray(array);
+	known = 1;
+}
+
+void CachingRenderDevice::disableArray(ClientArray array)
+{
+	auto& known = _arrays[static_cast<int>(array)];
+	if (!issue(Arrays, known == 0)) return;
+	_device->disableArray(array);
+	known = 0;
+}
+
+void CachingRenderDevice::arrayPointer(ClientArray array, int components, ComponentType type, size_t stride, size_t offset)
+{
+	const unsigned int buffer = _buffers[static_cast<int>(Buffer::Vertex)];
+	const Pointer pointer{ buffer != kUnknown, buffer, components, type, stride, offset };
+	auto& current = _pointers[static_cast<int>(array)];
+	if (!issue(Pointers, current == pointer)) return;
+	_device->arrayPointer(array, components, type, stride, offset);
+	current = pointer;
+}
+
+void CachingRenderDevice::color(const color4& color)
+{
+	if (!issue(CurrentColor, _colorKnown && _color == color)) return;
+	_device->color(color);
+	_color = color;
+	_colorKnown = true;
+}
+
+void CachingRenderDevice::lineWidth(float width)
+{
+	if (!issue(LineWidths, _lineWidthKnown && _lineWidth == width)) return;
+	_device->lineWidth(width);
+	_lineWidth = width;
+	_lineWidthKnown = true;
+}
+
+void CachingRenderDevice::enableAttribute(unsigned int index)
+{
+	signed char unused = -1;
+	auto& known = index < kAttributes ? _attributes[index].enabled : unused;
+	if (!issue(Attributes, known == 1)) return;
+	_device->enableAttribute(index);
+	known = 1;
+}
+
+void CachingRenderDevice::disableAttribute(unsigned int index)
+{
+	signed char unused = -1;
+	auto& known = index < kAttributes ? _attributes[index].enabled : unused;
+	if (!issue(Attributes, known == 0)) return;
+	_device->disableAttribute(index);
+	known = 0;
+}
+
+void CachingRenderDevice::attributePointer(unsigned int index, int components, size_t stride, size_t offset)
+{
+	const unsigned int buffer = _buffers[static_cast<int>(Buffer::Vertex)];
+	const Pointer pointer{ buffer != kUnknown, buffer, components, ComponentType::Float, stride, offset };
+	Pointer unused;
+	auto& current = index < kAttributes ? _attributes[index].pointer : unused;
+	if (!issue(Attributes, current == pointer)) return;
+	_device->attributePointer(index, components, stride, offset);
+	current = pointer;
+}
+
+void CachingRenderDevice::attributeDivisor(unsigned int index, unsigned int divisor)
+{
+	unsigned int unused = kUnknown;
+	auto& current = index < kAttributes ? _attributes[index].divisor : unused;
+	if (!issue(Attributes, current == divisor)) return;
+	_device->attributeDivisor(index, divisor);
+	current = divisor;
+}
+
+void CachingRenderDevice::deleteProgram(unsigned int program)
+{
+	_device->deleteProgram(program);
+	// A deleted program stays in use until another one is, but its name may come back
+	if (_program == program) _program = kUnknown;
+}
+
+void CachingRenderDevice::useProgram(unsigned int program)
+{
+	if (!issue(Programs, _program == program)) return;
+	_device->useProgram(program);
+	_program = program;
+}
+
+void CachingRenderDevice::drawElements(Primitive primitive, size_t count, size_t firstIndex, int baseVertex)
+{
+	_device->drawElements(primitive, count, firstIndex, baseVertex);
+	++_frame.drawCalls;
+	if (primitive == Primitive::Triangles) _frame.triangles += count / 3;
+}
+
+void CachingRenderDevice::multiDrawElements(const int* counts, const void* const* offsets, size_t drawCount, int baseVertex)
+{
+	_device->multiDrawElements(counts, offsets, drawCount, baseVertex);
+	++_frame.drawCalls;
+	for (size_t i = 0; i < drawCount; ++i) _frame.triangles += counts[i] / 3;
+}
+
+void CachingRenderDevice::drawElementsInstanced(size_t count, size_t firstIndex, size_t instances, int baseVertex)
+{
+	_device->drawElementsInstanced(count, firstIndex, instances, baseVertex);
+	++_frame.drawCalls;
+	_frame.triangles += count / 3 * instances;
+}
+
+void CachingRenderDevice::drawArrays(Primitive primitive, size_t first, size_t count)
+{
+	_device->drawArrays(primitive, first, count);
+	++_frame.drawCalls;
+	if (primitive == Primitive::Triangles) _frame.triangles += count / 3;
+}
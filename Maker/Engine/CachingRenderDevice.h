@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include "RenderDevice.h"
+
+// Sits in front of another device and keeps a shadow copy of the state the engine sets: bound buffers and texture,
+// per-texture sampler settings, enables, client arrays and their pointers, generic attributes, colour, line width
+// and the current program. A call that would set what is already current is dropped before it reaches the driver.
+//
+// State starts out unknown and becomes known once the cache has seen it set, so anything that touches GL behind the
+// device's back (the editor UI, viewport setup) is covered by calling beginFrame() or invalidate() afterwards.
+// Matrices, uniforms, uploads and draws always go through; draws are counted, with their triangles, in the stats.
+class CachingRenderDevice : public RenderDevice
+{
+public:
+	enum Kind { BufferBinds, TextureBinds, Samplers, Enables, Arrays, Pointers, Attributes, CurrentColor, LineWidths, Programs, KindCount };
+	static const char* kindName(Kind kind);
+
+	struct Stats
+	{
+		std::array<size_t, KindCount> issued{};
+		std::array<size_t, KindCount> skipped{};
+		size_t drawCalls = 0;
+		size_t triangles = 0;	// of triangle draws, times instances
+
+		size_t totalIssued() const;
+		size_t totalSkipped() const;
+	};
+
+	// Off passes every call through (still counted as issued), to compare against the unfiltered stream
+	bool enabled = true;
+
+	explicit CachingRenderDevice(std::unique_ptr<RenderDevice> device);
+
+	RenderDevice& device() { return *_device; }
+
+	// Forgets everything known about the context; the next set of each piece of state goes through
+	void invalidate();
+	// Keeps the finished frame's counts for lastFrame(), starts new ones and invalidates
+	void beginFrame();
+	const Stats& frame() const { return _frame; }
+	const Stats& lastFrame() const { return _lastFrame; }
+
+	bool supports(Feature feature) override { return _device->supports(feature); }
+
+	unsigned int createBuffer() override { return _device->createBuffer(); }
+	void deleteBuffer(unsigned int id) override;
+	void bindBuffer(Buffer target, unsigned int id) override;
+	void bufferData(Buffer target, size_t size, const void* data, Usage usage) override { _device->bufferData(target, size, data, usage); }
+	void bufferSubData(Buffer target, size_t offset, size_t size, const void* data) override { _device->bufferSubData(target, offset, size, data); }
+	void copyBuffer(unsigned int from, unsigned int to, size_t fromOffset, size_t toOffset, size_t size) override { _device->copyBuffer(from, to, fromOffset, toOffset, size); }
+
+	unsigned int createTexture() override { return _device->createTexture(); }
+	void deleteTexture(unsigned int id) override;
+	void bindTexture(unsigned int id) override;
+	void textureImage(unsigned int level, unsigned int width, unsigned int height, unsigned int channels, BlockFormat format, const void* data, size_t size) override
+	{
+		_device->textureImage(level, width, height, channels, format, data, size);
+	}
+	void textureLevels(unsigned int base, unsigned int max) override { _device->textureLevels(base, max); }
+	void textureSampler(Wrap wrap, Filter minFilter, Filter magFilter) override;
+
+	void enable(Capability capability) override;
+	void disable(Capability capability) override;
+	bool isEnabled(Capability capability) override;
+	void enableArray(ClientArray array) override;
+	void disableArray(ClientArray array) override;
+	void arrayPointer(ClientArray array, int components, ComponentType type, size_t stride, size_t offset) override;
+	void color(const color4& color) override;
+	void lineWidth(float width) override;
+	void loadMatrix(const mat4& matrix) override { _device->loadMatrix(matrix); }
+	void pushMatrix() override { _device->pushMatrix(); }
+	void multMatrix(const mat4& matrix) override { _device->multMatrix(matrix); }
+	void popMatrix() override { _device->popMatrix(); }
+
+	void enableAttribute(unsigned int index) override;
+	void disableAttribute(unsigned int index) override;
+	void attributePointer(unsigned int index, int components, size_t stride, size_t offset) override;
+	void attributeDivisor(unsigned int index, unsigned int divisor) override;
+
+	unsigned int createProgram(const char* vertexSource, const char* fragmentSource,
+		const std::vector<std::pair<unsigned int, const char*>>& attributes, std::string& log) override
+	{
+		return _device->createProgram(vertexSource, fragmentSource, attributes, log);
+	}
+	void deleteProgram(unsigned int program) override;
+	void useProgram(unsigned int program) override;
+	int uniformLocation(unsigned int program, const char* name) override { return _device->uniformLocation(program, name); }
+	void uniform(int location, int value) override { _device->uniform(location, value); }
+
+	void drawElements(Primitive primitive, size_t count, size_t firstIndex, int baseVertex) override;
+	void multiDrawElements(const int* counts, const void* const* offsets, size_t drawCount, int baseVertex) override;
+	void drawElementsInstanced(size_t count, size_t firstIndex, size_t instances, int baseVertex) override;
+	void drawArrays(Primitive primitive, size_t first, size_t count) override;
+
+private:
+	static constexpr unsigned int kUnknown = ~0u;
+	static constexpr unsigned int kAttributes = 16;	// the minimum every GL implementation has
+
+	// Where an array or attribute reads from; the buffer is the one bound when the pointer was set
+	struct Pointer
+	{
+		bool known = false;
+		unsigned int buffer = 0;
+		int components = 0;
+		ComponentType type = ComponentType::Float;
+		size_t stride = 0;
+		size_t offset = 0;
+
+		bool operator==(const Pointer& other) const;
+	};
+
+	struct SamplerState
+	{
+		Wrap wrap;
+		Filter minFilter;
+		Filter magFilter;
+	};
+
+	struct AttributeState
+	{
+		signed char enabled = -1;
+		unsigned int divisor = kUnknown;
+		Pointer pointer;
+	};
+
+	std::unique_ptr<RenderDevice> _device;
+	Stats _frame;
+	Stats _lastFrame;
+
+	std::array<unsigned int, 2> _buffers;
+	unsigned int _texture = kUnknown;
+	unsigned int _program = kUnknown;
+	std::array<signed char, 2> _capabilities;
+	std::array<signed char, 4> _arrays;
+	std::array<Pointer, 4> _pointers;
+	std::array<AttributeState, kAttributes> _attributes;
+	bool _colorKnown = false;
+	color4 _color{};
+	bool _lineWidthKnown = false;
+	float _lineWidth = 0;
+	// Sampler settings belong to the texture object, so they outlive invalidate() until the texture is deleted
+	std::unordered_map<unsigned int, SamplerState> _samplers;
+
+	// Counts the call and tells whether it has to reach the device
+	bool issue(Kind kind, bool redundant);
+};
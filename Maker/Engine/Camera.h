@@ -73,6 +73,8 @@ struct Frustum : public Plane
     Plane* m_plane[6] = { &left, &right, &top, &bot, &_near, &_far };
 
     glm::vec3 vertices[8]{};
+    // world-space apex of the frustum (camera position for perspective projections)
+    glm::vec3 eye{};
 
     void Update(const glm::mat4& vpm)
     {
@@ -117,6 +119,13 @@ struct Frustum : public Plane
             temp = transformInv * glm::vec4(vertices[i], 1.0f);
             vertices[i] = temp / temp.w;
         }
+
+        // the eye is the point the projection sends to infinity: clip-space direction (0, 0, 1, 0)
+        temp = transformInv * glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+        if (glm::abs(temp.w) > 1e-12f)
+        {
+            eye = glm::vec3(temp) / temp.w;
+        }
     }
 
     // tests if a AaBox is within the frustrum
@@ -26,6 +26,9 @@ public:
 
 	void SetName(const std::string& name) { this->name = name; }
 
+	// Called once per simulation tick by GameObject::Update while the component is enabled
+	virtual void Update(double /*deltaTime*/) {}
+
 protected:
 	std::weak_ptr<GameObject> owner;
 	std::string name;
@@ -55,8 +55,8 @@ GameObject GameObject::createCube()
         { 1.0f, 1.0f },
     };
 
-    mesh->load(vertices.data(), vertices.size(), indices.data(), indices.size());
-    mesh->loadTexCoords(texCoords.data(), texCoords.size());
+    mesh->load(std::move(vertices), std::move(indices));
+    mesh->loadTexCoords(std::move(texCoords));
 
     GameObject gameObject;
     gameObject.meshPath = "Default Cube";
@@ -114,8 +114,8 @@ GameObject GameObject::createSphere() {
         }
     }
 
-    mesh->load(vertices.data(), vertices.size(), indices.data(), indices.size());
-    mesh->loadTexCoords(texCoords.data(), texCoords.size());
+    mesh->load(std::move(vertices), std::move(indices));
+    mesh->loadTexCoords(std::move(texCoords));
 
     GameObject gameObject;
     gameObject.meshPath = "Default Cube Sphere";
@@ -183,8 +183,8 @@ GameObject GameObject::createCylinder()
     texCoords.push_back({ 0.5f, 0.0f }); // Center of bottom circle
     texCoords.push_back({ 0.5f, 1.0f }); // Center of top circle
 
-    mesh->load(vertices.data(), vertices.size(), indices.data(), indices.size());
-    mesh->loadTexCoords(texCoords.data(), texCoords.size());
+    mesh->load(std::move(vertices), std::move(indices));
+    mesh->loadTexCoords(std::move(texCoords));
 
     GameObject gameObject;
     gameObject.meshPath = "Default Cylinder";
@@ -0,0 +1,155 @@
+#include "DebugDraw.h"
+#include "Camera.h"
+#include "Mesh.h"
+#include "Profiler.h"
+#include "RenderDevice.h"
+#include <cstddef>
+
+void DebugDraw::line(const vec3& a, const vec3& b, const color4& color)
+{
+	_frame.push_back({ glm::vec3(a), color });
+	_frame.push_back({ glm::vec3(b), color });
+}
+
+void DebugDraw::box(const BoundingBox& box, const mat4& transform, const color4& color)
+{
+	// Corner i has x, y, z taken from max where bits 2, 1, 0 of i are set (v000 ... v111)
+	std::array<vec3, 8> corners = box.vertices();
+	for (auto& corner : corners) corner = vec3(transform * vec4(corner, 1.0));
+
+	static constexpr int edges[12][2] = {
+		{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },	// along z
+		{ 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },	// along y
+		{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },	// along x
+	};
+	for (const auto& edge : edges) line(corners[edge[0]], corners[edge[1]], color);
+}
+
+void DebugDraw::axis(const mat4& transform, double size)
+{
+	const vec3 origin(transform[3]);
+	line(origin, vec3(transform * vec4(size, 0, 0, 1)), Colors::Red);
+	line(origin, vec3(transform * vec4(0, size, 0, 1)), Colors::Green);
+	line(origin, vec3(transform * vec4(0, 0, size, 1)), Colors::Blue);
+}
+
+void DebugDraw::frustum(const Frustum& frustum, const color4& color)
+{
+	const auto& v = frustum.vertices;
+	for (int i = 0; i < 4; ++i) {
+		const int next = (i + 1) % 4;
+		line(vec3(v[i]), vec3(v[next]), color);				// near plane
+		line(vec3(v[i + 4]), vec3(v[next + 4]), color);		// far plane
+		line(vec3(v[i]), vec3(v[i + 4]), color);			// sides
+	}
+}
+
+void DebugDraw::grid(int size, double step, const color4& color)
+{
+	_gridThisFrame = true;
+	if (_grid.vertices && size == _gridSize && step == _gridStep && color == _gridColor) return;
+
+	std::vector<DebugVertex> vertices;
+	for (double i = -size; i <= size; i += step) {
+		vertices.push_back({ glm::vec3(i, 0, -size), color });
+		vertices.push_back({ glm::vec3(i, 0, size), color });
+		vertices.push_back({ glm::vec3(-size, 0, i), color });
+		vertices.push_back({ glm::vec3(size, 0, i), color });
+	}
+	upload(_grid, vertices);
+	_gridSize = size;
+	_gridStep = step;
+	_gridColor = color;
+}
+
+void DebugDraw::normals(const std::shared_ptr<Mesh>& mesh, const mat4& modelMatrix, float length)
+{
+	if (!mesh) return;
+
+	CachedNormals& cached = _normals[mesh.get()];
+	// A different mesh at a recycled address, a reloaded mesh or a new length all rebuild the lines
+	if (cached.mesh.lock() != mesh || cached.length != length || cached.numIndices != mesh->numIndices()) {
+		std::vector<glm::vec3> lines;
+		mesh->faceNormalLines(length, lines);
+		std::vector<DebugVertex> vertices;
+		vertices.reserve(lines.size());
+		for (const auto& position : lines) vertices.push_back({ position, Colors::Red });
+
+		upload(cached.lines, vertices);
+		cached.mesh = mesh;
+		cached.length = length;
+		cached.numIndices = mesh->numIndices();
+	}
+	_normalsThisFrame.push_back({ &cached.lines, modelMatrix });
+}
+
+void DebugDraw::upload(CachedLines& cached, const std::vector<DebugVertex>& vertices)
+{
+	if (vertices.empty()) cached.buffer.unload();
+	else cached.buffer.loadData(vertices.data(), vertices.size() * sizeof(DebugVertex));
+	cached.vertices = vertices.size();
+}
+
+void DebugDraw::pointArrays()
+{
+	auto& device = RenderDevice::getInstance();
+	device.arrayPointer(RenderDevice::ClientArray::Vertex, 3, RenderDevice::ComponentType::Float, sizeof(DebugVertex), offsetof(DebugVertex, position));
+	device.arrayPointer(RenderDevice::ClientArray::Color, 4, RenderDevice::ComponentType::UnsignedByte, sizeof(DebugVertex), offsetof(DebugVertex, color));
+}
+
+size_t DebugDraw::draw(const CachedLines& cached)
+{
+	if (!cached.vertices) return 0;
+	cached.buffer.bind();
+	pointArrays();
+	RenderDevice::getInstance().drawArrays(RenderDevice::Primitive::Lines, 0, cached.vertices);
+	return 1;
+}
+
+void DebugDraw::flush(const mat4& view)
+{
+	PROFILE_SCOPE("DebugDraw::flush");
+	_stats = Stats();
+	_stats.frameLines = _frame.size() / 2;
+
+	auto& device = RenderDevice::getInstance();
+	device.disable(RenderDevice::Capability::Texture2D);
+	device.lineWidth(lineWidth);
+	device.enableArray(RenderDevice::ClientArray::Vertex);
+	device.enableArray(RenderDevice::ClientArray::Color);
+
+	device.loadMatrix(view);
+	if (_gridThisFrame) {
+		_stats.drawCalls += draw(_grid);
+		_stats.cachedLines += _grid.vertices / 2;
+	}
+	if (!_frame.empty()) {
+		_frameBuffer.streamData(_frame.data(), _frame.size() * sizeof(DebugVertex));
+		pointArrays();
+		device.drawArrays(RenderDevice::Primitive::Lines, 0, _frame.size());
+		++_stats.drawCalls;
+	}
+	// Normals are in mesh space, so each mesh needs its model matrix
+	for (const auto& normals : _normalsThisFrame) {
+		device.loadMatrix(view * normals.modelMatrix);
+		_stats.drawCalls += draw(*normals.lines);
+		_stats.cachedLines += normals.lines->vertices / 2;
+	}
+
+	device.disableArray(RenderDevice::ClientArray::Color);
+	device.disableArray(RenderDevice::ClientArray::Vertex);
+	device.bindBuffer(RenderDevice::Buffer::Vertex, 0);
+	// The colour array leaves the current colour undefined
+	device.color(Colors::White);
+	device.loadMatrix(view);
+
+	_frame.clear();
+	_normalsThisFrame.clear();
+	_gridThisFrame = false;
+
+	// Normals of meshes that are gone
+	for (auto itr = _normals.begin(); itr != _normals.end();) {
+		if (itr->second.mesh.expired()) itr = _normals.erase(itr);
+		else ++itr;
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "types.h"
+#include "BoundingBox.h"
+#include "BufferObject.h"
+
+class Mesh;
+struct Frustum;
+
+struct DebugVertex
+{
+	glm::vec3 position;
+	color4 color;
+};
+
+// Debug lines for the whole frame. Lines added through line/box/axis/frustum collect in a CPU buffer that is
+// uploaded once and drawn with a single glDrawArrays at flush. The floor grid and per-mesh face normals do not
+// change between frames, so they are built once into buffers of their own and only redrawn.
+class DebugDraw
+{
+public:
+	struct Stats
+	{
+		size_t frameLines = 0;
+		size_t cachedLines = 0;
+		size_t drawCalls = 0;
+	};
+
+	float lineWidth = 1.0f;
+
+	static DebugDraw& getInstance()
+	{
+		static DebugDraw instance;
+		return instance;
+	}
+
+	void line(const vec3& a, const vec3& b, const color4& color);
+	// The 12 edges of box, each corner moved by transform
+	void box(const BoundingBox& box, const mat4& transform, const color4& color);
+	// Red, green and blue unit axes of transform, scaled by size
+	void axis(const mat4& transform, double size);
+	void frustum(const Frustum& frustum, const color4& color);
+
+	// Square grid on the XZ plane, rebuilt only when size or step change
+	void grid(int size, double step, const color4& color);
+	// One line per triangle from its centre along the face normal; built on first use for each mesh
+	void normals(const std::shared_ptr<Mesh>& mesh, const mat4& modelMatrix, float length);
+
+	// Draws everything added since the last flush with view as the modelview, then starts a new frame
+	void flush(const mat4& view);
+
+	const Stats& stats() const { return _stats; }
+
+private:
+	struct CachedLines
+	{
+		BufferObject buffer;
+		size_t vertices = 0;
+	};
+
+	struct CachedNormals
+	{
+		std::weak_ptr<Mesh> mesh;
+		CachedLines lines;
+		float length = 0;
+		size_t numIndices = 0;
+	};
+
+	struct NormalsDraw
+	{
+		const CachedLines* lines;
+		mat4 modelMatrix;
+	};
+
+	std::vector<DebugVertex> _frame;
+	BufferObject _frameBuffer;
+
+	CachedLines _grid;
+	int _gridSize = 0;
+	double _gridStep = 0;
+	color4 _gridColor{};
+	bool _gridThisFrame = false;
+
+	std::map<const Mesh*, CachedNormals> _normals;
+	std::vector<NormalsDraw> _normalsThisFrame;
+
+	Stats _stats;
+
+	void upload(CachedLines& cached, const std::vector<DebugVertex>& vertices);
+	// Points the vertex and colour arrays at the interleaved DebugVertex layout of the bound buffer
+	static void pointArrays();
+	size_t draw(const CachedLines& cached);
+};
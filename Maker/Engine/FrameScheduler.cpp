@@ -0,0 +1,123 @@
+#include "FrameScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+namespace
+{
+	// A sleep that overran by more than this was the machine being busy, not the timer being coarse
+	constexpr auto kMaxOverrun = std::chrono::milliseconds(4);
+
+	double milliseconds(FrameScheduler::clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+}
+
+FrameScheduler::FrameScheduler()
+{
+#if defined(_WIN32)
+	// Sleeps round up to the system timer period, 15.6 ms unless asked otherwise
+	timeBeginPeriod(1);
+#endif
+}
+
+FrameScheduler::~FrameScheduler()
+{
+#if defined(_WIN32)
+	timeEndPeriod(1);
+#endif
+}
+
+void FrameScheduler::beginFrame()
+{
+	const auto now = clock::now();
+	if (!_started) {
+		// The first frame simulates one step, so there is a state to draw
+		_started = true;
+		_deadline = now;
+		_accumulated = deltaTime();
+	}
+	else {
+		const auto elapsed = now - _frameStart;
+		_frameTimes[_recorded % kHistory] = static_cast<float>(milliseconds(elapsed));
+		++_recorded;
+		_accumulated += std::chrono::duration<double>(elapsed).count();
+	}
+	_frameStart = now;
+	_steps = 0;
+
+	const double most = settings.maxSteps * deltaTime();
+	if (_accumulated > most) {
+		_droppedSteps += static_cast<size_t>((_accumulated - most) / deltaTime());
+		_accumulated = most;
+	}
+}
+
+bool FrameScheduler::step()
+{
+	if (_steps >= settings.maxSteps || _accumulated < deltaTime()) return false;
+	_accumulated -= deltaTime();
+	++_steps;
+	return true;
+}
+
+void FrameScheduler::endFrame()
+{
+	const auto now = clock::now();
+	_workTimes[_recorded % kHistory] = static_cast<float>(milliseconds(now - _frameStart));
+	if (settings.frameRate <= 0.0) {
+		_deadline = now;
+		return;
+	}
+
+	const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / settings.frameRate));
+	_deadline += period;
+	// More than a frame behind: start the schedule over instead of rushing through the frames that were missed
+	if (_deadline + period < now) _deadline = now;
+	waitUntil(_deadline, std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(settings.spinTime)));
+}
+
+void FrameScheduler::waitUntil(clock::time_point deadline, clock::duration spin)
+{
+	const auto wake = deadline - spin - _overrun;
+	if (clock::now() < wake) {
+		std::this_thread::sleep_until(wake);
+		const auto overrun = std::min<clock::duration>(clock::now() - wake, kMaxOverrun);
+		_overrun = std::max(overrun, _overrun - _overrun / 16);
+	}
+	while (clock::now() < deadline) std::this_thread::yield();
+}
+
+FrameScheduler::Stats FrameScheduler::stats() const
+{
+	Stats stats;
+	stats.droppedSteps = _droppedSteps;
+	stats.frames = std::min(_recorded, kHistory);
+	if (!stats.frames) return stats;
+
+	std::vector<float> times(_frameTimes.begin(), _frameTimes.begin() + stats.frames);
+	std::sort(times.begin(), times.end());
+	for (float time : times) stats.mean += time;
+	stats.mean /= times.size();
+	stats.p50 = percentile(times, 0.50);
+	stats.p95 = percentile(times, 0.95);
+	stats.p99 = percentile(times, 0.99);
+	stats.max = times.back();
+
+	times.assign(_workTimes.begin(), _workTimes.begin() + stats.frames);
+	std::sort(times.begin(), times.end());
+	stats.workP50 = percentile(times, 0.50);
+	stats.workP95 = percentile(times, 0.95);
+	stats.workP99 = percentile(times, 0.99);
+	return stats;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Paces a main loop that simulates at a fixed rate and renders as often as the frame rate allows. Each frame:
+//
+//   scheduler.beginFrame();
+//   pollEvents();                              // before the update, so input is at most one frame old
+//   while (scheduler.step()) update(scheduler.deltaTime());
+//   render(scheduler.alpha());                 // blend the last two simulated states by alpha
+//   scheduler.endFrame();                      // waits for the next frame's deadline
+//
+// Elapsed time is banked and spent in whole steps, at most maxSteps per frame so a long stall does not snowball
+// into ever longer frames; the remainder, as a fraction of a step, is alpha. Deadlines follow one another a frame
+// period apart rather than being taken from the end of the wait, so oversleeping in one frame does not push every
+// later frame back.
+//
+// The wait sleeps until shortly before the deadline and spins for the rest, since a sleep can overrun by a
+// millisecond or more. How far it is allowed to overrun is learned from the sleeps so far.
+class FrameScheduler
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+	struct Settings
+	{
+		double updateRate = 60.0;	// simulation steps per second
+		double frameRate = 60.0;	// frames per second endFrame() waits for; 0 does not wait
+		unsigned int maxSteps = 5;	// per frame; time beyond them is dropped
+		double spinTime = 0.001;	// seconds spun before each deadline at least, on top of the learnt sleep overrun
+	};
+
+	// Over the last kHistory frames, in milliseconds
+	struct Stats
+	{
+		size_t frames = 0;
+		double mean = 0, p50 = 0, p95 = 0, p99 = 0, max = 0;	// time from one frame's start to the next
+		double workP50 = 0, workP95 = 0, workP99 = 0;			// of it, time spent before endFrame()'s wait
+		size_t droppedSteps = 0;								// in total, since the scheduler started
+	};
+
+	static constexpr size_t kHistory = 240;
+
+	// Nearest-rank percentile of sorted values, as Stats reports them; 0 when there are none
+	template <typename T>
+	static double percentile(const std::vector<T>& sorted, double fraction)
+	{
+		if (sorted.empty()) return 0.0;
+		const size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+		return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+	}
+
+	Settings settings;
+
+	FrameScheduler();
+	~FrameScheduler();
+	FrameScheduler(const FrameScheduler&) = delete;
+	FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+	void beginFrame();
+	// True while a simulation step is due; each call that returns true consumes one
+	bool step();
+	// Seconds simulated per step
+	double deltaTime() const { return 1.0 / settings.updateRate; }
+	// How far between the last two steps the frame is drawn, in [0, 1)
+	double alpha() const { return _accumulated / deltaTime(); }
+	void endFrame();
+
+	Stats stats() const;
+
+	// Sleeps until shortly before deadline, then spins; spin is the least time left to spinning
+	void waitUntil(clock::time_point deadline, clock::duration spin);
+
+private:
+	clock::time_point _frameStart{};
+	clock::time_point _deadline{};
+	bool _started = false;
+	double _accumulated = 0.0;	// seconds not yet simulated
+	unsigned int _steps = 0;	// taken this frame
+	size_t _droppedSteps = 0;
+	clock::duration _overrun{};	// the worst recent sleep overrun, decaying
+
+	std::array<float, kHistory> _frameTimes{};
+	std::array<float, kHistory> _workTimes{};
+	size_t _recorded = 0;
+};
@@ -3,13 +3,20 @@
 #include <iostream>
 #include <string>
 #include "Log.h"
+#include "DebugDraw.h"
+#include "RenderDevice.h"
 
 using namespace std;
 
-int GameObject::nextID = 1; // Initialize the static member variable
+std::atomic<int> GameObject::nextID{ 1 }; // Initialize the static member variable
 
 GameObject::GameObject(const std::string& name)
-	: TreeExt<GameObject>(nextID), id(nextID++), name(name), cachedComponentType(typeid(Component))
+	: GameObject(name, nextID++)
+{
+}
+
+GameObject::GameObject(const std::string& name, int id)
+	: TreeExt<GameObject>(id), id(id), name(name), cachedComponentType(typeid(Component))
 {
 	AddComponent<TransformComponent>();
 	if (name == "Main Camera")
@@ -26,8 +33,9 @@ GameObject::~GameObject()
 void GameObject::draw() const 
 {
 
-	glPushMatrix();
-	glMultMatrixd(GetComponent<TransformComponent>()->transform().data());
+	auto& device = RenderDevice::getInstance();
+	device.pushMatrix();
+	device.multMatrix(GetComponent<TransformComponent>()->transform().mat());
 
 
 	if (auto meshRenderer = GetComponent<MeshLoader>())
@@ -44,7 +52,50 @@ void GameObject::draw() const
 		
 	}
 
-	glPopMatrix();
+	device.popMatrix();
+}
+
+void GameObject::draw(const Frustum& frustum, const mat4& parentMatrix) const
+{
+	const auto& transform = GetComponent<TransformComponent>()->transform();
+	const mat4 modelMatrix = parentMatrix * transform.mat();
+
+	auto& device = RenderDevice::getInstance();
+	device.pushMatrix();
+	device.multMatrix(transform.mat());
+
+	if (HasComponent<MeshLoader>())
+	{
+		GetComponent<MeshLoader>()->Render(frustum, modelMatrix);
+	}
+
+	for (const auto& child : children())
+	{
+		if (child.HasComponent<MeshLoader>())
+		{
+			child.draw(frustum, modelMatrix);
+		}
+	}
+
+	device.popMatrix();
+}
+
+void GameObject::enqueue(RenderQueue& queue, const Frustum& frustum, const mat4& parentMatrix) const
+{
+	const mat4 modelMatrix = parentMatrix * GetComponent<TransformComponent>()->transform().mat();
+
+	if (HasComponent<MeshLoader>() && !staticBatched)
+	{
+		GetComponent<MeshLoader>()->Enqueue(queue, frustum, modelMatrix);
+	}
+
+	for (const auto& child : children())
+	{
+		if (child.HasComponent<MeshLoader>())
+		{
+			child.enqueue(queue, frustum, modelMatrix);
+		}
+	}
 }
 
 void GameObject::UpdateCamera() const
@@ -61,6 +112,19 @@ void GameObject::UpdateCamera() const
 	}
 }
 
+void GameObject::Update(double deltaTime)
+{
+	for (auto& [type, component] : components)
+	{
+		if (component->IsEnabled()) component->Update(deltaTime);
+	}
+
+	for (auto& child : getChildren())
+	{
+		if (child.active) child.Update(deltaTime);
+	}
+}
+
 std::string GameObject::GetName() const
 {
 	return name;
@@ -68,11 +132,9 @@ std::string GameObject::GetName() const
 
 void GameObject::SetName(const std::string& name)
 {
-	string newName = name;
-	string oldName = this->name;
+	// Every object loaded with a scene is renamed on the way in, so this stays out of normal builds
+	LOG_TRACE(Log::Scene, "GameObject %s renamed to %s", this->name.c_str(), name.c_str());
 	this->name = name;
-	string message = "GameObject " + oldName + " renamed to " + newName;
-	Log::getInstance().logMessage(message);
 }
 
 bool GameObject::CompareTag(const std::string& tag) const
@@ -87,50 +149,18 @@ BoundingBox GameObject::boundingBox() const {
 	return GetComponent<TransformComponent>()->transform().mat() * bbox;
 }
 
-void GameObject::drawAxis(double size) {
-	glLineWidth(2.0);
-	glBegin(GL_LINES);
-	glColor3ub(255, 0, 0);
-	glVertex3d(0, 0, 0);
-	glVertex3d(size, 0, 0);
-	glColor3ub(0, 255, 0);
-	glVertex3d(0, 0, 0);
-	glVertex3d(0, size, 0);
-	glColor3ub(0, 0, 255);
-	glVertex3d(0, 0, 0);
-	glVertex3d(0, 0, size);
-	glEnd();
+void GameObject::drawAxis(const mat4& transform, double size) {
+	DebugDraw::getInstance().axis(transform, size);
 }
 
-inline static void glVertex3(const vec3& v) { glVertex3dv(&v.x); }
-void GameObject::drawWiredQuad(const vec3& v0, const vec3& v1, const vec3& v2, const vec3& v3) {
-	glBegin(GL_LINE_LOOP);
-	glVertex3(v0);
-	glVertex3(v1);
-	glVertex3(v2);
-	glVertex3(v3);
-	glEnd();
-}
-
-void GameObject::drawBoundingBox(const BoundingBox& bbox) {
-	glLineWidth(2.0);
-	drawWiredQuad(bbox.v000(), bbox.v001(), bbox.v011(), bbox.v010());
-	drawWiredQuad(bbox.v100(), bbox.v101(), bbox.v111(), bbox.v110());
-	drawWiredQuad(bbox.v000(), bbox.v001(), bbox.v101(), bbox.v100());
-	drawWiredQuad(bbox.v010(), bbox.v011(), bbox.v111(), bbox.v110());
-	drawWiredQuad(bbox.v000(), bbox.v010(), bbox.v110(), bbox.v100());
-	drawWiredQuad(bbox.v001(), bbox.v011(), bbox.v111(), bbox.v101());
-
+void GameObject::drawBoundingBox(const BoundingBox& bbox, const mat4& transform, const color4& color) {
+	DebugDraw::getInstance().box(bbox, transform, color);
 }
 
-void GameObject::drawDebug(const GameObject& obj) {
-	glPushMatrix();
-	glColor3ub(255, 255, 0);
-	drawBoundingBox(obj.boundingBox());
-	glMultMatrixd(obj.GetComponent<TransformComponent>()->transform().data());
-	drawAxis(0.5);
-	glColor3ub(255, 255, 255);
-	drawBoundingBox(obj.localBoundingBox());
-	for (const auto& child : obj.children()) drawDebug(child);
-	glPopMatrix();
+void GameObject::drawDebug(const GameObject& obj, const mat4& parentMatrix) {
+	const mat4 modelMatrix = parentMatrix * obj.GetComponent<TransformComponent>()->transform().mat();
+	drawBoundingBox(obj.boundingBox(), parentMatrix, color4(255, 255, 0, 255));
+	drawAxis(modelMatrix, 0.5);
+	drawBoundingBox(obj.localBoundingBox(), modelMatrix, Colors::White);
+	for (const auto& child : obj.children()) drawDebug(child, modelMatrix);
 }
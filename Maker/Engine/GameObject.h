@@ -1,5 +1,6 @@
 #pragma once
 #include <GL/glew.h>
+#include <atomic>
 #include <memory>
 #include <string> 
 #include <glm/glm.hpp>
@@ -11,9 +12,12 @@
 #include "Texture.h"
 #include "BoundingBox.h"
 #include "Component.h"
+#include "MemoryTracker.h"
 #include "Mesh.h"
 #include "Scene.h"
 
+class RenderQueue;
+
 class GameObject : public std::enable_shared_from_this<GameObject>, public TreeExt<GameObject>
 {
 
@@ -30,7 +34,9 @@ public:
 	std::string meshPath;
 	std::string texturePath;
 	bool drawTexture = true;
-	static int nextID; // Static member to keep track of the next available ID
+	bool isStatic = false;		// never moves; merged by the StaticBatcher
+	bool staticBatched = false;	// drawn through a static batch instead of its own MeshLoader
+	static std::atomic<int> nextID; // Static member to keep track of the next available ID
 
 	
 
@@ -46,6 +52,8 @@ public:
 	}
 public:
 	GameObject(const std::string& name = "GameObject");
+	// With an id taken from reserveIds(), for builders that create objects on several threads in a fixed id order
+	GameObject(const std::string& name, int id);
 	/*GameObject(const GameObject& other) = delete;
 	GameObject& operator=(const GameObject& other) = delete;
 	GameObject(GameObject&& other) = default;
@@ -73,6 +81,9 @@ public:
 		return this->id == other.id;
 	}
 
+	// Takes count consecutive ids off nextID and returns the first
+	static int reserveIds(int count) { return nextID.fetch_add(count); }
+
 	int getId() const { return id; }
 	void setId(int id) { this->id = id; }
 	const auto& color() const { return _color; }
@@ -85,8 +96,7 @@ public:
 	BoundingBox boundingBox() const;
 	BoundingBox localBoundingBox() const { return _mesh_ptr ? _mesh_ptr->boundingBox() : BoundingBox(); }
 
-	void drawWiredQuad(const vec3& v0, const vec3& v1, const vec3& v2, const vec3& v3);
-	void drawBoundingBox(const BoundingBox& box);
+	void drawBoundingBox(const BoundingBox& box, const mat4& transform, const color4& color);
 
 	void setTextureImage(const std::shared_ptr<Image>& img_ptr) { _texture.setImage(img_ptr); }
 	void setMesh(const std::shared_ptr<Mesh>& mesh_ptr) { _mesh_ptr = mesh_ptr; }
@@ -107,22 +117,31 @@ public:
 	void DeleteGameObject();
 
 	void draw() const;
-	void drawAxis(double size);
-	void drawDebug(const GameObject& obj);
+	// Draws this object and its children, culling mesh submeshes against the frustum
+	void draw(const Frustum& frustum, const mat4& parentMatrix = mat4(1.0)) const;
+	// Same traversal as draw(frustum, parentMatrix), recording into the queue instead of drawing
+	void enqueue(RenderQueue& queue, const Frustum& frustum, const mat4& parentMatrix = mat4(1.0)) const;
+	void drawAxis(const mat4& transform, double size);
+	// Queues world and local bounds plus axes of obj and its children with DebugDraw
+	void drawDebug(const GameObject& obj, const mat4& parentMatrix = mat4(1.0));
 
 	void UpdateCamera() const;
+	// Updates the enabled components of this object, then of its active children
+	void Update(double deltaTime);
 
 private:
 	
 	
 	mutable std::type_index cachedComponentType;
 	mutable std::shared_ptr<Component> cachedComponent;
+	// The object itself; names, children and components are charged (or not) on their own
+	TrackedBytes _memory{ MemoryTag::Scene, sizeof(GameObject) };
 };
 
 template <typename T, typename... Args>
 std::shared_ptr<T> GameObject::AddComponent(Args&&... args) {
 	static_assert(std::is_base_of<Component, T>::value, "T must be derived from Component");
-	std::shared_ptr<T> newComponent = std::make_shared<T>(weak_from_this(), std::forward<Args>(args)...);
+	std::shared_ptr<T> newComponent = std::allocate_shared<T>(TaggedAllocator<T, MemoryTag::Components>(), weak_from_this(), std::forward<Args>(args)...);
 	components[typeid(T)] = newComponent;
 	return newComponent;
 }
@@ -0,0 +1,256 @@
+#include "GeometryArena.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <cstring>
+
+static GpuMemory gpuKind(RenderDevice::Buffer target)
+{
+	return target == RenderDevice::Buffer::Index ? GpuMemory::IndexBuffers : GpuMemory::VertexBuffers;
+}
+
+DeviceArenaBuffer::~DeviceArenaBuffer()
+{
+	if (_id) RenderDevice::getInstance().deleteBuffer(_id);
+	if (_size) MemoryTracker::getInstance().releaseGpu(gpuKind(_target), _size);
+}
+
+void DeviceArenaBuffer::resize(size_t bytes, const std::vector<ArenaAllocator::Move>& keep)
+{
+	// Copying into a fresh buffer instead of within the old one: compaction moves may overlap
+	auto& device = RenderDevice::getInstance();
+	const unsigned int id = device.createBuffer();
+	device.bindBuffer(_target, id);
+	device.bufferData(_target, bytes, nullptr, RenderDevice::Usage::Static);
+	if (_id) {
+		for (const auto& move : keep) device.copyBuffer(_id, id, move.from, move.to, move.size);
+		device.deleteBuffer(_id);
+	}
+	_id = id;
+	auto& tracker = MemoryTracker::getInstance();
+	if (_size) tracker.releaseGpu(gpuKind(_target), _size);
+	tracker.allocateGpu(gpuKind(_target), bytes);
+	_size = bytes;
+}
+
+void DeviceArenaBuffer::write(size_t offset, const void* data, size_t bytes)
+{
+	auto& device = RenderDevice::getInstance();
+	device.bindBuffer(_target, _id);
+	device.bufferSubData(_target, offset, bytes, data);
+}
+
+void DeviceArenaBuffer::bind() const
+{
+	RenderDevice::getInstance().bindBuffer(_target, _id);
+}
+
+void MockArenaBuffer::resize(size_t size, const std::vector<ArenaAllocator::Move>& keep)
+{
+	std::vector<unsigned char> resized(size);
+	for (const auto& move : keep) {
+		std::memcpy(resized.data() + move.to, bytes.data() + move.from, move.size);
+		bytesCopied += move.size;
+	}
+	bytes.swap(resized);
+	++resizes;
+}
+
+void MockArenaBuffer::write(size_t offset, const void* data, size_t size)
+{
+	std::memcpy(bytes.data() + offset, data, size);
+	++writes;
+}
+
+GeometryArena::Allocation::Allocation(Allocation&& other) noexcept :
+	_arena(other._arena), _vertices(other._vertices), _indices(other._indices)
+{
+	other._arena = nullptr;
+}
+
+GeometryArena::Allocation& GeometryArena::Allocation::operator=(Allocation&& other) noexcept
+{
+	if (this != &other) {
+		reset();
+		_arena = other._arena;
+		_vertices = other._vertices;
+		_indices = other._indices;
+		other._arena = nullptr;
+	}
+	return *this;
+}
+
+GeometryArena::Allocation::~Allocation()
+{
+	reset();
+}
+
+void GeometryArena::Allocation::reset()
+{
+	if (_arena) _arena->free(*this);
+	_arena = nullptr;
+}
+
+size_t GeometryArena::Allocation::baseVertex() const
+{
+	return _arena->_vertexSlots.offset(_vertices);
+}
+
+size_t GeometryArena::Allocation::firstIndex() const
+{
+	return _indices ? _arena->_indexSlots.offset(_indices) : 0;
+}
+
+GeometryArena& GeometryArena::getInstance()
+{
+	// Never destroyed: meshes in static scene objects give their ranges back after any function-local static is gone
+	static GeometryArena* instance = new GeometryArena();
+	return *instance;
+}
+
+GeometryArena::GeometryArena(BufferFactory factory) :
+	_factory(std::move(factory))
+{
+	if (_factory) {
+		_checked = _available = true;
+	}
+	else {
+		_factory = [](bool indices) { return std::make_unique<DeviceArenaBuffer>(indices ? RenderDevice::Buffer::Index : RenderDevice::Buffer::Vertex); };
+	}
+}
+
+bool GeometryArena::available()
+{
+	if (!_checked) {
+		_checked = true;
+		_available = RenderDevice::getInstance().supports(RenderDevice::Feature::BaseVertex);
+	}
+	return _available;
+}
+
+std::vector<std::pair<ArenaBuffer*, size_t>> GeometryArena::vertexBuffers()
+{
+	std::vector<std::pair<ArenaBuffer*, size_t>> buffers;
+	for (int s = 0; s < StreamCount; ++s) {
+		if (_streams[s]) buffers.emplace_back(_streams[s].get(), kStride[s]);
+	}
+	return buffers;
+}
+
+void GeometryArena::reserve(ArenaAllocator& slots, size_t size, size_t initial, std::vector<std::pair<ArenaBuffer*, size_t>> buffers)
+{
+	const auto stats = slots.stats();
+	if (stats.largestFree >= size) return;
+
+	if (stats.freeSpace >= size && stats.fragmentation() >= settings.compactFragmentation) {
+		compact(slots, buffers);
+		return;
+	}
+
+	const size_t old = slots.capacity();
+	size_t capacity = std::max(initial, old * 2);
+	while (capacity - old < size) capacity *= 2;
+	slots.grow(capacity);
+	for (auto& [buffer, stride] : buffers) {
+		if (old) buffer->resize(capacity * stride, { { 0, 0, old * stride } });
+		else buffer->resize(capacity * stride, {});
+	}
+	if (old) ++_grows;
+}
+
+GeometryArena::Allocation GeometryArena::allocate(size_t vertexCount, size_t indexCount)
+{
+	Allocation allocation;
+	if (!vertexCount || !available()) return allocation;
+
+	if (!_streams[Positions]) _streams[Positions] = _factory(false);
+	if (!_indexBuffer) _indexBuffer = _factory(true);
+
+	reserve(_vertexSlots, vertexCount, settings.initialVertices, vertexBuffers());
+	if (indexCount) reserve(_indexSlots, indexCount, settings.initialIndices, { { _indexBuffer.get(), sizeof(unsigned int) } });
+
+	allocation._arena = this;
+	allocation._vertices = _vertexSlots.allocate(vertexCount);
+	allocation._indices = _indexSlots.allocate(indexCount);
+	return allocation;
+}
+
+void GeometryArena::free(Allocation& allocation)
+{
+	_vertexSlots.free(allocation._vertices);
+	_indexSlots.free(allocation._indices);
+	allocation._vertices = allocation._indices = ArenaAllocator::kInvalid;
+}
+
+void GeometryArena::write(const Allocation& allocation, Stream stream, const void* data, size_t vertexCount)
+{
+	if (!allocation || !vertexCount) return;
+
+	auto& buffer = _streams[stream];
+	if (!buffer) {
+		buffer = _factory(false);
+		buffer->resize(_vertexSlots.capacity() * kStride[stream], {});
+	}
+	vertexCount = std::min(vertexCount, _vertexSlots.size(allocation._vertices));
+	buffer->write(allocation.baseVertex() * kStride[stream], data, vertexCount * kStride[stream]);
+}
+
+void GeometryArena::writeIndices(const Allocation& allocation, const unsigned int* indices, size_t indexCount)
+{
+	if (!allocation || !indexCount) return;
+	indexCount = std::min(indexCount, _indexSlots.size(allocation._indices));
+	_indexBuffer->write(allocation.firstIndex() * sizeof(unsigned int), indices, indexCount * sizeof(unsigned int));
+}
+
+void GeometryArena::bindArrays() const
+{
+	auto& device = RenderDevice::getInstance();
+	if (_streams[TexCoords]) {
+		_streams[TexCoords]->bind();
+		device.arrayPointer(RenderDevice::ClientArray::TexCoord, 2, RenderDevice::ComponentType::Float, 0, 0);
+	}
+	if (_streams[Normals]) {
+		_streams[Normals]->bind();
+		device.arrayPointer(RenderDevice::ClientArray::Normal, 3, RenderDevice::ComponentType::Float, 0, 0);
+	}
+	if (_streams[Colors]) {
+		_streams[Colors]->bind();
+		device.arrayPointer(RenderDevice::ClientArray::Color, 3, RenderDevice::ComponentType::UnsignedByte, 0, 0);
+	}
+	if (_streams[Positions]) {
+		_streams[Positions]->bind();
+		device.arrayPointer(RenderDevice::ClientArray::Vertex, 3, RenderDevice::ComponentType::Float, 0, 0);
+	}
+	if (_indexBuffer) _indexBuffer->bind();
+}
+
+void GeometryArena::compact(ArenaAllocator& slots, const std::vector<std::pair<ArenaBuffer*, size_t>>& buffers)
+{
+	const auto moves = slots.compact();
+	for (auto& [buffer, stride] : buffers) {
+		std::vector<ArenaAllocator::Move> bytes;
+		bytes.reserve(moves.size());
+		for (const auto& move : moves) bytes.push_back({ move.from * stride, move.to * stride, move.size * stride });
+		buffer->resize(buffer->size(), bytes);
+	}
+	++_compactions;
+}
+
+void GeometryArena::defragment()
+{
+	if (!_vertexSlots.isCompact()) compact(_vertexSlots, vertexBuffers());
+	if (_indexBuffer && !_indexSlots.isCompact()) compact(_indexSlots, { { _indexBuffer.get(), sizeof(unsigned int) } });
+}
+
+GeometryArena::Stats GeometryArena::stats() const
+{
+	Stats stats;
+	stats.vertices = _vertexSlots.stats();
+	stats.indices = _indexSlots.stats();
+	for (const auto& stream : _streams) {
+		if (stream) stats.gpuBytes += stream->size();
+	}
+	if (_indexBuffer) stats.gpuBytes += _indexBuffer->size();
+	stats.grows = _grows;
+	stats.compactions = _compactions;
+	return stats;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "ArenaAllocator.h"
+#include "RenderDevice.h"
+
+// Storage behind one arena stream. resize() replaces the storage with a new one of the given size and copies the
+// listed ranges (in bytes) over from the old one; that covers both growing and compaction.
+class ArenaBuffer
+{
+public:
+	virtual ~ArenaBuffer() = default;
+	virtual void resize(size_t bytes, const std::vector<ArenaAllocator::Move>& keep) = 0;
+	virtual void write(size_t offset, const void* data, size_t bytes) = 0;
+	virtual void bind() const = 0;
+	virtual size_t size() const = 0;
+};
+
+// A buffer on the installed RenderDevice
+class DeviceArenaBuffer : public ArenaBuffer
+{
+	unsigned int _id = 0;
+	RenderDevice::Buffer _target;
+	size_t _size = 0;
+
+public:
+	explicit DeviceArenaBuffer(RenderDevice::Buffer target) : _target(target) {}
+	~DeviceArenaBuffer() override;
+
+	void resize(size_t bytes, const std::vector<ArenaAllocator::Move>& keep) override;
+	void write(size_t offset, const void* data, size_t bytes) override;
+	void bind() const override;
+	size_t size() const override { return _size; }
+};
+
+// Keeps the bytes in RAM and counts what would have reached the device, so the arena's contents can be checked
+class MockArenaBuffer : public ArenaBuffer
+{
+public:
+	std::vector<unsigned char> bytes;
+	size_t resizes = 0;
+	size_t writes = 0;
+	size_t bytesCopied = 0;
+	mutable size_t binds = 0;
+
+	void resize(size_t bytes, const std::vector<ArenaAllocator::Move>& keep) override;
+	void write(size_t offset, const void* data, size_t bytes) override;
+	void bind() const override { ++binds; }
+	size_t size() const override { return bytes.size(); }
+};
+
+// A few large buffers shared by every mesh. Vertices are handed out in slots that are valid across all attribute
+// streams, so a mesh is one base vertex plus one index range, and after binding the arena once any mesh in it is
+// drawn with a base-vertex draw. A stream's buffer is only created once some mesh writes that attribute, but
+// it then spans every slot. Indices stay mesh-local.
+//
+// When an allocation does not fit, the arena compacts if there is enough free space in total and it is splintered
+// past settings.compactFragmentation, and grows (doubling) otherwise.
+class GeometryArena
+{
+public:
+	enum Stream { Positions, Normals, TexCoords, Colors, StreamCount };
+	static constexpr size_t kStride[StreamCount] = { 12, 12, 8, 3 };
+
+	using BufferFactory = std::function<std::unique_ptr<ArenaBuffer>(bool indices)>;
+
+	struct Settings
+	{
+		size_t initialVertices = 1 << 18;
+		size_t initialIndices = 1 << 20;
+		double compactFragmentation = 0.5;
+	};
+
+	struct Stats
+	{
+		ArenaAllocator::Stats vertices;
+		ArenaAllocator::Stats indices;
+		size_t gpuBytes = 0;
+		size_t grows = 0;
+		size_t compactions = 0;
+	};
+
+	// Owns one mesh's vertex slots and index range and gives them back on destruction
+	class Allocation
+	{
+		GeometryArena* _arena = nullptr;
+		ArenaAllocator::Handle _vertices = ArenaAllocator::kInvalid;
+		ArenaAllocator::Handle _indices = ArenaAllocator::kInvalid;
+		friend class GeometryArena;
+
+	public:
+		Allocation() = default;
+		Allocation(Allocation&& other) noexcept;
+		Allocation& operator=(Allocation&& other) noexcept;
+		Allocation(const Allocation&) = delete;
+		Allocation& operator=(const Allocation&) = delete;
+		~Allocation();
+
+		explicit operator bool() const { return _arena != nullptr; }
+		GeometryArena* arena() const { return _arena; }
+		size_t baseVertex() const;
+		size_t firstIndex() const;
+		void reset();
+	};
+
+	Settings settings;
+
+	static GeometryArena& getInstance();
+
+	// Without a factory the arena uses device buffers and is only available where the device supports base-vertex draws
+	explicit GeometryArena(BufferFactory factory = {});
+
+	bool available();
+
+	Allocation allocate(size_t vertexCount, size_t indexCount);
+	void write(const Allocation& allocation, Stream stream, const void* data, size_t vertexCount);
+	void writeIndices(const Allocation& allocation, const unsigned int* indices, size_t indexCount);
+
+	// Binds the index buffer and points every existing stream's array at offset 0
+	void bindArrays() const;
+	// Packs all allocations together now, regardless of fragmentation
+	void defragment();
+
+	Stats stats() const;
+	const ArenaBuffer* buffer(Stream stream) const { return _streams[stream].get(); }
+	const ArenaBuffer* indexBuffer() const { return _indexBuffer.get(); }
+
+private:
+	BufferFactory _factory;
+	bool _checked = false;
+	bool _available = false;
+	ArenaAllocator _vertexSlots;
+	ArenaAllocator _indexSlots;
+	std::array<std::unique_ptr<ArenaBuffer>, StreamCount> _streams;
+	std::unique_ptr<ArenaBuffer> _indexBuffer;
+	size_t _grows = 0;
+	size_t _compactions = 0;
+
+	void free(Allocation& allocation);
+	void compact(ArenaAllocator& slots, const std::vector<std::pair<ArenaBuffer*, size_t>>& buffers);
+	// Makes room for size more units in slots, compacting or growing the given buffers
+	void reserve(ArenaAllocator& slots, size_t size, size_t initial, std::vector<std::pair<ArenaBuffer*, size_t>> buffers);
+	std::vector<std::pair<ArenaBuffer*, size_t>> vertexBuffers();
+};
@@ -1,65 +1,90 @@
-#include <GL/glew.h>
 #include "Image.h"
+#include "ImageDecoder.h"
+#include "RenderDevice.h"
+#include <filesystem>
 #include <vector>
 
 
 Image::~Image() {
-	if (_id) glDeleteTextures(1, &_id);
+	if (_id) RenderDevice::getInstance().deleteTexture(_id);
+	setGpuBytes(0);
 }
 
 Image::Image(Image&& other) noexcept :
 	_id(other._id),
 	_width(other._width),
 	_height(other._height),
-	_channels(other._channels) {
+	_channels(other._channels),
+	_levels(other._levels),
+	_format(other._format),
+	_gpuBytes(other._gpuBytes),
+	_mips(std::move(other._mips)) {
 	other._id = 0;
+	other._gpuBytes = 0;
+	updateCpuMemory();
+	other.updateCpuMemory();
+}
+
+void Image::setGpuBytes(size_t bytes) {
+	auto& tracker = MemoryTracker::getInstance();
+	if (_gpuBytes) tracker.releaseGpu(GpuMemory::Textures, _gpuBytes);
+	if (bytes) tracker.allocateGpu(GpuMemory::Textures, bytes);
+	_gpuBytes = bytes;
 }
 
 void Image::bind() const {
-	glBindTexture(GL_TEXTURE_2D, _id);
+	RenderDevice::getInstance().bindTexture(_id);
 }
 
-static auto formatFromChannels(int channels) {
-	switch (channels) {
-	case 1: return GL_LUMINANCE;
-	case 2: return GL_LUMINANCE_ALPHA;
-	case 3: return GL_RGB;
-	case 4: return GL_RGBA;
-	default: return GL_RGB;
-	}
+void Image::load(int width, int height, int channels, void* data) {
+	load(MipGen::build(data, width, height, channels));
 }
 
-static int rowAlignment(int width, int channels) {
-	const size_t rowSizeInBytes = static_cast<size_t>(width) * channels;
-	if ((rowSizeInBytes % 8) == 0) return 8;
-	if ((rowSizeInBytes % 4) == 0) return 4;
-	if ((rowSizeInBytes % 2) == 0) return 2;
-	return 1;
+void Image::load(MipChain&& mips) {
+	loadLevels(mips.width, mips.height, mips.channels, mips.levels.data(), mips.levels.size(), mips.pixels.data(), mips.format);
+	_mips = std::move(mips);
+	_dataCache.clear();
+	updateCpuMemory();
 }
 
-void Image::load(int width, int height, int channels, void* data) {
+void Image::loadLevels(unsigned int width, unsigned int height, unsigned int channels, const MipLevel* levels, size_t levelCount, const unsigned char* base, BlockFormat format) {
 	_width = width;
 	_height = height;
 	_channels = channels;
-	_data = std::make_unique<char[]>(width * height * channels);
+	_levels = static_cast<unsigned int>(levelCount);
+	_format = format;
+	_mips = MipChain();
+	std::vector<unsigned char>().swap(_dataCache);
+	updateCpuMemory();
 
-	if (!_id) glGenTextures(1, &_id);
+	auto& device = RenderDevice::getInstance();
+	if (!_id) _id = device.createTexture();
 
 	bind();
-	glPixelStorei(GL_UNPACK_ALIGNMENT, rowAlignment(width, channels));
-	glTexImage2D(GL_TEXTURE_2D, 0, channels, width, height, 0, formatFromChannels(channels), GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	size_t gpuBytes = 0;
+	for (size_t i = 0; i < levelCount; ++i) {
+		const MipLevel& level = levels[i];
+		device.textureImage(static_cast<unsigned int>(i), level.width, level.height, channels, format, base + level.offset, level.size);
+		gpuBytes += level.size;
+	}
+	setGpuBytes(gpuBytes);
+	device.textureLevels(0, levelCount ? static_cast<unsigned int>(levelCount - 1) : 0);
+	device.textureSampler(RenderDevice::Wrap::Repeat, RenderDevice::Filter::NearestMipmapNearest, RenderDevice::Filter::Nearest);
 }
 
 void Image::LoadTexture(const std::string& path)
 {
+	ImageDecoder::Job job{ path };
+	if (ImageDecoder::isSupported(path) && ImageDecoder::decodeFile(job)) {
+		load(job.info.width, job.info.height, job.info.channels, job.pixels.data());
+		return;
+	}
+
+	// Anything stb cannot read falls back to DevIL
+	std::lock_guard<std::mutex> lock(devilMutex());
 	auto img = ilGenImage();
 	ilBindImage(img);
-	ilLoadImage((const wchar_t*)path.c_str());
+	ilLoadImage(std::filesystem::path(path).c_str());
 	auto width = ilGetInteger(IL_IMAGE_WIDTH);
 
 	auto height = ilGetInteger(IL_IMAGE_HEIGHT);
@@ -76,12 +101,16 @@ void Image::LoadTexture(const std::string& path)
 	ilDeleteImage(img);
 }
 
+std::mutex& Image::devilMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
 const std::vector<unsigned char>& Image::rawData() const {
-	if (_dataCache.empty()) {
-		_dataCache.resize(_width * _height * _channels);
-		bind();
-		glGetTexImage(GL_TEXTURE_2D, 0, formatFromChannels(_channels), GL_UNSIGNED_BYTE, _dataCache.data());
+	if (_dataCache.empty() && !_mips.empty() && _mips.format == BlockFormat::None) {
+		_dataCache.assign(_mips.level(0), _mips.level(0) + _mips.levels[0].size);
+		updateCpuMemory();
 	}
 	return _dataCache;
 }
-
@@ -6,6 +6,11 @@
 #include <IL/il.h>
 #include <IL/ilu.h>
 #include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "MemoryTracker.h"
+#include "MipChain.h"
 
 class Image {
 
@@ -13,17 +18,32 @@ class Image {
 	unsigned short _width = 0;
 	unsigned short _height = 0;
 	unsigned char _channels = 0;
-	std::unique_ptr<char[]> _data;
+	unsigned int _levels = 0;
+	BlockFormat _format = BlockFormat::None;
+	size_t _gpuBytes = 0;
+
+	// CPU copy of every level; empty for images uploaded straight from a cooked file
+	MipChain _mips;
 
 	mutable std::vector<unsigned char> _dataCache;
+	mutable TrackedBytes _cpuMemory{ MemoryTag::Textures };
+
+	// Charges the CPU copy and the level 0 cache to MemoryTag::Textures
+	void updateCpuMemory() const { _cpuMemory.set(_mips.pixels.capacity() + _dataCache.capacity()); }
+	void setGpuBytes(size_t bytes);
 
 public:
 	unsigned int id() const { return _id; }
 	auto width() const { return _width; }
 	auto height() const { return _height; }
 	auto channels() const { return _channels; }
-	const char* data() const { return _data.get(); }
-	char* data() { return _data.get(); }
+	auto levels() const { return _levels; }
+	auto format() const { return _format; }
+	// Bytes handed to GL over all levels (compressed size for block formats)
+	auto gpuBytes() const { return _gpuBytes; }
+	const char* data() const { return _mips.empty() ? nullptr : reinterpret_cast<const char*>(_mips.pixels.data()); }
+	char* data() { return _mips.empty() ? nullptr : reinterpret_cast<char*>(_mips.pixels.data()); }
+	const MipChain& mips() const { return _mips; }
 
 	Image() = default;
 	Image(const Image&) = delete;
@@ -33,10 +53,19 @@ public:
 	~Image();
 
 	void bind() const;
+	// Builds the mip chain on the CPU and uploads every level; the chain is kept as the CPU copy
 	void load(int width, int height, int channels, void* data);
+	void load(MipChain&& mips);
+	// Uploads levels found at base + level.offset (e.g. inside a memory-mapped file) without keeping a CPU copy.
+	// Block-compressed levels go through glCompressedTexImage2D.
+	void loadLevels(unsigned int width, unsigned int height, unsigned int channels, const MipLevel* levels, size_t levelCount, const unsigned char* base, BlockFormat format = BlockFormat::None);
 	// Load Texture
 	void LoadTexture(const std::string& path);
 
+	// DevIL keeps one bound image for the whole process; held around every use of it, on any thread
+	static std::mutex& devilMutex();
+
+	// Level 0 pixels from the CPU copy (empty when there is none or it is compressed); never reads back from the GPU
 	const std::vector<unsigned char>& rawData() const;
 };
 
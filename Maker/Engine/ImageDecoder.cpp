@@ -0,0 +1,86 @@
+#include "ImageDecoder.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <future>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_BMP
+#define STBI_ONLY_TGA
+#define STBI_NO_STDIO
+#include <stb_image.h>
+
+namespace ImageDecoder
+{
+	bool isSupported(const std::string& path)
+	{
+		const size_t dot = path.rfind('.');
+		if (dot == std::string::npos) return false;
+		std::string extension = path.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return extension == "png" || extension == "jpg" || extension == "jpeg" || extension == "bmp" || extension == "tga";
+	}
+
+	bool readFile(const std::string& path, std::vector<unsigned char>& bytes)
+	{
+		std::ifstream is(path, std::ios::binary | std::ios::ate);
+		if (!is.is_open()) return false;
+		const std::streamsize size = is.tellg();
+		if (size <= 0) return false;
+		bytes.resize(static_cast<size_t>(size));
+		is.seekg(0);
+		return static_cast<bool>(is.read(reinterpret_cast<char*>(bytes.data()), size));
+	}
+
+	bool probe(const unsigned char* encoded, size_t size, Info& info)
+	{
+		int w, h, comp;
+		if (!stbi_info_from_memory(encoded, static_cast<int>(size), &w, &h, &comp)) return false;
+		info.width = w;
+		info.height = h;
+		info.channels = comp;
+		return true;
+	}
+
+	bool decode(const unsigned char* encoded, size_t size, unsigned char* pixels, size_t capacity, Info& info)
+	{
+		int w, h, comp;
+		stbi_uc* decoded = stbi_load_from_memory(encoded, static_cast<int>(size), &w, &h, &comp, 0);
+		if (!decoded) return false;
+
+		info.width = w;
+		info.height = h;
+		info.channels = comp;
+		const bool fits = info.bytes() <= capacity;
+		if (fits) std::memcpy(pixels, decoded, info.bytes());
+		stbi_image_free(decoded);
+		return fits;
+	}
+
+	bool decodeFile(Job& job)
+	{
+		PROFILE_SCOPE("ImageDecoder::decodeFile");
+		std::vector<unsigned char> encoded;
+		job.ok = readFile(job.path, encoded) && probe(encoded.data(), encoded.size(), job.info);
+		if (!job.ok) return false;
+
+		job.pixels.resize(job.info.bytes());
+		job.ok = decode(encoded.data(), encoded.size(), job.pixels.data(), job.pixels.size(), job.info);
+		return job.ok;
+	}
+
+	void decodeFiles(std::vector<Job>& jobs)
+	{
+		std::vector<std::future<bool>> pending;
+		pending.reserve(jobs.size());
+		for (auto& job : jobs) {
+			pending.push_back(ThreadPool::getInstance().submit([&job]() { return decodeFile(job); }));
+		}
+		for (auto& result : pending) result.wait();
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Re-entrant PNG / JPG / BMP / TGA decoding (stb_image). Unlike DevIL there is no bound-image state,
+// so any number of images can be decoded at once from any thread. Rows come out top row first for
+// every format, TGA included.
+namespace ImageDecoder
+{
+	struct Info
+	{
+		unsigned int width = 0;
+		unsigned int height = 0;
+		unsigned int channels = 0;
+
+		size_t bytes() const { return static_cast<size_t>(width) * height * channels; }
+	};
+
+	struct Job
+	{
+		std::string path;
+		Info info;
+		std::vector<unsigned char> pixels;
+		bool ok = false;
+
+		Job() = default;
+		explicit Job(std::string path) : path(std::move(path)) {}
+	};
+
+	bool isSupported(const std::string& path);
+	bool readFile(const std::string& path, std::vector<unsigned char>& bytes);
+
+	// Reads the header only
+	bool probe(const unsigned char* encoded, size_t size, Info& info);
+
+	// Decodes into a caller-owned buffer of at least capacity bytes (Info::bytes() from probe), keeping the file's channel count
+	bool decode(const unsigned char* encoded, size_t size, unsigned char* pixels, size_t capacity, Info& info);
+
+	// Reads, probes, sizes job.pixels and decodes into it
+	bool decodeFile(Job& job);
+
+	// decodeFile for every job, spread over the ThreadPool; returns once all are done
+	void decodeFiles(std::vector<Job>& jobs);
+}
@@ -0,0 +1,106 @@
+#include "InstancedDrawer.h"
+#include "Mesh.h"
+#include "Log.h"
+#include "RenderDevice.h"
+#include <string>
+
+namespace
+{
+	const char* kVertexShader = R"(#version 120
+attribute mat4 instanceModel;
+varying vec2 texCoord;
+void main()
+{
+	gl_Position = gl_ModelViewProjectionMatrix * (instanceModel * gl_Vertex);
+	gl_FrontColor = gl_Color;
+	texCoord = gl_MultiTexCoord0.xy;
+}
+)";
+
+	const char* kFragmentShader = R"(#version 120
+uniform sampler2D texture0;
+uniform bool textured;
+varying vec2 texCoord;
+void main()
+{
+	vec4 color = gl_Color;
+	if (textured) color *= texture2D(texture0, texCoord);
+	gl_FragColor = color;
+}
+)";
+}
+
+InstancedDrawer::~InstancedDrawer()
+{
+	if (_program) RenderDevice::getInstance().deleteProgram(_program);
+}
+
+bool InstancedDrawer::compile()
+{
+	auto& device = RenderDevice::getInstance();
+	if (!device.supports(RenderDevice::Feature::Instancing)) return false;
+
+	// Locations 4-7 are not aliased by the vertex, normal, colour or texcoord arrays on any driver
+	std::string log;
+	_program = device.createProgram(kVertexShader, kFragmentShader, { { kMatrixAttribute, "instanceModel" } }, log);
+	if (!_program) {
+		LOG_ERROR(Log::Render, "Instancing program: %s", log.c_str());
+		return false;
+	}
+
+	_texturedLocation = device.uniformLocation(_program, "textured");
+	device.useProgram(_program);
+	device.uniform(device.uniformLocation(_program, "texture0"), 0);
+	device.useProgram(0);
+	return true;
+}
+
+bool InstancedDrawer::available()
+{
+	if (!_tried) {
+		_tried = true;
+		_available = compile();
+		if (!_available) LOG_WARNING(Log::Render, "Instanced drawing unavailable, repeated meshes are drawn one by one");
+	}
+	return _available;
+}
+
+void InstancedDrawer::upload(const std::vector<glm::mat4>& matrices)
+{
+	_instances.streamData(matrices.data(), matrices.size() * sizeof(glm::mat4));
+}
+
+void InstancedDrawer::begin()
+{
+	auto& device = RenderDevice::getInstance();
+	device.useProgram(_program);
+	for (unsigned int column = 0; column < 4; ++column) {
+		device.enableAttribute(kMatrixAttribute + column);
+		device.attributeDivisor(kMatrixAttribute + column, 1);
+	}
+}
+
+void InstancedDrawer::draw(const Mesh& mesh, size_t first, size_t count, bool textured)
+{
+	auto& device = RenderDevice::getInstance();
+	device.uniform(_texturedLocation, textured ? 1 : 0);
+
+	// Pointing the attributes at the group's slice stands in for a base instance, which 3.3 does not have
+	_instances.bind();
+	const size_t offset = first * sizeof(glm::mat4);
+	for (unsigned int column = 0; column < 4; ++column) {
+		device.attributePointer(kMatrixAttribute + column, 4, sizeof(glm::mat4), offset + column * sizeof(glm::vec4));
+	}
+	mesh.drawInstanced(count);
+}
+
+void InstancedDrawer::end()
+{
+	auto& device = RenderDevice::getInstance();
+	for (unsigned int column = 0; column < 4; ++column) {
+		device.attributeDivisor(kMatrixAttribute + column, 0);
+		device.disableAttribute(kMatrixAttribute + column);
+	}
+	device.bindBuffer(RenderDevice::Buffer::Vertex, 0);
+	device.useProgram(0);
+}
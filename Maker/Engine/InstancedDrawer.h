@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "BufferObject.h"
+
+class Mesh;
+
+// Draws many copies of a mesh with one glDrawElementsInstanced. The fixed-function pipeline has no per-instance
+// transform, so a GLSL 1.20 program stands in for it: positions go through the instance's model matrix (vertex
+// attributes 4-7, advanced once per instance) and then the compatibility modelview / projection, and the current
+// colour or colour array is modulated by the bound texture as GL_MODULATE would.
+class InstancedDrawer
+{
+	unsigned int _program = 0;
+	int _texturedLocation = -1;
+	bool _tried = false;
+	bool _available = false;
+	BufferObject _instances;
+
+	bool compile();
+
+public:
+	static constexpr unsigned int kMatrixAttribute = 4;
+
+	InstancedDrawer() = default;
+	InstancedDrawer(const InstancedDrawer&) = delete;
+	InstancedDrawer& operator=(const InstancedDrawer&) = delete;
+	~InstancedDrawer();
+
+	// Builds the program on first call; false if the context lacks GL 3.3 or the program does not link
+	bool available();
+
+	// Replaces the frame's instance matrices
+	void upload(const std::vector<glm::mat4>& matrices);
+
+	void begin();
+	// Mesh arrays and texture must already be bound; draws instances [first, first + count) of the uploaded matrices
+	void draw(const Mesh& mesh, size_t first, size_t count, bool textured);
+	void end();
+};
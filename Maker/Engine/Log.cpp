@@ -0,0 +1,247 @@
+#include "Log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+	const auto kEpoch = std::chrono::steady_clock::now();
+
+	int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - kEpoch).count();
+	}
+}
+
+Log& Log::getInstance()
+{
+	// Never destroyed: anything torn down with the statics may still log on its way out
+	static Log* instance = new Log();
+	return *instance;
+}
+
+const char* Log::levelName(Level level)
+{
+	switch (level) {
+	case Trace: return "Trace";
+	case Debug: return "Debug";
+	case Info: return "Info";
+	case Warning: return "Warning";
+	case Error: return "Error";
+	default: return "";
+	}
+}
+
+const char* Log::categoryName(Category category)
+{
+	switch (category) {
+	case General: return "General";
+	case Render: return "Render";
+	case Assets: return "Assets";
+	case Scene: return "Scene";
+	case Editor: return "Editor";
+	default: return "";
+	}
+}
+
+Log::Log() :
+	_slots(new Slot[kSlots])
+{
+	for (size_t i = 0; i < kSlots; ++i) _slots[i].sequence.store(i, std::memory_order_relaxed);
+	_sink = std::thread(&Log::run, this);
+	// The sink is never joined, so what is still in the ring at exit is written out here
+	std::atexit([] { getInstance().flush(); });
+}
+
+Log::~Log()
+{
+	_running = false;
+	if (_sink.joinable()) _sink.join();
+}
+
+void Log::write(Level level, Category category, const char* format, ...)
+{
+	if (level < minLevel.load(std::memory_order_relaxed)) return;
+
+	// Claim a position whose slot the sink has released; a slot still a lap behind means the ring is full
+	uint64_t position = _tail.load(std::memory_order_relaxed);
+	Slot* slot = nullptr;
+	for (;;) {
+		slot = &_slots[position % kSlots];
+		const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+		const int64_t lag = static_cast<int64_t>(sequence - position);
+		if (lag == 0) {
+			if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+		}
+		else if (lag < 0) {
+			if (dropWhenFull.load(std::memory_order_relaxed)) {
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			std::this_thread::yield();
+			position = _tail.load(std::memory_order_relaxed);
+		}
+		else position = _tail.load(std::memory_order_relaxed);
+	}
+
+	slot->time = now();
+	slot->level = level;
+	slot->category = category;
+	va_list args;
+	va_start(args, format);
+	const int length = std::vsnprintf(slot->text, kMessageBytes, format, args);
+	va_end(args);
+	slot->length = length < 0 ? 0 : static_cast<uint32_t>(std::min<size_t>(length, kMessageBytes - 1));
+	slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+void Log::run()
+{
+	while (_running.load(std::memory_order_relaxed)) {
+		if (!drain()) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	drain();
+}
+
+bool Log::drain()
+{
+	// File lines are gathered under the history lock and written once it is released, so the console
+	// never waits on the disk
+	std::string pending;
+	bool drained = false;
+	uint64_t position = _consumed.load(std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (;; ++position) {
+			Slot& slot = _slots[position % kSlots];
+			if (slot.sequence.load(std::memory_order_acquire) != position + 1) break;
+			append(slot.time, slot.level, slot.category, slot.text, slot.length, pending);
+			slot.sequence.store(position + kSlots, std::memory_order_release);
+			drained = true;
+		}
+
+		const size_t dropped = _dropped.load(std::memory_order_relaxed);
+		if (dropped != _droppedReported) {
+			char text[64];
+			const int length = std::snprintf(text, sizeof(text), "%zu messages dropped, the log ring was full", dropped - _droppedReported);
+			append(now(), Warning, General, text, static_cast<size_t>(std::max(length, 0)), pending);
+			_droppedReported = dropped;
+			drained = true;
+		}
+	}
+
+	if (!pending.empty()) {
+		std::lock_guard<std::mutex> lock(_fileMutex);
+		if (_file.is_open()) {
+			_file.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+			_file.flush();
+		}
+	}
+	// Published after the write, so flush() returns with the lines in the file too
+	_consumed.store(position, std::memory_order_release);
+	return drained;
+}
+
+void Log::append(int64_t time, Level level, Category category, const char* text, size_t length, std::string& fileLines)
+{
+	// One history line per text line, so every console row is the same height
+	const char* end = text + length;
+	for (const char* begin = text; ; ) {
+		const char* newline = std::find(begin, end, '\n');
+		_entries.push_back({ _text.size(), static_cast<uint32_t>(newline - begin), level, category, time });
+		_text.append(begin, newline);
+		if (newline == end) break;
+		begin = newline + 1;
+	}
+	if (_fileOpen.load(std::memory_order_relaxed)) {
+		char prefix[48];
+		const int prefixLength = std::snprintf(prefix, sizeof(prefix), "[%10.3f] %-7s %-7s ", time / 1e9, levelName(level), categoryName(category));
+		fileLines.append(prefix, static_cast<size_t>(std::clamp(prefixLength, 0, int(sizeof(prefix)) - 1)));
+		fileLines.append(text, length);
+		fileLines += '\n';
+	}
+
+	const size_t limit = std::max<size_t>(historyLimit.load(std::memory_order_relaxed), 2);
+	if (_entries.size() > limit) {
+		// Dropping half at once keeps trimming amortised constant per line
+		const size_t drop = _entries.size() / 2;
+		const size_t bytes = _entries[drop].offset;
+		_text.erase(0, bytes);
+		_entries.erase(_entries.begin(), _entries.begin() + drop);
+		for (auto& entry : _entries) entry.offset -= bytes;
+		_first += drop;
+	}
+}
+
+bool Log::setFile(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(_fileMutex);
+	if (_file.is_open()) _file.close();
+	if (!path.empty()) _file.open(path, std::ios::app);
+	_fileOpen.store(_file.is_open(), std::memory_order_relaxed);
+	return path.empty() || _file.is_open();
+}
+
+void Log::flush()
+{
+	const uint64_t target = _tail.load(std::memory_order_acquire);
+	while (_consumed.load(std::memory_order_acquire) < target && _sink.joinable()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+size_t Log::firstLine() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _first;
+}
+
+size_t Log::endLine() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _first + _entries.size();
+}
+
+void Log::lines(size_t first, size_t count, std::vector<Line>& out) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	out.clear();
+	const size_t begin = std::max(first, _first);
+	const size_t end = std::min(first + count, _first + _entries.size());
+	for (size_t i = begin; i < end; ++i) {
+		const Entry& entry = _entries[i - _first];
+		out.push_back({ entry.time, entry.level, entry.category, _text.substr(entry.offset, entry.length) });
+	}
+}
+
+void Log::lines(const size_t* indices, size_t count, std::vector<Line>& out) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	out.clear();
+	for (size_t i = 0; i < count; ++i) {
+		if (indices[i] < _first || indices[i] >= _first + _entries.size()) continue;
+		const Entry& entry = _entries[indices[i] - _first];
+		out.push_back({ entry.time, entry.level, entry.category, _text.substr(entry.offset, entry.length) });
+	}
+}
+
+size_t Log::match(size_t first, Level level, int category, std::vector<size_t>& out) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	const size_t end = _first + _entries.size();
+	for (size_t i = std::max(first, _first); i < end; ++i) {
+		const Entry& entry = _entries[i - _first];
+		if (entry.level >= level && (category < 0 || entry.category == category)) out.push_back(i);
+	}
+	return end;
+}
+
+void Log::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_first += _entries.size();
+	_entries.clear();
+	_text.clear();
+}
@@ -1,25 +1,139 @@
 #pragma once
-#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+
+// Messages below this level are compiled out: 0 trace, 1 debug, 2 info, 3 warning, 4 error, 5 nothing
+#ifndef MAKER_LOG_LEVEL
+#ifdef NDEBUG
+#define MAKER_LOG_LEVEL 2
+#else
+#define MAKER_LOG_LEVEL 1
+#endif
+#endif
 
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG_PRINTF_FORMAT(formatIndex, firstArg) __attribute__((format(printf, formatIndex, firstArg)))
+#else
+#define LOG_PRINTF_FORMAT(formatIndex, firstArg)
+#endif
+
+// Asynchronous logger. Any thread formats its message straight into a slot of a bounded ring, claimed with one
+// compare-and-swap and no locks. When the ring is full the writer yields until the sink frees a slot, or with
+// dropWhenFull set gives up and counts the message instead (for threads that must never wait).
+// A background thread drains the ring into the history the console shows and into the log file, if one is open.
+//
+// The history keeps historyLimit lines; past that the oldest half goes. Lines are addressed by absolute index
+// (firstLine() moves up as lines are dropped), so a view can keep its place while the history is trimmed.
 class Log
 {
-protected:
-	Log() = default;
 public:
-	static Log& getInstance()
-	{
-		static Log instance;
-		return instance;
-	}
-	std::vector<std::string> logMessages;
-	void logMessage(const std::string& message)
+	enum Level { Trace, Debug, Info, Warning, Error, LevelCount };
+	enum Category { General, Render, Assets, Scene, Editor, CategoryCount };
+
+	static constexpr size_t kSlots = 4096;
+	static constexpr size_t kMessageBytes = 240;	// longer messages are cut
+
+	struct Line
 	{
-		logMessages.push_back(message);
-	}
+		int64_t time;	// nanoseconds since the log started
+		Level level;
+		Category category;
+		std::string text;
+	};
+
+	// Messages under this are discarded at runtime, before formatting
+	std::atomic<Level> minLevel{ Trace };
+	std::atomic<bool> dropWhenFull{ false };
+	std::atomic<size_t> historyLimit{ size_t(1) << 20 };
+
+	static Log& getInstance();
+	static const char* levelName(Level level);
+	static const char* categoryName(Category category);
+
+	void write(Level level, Category category, const char* format, ...) LOG_PRINTF_FORMAT(4, 5);
+
+	// Appends to path from now on; an empty path closes the file
+	bool setFile(const std::string& path);
+	// Returns once everything written before the call is in the history and the file
+	void flush();
+	// Messages lost to a full ring with dropWhenFull set
+	size_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+	size_t firstLine() const;
+	size_t endLine() const;
+	// Copies lines [first, first + count) that are still kept into out (replacing its contents)
+	void lines(size_t first, size_t count, std::vector<Line>& out) const;
+	// Same for the lines at the given absolute indices (a filtered view)
+	void lines(const size_t* indices, size_t count, std::vector<Line>& out) const;
+	// Appends the absolute index of every line from first on that passes the filter (category -1 for all);
+	// returns the index to continue from next time
+	size_t match(size_t first, Level level, int category, std::vector<size_t>& out) const;
+	void clear();
+
 	Log(const Log&) = delete;
 	Log(Log&&) = delete;
 	Log& operator=(const Log&) = delete;
 	Log& operator=(Log&&) = delete;
 
-};
\ No newline at end of file
+private:
+	struct Slot
+	{
+		// Vyukov's bounded queue: equal to the position when free for it, position + 1 once written
+		std::atomic<uint64_t> sequence{ 0 };
+		int64_t time = 0;
+		Level level = Info;
+		Category category = General;
+		uint32_t length = 0;
+		char text[kMessageBytes];
+	};
+
+	struct Entry
+	{
+		size_t offset;
+		uint32_t length;
+		Level level;
+		Category category;
+		int64_t time;
+	};
+
+	std::unique_ptr<Slot[]> _slots;
+	alignas(64) std::atomic<uint64_t> _tail{ 0 };	// next position to claim
+	alignas(64) std::atomic<uint64_t> _consumed{ 0 };	// positions the sink has finished with
+	std::atomic<size_t> _dropped{ 0 };
+	std::atomic<bool> _running{ true };
+	std::thread _sink;
+
+	// Sink side only; producers never take it
+	mutable std::mutex _mutex;
+	std::string _text;
+	std::vector<Entry> _entries;
+	size_t _first = 0;	// absolute index of _entries[0]
+	size_t _droppedReported = 0;
+
+	// Taken by the sink only around file writes, after it has let go of _mutex
+	std::mutex _fileMutex;
+	std::ofstream _file;
+	std::atomic<bool> _fileOpen{ false };
+
+	Log();
+	~Log();
+	void run();
+	// Moves whatever is ready out of the ring; returns false when there was nothing
+	bool drain();
+	// Adds the message to the history, and its file lines to fileLines when a file is open
+	void append(int64_t time, Level level, Category category, const char* text, size_t length, std::string& fileLines);
+};
+
+#define LOG_AT(level, category, ...) \
+	do { if constexpr (static_cast<int>(level) >= MAKER_LOG_LEVEL) Log::getInstance().write(level, category, __VA_ARGS__); } while (0)
+#define LOG_TRACE(category, ...) LOG_AT(Log::Trace, category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) LOG_AT(Log::Debug, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG_AT(Log::Info, category, __VA_ARGS__)
+#define LOG_WARNING(category, ...) LOG_AT(Log::Warning, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG_AT(Log::Error, category, __VA_ARGS__)
@@ -0,0 +1,81 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return;
+	_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		close();
+		return;
+	}
+	_size = static_cast<size_t>(size.QuadPart);
+
+	_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping) _data = static_cast<const unsigned char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data) close();
+}
+
+void MappedFile::close()
+{
+	if (_data) UnmapViewOfFile(_data);
+	if (_mapping) CloseHandle(_mapping);
+	if (_file) CloseHandle(_file);
+	_data = nullptr;
+	_mapping = nullptr;
+	_file = nullptr;
+	_size = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+{
+	_fd = open(path.c_str(), O_RDONLY);
+	if (_fd < 0) return;
+
+	struct stat st;
+	if (fstat(_fd, &st) != 0 || st.st_size == 0) {
+		close();
+		return;
+	}
+	_size = static_cast<size_t>(st.st_size);
+
+	void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+	if (data == MAP_FAILED) {
+		close();
+		return;
+	}
+	_data = static_cast<const unsigned char*>(data);
+}
+
+void MappedFile::close()
+{
+	if (_data) munmap(const_cast<unsigned char*>(_data), _size);
+	if (_fd >= 0) ::close(_fd);
+	_data = nullptr;
+	_fd = -1;
+	_size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
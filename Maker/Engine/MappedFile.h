@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file mapped into memory. The mapping lives as long as the object.
+class MappedFile
+{
+	const unsigned char* _data = nullptr;
+	size_t _size = 0;
+#ifdef _WIN32
+	void* _file = nullptr;
+	void* _mapping = nullptr;
+#else
+	int _fd = -1;
+#endif
+
+	void close();
+
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool isOpen() const { return _data != nullptr; }
+	const unsigned char* data() const { return _data; }
+	size_t size() const { return _size; }
+};
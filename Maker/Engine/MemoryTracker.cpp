@@ -0,0 +1,189 @@
+#include "MemoryTracker.h"
+#include <fstream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <sstream>
+#endif
+
+MemoryTracker& MemoryTracker::getInstance()
+{
+	// Never destroyed: global meshes and images give their bytes back while statics are torn down
+	static MemoryTracker* instance = new MemoryTracker();
+	return *instance;
+}
+
+const char* MemoryTracker::tagName(MemoryTag tag)
+{
+	switch (tag) {
+	case MemoryTag::Meshes: return "Meshes";
+	case MemoryTag::Textures: return "Textures";
+	case MemoryTag::Scene: return "Scene";
+	case MemoryTag::Components: return "Components";
+	case MemoryTag::Importer: return "Importer";
+	case MemoryTag::GUI: return "GUI";
+	default: return "";
+	}
+}
+
+const char* MemoryTracker::gpuName(GpuMemory kind)
+{
+	switch (kind) {
+	case GpuMemory::VertexBuffers: return "Vertex buffers";
+	case GpuMemory::IndexBuffers: return "Index buffers";
+	case GpuMemory::Textures: return "Textures";
+	default: return "";
+	}
+}
+
+void MemoryTracker::add(Counter& counter, size_t bytes)
+{
+	const size_t now = counter.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	size_t peak = counter.peak.load(std::memory_order_relaxed);
+	while (now > peak && !counter.peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+	counter.live.fetch_add(1, std::memory_order_relaxed);
+	counter.allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemoryTracker::remove(Counter& counter, size_t bytes)
+{
+	counter.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+	counter.live.fetch_sub(1, std::memory_order_relaxed);
+}
+
+MemoryTracker::Usage MemoryTracker::read(const Counter& counter, size_t budget)
+{
+	Usage usage;
+	usage.bytes = counter.bytes.load(std::memory_order_relaxed);
+	usage.peak = counter.peak.load(std::memory_order_relaxed);
+	usage.live = counter.live.load(std::memory_order_relaxed);
+	usage.allocations = counter.allocations.load(std::memory_order_relaxed);
+	usage.budget = budget;
+	return usage;
+}
+
+size_t MemoryTracker::Snapshot::cpuBytes() const
+{
+	size_t total = 0;
+	for (const auto& usage : cpu) total += usage.bytes;
+	return total;
+}
+
+size_t MemoryTracker::Snapshot::gpuBytes() const
+{
+	size_t total = 0;
+	for (const auto& usage : gpu) total += usage.bytes;
+	return total;
+}
+
+MemoryTracker::Snapshot MemoryTracker::snapshot(bool withProcess) const
+{
+	Snapshot snapshot;
+	for (size_t i = 0; i < kTags; ++i) snapshot.cpu[i] = read(_cpu[i], budgets[i]);
+	for (size_t i = 0; i < kGpuKinds; ++i) snapshot.gpu[i] = read(_gpu[i], gpuBudgets[i]);
+	if (withProcess) snapshot.process = processMemory();
+	return snapshot;
+}
+
+#if defined(_WIN32)
+
+MemoryTracker::ProcessMemory MemoryTracker::processMemory()
+{
+	ProcessMemory memory;
+	PROCESS_MEMORY_COUNTERS_EX counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters))) {
+		memory.valid = true;
+		memory.resident = counters.WorkingSetSize;
+		memory.peakResident = counters.PeakWorkingSetSize;
+		memory.privateBytes = counters.PrivateUsage;
+	}
+	return memory;
+}
+
+#elif defined(__linux__)
+
+MemoryTracker::ProcessMemory MemoryTracker::processMemory()
+{
+	// Lines like "VmRSS:     123456 kB"
+	ProcessMemory memory;
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		size_t* field = nullptr;
+		if (line.rfind("VmRSS:", 0) == 0) field = &memory.resident;
+		else if (line.rfind("VmHWM:", 0) == 0) field = &memory.peakResident;
+		else if (line.rfind("RssAnon:", 0) == 0) field = &memory.privateBytes;
+		if (!field) continue;
+
+		std::istringstream values(line.substr(line.find(':') + 1));
+		size_t kilobytes = 0;
+		if (values >> kilobytes) {
+			*field = kilobytes * 1024;
+			memory.valid = true;
+		}
+	}
+	return memory;
+}
+
+#else
+
+MemoryTracker::ProcessMemory MemoryTracker::processMemory()
+{
+	return ProcessMemory();
+}
+
+#endif
+
+void MemoryTracker::writeJson(std::ostream& out, const Snapshot& snapshot)
+{
+	auto writeUsage = [&out](const char* name, const Usage& usage, bool last) {
+		out << "    \"" << name << "\": { \"bytes\": " << usage.bytes << ", \"peak\": " << usage.peak
+			<< ", \"live\": " << usage.live << ", \"allocations\": " << usage.allocations << ", \"budget\": " << usage.budget
+			<< ", \"overBudget\": " << (usage.overBudget() ? "true" : "false") << " }" << (last ? "\n" : ",\n");
+	};
+
+	const auto& process = snapshot.process;
+	out << "{\n  \"process\": { \"valid\": " << (process.valid ? "true" : "false") << ", \"resident\": " << process.resident
+		<< ", \"peakResident\": " << process.peakResident << ", \"private\": " << process.privateBytes << " },\n";
+	out << "  \"cpu\": {\n";
+	for (size_t i = 0; i < kTags; ++i) writeUsage(tagName(static_cast<MemoryTag>(i)), snapshot.cpu[i], i + 1 == kTags);
+	out << "  },\n  \"gpu\": {\n";
+	for (size_t i = 0; i < kGpuKinds; ++i) writeUsage(gpuName(static_cast<GpuMemory>(i)), snapshot.gpu[i], i + 1 == kGpuKinds);
+	out << "  },\n  \"totals\": { \"cpu\": " << snapshot.cpuBytes() << ", \"gpu\": " << snapshot.gpuBytes() << " }\n}\n";
+}
+
+bool MemoryTracker::dump(const std::string& path) const
+{
+	std::ofstream out(path);
+	if (!out) return false;
+	writeJson(out, snapshot());
+	return static_cast<bool>(out);
+}
+
+TrackedBytes& TrackedBytes::operator=(const TrackedBytes& other)
+{
+	if (this != &other) set(other._bytes);
+	return *this;
+}
+
+TrackedBytes& TrackedBytes::operator=(TrackedBytes&& other) noexcept
+{
+	if (this != &other) {
+		set(other._bytes);
+		other.set(0);
+	}
+	return *this;
+}
+
+void TrackedBytes::set(size_t bytes)
+{
+	if (bytes == _bytes) return;
+	auto& tracker = MemoryTracker::getInstance();
+	if (_bytes) tracker.release(_tag, _bytes);
+	if (bytes) tracker.allocate(_tag, bytes);
+	_bytes = bytes;
+}
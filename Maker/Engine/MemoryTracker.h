@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+
+// Subsystems RAM is charged to. Counting is opt-in: only what goes through TrackedBytes, TaggedAllocator or
+// MemoryTracker::allocate() shows up, the rest of the process is the difference to the resident size.
+enum class MemoryTag { Meshes, Textures, Scene, Components, Importer, GUI, Count };
+
+// GPU-resident storage, as handed to the device (BufferObject, Image and the geometry arena)
+enum class GpuMemory { VertexBuffers, IndexBuffers, Textures, Count };
+
+// Live bytes, peak and allocation counts per tag, updated with atomics so any thread may allocate
+class MemoryTracker
+{
+public:
+	static constexpr size_t kTags = static_cast<size_t>(MemoryTag::Count);
+	static constexpr size_t kGpuKinds = static_cast<size_t>(GpuMemory::Count);
+
+	struct Usage
+	{
+		size_t bytes = 0;
+		size_t peak = 0;
+		size_t live = 0;		// allocations not yet released
+		size_t allocations = 0;	// ever made
+		size_t budget = 0;		// 0 for none
+
+		bool overBudget() const { return budget && bytes > budget; }
+	};
+
+	// What the OS reports for the whole process; valid is false where there is no backend
+	struct ProcessMemory
+	{
+		bool valid = false;
+		size_t resident = 0;
+		size_t peakResident = 0;
+		size_t privateBytes = 0;	// committed private memory (Windows), anonymous resident memory (Linux)
+	};
+
+	struct Snapshot
+	{
+		std::array<Usage, kTags> cpu;
+		std::array<Usage, kGpuKinds> gpu;
+		ProcessMemory process;
+
+		size_t cpuBytes() const;
+		size_t gpuBytes() const;
+	};
+
+	// Per-tag limits, only reported against (the panel highlights them, the dump flags them)
+	std::array<size_t, kTags> budgets{};
+	std::array<size_t, kGpuKinds> gpuBudgets{};
+
+	static MemoryTracker& getInstance();
+	static const char* tagName(MemoryTag tag);
+	static const char* gpuName(GpuMemory kind);
+
+	void allocate(MemoryTag tag, size_t bytes) { add(_cpu[static_cast<size_t>(tag)], bytes); }
+	void release(MemoryTag tag, size_t bytes) { remove(_cpu[static_cast<size_t>(tag)], bytes); }
+	void allocateGpu(GpuMemory kind, size_t bytes) { add(_gpu[static_cast<size_t>(kind)], bytes); }
+	void releaseGpu(GpuMemory kind, size_t bytes) { remove(_gpu[static_cast<size_t>(kind)], bytes); }
+
+	// Reading the process figures costs a syscall or a file read, so callers that poll should do it sparingly
+	Snapshot snapshot(bool withProcess = true) const;
+	static ProcessMemory processMemory();
+
+	// Machine-readable form of a snapshot, for leak and budget tracking across runs
+	static void writeJson(std::ostream& out, const Snapshot& snapshot);
+	bool dump(const std::string& path) const;
+
+private:
+	struct Counter
+	{
+		std::atomic<size_t> bytes{ 0 };
+		std::atomic<size_t> peak{ 0 };
+		std::atomic<size_t> live{ 0 };
+		std::atomic<size_t> allocations{ 0 };
+	};
+
+	std::array<Counter, kTags> _cpu;
+	std::array<Counter, kGpuKinds> _gpu;
+
+	MemoryTracker() = default;
+	static void add(Counter& counter, size_t bytes);
+	static void remove(Counter& counter, size_t bytes);
+	static Usage read(const Counter& counter, size_t budget);
+};
+
+// The bytes one object holds under a tag, kept up to date with set(). Copies are charged again; moves hand the
+// bytes over.
+class TrackedBytes
+{
+	MemoryTag _tag;
+	size_t _bytes = 0;
+
+public:
+	explicit TrackedBytes(MemoryTag tag, size_t bytes = 0) : _tag(tag) { set(bytes); }
+	TrackedBytes(const TrackedBytes& other) : TrackedBytes(other._tag, other._bytes) {}
+	TrackedBytes(TrackedBytes&& other) noexcept : _tag(other._tag), _bytes(other._bytes) { other._bytes = 0; }
+	TrackedBytes& operator=(const TrackedBytes& other);
+	TrackedBytes& operator=(TrackedBytes&& other) noexcept;
+	~TrackedBytes() { set(0); }
+
+	MemoryTag tag() const { return _tag; }
+	size_t bytes() const { return _bytes; }
+	void set(size_t bytes);
+};
+
+// Standard allocator that charges everything it hands out to Tag; for containers and allocate_shared
+template <class T, MemoryTag Tag>
+struct TaggedAllocator
+{
+	using value_type = T;
+	template <class U> struct rebind { using other = TaggedAllocator<U, Tag>; };
+
+	TaggedAllocator() = default;
+	template <class U> TaggedAllocator(const TaggedAllocator<U, Tag>&) noexcept {}
+
+	T* allocate(size_t n)
+	{
+		T* p = std::allocator<T>().allocate(n);
+		MemoryTracker::getInstance().allocate(Tag, n * sizeof(T));
+		return p;
+	}
+
+	void deallocate(T* p, size_t n) noexcept
+	{
+		MemoryTracker::getInstance().release(Tag, n * sizeof(T));
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	template <class U> bool operator==(const TaggedAllocator<U, Tag>&) const noexcept { return true; }
+	template <class U> bool operator!=(const TaggedAllocator<U, Tag>&) const noexcept { return false; }
+};
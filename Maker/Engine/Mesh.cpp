@@ -1,12 +1,15 @@
-#include <GL/glew.h>
 #include "Mesh.h"
+#include "MeshIngest.h"
+#include "Camera.h"
+#include "Log.h"
+#include "RenderDevice.h"
+#include "TextureCache.h"
+#include <chrono>
+#include <string>
 
 
 using namespace std;
 
-#define CHECKERS_HEIGHT 32
-#define CHECKERS_WIDTH 32
-
 Mesh::Mesh()
 {
 	
@@ -14,10 +17,10 @@ Mesh::Mesh()
 
 Mesh::Mesh(std::vector<glm::vec3> vertices, std::vector<glm::vec2> tex_coords, std::vector<glm::vec3> normals, std::vector<glm::u8vec3> colors, std::vector<unsigned int> indices)
 {
-	load(vertices.data(), vertices.size(), indices.data(), indices.size());
+	load(std::move(vertices), std::move(indices));
 
 	if (!tex_coords.empty()) {
-		loadTexCoords(tex_coords.data(), tex_coords.size());
+		loadTexCoords(std::move(tex_coords));
 	}
 
 	if (!normals.empty()) {
@@ -25,144 +28,400 @@ Mesh::Mesh(std::vector<glm::vec3> vertices, std::vector<glm::vec2> tex_coords, s
 	}
 
 	if (!colors.empty()) {
-		loadColors(colors.data(), colors.size());
+		loadColors(std::move(colors));
 	}
 }
 
 void Mesh::load(const glm::vec3* vertices, size_t num_verts, unsigned int* indices, size_t num_indexs)
 {
-	_vertices.assign(vertices, vertices + num_verts);
-	_indices.assign(indices, indices + num_indexs);
-	_vertices_buffer.loadData(vertices, num_verts * sizeof(glm::vec3));
-	_indices_buffer.loadIndices(indices, num_indexs);
+	load(std::vector<glm::vec3>(vertices, vertices + num_verts), std::vector<unsigned int>(indices, indices + num_indexs));
+}
+
+void Mesh::load(std::vector<glm::vec3>&& vertices, std::vector<unsigned int>&& indices)
+{
+	// Into the shared arena when the context can draw from it, otherwise into buffers of the mesh's own
+	auto& arena = GeometryArena::getInstance();
+	_arena = arena.allocate(vertices.size(), indices.size());
+	if (_arena) {
+		arena.write(_arena, GeometryArena::Positions, vertices.data(), vertices.size());
+		arena.writeIndices(_arena, indices.data(), indices.size());
+		_vertices_buffer.unload();
+		_indices_buffer.unload();
+	}
+	else {
+		_vertices_buffer.loadData(vertices.data(), vertices.size() * sizeof(glm::vec3));
+		_indices_buffer.loadIndices(indices.data(), indices.size());
+	}
 	_texCoords_buffer.unload();
 	_normals_buffer.unload();
 	_colors_buffer.unload();
-
-	_boundingBox.min = _vertices.front();
-	_boundingBox.max = _vertices.front();
-
-	for (const auto& v : _vertices) {
-		_boundingBox.min = glm::min(_boundingBox.min, glm::dvec3(v));
-		_boundingBox.max = glm::max(_boundingBox.max, glm::dvec3(v));
-	}
+	_hasTexCoords = _hasNormals = _hasColors = false;
+	_numVertices = vertices.size();
+	_numIndices = indices.size();
+	_contentHash = TextureCache::hashBytes(vertices.data(), vertices.size() * sizeof(glm::vec3));
+	_contentHash = TextureCache::hashBytes(indices.data(), indices.size() * sizeof(unsigned int), _contentHash);
+
+	glm::vec3 bbMin(0), bbMax(0);
+	MeshIngest::computeBounds(vertices.data(), vertices.size(), bbMin, bbMax);
+	_boundingBox.min = bbMin;
+	_boundingBox.max = bbMax;
+
+	_subMeshes.assign(1, SubMesh{ 0, static_cast<unsigned int>(_numIndices), 0, 0, _boundingBox });
+	setMeshlets({});
+
+	_vertices = std::move(vertices);
+	_indices = std::move(indices);
+	_texCoords.clear();
+	_colors.clear();
+	_cpuDataReleased = false;
+	_cpuMemory.set(cpuBytes());
+	applyResidency();
 }
 
 void Mesh::loadTexCoords(const glm::vec2* tex_coords, size_t num_tex_coords)
 {
-	_texCoords.assign(tex_coords, tex_coords + num_tex_coords);
-	_texCoords_buffer.loadData(tex_coords, num_tex_coords * sizeof(glm::vec2));
+	loadTexCoords(std::vector<glm::vec2>(tex_coords, tex_coords + num_tex_coords));
+}
+
+void Mesh::loadTexCoords(std::vector<glm::vec2>&& tex_coords)
+{
+	if (_arena) _arena.arena()->write(_arena, GeometryArena::TexCoords, tex_coords.data(), tex_coords.size());
+	else _texCoords_buffer.loadData(tex_coords.data(), tex_coords.size() * sizeof(glm::vec2));
+	_hasTexCoords = true;
+	_contentHash = TextureCache::hashBytes(tex_coords.data(), tex_coords.size() * sizeof(glm::vec2), _contentHash);
+	if (_residency == MeshResidency::KeepCPUCopy) _texCoords = std::move(tex_coords);
+	_cpuMemory.set(cpuBytes());
 }
 
 void Mesh::loadNormals(const glm::vec3* normals, size_t num_normals)
 {
-	_normals_buffer.loadData(normals, num_normals * sizeof(glm::vec3));
+	if (_arena) _arena.arena()->write(_arena, GeometryArena::Normals, normals, num_normals);
+	else _normals_buffer.loadData(normals, num_normals * sizeof(glm::vec3));
+	_hasNormals = true;
 }
 
 void Mesh::loadColors(const glm::u8vec3* colors, size_t num_colors)
 {
-	_colors.assign(colors, colors + num_colors);
-	_colors_buffer.loadData(colors, num_colors * sizeof(glm::u8vec3));
+	loadColors(std::vector<glm::u8vec3>(colors, colors + num_colors));
 }
 
-void Mesh::draw() const
+void Mesh::loadColors(std::vector<glm::u8vec3>&& colors)
+{
+	if (_arena) _arena.arena()->write(_arena, GeometryArena::Colors, colors.data(), colors.size());
+	else _colors_buffer.loadData(colors.data(), colors.size() * sizeof(glm::u8vec3));
+	_hasColors = true;
+	_contentHash = TextureCache::hashBytes(colors.data(), colors.size() * sizeof(glm::u8vec3), _contentHash);
+	if (_residency == MeshResidency::KeepCPUCopy) _colors = std::move(colors);
+	_cpuMemory.set(cpuBytes());
+}
+
+void Mesh::setResidency(MeshResidency residency, MeshReloader reloader)
+{
+	_residency = residency;
+	_reloader = std::move(reloader);
+	applyResidency();
+}
+
+void Mesh::applyResidency()
+{
+	if (_residency != MeshResidency::KeepCPUCopy) releaseCpuData();
+}
+
+void Mesh::releaseCpuData()
 {
+	freeCpuArrays();
+}
+
+void Mesh::trimCpuData() const
+{
+	if (_residency != MeshResidency::KeepCPUCopy) freeCpuArrays();
+}
+
+void Mesh::freeCpuArrays() const
+{
+	std::lock_guard<std::mutex> lock(_cpuMutex);
+	std::vector<glm::vec3>().swap(_vertices);
+	std::vector<unsigned int>().swap(_indices);
+	std::vector<glm::vec2>().swap(_texCoords);
+	std::vector<glm::u8vec3>().swap(_colors);
+	_cpuDataReleased.store(true, std::memory_order_release);
+	_cpuMemory.set(0);
+}
 
-	if (texture_id)
+void Mesh::ensureCpuData() const
+{
+	if (_residency != MeshResidency::ReloadOnDemand || !_cpuDataReleased.load(std::memory_order_acquire)) return;
+	std::lock_guard<std::mutex> lock(_cpuMutex);
+	// Another thread may have read it back while this one waited
+	if (_cpuDataReleased.load(std::memory_order_relaxed)) reloadCpuData();
+}
+
+void Mesh::reloadCpuData() const
+{
+	MeshCpuData data;
+	if (!_reloader || !_reloader(data)) return;
+
+	// The source may have been rewritten since load (a re-import over the same cooked file): arrays that are
+	// not the ones uploaded would disagree with the GPU copy, so they are refused
+	uint64_t hash = TextureCache::hashBytes(data.vertices.data(), data.vertices.size() * sizeof(glm::vec3));
+	hash = TextureCache::hashBytes(data.indices.data(), data.indices.size() * sizeof(unsigned int), hash);
+	hash = TextureCache::hashBytes(data.texCoords.data(), data.texCoords.size() * sizeof(glm::vec2), hash);
+	hash = TextureCache::hashBytes(data.colors.data(), data.colors.size() * sizeof(glm::u8vec3), hash);
+	if (data.vertices.size() != _numVertices || data.indices.size() != _numIndices || hash != _contentHash) {
+		LOG_WARNING(Log::Assets, "Mesh reload: %zu vertices, %zu indices read back differ from the %zu, %zu loaded; source changed, kept released",
+			data.vertices.size(), data.indices.size(), _numVertices, _numIndices);
+		return;
+	}
+
+	_vertices = std::move(data.vertices);
+	_indices = std::move(data.indices);
+	_texCoords = std::move(data.texCoords);
+	_colors = std::move(data.colors);
+	_cpuMemory.set(cpuBytes());
+	_cpuDataReleased.store(false, std::memory_order_release);
+}
+
+size_t Mesh::cpuBytes() const
+{
+	return _vertices.capacity() * sizeof(glm::vec3) +
+		_indices.capacity() * sizeof(unsigned int) +
+		_texCoords.capacity() * sizeof(glm::vec2) +
+		_colors.capacity() * sizeof(glm::u8vec3);
+}
+
+size_t Mesh::gpuBytes() const
+{
+	if (!_arena) {
+		return _vertices_buffer.gpuBytes() + _indices_buffer.gpuBytes() + _texCoords_buffer.gpuBytes() +
+			_normals_buffer.gpuBytes() + _colors_buffer.gpuBytes();
+	}
+	size_t stride = GeometryArena::kStride[GeometryArena::Positions];
+	if (_hasNormals) stride += GeometryArena::kStride[GeometryArena::Normals];
+	if (_hasTexCoords) stride += GeometryArena::kStride[GeometryArena::TexCoords];
+	if (_hasColors) stride += GeometryArena::kStride[GeometryArena::Colors];
+	return _numVertices * stride + _numIndices * sizeof(unsigned int);
+}
+
+void Mesh::beginDraw() const
+{
+	auto& device = RenderDevice::getInstance();
+	if (_checker)
 	{
-		glEnable(GL_TEXTURE_2D);
-		glBindTexture(GL_TEXTURE_2D, texture_id);
+		device.enable(RenderDevice::Capability::Texture2D);
+		_checker->bind();
+	}
+
+	if (hasTexCoords()) device.enableArray(RenderDevice::ClientArray::TexCoord);
+	if (hasNormals()) device.enableArray(RenderDevice::ClientArray::Normal);
+	if (hasColors()) device.enableArray(RenderDevice::ClientArray::Color);
+	device.enableArray(RenderDevice::ClientArray::Vertex);
+
+	bindArrays();
+}
+
+void Mesh::bindArrays() const
+{
+	if (_arena) {
+		_arena.arena()->bindArrays();
+		return;
 	}
 
-	if (_texCoords_buffer.id())
+	auto& device = RenderDevice::getInstance();
+	if (_hasTexCoords)
 	{
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 		_texCoords_buffer.bind();
-		glTexCoordPointer(2, GL_FLOAT, 0, nullptr);
+		device.arrayPointer(RenderDevice::ClientArray::TexCoord, 2, RenderDevice::ComponentType::Float, 0, 0);
 	}
 
-	if (_normals_buffer.id())
+	if (_hasNormals)
 	{
-		glEnableClientState(GL_NORMAL_ARRAY);
 		_normals_buffer.bind();
-		glNormalPointer(GL_FLOAT, 0, nullptr);
+		device.arrayPointer(RenderDevice::ClientArray::Normal, 3, RenderDevice::ComponentType::Float, 0, 0);
 	}
 
-	if (_colors_buffer.id())
+	if (_hasColors)
 	{
-		glEnableClientState(GL_COLOR_ARRAY);
 		_colors_buffer.bind();
-		glColorPointer(3, GL_UNSIGNED_BYTE, 0, nullptr);
+		device.arrayPointer(RenderDevice::ClientArray::Color, 3, RenderDevice::ComponentType::UnsignedByte, 0, 0);
 	}
 
-	glEnableClientState(GL_VERTEX_ARRAY);
 	_vertices_buffer.bind();
-	glVertexPointer(3, GL_FLOAT, 0, nullptr);
+	device.arrayPointer(RenderDevice::ClientArray::Vertex, 3, RenderDevice::ComponentType::Float, 0, 0);
 
 	_indices_buffer.bind();
-	glDrawElements(GL_TRIANGLES, _indices.size(), GL_UNSIGNED_INT, 0);
+}
 
-	glDisableClientState(GL_VERTEX_ARRAY);
-	if (_colors_buffer.id()) glDisableClientState(GL_COLOR_ARRAY);
-	if (_normals_buffer.id()) glDisableClientState(GL_NORMAL_ARRAY);
-	if (_texCoords_buffer.id()) glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+void Mesh::endDraw() const
+{
+	auto& device = RenderDevice::getInstance();
+	device.disableArray(RenderDevice::ClientArray::Vertex);
+	if (_hasColors) device.disableArray(RenderDevice::ClientArray::Color);
+	if (_hasNormals) device.disableArray(RenderDevice::ClientArray::Normal);
+	if (_hasTexCoords) device.disableArray(RenderDevice::ClientArray::TexCoord);
 
-	if (texture_id)
+	if (_checker)
 	{
-		glDisable(GL_TEXTURE_2D);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		device.disable(RenderDevice::Capability::Texture2D);
+		device.bindTexture(0);
+	}
+}
+
+void Mesh::draw() const
+{
+	beginDraw();
+	drawRange(0, _numIndices);
+	endDraw();
+}
+
+void Mesh::drawRange(size_t indexOffset, size_t indexCount) const
+{
+	auto& device = RenderDevice::getInstance();
+	if (_arena) device.drawElements(RenderDevice::Primitive::Triangles, indexCount, _arena.firstIndex() + indexOffset, static_cast<int>(_arena.baseVertex()));
+	else device.drawElements(RenderDevice::Primitive::Triangles, indexCount, indexOffset);
+}
+
+void Mesh::drawInstanced(size_t count) const
+{
+	auto& device = RenderDevice::getInstance();
+	if (_arena) device.drawElementsInstanced(_numIndices, _arena.firstIndex(), count, static_cast<int>(_arena.baseVertex()));
+	else device.drawElementsInstanced(_numIndices, 0, count);
+}
+
+void Mesh::drawVisible(const Frustum& frustum, const mat4& modelMatrix) const
+{
+	beginDraw();
+	drawBound(frustum, modelMatrix);
+	endDraw();
+}
+
+size_t Mesh::drawBound(const Frustum& frustum, const mat4& modelMatrix) const
+{
+	if (!_meshlets.empty()) return drawMeshlets(frustum, modelMatrix);
+
+	if (_subMeshes.size() <= 1) {
+		drawRange(0, _numIndices);
+		return 1;
+	}
+
+	// Adjacent visible ranges are merged so a fully visible mesh is still a single draw
+	size_t draws = 0;
+	size_t runStart = 0;
+	size_t runCount = 0;
+	for (const auto& sub : _subMeshes) {
+		const bool visible = frustum.ContainsBBox(modelMatrix * sub.boundingBox) != FRUSTUM_OUT;
+		if (visible && runCount && runStart + runCount == sub.indexOffset) {
+			runCount += sub.indexCount;
+			continue;
+		}
+		if (runCount) {
+			drawRange(runStart, runCount);
+			++draws;
+		}
+		runStart = sub.indexOffset;
+		runCount = visible ? sub.indexCount : 0;
 	}
+	if (runCount) {
+		drawRange(runStart, runCount);
+		++draws;
+	}
+	return draws;
 }
 
 
 
-void Mesh::CheckerTexture()
+void Mesh::setMeshlets(std::vector<Meshlet> meshlets)
 {
-	GLubyte checkerImage[CHECKERS_HEIGHT][CHECKERS_WIDTH][4];
-	for (int i = 0; i < CHECKERS_HEIGHT; i++) {
-		for (int j = 0; j < CHECKERS_WIDTH; j++) {
-			int c = ((((i & 0x8) == 0) ^ (((j & 0x8)) == 0))) * 255;
-			checkerImage[i][j][0] = (GLubyte)c;
-			checkerImage[i][j][1] = (GLubyte)c;
-			checkerImage[i][j][2] = (GLubyte)c;
-			checkerImage[i][j][3] = (GLubyte)255;
+	_meshlets = std::move(meshlets);
+	_meshletCull.assign(_meshlets);
+}
+
+void Mesh::buildMeshlets()
+{
+	if (_numIndices / 3 <= Meshlets::kMaxTriangles) {
+		setMeshlets({});
+		return;
+	}
+
+	const auto& verts = vertices();
+	const auto& idx = indices();
+	if (verts.empty() || idx.empty()) return;
+
+	std::vector<Meshlet> meshlets;
+	for (const auto& sub : _subMeshes) {
+		Meshlets::build(verts.data(), verts.size(), idx.data(), sub.indexOffset, sub.indexCount, meshlets);
+	}
+	setMeshlets(std::move(meshlets));
+}
+
+size_t Mesh::drawMeshlets(const Frustum& frustum, const mat4& modelMatrix) const
+{
+	// Bring the frustum into model space instead of moving every cluster to world space
+	const glm::mat4 model(modelMatrix);
+	const Plane* worldPlanes[6] = { &frustum.left, &frustum.right, &frustum.top, &frustum.bot, &frustum._near, &frustum._far };
+	glm::vec4 planes[6];
+	for (int p = 0; p < 6; ++p) {
+		planes[p] = glm::vec4(worldPlanes[p]->normal, worldPlanes[p]->distance) * model;
+		planes[p] /= glm::length(glm::vec3(planes[p]));
+	}
+	const glm::vec3 eye = glm::vec3(glm::inverse(model) * glm::vec4(frustum.eye, 1.0f));
+
+	// Backface cones only hold when back faces are really culled and the transform keeps angles (uniform scale, no mirroring)
+	const float sx = glm::length(glm::vec3(model[0])), sy = glm::length(glm::vec3(model[1])), sz = glm::length(glm::vec3(model[2]));
+	const bool uniformScale = glm::abs(sx - sy) <= 0.01f * sx && glm::abs(sx - sz) <= 0.01f * sx;
+	const bool coneCull = RenderDevice::getInstance().isEnabled(RenderDevice::Capability::CullFace) && uniformScale && glm::determinant(glm::mat3(model)) > 0;
+
+	_meshletVisible.resize(_meshlets.size());
+	Meshlets::cull(_meshletCull, planes, eye, coneCull, _meshletVisible.data());
+
+	// Adjacent visible clusters are merged into one range, then everything goes out in a single multi-draw
+	_drawCounts.clear();
+	_drawOffsets.clear();
+	const size_t indexBase = _arena ? _arena.firstIndex() : 0;
+	size_t runEnd = 0;
+	for (size_t i = 0; i < _meshlets.size(); ++i) {
+		if (!_meshletVisible[i]) continue;
+		const Meshlet& m = _meshlets[i];
+		const size_t count = m.triangleCount * 3;
+		if (!_drawCounts.empty() && runEnd == m.indexOffset) {
+			_drawCounts.back() += static_cast<int>(count);
 		}
+		else {
+			_drawCounts.push_back(static_cast<int>(count));
+			_drawOffsets.push_back(reinterpret_cast<const void*>((indexBase + m.indexOffset) * sizeof(unsigned int)));
+		}
+		runEnd = m.indexOffset + count;
 	}
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glGenTextures(1, &texture_id);
-	glBindTexture(GL_TEXTURE_2D, texture_id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, CHECKERS_WIDTH, CHECKERS_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, checkerImage);
-	
+	if (_drawCounts.empty()) return 0;
+
+	RenderDevice::getInstance().multiDrawElements(_drawCounts.data(), _drawOffsets.data(), _drawCounts.size(), _arena ? static_cast<int>(_arena.baseVertex()) : 0);
+	return 1;
+}
 
+void Mesh::CheckerTexture()
+{
+	_checker = TextureCache::getInstance().checker();
 }
 
 void Mesh::deleteCheckerTexture() {
-	if (texture_id) {
-		glDeleteTextures(1, &texture_id);
-		texture_id = 0;
-	}
+	_checker.reset();
 }
 
-void Mesh::drawNormals(float length) const {
-	glBegin(GL_LINES);
-	glColor3ub(255, 0, 0);
-	for (size_t i = 0; i < _indices.size(); i += 3) {
-		glm::vec3 v0 = _vertices[_indices[i]];
-		glm::vec3 v1 = _vertices[_indices[i + 1]];
-		glm::vec3 v2 = _vertices[_indices[i + 2]];
+void Mesh::faceNormalLines(float length, std::vector<glm::vec3>& lines) const {
+	const auto& verts = vertices();
+	const auto& idx = indices();
+	lines.clear();
+	lines.reserve(idx.size() / 3 * 2);
+	for (size_t i = 0; i + 2 < idx.size(); i += 3) {
+		glm::vec3 v0 = verts[idx[i]];
+		glm::vec3 v1 = verts[idx[i + 1]];
+		glm::vec3 v2 = verts[idx[i + 2]];
 
 		glm::vec3 normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
 		glm::vec3 center = (v0 + v1 + v2) / 3.0f;
 
-		glVertex3fv(glm::value_ptr(center));
-		glVertex3fv(glm::value_ptr(center + normal * length));
+		lines.push_back(center);
+		lines.push_back(center + normal * length);
 	}
-	glClearColor(0, 0, 0, 0);
-	glEnd();
 }
 
 void Mesh::LoadFile(const char* file_path)
@@ -170,64 +429,79 @@ void Mesh::LoadFile(const char* file_path)
 	const aiScene* scene = aiImportFile(file_path, aiProcessPreset_TargetRealtime_MaxQuality);
 
 	if (scene != nullptr && scene->HasMeshes()) {
-		std::vector<glm::vec3> all_vertices;
-		std::vector<unsigned int> all_indices;
-		std::vector<glm::vec2> all_texCoords;
-		std::vector<glm::vec3> all_normals;
-		std::vector<glm::u8vec3> all_colors;
+		const auto t0 = std::chrono::high_resolution_clock::now();
+
+		// Size everything up front so the per-mesh copies are plain bulk writes
+		size_t num_vertices = 0;
+		size_t num_indices = 0;
+		bool has_texCoords = false, has_normals = false, has_colors = false;
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+			const aiMesh* mesh = scene->mMeshes[i];
+			num_vertices += mesh->mNumVertices;
+			for (unsigned int j = 0; j < mesh->mNumFaces; j++) num_indices += mesh->mFaces[j].mNumIndices;
+			has_texCoords |= mesh->HasTextureCoords(0);
+			has_normals |= mesh->HasNormals();
+			has_colors |= mesh->HasVertexColors(0);
+		}
+
+		std::vector<glm::vec3> all_vertices(num_vertices);
+		std::vector<unsigned int> all_indices(num_indices);
+		std::vector<glm::vec2> all_texCoords(has_texCoords ? num_vertices : 0);
+		std::vector<glm::vec3> all_normals(has_normals ? num_vertices : 0);
+		std::vector<glm::u8vec3> all_colors(has_colors ? num_vertices : 0, glm::u8vec3(255));
+
+		std::vector<SubMesh> subMeshes(scene->mNumMeshes);
 
 		unsigned int vertex_offset = 0;
+		size_t index_offset = 0;
 
 		for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
-			aiMesh* mesh = scene->mMeshes[i];
+			const aiMesh* mesh = scene->mMeshes[i];
+			const size_t count = mesh->mNumVertices;
 
-			// Copy vertices
-			//gui->logMessage("Loading mesh vertices");
-			for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
-				all_vertices.push_back(glm::vec3(mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z));
-			}
+			SubMesh& sub = subMeshes[i];
+			sub.indexOffset = static_cast<unsigned int>(index_offset);
+			sub.baseVertex = vertex_offset;
+			sub.materialSlot = mesh->mMaterialIndex;
+
+			MeshIngest::copyVec3(mesh->mVertices, all_vertices.data() + vertex_offset, count);
+			glm::vec3 subMin(0), subMax(0);
+			MeshIngest::computeBounds(all_vertices.data() + vertex_offset, count, subMin, subMax);
+			sub.boundingBox.min = subMin;
+			sub.boundingBox.max = subMax;
 
-			// Copy indices
-			//gui->logMessage("Loading mesh indices");
 			for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
-				aiFace& face = mesh->mFaces[j];
+				const aiFace& face = mesh->mFaces[j];
 				for (unsigned int k = 0; k < face.mNumIndices; k++) {
-					all_indices.push_back(face.mIndices[k] + vertex_offset);
+					all_indices[index_offset++] = face.mIndices[k] + vertex_offset;
 				}
 			}
+			sub.indexCount = static_cast<unsigned int>(index_offset) - sub.indexOffset;
 
-			// Copy texture coordinates
-			//gui->logMessage("Loading mesh texture coordinates");
 			if (mesh->HasTextureCoords(0)) {
-				for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
-					all_texCoords.push_back(glm::vec2(mesh->mTextureCoords[0][j].x, -mesh->mTextureCoords[0][j].y));
-				}
+				MeshIngest::copyTexCoords(mesh->mTextureCoords[0], all_texCoords.data() + vertex_offset, count, true);
 			}
 
-			// Copy normals
-			//gui->logMessage("Loading mesh normals");
 			if (mesh->HasNormals()) {
-				for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
-					all_normals.push_back(glm::vec3(mesh->mNormals[j].x, mesh->mNormals[j].y, mesh->mNormals[j].z));
-				}
+				MeshIngest::copyVec3(mesh->mNormals, all_normals.data() + vertex_offset, count);
 			}
 
-			// Copy colors
-			//gui->logMessage("Loading mesh colors");
 			if (mesh->HasVertexColors(0)) {
-				for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
-					all_colors.push_back(glm::u8vec3(mesh->mColors[0][j].r * 255, mesh->mColors[0][j].g * 255, mesh->mColors[0][j].b * 255));
-				}
+				MeshIngest::packColors(mesh->mColors[0], all_colors.data() + vertex_offset, count);
 			}
 
 			vertex_offset += mesh->mNumVertices;
 		}
 
+		const auto t1 = std::chrono::high_resolution_clock::now();
+
 		// Load the combined mesh data
-		load(all_vertices.data(), all_vertices.size(), all_indices.data(), all_indices.size());
+		load(std::move(all_vertices), std::move(all_indices));
+		setSubMeshes(std::move(subMeshes));
+		buildMeshlets();
 
 		if (!all_texCoords.empty()) {
-			loadTexCoords(all_texCoords.data(), all_texCoords.size());
+			loadTexCoords(std::move(all_texCoords));
 		}
 
 		if (!all_normals.empty()) {
@@ -235,9 +509,12 @@ void Mesh::LoadFile(const char* file_path)
 		}
 
 		if (!all_colors.empty()) {
-			loadColors(all_colors.data(), all_colors.size());
+			loadColors(std::move(all_colors));
 		}
 
+		const double ingestNs = std::chrono::duration<double, std::nano>(t1 - t0).count();
+		LOG_DEBUG(Log::Assets, "Mesh ingest: %zu vertices, %.2f ns/vertex", num_vertices, num_vertices ? ingestNs / num_vertices : 0.0);
+
 		aiReleaseImport(scene);
 	}
 	else {
@@ -245,13 +522,3 @@ void Mesh::LoadFile(const char* file_path)
 		//cout << "Error loading mesh: " << file_path << endl;
 	}
 }
-
-
-
-
-
-
-
-
-
-
@@ -5,58 +5,175 @@
 #include <assimp/postprocess.h>
 #include <IL/il.h>
 #include <IL/ilu.h>
+#include <atomic>
 #include <vector>
+#include <functional>
+#include <mutex>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "BufferObject.h"
+#include "GeometryArena.h"
 #include "BoundingBox.h"
+#include "Meshlet.h"
 #include "MeshLoader.h"
+#include "MemoryTracker.h"
+#include "Image.h"
+
+struct Frustum;
+
+// A contiguous index range inside the shared Mesh buffers (one per aiMesh on import).
+// Indices are stored already offset by baseVertex, so ranges can be drawn with plain glDrawElements.
+struct SubMesh
+{
+	unsigned int indexOffset = 0;
+	unsigned int indexCount = 0;
+	unsigned int baseVertex = 0;
+	unsigned int materialSlot = 0;
+	BoundingBox boundingBox;
+};
+
+// What happens to the CPU-side arrays once they have been uploaded to GL buffers
+enum class MeshResidency
+{
+	KeepCPUCopy,		// arrays stay in RAM next to the GPU copy (default)
+	DropAfterUpload,	// arrays are freed after upload; vertices()/indices()/... come back empty
+	ReloadOnDemand,		// arrays are freed after upload and re-read through the reloader on first access; what is
+						// read back stays in RAM until trimCpuData() or releaseCpuData() frees it again
+};
+
+struct MeshCpuData
+{
+	std::vector<glm::vec3> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<glm::vec2> texCoords;
+	std::vector<glm::u8vec3> colors;
+};
+
+// Fills the CPU arrays back in (usually from the cooked .mesh file). Returns false if the data is gone; what it
+// reads is checked against the sizes and contentHash() recorded at load and dropped if the source has changed.
+using MeshReloader = std::function<bool(MeshCpuData&)>;
 
 class Mesh
 {
-	std::vector<glm::vec3> _vertices;
-	std::vector<unsigned int> _indices;
-	std::vector<glm::vec2> _texCoords;
-	std::vector<glm::u8vec3> _colors;
+	mutable std::vector<glm::vec3> _vertices;
+	mutable std::vector<unsigned int> _indices;
+	mutable std::vector<glm::vec2> _texCoords;
+	mutable std::vector<glm::u8vec3> _colors;
+
+	MeshResidency _residency = MeshResidency::KeepCPUCopy;
+	MeshReloader _reloader;
+	mutable std::atomic<bool> _cpuDataReleased{ false };
+	// Serialises reloads, so meshes shared between threads are read back once
+	mutable std::mutex _cpuMutex;
+	mutable TrackedBytes _cpuMemory{ MemoryTag::Meshes };
+	size_t _numVertices = 0;
+	size_t _numIndices = 0;
+	uint64_t _contentHash = 0;
 
 	BufferObject _vertices_buffer;
 	BufferObject _indices_buffer;
 	BufferObject _texCoords_buffer;
 	BufferObject _normals_buffer;
 	BufferObject _colors_buffer;
+	// Slots in the shared GeometryArena; while set, the buffers above stay empty
+	GeometryArena::Allocation _arena;
+	bool _hasTexCoords = false;
+	bool _hasNormals = false;
+	bool _hasColors = false;
 
-	unsigned int texture_id = 0;
+	std::shared_ptr<Image> _checker;
 
 	BoundingBox _boundingBox;
+	std::vector<SubMesh> _subMeshes;
+	std::vector<Meshlet> _meshlets;
+	Meshlets::CullData _meshletCull;
 
-	
+	// per-draw scratch for meshlet culling, kept around to avoid reallocating every frame
+	mutable std::vector<unsigned char> _meshletVisible;
+	mutable std::vector<int> _drawCounts;
+	mutable std::vector<const void*> _drawOffsets;
+
+	void beginDraw() const;
+	void endDraw() const;
+	size_t drawMeshlets(const Frustum& frustum, const mat4& modelMatrix) const;
+	// One indexed draw over [indexOffset, indexOffset + indexCount) of this mesh's indices, wherever they live
+	void drawRange(size_t indexOffset, size_t indexCount) const;
+	void ensureCpuData() const;
+	void reloadCpuData() const;
+	void freeCpuArrays() const;
+	void applyResidency();
 
 public:
 	Mesh();
+	// Sink constructor: pass the vectors with std::move to hand them over without a copy
 	Mesh(std::vector<glm::vec3> vertices, std::vector<glm::vec2> tex_coords, std::vector<glm::vec3> normals, std::vector<glm::u8vec3> colors, std::vector<unsigned int> indices);
 
-	const auto& vertices() const { return _vertices; }
-	const auto& indices() const { return _indices; }
+	const auto& vertices() const { ensureCpuData(); return _vertices; }
+	const auto& indices() const { ensureCpuData(); return _indices; }
 	const auto& boundingBox() const { return _boundingBox; }
-	const auto& texCoords() const { return _texCoords; }
-	const auto& colors() const { return _colors; } 
+	const auto& texCoords() const { ensureCpuData(); return _texCoords; }
+	const auto& colors() const { ensureCpuData(); return _colors; } 
+	const auto& subMeshes() const { return _subMeshes; }
+	const auto& meshlets() const { return _meshlets; }
+	// Of the vertex, index, texcoord and colour bytes loaded, so it holds while the arrays are released
+	uint64_t contentHash() const { return _contentHash; }
 
 	void setBoundingBox(const BoundingBox& boundingBox) {
 		_boundingBox = boundingBox;
 	}
-	
+	void setSubMeshes(std::vector<SubMesh> subMeshes) { _subMeshes = std::move(subMeshes); }
+	void setMeshlets(std::vector<Meshlet> meshlets);
+	// Clusters every submesh into meshlets; meshes too small to give more than one cluster are left without
+	void buildMeshlets();
+
+	size_t numVertices() const { return _numVertices; }
+	size_t numIndices() const { return _numIndices; }
+
+	MeshResidency residency() const { return _residency; }
+	// Applies the policy straight away: with anything but KeepCPUCopy the CPU arrays are released now
+	void setResidency(MeshResidency residency, MeshReloader reloader = {});
+	bool isCpuResident() const { return !_cpuDataReleased.load(std::memory_order_acquire); }
+	// Neither may run while another thread still reads the arrays
+	void releaseCpuData();
+	// Frees arrays read back on demand once the caller is done with them; does nothing under KeepCPUCopy
+	void trimCpuData() const;
+	size_t cpuBytes() const;
+	// The mesh's own buffers, or its share of the GeometryArena streams it writes
+	size_t gpuBytes() const;
 
 	void load(const glm::vec3* vertices, size_t num_verts, unsigned int* indices, size_t num_indexs);
 	void loadTexCoords(const glm::vec2* tex_coords, size_t num_tex_coords);
 	void loadNormals(const glm::vec3* normals, size_t num_normals);
 	void loadColors(const glm::u8vec3* colors, size_t num_colors);
+
+	// Move-in overloads: the mesh takes ownership of the arrays instead of copying them
+	void load(std::vector<glm::vec3>&& vertices, std::vector<unsigned int>&& indices);
+	void loadTexCoords(std::vector<glm::vec2>&& tex_coords);
+	void loadColors(std::vector<glm::u8vec3>&& colors);
 	void draw() const;
-	void drawNormals(float length) const;
+	// Draws only the meshlets (or, without meshlets, the submeshes) whose bounds, moved to world space by modelMatrix, touch the frustum
+	void drawVisible(const Frustum& frustum, const mat4& modelMatrix) const;
+
+	// Lower-level pieces for callers that manage GL state themselves (RenderQueue): which arrays the mesh has,
+	// binding its buffers and pointers without touching client states, and drawing with everything already bound.
+	bool hasTexCoords() const { return _hasTexCoords; }
+	bool hasNormals() const { return _hasNormals; }
+	bool hasColors() const { return _hasColors; }
+	// Meshes that return the same value share their bound arrays (one arena), so binding one binds them all
+	const void* arrayBinding() const { return _arena ? static_cast<const void*>(_arena.arena()) : this; }
+	const std::shared_ptr<Image>& checker() const { return _checker; }
+	void bindArrays() const;
+	// Returns the number of draw calls issued
+	size_t drawBound(const Frustum& frustum, const mat4& modelMatrix) const;
+	// The whole mesh count times, with everything bound and the per-instance attributes set up by the caller
+	void drawInstanced(size_t count) const;
+	// Two points per triangle, from its centre along the face normal (DebugDraw caches them per mesh)
+	void faceNormalLines(float length, std::vector<glm::vec3>& lines) const;
 	//void LoadFromMeshDTO(MeshImporter::MeshDTO& meshDTO);
 
 	void LoadFile(const char* filePath);
 
-	//
+	// Binds the shared checker pattern from the TextureCache while drawing, until deleteCheckerTexture()
 	void CheckerTexture();
 	void deleteCheckerTexture();
 
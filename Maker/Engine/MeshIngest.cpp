@@ -0,0 +1,166 @@
+#include "MeshIngest.h"
+#include "ParallelFor.h"
+#include <cstring>
+#include <cstdint>
+#include <cfloat>
+#include <mutex>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MESH_INGEST_SSE2 1
+#endif
+
+static_assert(sizeof(aiVector3D) == sizeof(glm::vec3), "aiVector3D must be three packed floats (ai_real = float)");
+static_assert(sizeof(aiColor4D) == 4 * sizeof(float), "aiColor4D must be four packed floats");
+static_assert(sizeof(glm::u8vec3) == 3, "glm::u8vec3 must be tightly packed");
+
+namespace MeshIngest
+{
+	void copyVec3(const aiVector3D* src, glm::vec3* dst, size_t count)
+	{
+		parallelFor(count, kParallelThreshold, [=](size_t begin, size_t end) {
+			std::memcpy(dst + begin, src + begin, (end - begin) * sizeof(glm::vec3));
+		});
+	}
+
+	static void copyTexCoordsRange(const aiVector3D* src, glm::vec2* dst, size_t begin, size_t end, bool flipV, [[maybe_unused]] bool simd)
+	{
+		size_t i = begin;
+#ifdef MESH_INGEST_SSE2
+		// 4 uvw triplets (12 floats, 3 registers) -> 4 uv pairs (8 floats, 2 registers)
+		const __m128 sign = flipV ? _mm_castsi128_ps(_mm_set_epi32(INT32_MIN, 0, INT32_MIN, 0)) : _mm_setzero_ps();
+		for (; simd && i + 4 <= end; i += 4) {
+			const float* in = &src[i].x;
+			const __m128 a = _mm_loadu_ps(in + 0); // u0 v0 w0 u1
+			const __m128 b = _mm_loadu_ps(in + 4); // v1 w1 u2 v2
+			const __m128 c = _mm_loadu_ps(in + 8); // w2 u3 v3 w3
+			const __m128 t = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 3, 3)); // u1 u1 v1 v1
+			const __m128 lo = _mm_shuffle_ps(a, t, _MM_SHUFFLE(2, 0, 1, 0)); // u0 v0 u1 v1
+			const __m128 hi = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2)); // u2 v2 u3 v3
+			float* out = &dst[i].x;
+			_mm_storeu_ps(out + 0, _mm_xor_ps(lo, sign));
+			_mm_storeu_ps(out + 4, _mm_xor_ps(hi, sign));
+		}
+#endif
+		for (; i < end; ++i) {
+			dst[i] = glm::vec2(src[i].x, flipV ? -src[i].y : src[i].y);
+		}
+	}
+
+	void copyTexCoords(const aiVector3D* src, glm::vec2* dst, size_t count, bool flipV)
+	{
+		parallelFor(count, kParallelThreshold, [=](size_t begin, size_t end) {
+			copyTexCoordsRange(src, dst, begin, end, flipV, true);
+		});
+	}
+
+	static void packColorsRange(const aiColor4D* src, glm::u8vec3* dst, size_t begin, size_t end, [[maybe_unused]] bool simd)
+	{
+		size_t i = begin;
+#ifdef MESH_INGEST_SSE2
+		const __m128 scale = _mm_set1_ps(255.0f);
+		for (; simd && i + 4 <= end; i += 4) {
+			const float* in = &src[i].r;
+			// truncate like the scalar float -> unsigned char conversion, then saturate to 0..255
+			const __m128i c0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(in + 0), scale));
+			const __m128i c1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(in + 4), scale));
+			const __m128i c2 = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(in + 8), scale));
+			const __m128i c3 = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(in + 12), scale));
+			const __m128i rgba = _mm_packus_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3));
+
+			alignas(16) unsigned char packed[16];
+			_mm_store_si128(reinterpret_cast<__m128i*>(packed), rgba);
+			unsigned char* out = &dst[i].r;
+			for (int k = 0; k < 4; ++k) {
+				out[k * 3 + 0] = packed[k * 4 + 0];
+				out[k * 3 + 1] = packed[k * 4 + 1];
+				out[k * 3 + 2] = packed[k * 4 + 2];
+			}
+		}
+#endif
+		for (; i < end; ++i) {
+			const glm::vec3 c = glm::clamp(glm::vec3(src[i].r, src[i].g, src[i].b) * 255.0f, 0.0f, 255.0f);
+			dst[i] = glm::u8vec3(c);
+		}
+	}
+
+	void packColors(const aiColor4D* src, glm::u8vec3* dst, size_t count)
+	{
+		parallelFor(count, kParallelThreshold, [=](size_t begin, size_t end) {
+			packColorsRange(src, dst, begin, end, true);
+		});
+	}
+
+	static void boundsRange(const glm::vec3* v, size_t begin, size_t end, glm::vec3& outMin, glm::vec3& outMax, [[maybe_unused]] bool simd)
+	{
+		glm::vec3 mn(FLT_MAX), mx(-FLT_MAX);
+		size_t i = begin;
+#ifdef MESH_INGEST_SSE2
+		// Each register holds a rotating xyz pattern; the lanes are folded back together at the end.
+		__m128 minA = _mm_set1_ps(FLT_MAX), minB = minA, minC = minA;
+		__m128 maxA = _mm_set1_ps(-FLT_MAX), maxB = maxA, maxC = maxA;
+		for (; simd && i + 4 <= end; i += 4) {
+			const float* in = &v[i].x;
+			const __m128 a = _mm_loadu_ps(in + 0); // x y z x
+			const __m128 b = _mm_loadu_ps(in + 4); // y z x y
+			const __m128 c = _mm_loadu_ps(in + 8); // z x y z
+			minA = _mm_min_ps(minA, a); maxA = _mm_max_ps(maxA, a);
+			minB = _mm_min_ps(minB, b); maxB = _mm_max_ps(maxB, b);
+			minC = _mm_min_ps(minC, c); maxC = _mm_max_ps(maxC, c);
+		}
+		alignas(16) float lo[12], hi[12];
+		_mm_store_ps(lo + 0, minA); _mm_store_ps(lo + 4, minB); _mm_store_ps(lo + 8, minC);
+		_mm_store_ps(hi + 0, maxA); _mm_store_ps(hi + 4, maxB); _mm_store_ps(hi + 8, maxC);
+		for (int k = 0; k < 12; ++k) {
+			mn[k % 3] = glm::min(mn[k % 3], lo[k]);
+			mx[k % 3] = glm::max(mx[k % 3], hi[k]);
+		}
+#endif
+		for (; i < end; ++i) {
+			mn = glm::min(mn, v[i]);
+			mx = glm::max(mx, v[i]);
+		}
+		outMin = mn;
+		outMax = mx;
+	}
+
+	void computeBounds(const glm::vec3* vertices, size_t count, glm::vec3& min, glm::vec3& max)
+	{
+		if (count == 0) return;
+
+		glm::vec3 mn(FLT_MAX), mx(-FLT_MAX);
+		std::mutex merge;
+		parallelFor(count, kParallelThreshold, [&](size_t begin, size_t end) {
+			glm::vec3 chunkMin, chunkMax;
+			boundsRange(vertices, begin, end, chunkMin, chunkMax, true);
+			std::lock_guard<std::mutex> lock(merge);
+			mn = glm::min(mn, chunkMin);
+			mx = glm::max(mx, chunkMax);
+		});
+		min = mn;
+		max = mx;
+	}
+
+	namespace Scalar
+	{
+		void copyVec3(const aiVector3D* src, glm::vec3* dst, size_t count)
+		{
+			for (size_t i = 0; i < count; ++i) dst[i] = glm::vec3(src[i].x, src[i].y, src[i].z);
+		}
+
+		void copyTexCoords(const aiVector3D* src, glm::vec2* dst, size_t count, bool flipV)
+		{
+			copyTexCoordsRange(src, dst, 0, count, flipV, false);
+		}
+
+		void packColors(const aiColor4D* src, glm::u8vec3* dst, size_t count)
+		{
+			packColorsRange(src, dst, 0, count, false);
+		}
+
+		void computeBounds(const glm::vec3* vertices, size_t count, glm::vec3& min, glm::vec3& max)
+		{
+			if (count) boundsRange(vertices, 0, count, min, max, false);
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <assimp/types.h>
+#include <assimp/vector3.h>
+#include <assimp/color4.h>
+
+// Bulk conversion kernels used when copying Assimp data into a Mesh.
+// Destinations must already be sized; every routine is SSE2 within a chunk
+// and splits across threads once the input is larger than kParallelThreshold.
+namespace MeshIngest
+{
+	constexpr size_t kParallelThreshold = 1 << 16;
+
+	// aiVector3D -> glm::vec3 (positions, normals). Both are three packed floats, so this is a straight copy.
+	void copyVec3(const aiVector3D* src, glm::vec3* dst, size_t count);
+
+	// aiVector3D (uvw) -> glm::vec2, negating v when flipV is set.
+	void copyTexCoords(const aiVector3D* src, glm::vec2* dst, size_t count, bool flipV);
+
+	// aiColor4D (0..1 floats) -> glm::u8vec3, saturating out-of-range values.
+	void packColors(const aiColor4D* src, glm::u8vec3* dst, size_t count);
+
+	// Component-wise min/max of a vertex array. Leaves min/max untouched when count is 0.
+	void computeBounds(const glm::vec3* vertices, size_t count, glm::vec3& min, glm::vec3& max);
+
+	// The same conversions as plain per-vertex loops on the calling thread: the baseline the Benchmark
+	// compares the kernels above against. Results match them exactly.
+	namespace Scalar
+	{
+		void copyVec3(const aiVector3D* src, glm::vec3* dst, size_t count);
+		void copyTexCoords(const aiVector3D* src, glm::vec2* dst, size_t count, bool flipV);
+		void packColors(const aiColor4D* src, glm::u8vec3* dst, size_t count);
+		void computeBounds(const glm::vec3* vertices, size_t count, glm::vec3& min, glm::vec3& max);
+	}
+}
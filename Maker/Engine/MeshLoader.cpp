@@ -1,4 +1,3 @@
-#include <GL/glew.h>
 #include "MeshLoader.h"
 #include "GameObject.h" 
 #include "Transform.h"
@@ -8,6 +7,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "Image.h"
+#include "TextureStreamer.h"
+#include "RenderQueue.h"
+#include "DebugDraw.h"
+#include "RenderDevice.h"
 
 MeshLoader::MeshLoader(std::weak_ptr<GameObject> owner) : Component(owner) {}
 
@@ -83,15 +86,45 @@ void MeshLoader::Render() const
     {
         glDisable(GL_TEXTURE_2D);
     }*/
+    beginMaterial();
+    if (mesh) mesh->draw();
+    endMaterial();
+}
+
+void MeshLoader::Render(const Frustum& frustum, const mat4& modelMatrix) const
+{
+    // Lets the streamer pick the mip this object needs from its size on screen
+    if (mesh && material && material->texture.image()) {
+        TextureStreamer::getInstance().noteUse(material->texture.image().get(), modelMatrix * mesh->boundingBox());
+    }
+    beginMaterial();
+    if (mesh) mesh->drawVisible(frustum, modelMatrix);
+    endMaterial();
+}
+
+void MeshLoader::Enqueue(RenderQueue& queue, const Frustum& frustum, const mat4& modelMatrix) const
+{
+    if (!mesh) return;
+    if (material && material->texture.image()) {
+        TextureStreamer::getInstance().noteUse(material->texture.image().get(), modelMatrix * mesh->boundingBox());
+    }
+    queue.push(*mesh, material.get(), modelMatrix, frustum);
+    if (drawNormals) DebugDraw::getInstance().normals(mesh, modelMatrix, 0.1f);
+}
+
+void MeshLoader::beginMaterial() const
+{
     if (material) {
-        glColor4ubv(&material->color.r);
+        auto& device = RenderDevice::getInstance();
+        device.color(material->color);
         if (material->texture.id()) {
-            glEnable(GL_TEXTURE_2D);
+            device.enable(RenderDevice::Capability::Texture2D);
             material->texture.bind();
         }
     }
+}
 
-    if (mesh) mesh->draw();
-
-    if (material && material->texture.id()) glDisable(GL_TEXTURE_2D);
+void MeshLoader::endMaterial() const
+{
+    if (material && material->texture.id()) RenderDevice::getInstance().disable(RenderDevice::Capability::Texture2D);
 }
@@ -6,7 +6,9 @@
 
 class Mesh;
 class Texture;
+class RenderQueue;
 class Image;
+struct Frustum;
 
 class MeshLoader : public Component {
 public:
@@ -29,10 +31,17 @@ public:
     glm::vec3 GetColor() const;
 
     void Render() const;
+    // Same as Render() but lets the mesh skip submeshes outside the frustum
+    void Render(const Frustum& frustum, const mat4& modelMatrix) const;
+    // Same as Render(frustum, modelMatrix) but only records the draw; the queue issues it later
+    void Enqueue(RenderQueue& queue, const Frustum& frustum, const mat4& modelMatrix) const;
 
     
 
 private:
+    void beginMaterial() const;
+    void endMaterial() const;
+
     std::shared_ptr<Mesh> mesh;
     std::shared_ptr<Image> image;
     std::shared_ptr<Texture> texture;
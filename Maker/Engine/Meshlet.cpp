@@ -0,0 +1,176 @@
+#include "Meshlet.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cfloat>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MESHLET_SSE2 1
+#endif
+
+namespace Meshlets
+{
+	// Clusters whose normals spread further than this from the average never pass the cone test, so don't bother
+	static constexpr float kMinConeDot = 0.1f;
+
+	static void finishMeshlet(const glm::vec3* vertices, const unsigned int* indices, const std::vector<unsigned int>& localVertices, Meshlet& meshlet)
+	{
+		glm::vec3 mn(FLT_MAX), mx(-FLT_MAX);
+		for (unsigned int v : localVertices) {
+			mn = glm::min(mn, vertices[v]);
+			mx = glm::max(mx, vertices[v]);
+		}
+		meshlet.aabbMin = mn;
+		meshlet.aabbMax = mx;
+		meshlet.center = (mn + mx) * 0.5f;
+
+		float radius2 = 0;
+		for (unsigned int v : localVertices) {
+			const glm::vec3 d = vertices[v] - meshlet.center;
+			radius2 = std::max(radius2, glm::dot(d, d));
+		}
+		meshlet.radius = std::sqrt(radius2);
+
+		glm::vec3 normals[kMaxTriangles];
+		unsigned int numNormals = 0;
+		glm::vec3 sum(0);
+		for (unsigned int t = 0; t < meshlet.triangleCount; ++t) {
+			const unsigned int* tri = indices + meshlet.indexOffset + t * 3;
+			const glm::vec3 n = glm::cross(vertices[tri[1]] - vertices[tri[0]], vertices[tri[2]] - vertices[tri[0]]);
+			const float len = glm::length(n);
+			if (len <= 0) continue;
+			normals[numNormals] = n / len;
+			sum += normals[numNormals++];
+		}
+
+		meshlet.coneAxis = glm::vec3(0);
+		meshlet.coneCutoff = 1;
+		const float sumLen = glm::length(sum);
+		if (numNormals == 0 || sumLen < 1e-6f) return;
+
+		const glm::vec3 axis = sum / sumLen;
+		float minDot = 1;
+		for (unsigned int i = 0; i < numNormals; ++i) minDot = std::min(minDot, glm::dot(axis, normals[i]));
+		if (minDot <= kMinConeDot) return;
+
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = std::sqrt(1 - minDot * minDot);
+	}
+
+	void build(const glm::vec3* vertices, size_t vertexCount, const unsigned int* indices, size_t indexOffset, size_t indexCount, std::vector<Meshlet>& out)
+	{
+		// stamp[v] == current means vertex v is already part of the meshlet being filled
+		std::vector<unsigned int> stamp(vertexCount, UINT_MAX);
+		std::vector<unsigned int> localVertices;
+		localVertices.reserve(kMaxVertices);
+		unsigned int current = 0;
+
+		Meshlet meshlet;
+		meshlet.indexOffset = static_cast<unsigned int>(indexOffset);
+
+		const size_t end = indexOffset + indexCount - indexCount % 3;
+		for (size_t i = indexOffset; i < end; i += 3) {
+			const unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			const unsigned int newVertices = (stamp[a] != current) + (stamp[b] != current && b != a) + (stamp[c] != current && c != a && c != b);
+
+			if (meshlet.triangleCount == kMaxTriangles || meshlet.vertexCount + newVertices > kMaxVertices) {
+				finishMeshlet(vertices, indices, localVertices, meshlet);
+				out.push_back(meshlet);
+
+				meshlet = Meshlet();
+				meshlet.indexOffset = static_cast<unsigned int>(i);
+				localVertices.clear();
+				++current;
+			}
+
+			for (unsigned int v : { a, b, c }) {
+				if (stamp[v] == current) continue;
+				stamp[v] = current;
+				localVertices.push_back(v);
+				++meshlet.vertexCount;
+			}
+			++meshlet.triangleCount;
+		}
+
+		if (meshlet.triangleCount) {
+			finishMeshlet(vertices, indices, localVertices, meshlet);
+			out.push_back(meshlet);
+		}
+	}
+
+	void CullData::assign(const std::vector<Meshlet>& meshlets)
+	{
+		count = meshlets.size();
+		const size_t padded = (count + 3) & ~size_t(3);
+		for (auto* lane : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius, &axisX, &axisY, &axisZ }) lane->assign(padded, 0.0f);
+		cutoff.assign(padded, 1.0f);
+
+		for (size_t i = 0; i < count; ++i) {
+			const Meshlet& m = meshlets[i];
+			const glm::vec3 extent = (m.aabbMax - m.aabbMin) * 0.5f;
+			centerX[i] = m.center.x; centerY[i] = m.center.y; centerZ[i] = m.center.z;
+			extentX[i] = extent.x; extentY[i] = extent.y; extentZ[i] = extent.z;
+			radius[i] = m.radius;
+			axisX[i] = m.coneAxis.x; axisY[i] = m.coneAxis.y; axisZ[i] = m.coneAxis.z;
+			cutoff[i] = m.coneCutoff;
+		}
+	}
+
+	void cull(const CullData& data, const glm::vec4 planes[6], const glm::vec3& eye, bool coneCull, unsigned char* visible)
+	{
+		size_t i = 0;
+#ifdef MESHLET_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		__m128 pn[6][3], pa[6][3], pd[6];
+		for (int p = 0; p < 6; ++p) {
+			for (int k = 0; k < 3; ++k) {
+				pn[p][k] = _mm_set1_ps(planes[p][k]);
+				pa[p][k] = _mm_and_ps(pn[p][k], absMask);
+			}
+			pd[p] = _mm_set1_ps(planes[p].w);
+		}
+		const __m128 eyeX = _mm_set1_ps(eye.x), eyeY = _mm_set1_ps(eye.y), eyeZ = _mm_set1_ps(eye.z);
+
+		for (; i < data.count; i += 4) {
+			const __m128 cx = _mm_loadu_ps(&data.centerX[i]), cy = _mm_loadu_ps(&data.centerY[i]), cz = _mm_loadu_ps(&data.centerZ[i]);
+			const __m128 ex = _mm_loadu_ps(&data.extentX[i]), ey = _mm_loadu_ps(&data.extentY[i]), ez = _mm_loadu_ps(&data.extentZ[i]);
+
+			// AABB vs plane: the box is out when its center is further behind the plane than its projected extent
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; ++p) {
+				const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pn[p][0], cx), _mm_mul_ps(pn[p][1], cy)), _mm_add_ps(_mm_mul_ps(pn[p][2], cz), pd[p]));
+				const __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pa[p][0], ex), _mm_mul_ps(pa[p][1], ey)), _mm_mul_ps(pa[p][2], ez));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, reach), zero));
+			}
+
+			if (coneCull) {
+				const __m128 vx = _mm_sub_ps(cx, eyeX), vy = _mm_sub_ps(cy, eyeY), vz = _mm_sub_ps(cz, eyeZ);
+				const __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+				const __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&data.axisX[i])), _mm_mul_ps(vy, _mm_loadu_ps(&data.axisY[i]))), _mm_mul_ps(vz, _mm_loadu_ps(&data.axisZ[i])));
+				const __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&data.cutoff[i]), len), _mm_loadu_ps(&data.radius[i]));
+				inside = _mm_andnot_ps(_mm_cmpgt_ps(along, limit), inside);
+			}
+
+			const int mask = _mm_movemask_ps(inside);
+			const size_t lanes = std::min<size_t>(4, data.count - i);
+			for (size_t k = 0; k < lanes; ++k) visible[i + k] = (mask >> k) & 1;
+		}
+#endif
+		for (; i < data.count; ++i) {
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; ++p) {
+				const float dist = planes[p].x * data.centerX[i] + planes[p].y * data.centerY[i] + planes[p].z * data.centerZ[i] + planes[p].w;
+				const float reach = std::abs(planes[p].x) * data.extentX[i] + std::abs(planes[p].y) * data.extentY[i] + std::abs(planes[p].z) * data.extentZ[i];
+				inside = dist + reach >= 0;
+			}
+			if (inside && coneCull) {
+				const glm::vec3 v(data.centerX[i] - eye.x, data.centerY[i] - eye.y, data.centerZ[i] - eye.z);
+				const float along = v.x * data.axisX[i] + v.y * data.axisY[i] + v.z * data.axisZ[i];
+				inside = !(along > data.cutoff[i] * glm::length(v) + data.radius[i]);
+			}
+			visible[i] = inside;
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// A small cluster of triangles inside a Mesh index buffer, used for culling below submesh granularity.
+// The triangles are a contiguous index range, so visible clusters can be drawn straight from the mesh buffers.
+// Plain floats and unsigned ints only: the struct is written as-is into the cooked .mesh format.
+struct Meshlet
+{
+	unsigned int indexOffset = 0;
+	unsigned int triangleCount = 0;
+	unsigned int vertexCount = 0;
+
+	glm::vec3 aabbMin{};
+	glm::vec3 aabbMax{};
+
+	// Bounding sphere, centered on the AABB
+	glm::vec3 center{};
+	float radius = 0;
+
+	// Backface cone: the cluster faces away from the eye when
+	// dot(center - eye, coneAxis) > coneCutoff * length(center - eye) + radius.
+	// coneCutoff is 1 for clusters whose normals spread too far to ever be culled this way.
+	glm::vec3 coneAxis{};
+	float coneCutoff = 1;
+};
+
+namespace Meshlets
+{
+	constexpr unsigned int kMaxVertices = 64;
+	constexpr unsigned int kMaxTriangles = 124;
+
+	// Splits indices [indexOffset, indexOffset + indexCount) into meshlets, walking the triangles in order
+	// and starting a new cluster whenever the vertex or triangle limit would be exceeded. Appends to out.
+	void build(const glm::vec3* vertices, size_t vertexCount, const unsigned int* indices, size_t indexOffset, size_t indexCount, std::vector<Meshlet>& out);
+
+	// Structure-of-arrays copy of the culling fields, padded to a multiple of 4 for the SIMD kernel
+	struct CullData
+	{
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> extentX, extentY, extentZ;
+		std::vector<float> radius;
+		std::vector<float> axisX, axisY, axisZ, cutoff;
+		size_t count = 0;
+
+		void assign(const std::vector<Meshlet>& meshlets);
+	};
+
+	// Writes 1 to visible[i] for every meshlet whose AABB touches all six planes (xyz = inward normal, w = distance,
+	// in the meshlets' own space) and, when coneCull is set, that is not entirely backfacing as seen from eye.
+	void cull(const CullData& data, const glm::vec4 planes[6], const glm::vec3& eye, bool coneCull, unsigned char* visible);
+}
@@ -0,0 +1,241 @@
+#include "MipChain.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIPGEN_SSE2 1
+#endif
+
+namespace MipGen
+{
+	// Output pixels handled per thread at minimum; small levels stay on the calling thread
+	static constexpr size_t kMinPixelsPerChunk = 1 << 14;
+
+	static constexpr int kKaiserTaps = 8;
+	static constexpr float kKaiserAlpha = 4.0f;
+
+	// Working images are always 4 floats per pixel so one pixel is one SSE register
+	using Pixel = std::array<float, 4>;
+
+	static const float* srgbToLinearTable()
+	{
+		static const auto table = [] {
+			std::array<float, 256> t{};
+			for (int i = 0; i < 256; ++i) {
+				const float c = i / 255.0f;
+				t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return t;
+		}();
+		return table.data();
+	}
+
+	static const unsigned char* linearToSrgbTable()
+	{
+		static const auto table = [] {
+			std::array<unsigned char, 4096> t{};
+			for (int i = 0; i < 4096; ++i) {
+				const float l = i / 4095.0f;
+				const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+				t[i] = static_cast<unsigned char>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+			}
+			return t;
+		}();
+		return table.data();
+	}
+
+	static bool isAlpha(unsigned int channel, unsigned int channels)
+	{
+		return (channels == 2 || channels == 4) && channel == channels - 1;
+	}
+
+	static float besselI0(float x)
+	{
+		float sum = 1, term = 1;
+		for (int k = 1; k < 16; ++k) {
+			term *= (x / (2 * k)) * (x / (2 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	// Weights for src pixels 2x-3 .. 2x+4 around dst pixel x, for a 2:1 reduction
+	static const float* kaiserWeights()
+	{
+		static const auto weights = [] {
+			std::array<float, kKaiserTaps> w{};
+			float total = 0;
+			for (int k = 0; k < kKaiserTaps; ++k) {
+				const float d = (k - 3.5f) / 2.0f; // distance from the dst center, in dst pixels
+				const float sinc = std::sin(3.14159265f * d) / (3.14159265f * d);
+				const float t = d / 2.0f;
+				const float window = besselI0(kKaiserAlpha * std::sqrt(std::max(0.0f, 1 - t * t))) / besselI0(kKaiserAlpha);
+				w[k] = sinc * window;
+				total += w[k];
+			}
+			for (auto& x : w) x /= total;
+			return w;
+		}();
+		return weights.data();
+	}
+
+	unsigned int filterReach(MipFilter filter)
+	{
+		// Kaiser reads src pixels 2x-3 .. 2x+4 for dst pixel x
+		return filter == MipFilter::Kaiser ? kKaiserTaps / 2 - 1 : 0;
+	}
+
+	unsigned int levelCount(unsigned int width, unsigned int height)
+	{
+		unsigned int levels = 1;
+		while (width > 1 || height > 1) {
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+			++levels;
+		}
+		return levels;
+	}
+
+	static void toLinear(const unsigned char* src, size_t count, unsigned int channels, bool srgb, Pixel* dst)
+	{
+		const float* lut = srgbToLinearTable();
+		for (size_t i = 0; i < count; ++i) {
+			Pixel p{ 0, 0, 0, 0 };
+			for (unsigned int c = 0; c < channels; ++c) {
+				const unsigned char v = src[i * channels + c];
+				p[c] = (srgb && !isAlpha(c, channels)) ? lut[v] : v / 255.0f;
+			}
+			dst[i] = p;
+		}
+	}
+
+	static void fromLinear(const Pixel* src, size_t count, unsigned int channels, bool srgb, unsigned char* dst)
+	{
+		const unsigned char* lut = linearToSrgbTable();
+		for (size_t i = 0; i < count; ++i) {
+			for (unsigned int c = 0; c < channels; ++c) {
+				const float v = std::clamp(src[i][c], 0.0f, 1.0f);
+				dst[i * channels + c] = (srgb && !isAlpha(c, channels))
+					? lut[static_cast<int>(v * 4095.0f + 0.5f)]
+					: static_cast<unsigned char>(v * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	static void downsampleBox(const Pixel* src, unsigned int sw, unsigned int sh, Pixel* dst, unsigned int dw, unsigned int dh)
+	{
+		parallelFor(dh, std::max<size_t>(1, kMinPixelsPerChunk / dw), [=](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; ++y) {
+				const Pixel* row0 = src + std::min<size_t>(2 * y, sh - 1) * sw;
+				const Pixel* row1 = src + std::min<size_t>(2 * y + 1, sh - 1) * sw;
+				for (size_t x = 0; x < dw; ++x) {
+					const size_t x0 = std::min<size_t>(2 * x, sw - 1);
+					const size_t x1 = std::min<size_t>(2 * x + 1, sw - 1);
+#ifdef MIPGEN_SSE2
+					const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0[x0].data()), _mm_loadu_ps(row0[x1].data())),
+						_mm_add_ps(_mm_loadu_ps(row1[x0].data()), _mm_loadu_ps(row1[x1].data())));
+					_mm_storeu_ps(dst[y * dw + x].data(), _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+					for (int c = 0; c < 4; ++c) dst[y * dw + x][c] = (row0[x0][c] + row0[x1][c] + row1[x0][c] + row1[x1][c]) * 0.25f;
+#endif
+				}
+			}
+		});
+	}
+
+	// One separable pass: reduces along x when horizontal, along y otherwise. Results are clamped at 0 so
+	// negative lobes can't push linear values below black on the next level.
+	static void kaiserPass(const Pixel* src, unsigned int sw, unsigned int sh, Pixel* dst, unsigned int dw, unsigned int dh, bool horizontal)
+	{
+		const float* w = kaiserWeights();
+		parallelFor(dh, std::max<size_t>(1, kMinPixelsPerChunk / dw), [=](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; ++y) {
+				for (size_t x = 0; x < dw; ++x) {
+					const long center = static_cast<long>(horizontal ? x : y) * 2 - 3;
+					const long limit = static_cast<long>(horizontal ? sw : sh) - 1;
+#ifdef MIPGEN_SSE2
+					__m128 sum = _mm_setzero_ps();
+					for (int k = 0; k < kKaiserTaps; ++k) {
+						const size_t s = static_cast<size_t>(std::clamp(center + k, 0L, limit));
+						const Pixel& p = horizontal ? src[y * sw + s] : src[s * sw + x];
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p.data()), _mm_set1_ps(w[k])));
+					}
+					_mm_storeu_ps(dst[y * dw + x].data(), _mm_max_ps(sum, _mm_setzero_ps()));
+#else
+					Pixel sum{ 0, 0, 0, 0 };
+					for (int k = 0; k < kKaiserTaps; ++k) {
+						const size_t s = static_cast<size_t>(std::clamp(center + k, 0L, limit));
+						const Pixel& p = horizontal ? src[y * sw + s] : src[s * sw + x];
+						for (int c = 0; c < 4; ++c) sum[c] += p[c] * w[k];
+					}
+					for (int c = 0; c < 4; ++c) dst[y * dw + x][c] = std::max(sum[c], 0.0f);
+#endif
+				}
+			}
+		});
+	}
+
+	static void downsampleKaiser(const Pixel* src, unsigned int sw, unsigned int sh, Pixel* dst, unsigned int dw, unsigned int dh, std::vector<Pixel>& scratch)
+	{
+		// An axis that is already 1 pixel wide is carried through unfiltered
+		const Pixel* rows = src;
+		if (dw != sw) {
+			scratch.resize(static_cast<size_t>(dw) * sh);
+			kaiserPass(src, sw, sh, scratch.data(), dw, sh, true);
+			rows = scratch.data();
+		}
+		if (dh != sh) {
+			kaiserPass(rows, dw, sh, dst, dw, dh, false);
+		}
+		else {
+			std::copy(rows, rows + static_cast<size_t>(dw) * dh, dst);
+		}
+	}
+
+	MipChain build(const void* pixels, unsigned int width, unsigned int height, unsigned int channels, MipFilter filter, bool srgb, unsigned int maxLevels)
+	{
+		MipChain chain;
+		chain.width = width;
+		chain.height = height;
+		chain.channels = channels;
+		chain.srgb = srgb;
+		if (!pixels || !width || !height || !channels) return chain;
+
+		const unsigned int count = maxLevels ? std::min(maxLevels, levelCount(width, height)) : levelCount(width, height);
+		size_t total = 0;
+		for (unsigned int w = width, h = height, i = 0; i < count; ++i) {
+			MipLevel level;
+			level.width = w;
+			level.height = h;
+			level.offset = total;
+			level.size = static_cast<size_t>(w) * h * channels;
+			total += level.size;
+			chain.levels.push_back(level);
+			w = std::max(1u, w / 2);
+			h = std::max(1u, h / 2);
+		}
+
+		chain.pixels.resize(total);
+		std::memcpy(chain.pixels.data(), pixels, chain.levels[0].size);
+
+		std::vector<Pixel> current(static_cast<size_t>(width) * height), next, scratch;
+		toLinear(chain.pixels.data(), current.size(), channels, srgb, current.data());
+
+		for (size_t i = 1; i < chain.levels.size(); ++i) {
+			const MipLevel& from = chain.levels[i - 1];
+			const MipLevel& to = chain.levels[i];
+			next.resize(static_cast<size_t>(to.width) * to.height);
+
+			if (filter == MipFilter::Kaiser) downsampleKaiser(current.data(), from.width, from.height, next.data(), to.width, to.height, scratch);
+			else downsampleBox(current.data(), from.width, from.height, next.data(), to.width, to.height);
+
+			fromLinear(next.data(), next.size(), channels, srgb, chain.pixels.data() + to.offset);
+			current.swap(next);
+		}
+		return chain;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "BlockCompression.h"
+
+enum class MipFilter
+{
+	Box,	// 2x2 average; cheap, slightly blurry
+	Kaiser,	// 8-tap Kaiser-windowed sinc, separable; sharper minification
+};
+
+struct MipLevel
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	size_t offset = 0;	// into MipChain::pixels (or the start of a cooked .tex file)
+	size_t size = 0;
+};
+
+// Every level of a texture, tightly packed back to back, level 0 first.
+// Levels hold raw pixels, or compressed blocks when format is not BlockFormat::None.
+struct MipChain
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int channels = 0;
+	bool srgb = true;
+	BlockFormat format = BlockFormat::None;
+	std::vector<MipLevel> levels;
+	std::vector<unsigned char> pixels;
+
+	bool empty() const { return levels.empty(); }
+	const unsigned char* level(size_t i) const { return pixels.data() + levels[i].offset; }
+};
+
+namespace MipGen
+{
+	// Number of levels down to 1x1
+	unsigned int levelCount(unsigned int width, unsigned int height);
+
+	// Texels on each side, beyond the 2 it reduces, that one 2:1 step of the filter reads
+	unsigned int filterReach(MipFilter filter);
+
+	// Builds the full chain from 8-bit pixels (1 to 4 channels). Filtering runs in linear light when srgb is set;
+	// alpha (the last channel of 2- and 4-channel images) is always filtered as-is. Each level is produced from the
+	// previous one at float precision, with SSE2 when available and rows split across threads for large images.
+	// maxLevels stops the chain early (0 = down to 1x1), e.g. for atlas pages whose gutters only cover a few levels.
+	MipChain build(const void* pixels, unsigned int width, unsigned int height, unsigned int channels, MipFilter filter = MipFilter::Box, bool srgb = true, unsigned int maxLevels = 0);
+}
@@ -0,0 +1,182 @@
+#include <GL/glew.h>
+#include "OffscreenContext.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#if defined(_WIN32)
+
+void OffscreenContext::createContext()
+{
+	// WGL needs a window for its pixel format; this one is never shown
+	static const wchar_t* const kClassName = L"MakerOffscreenContext";
+	WNDCLASSW windowClass{};
+	windowClass.style = CS_OWNDC;
+	windowClass.lpfnWndProc = DefWindowProcW;
+	windowClass.hInstance = GetModuleHandleW(nullptr);
+	windowClass.lpszClassName = kClassName;
+	RegisterClassW(&windowClass);
+
+	HWND window = CreateWindowW(kClassName, L"", WS_OVERLAPPEDWINDOW, 0, 0, 1, 1, nullptr, nullptr, windowClass.hInstance, nullptr);
+	if (!window) throw std::runtime_error("Could not create the hidden window of the offscreen context");
+	_display = window;
+	HDC deviceContext = GetDC(window);
+	_deviceContext = deviceContext;
+
+	PIXELFORMATDESCRIPTOR format{};
+	format.nSize = sizeof(format);
+	format.nVersion = 1;
+	format.dwFlags = PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL;
+	format.iPixelType = PFD_TYPE_RGBA;
+	format.cColorBits = 32;
+	format.cDepthBits = 24;
+	format.cStencilBits = 8;
+	const int pixelFormat = ChoosePixelFormat(deviceContext, &format);
+	if (!pixelFormat || !SetPixelFormat(deviceContext, pixelFormat, &format)) throw std::runtime_error("No OpenGL pixel format for the offscreen context");
+
+	HGLRC context = wglCreateContext(deviceContext);
+	if (!context) throw std::runtime_error("Could not create the offscreen OpenGL context");
+	_context = context;
+	if (!wglMakeCurrent(deviceContext, context)) throw std::runtime_error("Could not make the offscreen OpenGL context current");
+}
+
+void OffscreenContext::destroyContext()
+{
+	if (_context) {
+		wglMakeCurrent(nullptr, nullptr);
+		wglDeleteContext(static_cast<HGLRC>(_context));
+	}
+	if (_deviceContext) ReleaseDC(static_cast<HWND>(_display), static_cast<HDC>(_deviceContext));
+	if (_display) DestroyWindow(static_cast<HWND>(_display));
+	_context = _deviceContext = _display = nullptr;
+}
+
+#else
+
+void OffscreenContext::createContext()
+{
+	// The surfaceless platform needs no display server; drivers without it may still hand out a default display
+	EGLDisplay display = EGL_NO_DISPLAY;
+	auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) throw std::runtime_error("No EGL display for the offscreen context");
+	_display = display;
+	if (!eglBindAPI(EGL_OPENGL_API)) throw std::runtime_error("EGL has no desktop OpenGL");
+
+	// The engine draws with the fixed-function pipeline next to its shaders, so it needs a compatibility profile;
+	// 3.3 gives it base-vertex draws and instancing. No config is needed, nothing is drawn to an EGL surface.
+	const EGLint attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+	if (context == EGL_NO_CONTEXT) context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, nullptr);
+	if (context == EGL_NO_CONTEXT) throw std::runtime_error("Could not create the offscreen OpenGL context");
+	_context = context;
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) throw std::runtime_error("Could not make the offscreen OpenGL context current");
+}
+
+void OffscreenContext::destroyContext()
+{
+	if (_display) {
+		eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (_context) eglDestroyContext(_display, _context);
+		eglTerminate(_display);
+	}
+	_context = _display = nullptr;
+}
+
+#endif
+
+OffscreenContext::OffscreenContext(int width, int height) : _width(width), _height(height)
+{
+	try {
+		createContext();
+
+		// GLEW built for GLX reports the missing GLX display of an EGL context after it has loaded the GL entry points
+		const GLenum error = glewInit();
+#if defined(GLEW_ERROR_NO_GLX_DISPLAY)
+		if (error != GLEW_OK && error != GLEW_ERROR_NO_GLX_DISPLAY)
+#else
+		if (error != GLEW_OK)
+#endif
+			throw std::runtime_error(reinterpret_cast<const char*>(glewGetErrorString(error)));
+		if (!GLEW_VERSION_3_0) throw std::runtime_error("OpenGL 3.0 API is not available.");
+		if (const auto* renderer = glGetString(GL_RENDERER)) _renderer = reinterpret_cast<const char*>(renderer);
+
+		glGenFramebuffers(1, &_framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+		glGenRenderbuffers(1, &_colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+		glGenRenderbuffers(1, &_depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error("The offscreen framebuffer is incomplete");
+		glDrawBuffer(GL_COLOR_ATTACHMENT0);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glViewport(0, 0, width, height);
+	}
+	catch (...) {
+		destroyContext();
+		throw;
+	}
+}
+
+OffscreenContext::~OffscreenContext()
+{
+	if (_framebuffer) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &_framebuffer);
+		glDeleteRenderbuffers(1, &_colorBuffer);
+		glDeleteRenderbuffers(1, &_depthBuffer);
+	}
+	destroyContext();
+}
+
+void OffscreenContext::finish() const
+{
+	glFinish();
+}
+
+std::vector<unsigned char> OffscreenContext::readPixels() const
+{
+	const size_t row = static_cast<size_t>(_width) * 3;
+	std::vector<unsigned char> pixels(row * _height);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, _width, _height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+	// GL counts rows from the bottom
+	std::vector<unsigned char> swap(row);
+	for (int y = 0; y < _height / 2; ++y) {
+		auto* top = pixels.data() + y * row;
+		auto* bottom = pixels.data() + (_height - 1 - y) * row;
+		std::copy(top, top + row, swap.data());
+		std::copy(bottom, bottom + row, top);
+		std::copy(swap.data(), swap.data() + row, bottom);
+	}
+	return pixels;
+}
+
+bool OffscreenContext::savePpm(const std::string& path) const
+{
+	const auto pixels = readPixels();
+	std::ofstream file(path, std::ios::binary);
+	file << "P6\n" << _width << " " << _height << "\n255\n";
+	file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// A GL context with no window, drawing into a framebuffer object, for rendering where there is no display: build
+// boxes, CI runners, servers. On Linux it is an EGL context on Mesa's surfaceless platform, which needs neither X nor
+// Wayland and runs on llvmpipe when there is no GPU (LIBGL_ALWAYS_SOFTWARE=1 forces it where there is one). On
+// Windows it is a WGL context on a window that is never shown.
+//
+// Constructing it makes the context current, loads the GL entry points and binds the framebuffer with a viewport
+// over all of it, so the engine draws into it like into a window. Throws std::runtime_error when no context can be had.
+class OffscreenContext
+{
+	int _width;
+	int _height;
+	std::string _renderer;
+
+	unsigned int _framebuffer = 0;
+	unsigned int _colorBuffer = 0;
+	unsigned int _depthBuffer = 0;
+
+	void* _display = nullptr;		// EGLDisplay; the hidden HWND on Windows
+	void* _context = nullptr;		// EGLContext; HGLRC on Windows
+	void* _deviceContext = nullptr;	// HDC, Windows only
+
+	void createContext();
+	void destroyContext();
+
+public:
+	OffscreenContext(int width, int height);
+	OffscreenContext(const OffscreenContext&) = delete;
+	OffscreenContext& operator=(const OffscreenContext&) = delete;
+	~OffscreenContext();
+
+	int width() const { return _width; }
+	int height() const { return _height; }
+	double aspect() const { return static_cast<double>(_width) / _height; }
+	// GL_RENDERER of the context, "llvmpipe (LLVM 15.0.6, 256 bits)" on a software one
+	const std::string& renderer() const { return _renderer; }
+
+	// Blocks until the GPU has finished every command issued so far
+	void finish() const;
+	// The framebuffer as RGB rows, top row first
+	std::vector<unsigned char> readPixels() const;
+	// Writes the framebuffer to a binary PPM
+	bool savePpm(const std::string& path) const;
+};
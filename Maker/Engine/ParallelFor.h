@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Splits [0, count) into contiguous chunks and calls fn(begin, end) for each one on its own thread.
+// Ranges smaller than minChunk run inline on the calling thread, so small meshes pay no thread cost.
+template <typename Fn>
+void parallelFor(size_t count, size_t minChunk, Fn&& fn)
+{
+	const size_t hw = std::max(1u, std::thread::hardware_concurrency());
+	const size_t chunks = std::min(hw, minChunk ? count / minChunk : hw);
+
+	if (chunks <= 1) {
+		if (count) fn(size_t(0), count);
+		return;
+	}
+
+	const size_t chunkSize = (count + chunks - 1) / chunks;
+	std::vector<std::thread> workers;
+	workers.reserve(chunks - 1);
+
+	for (size_t c = 1; c < chunks; ++c) {
+		const size_t begin = c * chunkSize;
+		const size_t end = std::min(count, begin + chunkSize);
+		if (begin >= end) break;
+		workers.emplace_back([&fn, begin, end]() { fn(begin, end); });
+	}
+
+	fn(size_t(0), std::min(count, chunkSize));
+
+	for (auto& worker : workers) worker.join();
+}
@@ -0,0 +1,132 @@
+#include "Picking.h"
+#include "GameObject.h"
+#include "Mesh.h"
+#include "Profiler.h"
+#include "StaticBatcher.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+bool rayIntersectsBoundingBox(const glm::vec3& rayOrigin, const glm::vec3& rayDir, const BoundingBox& bbox) {
+	float tmin = (bbox.min.x - rayOrigin.x) / rayDir.x;
+	float tmax = (bbox.max.x - rayOrigin.x) / rayDir.x;
+
+	if (tmin > tmax) std::swap(tmin, tmax);
+
+	float tymin = (bbox.min.y - rayOrigin.y) / rayDir.y;
+	float tymax = (bbox.max.y - rayOrigin.y) / rayDir.y;
+
+	if (tymin > tymax) std::swap(tymin, tymax);
+
+	if ((tmin > tymax) || (tymin > tmax))
+		return false;
+
+	if (tymin > tmin)
+		tmin = tymin;
+
+	if (tymax < tmax)
+		tmax = tymax;
+
+	float tzmin = (bbox.min.z - rayOrigin.z) / rayDir.z;
+	float tzmax = (bbox.max.z - rayOrigin.z) / rayDir.z;
+
+	if (tzmin > tzmax) std::swap(tzmin, tzmax);
+
+	if ((tmin > tzmax) || (tzmin > tmax))
+		return false;
+
+	return true;
+}
+
+glm::vec3 getRayFromMouse(int mouseX, int mouseY, const glm::mat4& projection, const glm::mat4& view, const glm::ivec2& viewportSize) {
+	float x = (2.0f * mouseX) / viewportSize.x - 1.0f;
+	float y = 1.0f - (2.0f * mouseY) / viewportSize.y;
+	glm::vec4 rayClip = glm::vec4(x, y, -1.0f, 1.0f);
+
+	glm::vec4 rayEye = glm::inverse(projection) * rayClip;
+	rayEye = glm::vec4(rayEye.x, rayEye.y, -1.0f, 0.0f);
+
+	glm::vec3 rayWorld = glm::normalize(glm::vec3(glm::inverse(view) * rayEye));
+	return rayWorld;
+}
+
+// Moller-Trumbore; t is the distance along rayDir to the hit
+static bool rayIntersectsTriangle(const glm::vec3& rayOrigin, const glm::vec3& rayDir, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& t) {
+	const glm::vec3 edge1 = v1 - v0;
+	const glm::vec3 edge2 = v2 - v0;
+	const glm::vec3 p = glm::cross(rayDir, edge2);
+	const float det = glm::dot(edge1, p);
+	if (std::abs(det) < 1e-8f) return false;
+
+	const float invDet = 1.0f / det;
+	const glm::vec3 s = rayOrigin - v0;
+	const float u = glm::dot(s, p) * invDet;
+	if (u < 0.0f || u > 1.0f) return false;
+
+	const glm::vec3 q = glm::cross(s, edge1);
+	const float v = glm::dot(rayDir, q) * invDet;
+	if (v < 0.0f || u + v > 1.0f) return false;
+
+	t = glm::dot(edge2, q) * invDet;
+	return t > 0.0f;
+}
+
+// Id of the object owning the nearest batched triangle on the ray, or 0. Only the ranges whose bounds the ray
+// crosses are tested.
+static int raycastStaticBatches(const glm::vec3& rayOrigin, const glm::vec3& rayDir) {
+	int objectId = 0;
+	float nearest = std::numeric_limits<float>::max();
+	for (const auto& batch : StaticBatcher::getInstance().batches()) {
+		if (!rayIntersectsBoundingBox(rayOrigin, rayDir, batch.mesh->boundingBox())) continue;
+		const auto& vertices = batch.mesh->vertices();
+		const auto& indices = batch.mesh->indices();
+		for (const auto& range : batch.ranges) {
+			if (!rayIntersectsBoundingBox(rayOrigin, rayDir, range.bounds)) continue;
+			const size_t end = std::min<size_t>(range.indexOffset + range.indexCount, indices.size());
+			for (size_t i = range.indexOffset; i + 2 < end; i += 3) {
+				float t;
+				if (rayIntersectsTriangle(rayOrigin, rayDir, vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], t) && t < nearest) {
+					nearest = t;
+					objectId = batch.objectAtTriangle(i / 3);
+				}
+			}
+		}
+		batch.mesh->trimCpuData();
+	}
+	return objectId;
+}
+
+static bool containsObject(GameObject& go, int id) {
+	if (go.id == id) return true;
+	for (auto& child : go.getChildren()) {
+		if (containsObject(child, id)) return true;
+	}
+	return false;
+}
+
+GameObject* raycastFromMouseToGameObject(int mouseX, int mouseY, const glm::mat4& projection, const glm::mat4& view, const glm::ivec2& viewportSize) {
+	return raycastFromMouseToGameObject(scene, mouseX, mouseY, projection, view, viewportSize);
+}
+
+GameObject* raycastFromMouseToGameObject(GameObject& root, int mouseX, int mouseY, const glm::mat4& projection, const glm::mat4& view, const glm::ivec2& viewportSize) {
+	PROFILE_FUNCTION();
+	// The ray starts at the camera position, in world coordinates
+	glm::vec3 rayOrigin = glm::vec3(glm::inverse(view) * glm::vec4(0, 0, 0, 1));
+	glm::vec3 rayDirection = getRayFromMouse(mouseX, mouseY, projection, view, viewportSize);
+
+	// Merged objects are hit by their triangles, and the direct child they belong to is picked
+	if (const int batchedId = raycastStaticBatches(rayOrigin, rayDirection)) {
+		for (auto& go : root.getChildren()) {
+			if (containsObject(go, batchedId)) return &go;
+		}
+	}
+
+	// A batched object whose triangles the ray missed is not picked by its bounding box either
+	for (auto& go : root.getChildren()) {
+		if (!go.staticBatched && rayIntersectsBoundingBox(rayOrigin, rayDirection, go.boundingBox())) {
+			return &go;
+		}
+	}
+	return nullptr;
+}
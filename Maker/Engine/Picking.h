@@ -0,0 +1,16 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "BoundingBox.h"
+
+class GameObject;
+
+// Slab test of the ray against the box; rayDir does not need to be normalised
+bool rayIntersectsBoundingBox(const glm::vec3& rayOrigin, const glm::vec3& rayDir, const BoundingBox& bbox);
+
+// World-space direction of the ray through a pixel of the viewport (y grows downwards, as in window events)
+glm::vec3 getRayFromMouse(int mouseX, int mouseY, const glm::mat4& projection, const glm::mat4& view, const glm::ivec2& viewportSize);
+
+// First direct child of root whose world bounding box the mouse ray hits, or nullptr. Objects merged by the
+// StaticBatcher are tested by their triangles in the batch instead; the nearest triangle hit is picked first.
+GameObject* raycastFromMouseToGameObject(int mouseX, int mouseY, const glm::mat4& projection, const glm::mat4& view, const glm::ivec2& viewportSize);
+GameObject* raycastFromMouseToGameObject(GameObject& root, int mouseX, int mouseY, const glm::mat4& projection, const glm::mat4& view, const glm::ivec2& viewportSize);
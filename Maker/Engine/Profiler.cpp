@@ -0,0 +1,170 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+	thread_local uint32_t t_depth = 0;
+
+	const auto kEpoch = std::chrono::steady_clock::now();
+
+	void writeJsonString(std::ostream& out, const std::string& text)
+	{
+		out << '"';
+		for (char c : text) {
+			if (c == '"' || c == '\\') out << '\\' << c;
+			else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+			else out << c;
+		}
+		out << '"';
+	}
+}
+
+Profiler& Profiler::getInstance()
+{
+	// Never destroyed: pool threads may still close scopes while statics are torn down
+	static Profiler* instance = new Profiler();
+	return *instance;
+}
+
+int64_t Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - kEpoch).count();
+}
+
+uint32_t Profiler::openScope()
+{
+	return t_depth++;
+}
+
+void Profiler::closeScope()
+{
+	--t_depth;
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer()
+{
+	thread_local ThreadBuffer* buffer = nullptr;
+	if (!buffer) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_threads.push_back(std::make_unique<ThreadBuffer>());
+		buffer = _threads.back().get();
+		buffer->thread = static_cast<uint32_t>(_threads.size() - 1);
+		buffer->name = "Thread " + std::to_string(buffer->thread);
+	}
+	return *buffer;
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+	auto& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(_mutex);
+	buffer.name = name;
+}
+
+void Profiler::beginFrame()
+{
+	const int64_t start = now();
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_frameStarts.empty()) _frameStarts.resize(kFrames);
+	_frameStarts[_frameCount % kFrames] = start;
+	++_frameCount;
+}
+
+void Profiler::record(const char* name, int64_t start, int64_t end, uint32_t depth)
+{
+	auto& buffer = threadBuffer();
+	const uint64_t index = buffer.head.load(std::memory_order_relaxed);
+	Slot& slot = buffer.slots[index % kEventsPerThread];
+	// Writer half of the seqlock: a reader whose slot loads see any of the stores below also sees head at index
+	// (stored by the previous event) or later, and drops the slot as torn
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.start.store(start, std::memory_order_relaxed);
+	slot.end.store(end, std::memory_order_relaxed);
+	slot.depth.store(depth, std::memory_order_relaxed);
+	buffer.head.store(index + 1, std::memory_order_release);
+}
+
+Profiler::Capture Profiler::capture(size_t frames) const
+{
+	Capture capture;
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// The frame still running is left out: its events are not all in yet
+	if (_frameCount < 2) return capture;
+	const uint64_t complete = std::min<uint64_t>({ frames, _frameCount - 1, kFrames - 1 });
+	if (!complete) return capture;
+	for (uint64_t f = _frameCount - 1 - complete; f < _frameCount; ++f) capture.frames.push_back(_frameStarts[f % kFrames]);
+	const int64_t begin = capture.begin();
+	const int64_t end = capture.end();
+
+	for (const auto& buffer : _threads) {
+		Track track;
+		track.thread = buffer->thread;
+		track.name = buffer->name;
+
+		const uint64_t head = buffer->head.load(std::memory_order_acquire);
+		const uint64_t first = head > kEventsPerThread ? head - kEventsPerThread : 0;
+		std::vector<std::pair<uint64_t, Event>> read;
+		for (uint64_t i = first; i < head; ++i) {
+			const Slot& slot = buffer->slots[i % kEventsPerThread];
+			Event event{ slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+				slot.end.load(std::memory_order_relaxed), slot.depth.load(std::memory_order_relaxed) };
+			if (event.end <= begin || event.start >= end) continue;
+			read.emplace_back(i, event);
+		}
+
+		// Slots the owner wrapped over while we were reading may be torn; keep only those still in the ring. While
+		// the owner writes event after into its slot, head still reads after, so index after - kEventsPerThread is
+		// already being overwritten. The fence keeps the slot loads above from moving past the second head load and
+		// pairs with the release fence in record().
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t after = buffer->head.load(std::memory_order_relaxed);
+		for (const auto& [index, event] : read) {
+			if (index + kEventsPerThread > after) track.events.push_back(event);
+			else ++capture.dropped;
+		}
+
+		if (track.events.empty()) continue;
+		std::sort(track.events.begin(), track.events.end(), [](const Event& a, const Event& b) {
+			return a.start < b.start || (a.start == b.start && a.depth < b.depth);
+		});
+		capture.tracks.push_back(std::move(track));
+	}
+	return capture;
+}
+
+bool Profiler::exportChromeTrace(const std::string& path, size_t frames) const
+{
+	const Capture capture = this->capture(frames);
+	std::ofstream out(path);
+	if (!out) return false;
+
+	// Complete ("X") events in microseconds; one metadata event per thread for its name
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto separator = [&]() { if (!first) out << ",\n"; first = false; };
+	for (const auto& track : capture.tracks) {
+		separator();
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track.thread << ",\"args\":{\"name\":";
+		writeJsonString(out, track.name);
+		out << "}}";
+		for (const auto& event : track.events) {
+			separator();
+			out << "{\"name\":";
+			writeJsonString(out, event.name ? event.name : "");
+			out << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << track.thread
+				<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+		}
+	}
+	for (size_t f = 0; f + 1 < capture.frames.size(); ++f) {
+		separator();
+		out << "{\"name\":\"Frame " << f << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":" << capture.frames[f] / 1000.0 << "}";
+	}
+	out << "\n]}\n";
+	return static_cast<bool>(out);
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Builds with MAKER_PROFILER=0 compile every PROFILE_* marker out; the Profiler class itself stays so tools using
+// captures still link, they just see nothing recorded.
+#ifndef MAKER_PROFILER
+#define MAKER_PROFILER 1
+#endif
+
+// Hierarchical CPU timings. Each scope marker writes one event (name, start, end, nesting depth) into a ring owned
+// by its thread when it closes, with no locks on that path; older events are overwritten once a ring is full. The
+// main thread marks frame boundaries, and capture() copies out whatever falls into the last N frames from every
+// thread's ring for the timeline view or the Chrome trace export (chrome://tracing, Perfetto).
+//
+// Names must outlive the profiler: string literals or __func__.
+class Profiler
+{
+public:
+	static constexpr size_t kEventsPerThread = 1 << 16;
+	static constexpr size_t kFrames = 256;
+
+	struct Event
+	{
+		const char* name;
+		int64_t start;	// nanoseconds since the profiler started
+		int64_t end;
+		uint32_t depth;
+	};
+
+	struct Track
+	{
+		uint32_t thread;
+		std::string name;
+		std::vector<Event> events;	// ordered by start
+	};
+
+	struct Capture
+	{
+		std::vector<int64_t> frames;	// start of each captured frame, plus the end of the last one
+		std::vector<Track> tracks;
+		size_t dropped = 0;				// events overwritten before they could be read
+
+		int64_t begin() const { return frames.empty() ? 0 : frames.front(); }
+		int64_t end() const { return frames.empty() ? 0 : frames.back(); }
+	};
+
+	// Off skips recording at the markers; they still cost a load and a branch
+	std::atomic<bool> enabled{ true };
+
+	static Profiler& getInstance();
+	static int64_t now();
+
+	// Called by the main thread once per frame, before anything in it is profiled
+	void beginFrame();
+	// Names the calling thread's track
+	void setThreadName(const std::string& name);
+
+	void record(const char* name, int64_t start, int64_t end, uint32_t depth);
+	// Depth for a scope opening on this thread; closeScope() hands it back
+	static uint32_t openScope();
+	static void closeScope();
+
+	// The last frames complete frames (fewer if not that many have passed yet)
+	Capture capture(size_t frames) const;
+	bool exportChromeTrace(const std::string& path, size_t frames) const;
+
+private:
+	// Written only by the owning thread, read by capture() from any thread; the fields are atomic so a slot
+	// being overwritten mid-read is a stale value rather than a race, and the head check throws it away
+	struct Slot
+	{
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<int64_t> start{ 0 };
+		std::atomic<int64_t> end{ 0 };
+		std::atomic<uint32_t> depth{ 0 };
+	};
+
+	struct ThreadBuffer
+	{
+		uint32_t thread = 0;
+		std::string name;
+		std::unique_ptr<Slot[]> slots{ new Slot[kEventsPerThread] };
+		std::atomic<uint64_t> head{ 0 };	// events ever written
+	};
+
+	// Buffers are never freed: a thread's events stay readable after it exits
+	mutable std::mutex _mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> _threads;
+	std::vector<int64_t> _frameStarts;	// ring of kFrames
+	uint64_t _frameCount = 0;
+
+	Profiler() = default;
+	ThreadBuffer& threadBuffer();
+};
+
+// Times the enclosing scope; use through PROFILE_SCOPE so shipping builds can drop it
+class ProfileScope
+{
+	const char* _name = nullptr;
+	int64_t _start = 0;
+	uint32_t _depth = 0;
+
+public:
+	explicit ProfileScope(const char* name)
+	{
+		if (!Profiler::getInstance().enabled.load(std::memory_order_relaxed)) return;
+		_name = name;
+		_depth = Profiler::openScope();
+		_start = Profiler::now();
+	}
+
+	~ProfileScope()
+	{
+		if (!_name) return;
+		Profiler::getInstance().record(_name, _start, Profiler::now(), _depth);
+		Profiler::closeScope();
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#if MAKER_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_FRAME() Profiler::getInstance().beginFrame()
+#define PROFILE_THREAD(name) Profiler::getInstance().setThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
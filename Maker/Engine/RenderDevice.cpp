@@ -0,0 +1,617 @@
+#include <GL/glew.h>
+#include "RenderDevice.h"
+#include "CachingRenderDevice.h"
+#include <glm/gtc/type_ptr.hpp>
+
+namespace
+{
+	// Never destroyed: meshes and images in static scene objects release their buffers after any function-local static is gone
+	std::unique_ptr<RenderDevice>& installed()
+	{
+		static auto* device = new std::unique_ptr<RenderDevice>(std::make_unique<CachingRenderDevice>(std::make_unique<GLRenderDevice>()));
+		return *device;
+	}
+
+	GLenum bufferTarget(RenderDevice::Buffer target)
+	{
+		return target == RenderDevice::Buffer::Index ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+	}
+
+	GLenum capability(RenderDevice::Capability capability)
+	{
+		return capability == RenderDevice::Capability::CullFace ? GL_CULL_FACE : GL_TEXTURE_2D;
+	}
+
+	GLenum clientArray(RenderDevice::ClientArray array)
+	{
+		switch (array) {
+		case RenderDevice::ClientArray::Normal: return GL_NORMAL_ARRAY;
+		case RenderDevice::ClientArray::Color: return GL_COLOR_ARRAY;
+		case RenderDevice::ClientArray::TexCoord: return GL_TEXTURE_COORD_ARRAY;
+		default: return GL_VERTEX_ARRAY;
+		}
+	}
+
+	GLenum primitive(RenderDevice::Primitive primitive)
+	{
+		return primitive == RenderDevice::Primitive::Lines ? GL_LINES : GL_TRIANGLES;
+	}
+
+	GLint wrapMode(RenderDevice::Wrap wrap)
+	{
+		switch (wrap) {
+		case RenderDevice::Wrap::MirroredRepeat: return GL_MIRRORED_REPEAT;
+		case RenderDevice::Wrap::Clamp: return GL_CLAMP_TO_EDGE;
+		default: return GL_REPEAT;
+		}
+	}
+
+	GLint filterMode(RenderDevice::Filter filter)
+	{
+		switch (filter) {
+		case RenderDevice::Filter::Linear: return GL_LINEAR;
+		case RenderDevice::Filter::NearestMipmapNearest: return GL_NEAREST_MIPMAP_NEAREST;
+		case RenderDevice::Filter::NearestMipmapLinear: return GL_NEAREST_MIPMAP_LINEAR;
+		case RenderDevice::Filter::LinearMipmapLinear: return GL_LINEAR_MIPMAP_LINEAR;
+		default: return GL_NEAREST;
+		}
+	}
+
+	GLenum formatFromChannels(unsigned int channels)
+	{
+		switch (channels) {
+		case 1: return GL_LUMINANCE;
+		case 2: return GL_LUMINANCE_ALPHA;
+		case 4: return GL_RGBA;
+		default: return GL_RGB;
+		}
+	}
+
+	GLenum compressedFormat(BlockFormat format)
+	{
+		switch (format) {
+		case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+		default: return 0;
+		}
+	}
+
+	int rowAlignment(unsigned int width, unsigned int channels)
+	{
+		const size_t rowSizeInBytes = static_cast<size_t>(width) * channels;
+		if ((rowSizeInBytes % 8) == 0) return 8;
+		if ((rowSizeInBytes % 4) == 0) return 4;
+		if ((rowSizeInBytes % 2) == 0) return 2;
+		return 1;
+	}
+
+	const void* bufferOffset(size_t offset)
+	{
+		return reinterpret_cast<const void*>(offset);
+	}
+
+	unsigned int compileShader(GLenum type, const char* source, std::string& log)
+	{
+		const unsigned int shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+
+		int ok = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+		if (!ok) {
+			char info[512] = {};
+			glGetShaderInfoLog(shader, sizeof(info), nullptr, info);
+			log = info;
+			glDeleteShader(shader);
+			return 0;
+		}
+		return shader;
+	}
+}
+
+RenderDevice& RenderDevice::getInstance()
+{
+	return *installed();
+}
+
+void RenderDevice::install(std::unique_ptr<RenderDevice> device)
+{
+	installed() = device ? std::move(device) : std::make_unique<CachingRenderDevice>(std::make_unique<GLRenderDevice>());
+}
+
+bool GLRenderDevice::supports(Feature feature)
+{
+	int& known = _features[static_cast<int>(feature)];
+	if (known < 0) {
+		// Base-vertex draws are core from 3.2 on, instanced arrays and attribute divisors from 3.3
+		known = feature == Feature::BaseVertex ? GLEW_VERSION_3_2 : GLEW_VERSION_3_3;
+	}
+	return known != 0;
+}
+
+unsigned int GLRenderDevice::createBuffer()
+{
+	unsigned int id = 0;
+	glGenBuffers(1, &id);
+	return id;
+}
+
+void GLRenderDevice::deleteBuffer(unsigned int id)
+{
+	glDeleteBuffers(1, &id);
+}
+
+void GLRenderDevice::bindBuffer(Buffer target, unsigned int id)
+{
+	glBindBuffer(bufferTarget(target), id);
+}
+
+void GLRenderDevice::bufferData(Buffer target, size_t size, const void* data, Usage usage)
+{
+	glBufferData(bufferTarget(target), size, data, usage == Usage::Stream ? GL_STREAM_DRAW : GL_STATIC_DRAW);
+}
+
+void GLRenderDevice::bufferSubData(Buffer target, size_t offset, size_t size, const void* data)
+{
+	glBufferSubData(bufferTarget(target), offset, size, data);
+}
+
+void GLRenderDevice::copyBuffer(unsigned int from, unsigned int to, size_t fromOffset, size_t toOffset, size_t size)
+{
+	glBindBuffer(GL_COPY_READ_BUFFER, from);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, to);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, fromOffset, toOffset, size);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+unsigned int GLRenderDevice::createTexture()
+{
+	unsigned int id = 0;
+	glGenTextures(1, &id);
+	return id;
+}
+
+void GLRenderDevice::deleteTexture(unsigned int id)
+{
+	glDeleteTextures(1, &id);
+}
+
+void GLRenderDevice::bindTexture(unsigned int id)
+{
+	glBindTexture(GL_TEXTURE_2D, id);
+}
+
+void GLRenderDevice::textureImage(unsigned int level, unsigned int width, unsigned int height, unsigned int channels, BlockFormat format, const void* data, size_t size)
+{
+	if (format != BlockFormat::None) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, compressedFormat(format), width, height, 0, static_cast<GLsizei>(size), data);
+		return;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, rowAlignment(width, channels));
+	glTexImage2D(GL_TEXTURE_2D, level, channels, width, height, 0, formatFromChannels(channels), GL_UNSIGNED_BYTE, data);
+}
+
+void GLRenderDevice::textureLevels(unsigned int base, unsigned int max)
+{
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, max);
+}
+
+void GLRenderDevice::textureSampler(Wrap wrap, Filter minFilter, Filter magFilter)
+{
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode(wrap));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode(wrap));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterMode(minFilter));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterMode(magFilter));
+}
+
+void GLRenderDevice::enable(Capability capability)
+{
+	glEnable(::capability(capability));
+}
+
+void GLRenderDevice::disable(Capability capability)
+{
+	glDisable(::capability(capability));
+}
+
+bool GLRenderDevice::isEnabled(Capability capability)
+{
+	return glIsEnabled(::capability(capability));
+}
+
+void GLRenderDevice::enableArray(ClientArray array)
+{
+	glEnableClientState(clientArray(array));
+}
+
+void GLRenderDevice::disableArray(ClientArray array)
+{
+	glDisableClientState(clientArray(array));
+}
+
+void GLRenderDevice::arrayPointer(ClientArray array, int components, ComponentType type, size_t stride, size_t offset)
+{
+	const GLenum glType = type == ComponentType::UnsignedByte ? GL_UNSIGNED_BYTE : GL_FLOAT;
+	switch (array) {
+	case ClientArray::Vertex: glVertexPointer(components, glType, static_cast<GLsizei>(stride), bufferOffset(offset)); break;
+	case ClientArray::Normal: glNormalPointer(glType, static_cast<GLsizei>(stride), bufferOffset(offset)); break;
+	case ClientArray::Color: glColorPointer(components, glType, static_cast<GLsizei>(stride), bufferOffset(offset)); break;
+	case ClientArray::TexCoord: glTexCoordPointer(components, glType, static_cast<GLsizei>(stride), bufferOffset(offset)); break;
+	}
+}
+
+void GLRenderDevice::color(const color4& color)
+{
+	glColor4ubv(glm::value_ptr(color));
+}
+
+void GLRenderDevice::lineWidth(float width)
+{
+	glLineWidth(width);
+}
+
+void GLRenderDevice::loadMatrix(const mat4& matrix)
+{
+	glLoadMatrixd(glm::value_ptr(matrix));
+}
+
+void GLRenderDevice::pushMatrix()
+{
+	glPushMatrix();
+}
+
+void GLRenderDevice::multMatrix(const mat4& matrix)
+{
+	glMultMatrixd(glm::value_ptr(matrix));
+}
+
+void GLRenderDevice::popMatrix()
+{
+	glPopMatrix();
+}
+
+void GLRenderDevice::enableAttribute(unsigned int index)
+{
+	glEnableVertexAttribArray(index);
+}
+
+void GLRenderDevice::disableAttribute(unsigned int index)
+{
+	glDisableVertexAttribArray(index);
+}
+
+void GLRenderDevice::attributePointer(unsigned int index, int components, size_t stride, size_t offset)
+{
+	glVertexAttribPointer(index, components, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), bufferOffset(offset));
+}
+
+void GLRenderDevice::attributeDivisor(unsigned int index, unsigned int divisor)
+{
+	glVertexAttribDivisor(index, divisor);
+}
+
+unsigned int GLRenderDevice::createProgram(const char* vertexSource, const char* fragmentSource,
+	const std::vector<std::pair<unsigned int, const char*>>& attributes, std::string& log)
+{
+	const unsigned int vertex = compileShader(GL_VERTEX_SHADER, vertexSource, log);
+	const unsigned int fragment = vertex ? compileShader(GL_FRAGMENT_SHADER, fragmentSource, log) : 0;
+	if (!vertex || !fragment) {
+		if (vertex) glDeleteShader(vertex);
+		return 0;
+	}
+
+	unsigned int program = glCreateProgram();
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	for (const auto& [location, name] : attributes) glBindAttribLocation(program, location, name);
+	glLinkProgram(program);
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	int ok = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		char info[512] = {};
+		glGetProgramInfoLog(program, sizeof(info), nullptr, info);
+		log = info;
+		glDeleteProgram(program);
+		program = 0;
+	}
+	return program;
+}
+
+void GLRenderDevice::deleteProgram(unsigned int program)
+{
+	glDeleteProgram(program);
+}
+
+void GLRenderDevice::useProgram(unsigned int program)
+{
+	glUseProgram(program);
+}
+
+int GLRenderDevice::uniformLocation(unsigned int program, const char* name)
+{
+	return glGetUniformLocation(program, name);
+}
+
+void GLRenderDevice::uniform(int location, int value)
+{
+	glUniform1i(location, value);
+}
+
+void GLRenderDevice::drawElements(Primitive primitive, size_t count, size_t firstIndex, int baseVertex)
+{
+	const void* offset = bufferOffset(firstIndex * sizeof(unsigned int));
+	if (baseVertex) glDrawElementsBaseVertex(::primitive(primitive), static_cast<GLsizei>(count), GL_UNSIGNED_INT, offset, baseVertex);
+	else glDrawElements(::primitive(primitive), static_cast<GLsizei>(count), GL_UNSIGNED_INT, offset);
+}
+
+void GLRenderDevice::multiDrawElements(const int* counts, const void* const* offsets, size_t drawCount, int baseVertex)
+{
+	if (baseVertex) {
+		// Every range of one mesh shares its base vertex
+		_baseVertices.assign(drawCount, baseVertex);
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, static_cast<GLsizei>(drawCount), _baseVertices.data());
+	}
+	else {
+		glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, static_cast<GLsizei>(drawCount));
+	}
+}
+
+void GLRenderDevice::drawElementsInstanced(size_t count, size_t firstIndex, size_t instances, int baseVertex)
+{
+	const void* offset = bufferOffset(firstIndex * sizeof(unsigned int));
+	if (baseVertex) glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(count), GL_UNSIGNED_INT, offset, static_cast<GLsizei>(instances), baseVertex);
+	else glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(count), GL_UNSIGNED_INT, offset, static_cast<GLsizei>(instances));
+}
+
+void GLRenderDevice::drawArrays(Primitive primitive, size_t first, size_t count)
+{
+	glDrawArrays(::primitive(primitive), static_cast<GLint>(first), static_cast<GLsizei>(count));
+}
+
+void RecordingRenderDevice::reset()
+{
+	counters = {};
+	log.clear();
+}
+
+void RecordingRenderDevice::record(const char* command, std::initializer_list<size_t> args)
+{
+	++counters.commands;
+	if (!keepLog) return;
+
+	std::string line = command;
+	for (size_t arg : args) line += " " + std::to_string(arg);
+	log.push_back(std::move(line));
+}
+
+bool RecordingRenderDevice::supports(Feature feature)
+{
+	return feature == Feature::BaseVertex ? baseVertex : instancing;
+}
+
+unsigned int RecordingRenderDevice::createBuffer()
+{
+	record("createBuffer", { _nextId });
+	++counters.buffersCreated;
+	return _nextId++;
+}
+
+void RecordingRenderDevice::deleteBuffer(unsigned int id)
+{
+	record("deleteBuffer", { id });
+}
+
+void RecordingRenderDevice::bindBuffer(Buffer target, unsigned int id)
+{
+	record("bindBuffer", { static_cast<size_t>(target), id });
+	++counters.bufferBinds;
+}
+
+void RecordingRenderDevice::bufferData(Buffer target, size_t size, const void* data, Usage usage)
+{
+	record("bufferData", { static_cast<size_t>(target), size, static_cast<size_t>(usage) });
+	if (data) counters.bytesUploaded += size;
+}
+
+void RecordingRenderDevice::bufferSubData(Buffer target, size_t offset, size_t size, const void*)
+{
+	record("bufferSubData", { static_cast<size_t>(target), offset, size });
+	counters.bytesUploaded += size;
+}
+
+void RecordingRenderDevice::copyBuffer(unsigned int from, unsigned int to, size_t fromOffset, size_t toOffset, size_t size)
+{
+	record("copyBuffer", { from, to, fromOffset, toOffset, size });
+}
+
+unsigned int RecordingRenderDevice::createTexture()
+{
+	record("createTexture", { _nextId });
+	++counters.texturesCreated;
+	return _nextId++;
+}
+
+void RecordingRenderDevice::deleteTexture(unsigned int id)
+{
+	record("deleteTexture", { id });
+}
+
+void RecordingRenderDevice::bindTexture(unsigned int id)
+{
+	record("bindTexture", { id });
+	++counters.textureBinds;
+}
+
+void RecordingRenderDevice::textureImage(unsigned int level, unsigned int width, unsigned int height, unsigned int channels, BlockFormat format, const void* data, size_t size)
+{
+	record("textureImage", { level, width, height, channels, static_cast<size_t>(format), size });
+	if (data) counters.bytesUploaded += size;
+}
+
+void RecordingRenderDevice::textureLevels(unsigned int base, unsigned int max)
+{
+	record("textureLevels", { base, max });
+}
+
+void RecordingRenderDevice::textureSampler(Wrap wrap, Filter minFilter, Filter magFilter)
+{
+	record("textureSampler", { static_cast<size_t>(wrap), static_cast<size_t>(minFilter), static_cast<size_t>(magFilter) });
+}
+
+void RecordingRenderDevice::enable(Capability capability)
+{
+	record("enable", { static_cast<size_t>(capability) });
+	++counters.stateChanges;
+	_enabled.insert(static_cast<int>(capability));
+}
+
+void RecordingRenderDevice::disable(Capability capability)
+{
+	record("disable", { static_cast<size_t>(capability) });
+	++counters.stateChanges;
+	_enabled.erase(static_cast<int>(capability));
+}
+
+bool RecordingRenderDevice::isEnabled(Capability capability)
+{
+	return _enabled.count(static_cast<int>(capability)) != 0;
+}
+
+void RecordingRenderDevice::enableArray(ClientArray array)
+{
+	record("enableArray", { static_cast<size_t>(array) });
+	++counters.stateChanges;
+}
+
+void RecordingRenderDevice::disableArray(ClientArray array)
+{
+	record("disableArray", { static_cast<size_t>(array) });
+	++counters.stateChanges;
+}
+
+void RecordingRenderDevice::arrayPointer(ClientArray array, int components, ComponentType type, size_t stride, size_t offset)
+{
+	record("arrayPointer", { static_cast<size_t>(array), static_cast<size_t>(components), static_cast<size_t>(type), stride, offset });
+}
+
+void RecordingRenderDevice::color(const color4& color)
+{
+	record("color", { color.r, color.g, color.b, color.a });
+	++counters.stateChanges;
+}
+
+void RecordingRenderDevice::lineWidth(float width)
+{
+	record("lineWidth", { static_cast<size_t>(width) });
+	++counters.stateChanges;
+}
+
+void RecordingRenderDevice::loadMatrix(const mat4&)
+{
+	record("loadMatrix");
+	++counters.stateChanges;
+}
+
+void RecordingRenderDevice::pushMatrix()
+{
+	record("pushMatrix");
+}
+
+void RecordingRenderDevice::multMatrix(const mat4&)
+{
+	record("multMatrix");
+	++counters.stateChanges;
+}
+
+void RecordingRenderDevice::popMatrix()
+{
+	record("popMatrix");
+	++counters.stateChanges;
+}
+
+void RecordingRenderDevice::enableAttribute(unsigned int index)
+{
+	record("enableAttribute", { index });
+	++counters.stateChanges;
+}
+
+void RecordingRenderDevice::disableAttribute(unsigned int index)
+{
+	record("disableAttribute", { index });
+	++counters.stateChanges;
+}
+
+void RecordingRenderDevice::attributePointer(unsigned int index, int components, size_t stride, size_t offset)
+{
+	record("attributePointer", { index, static_cast<size_t>(components), stride, offset });
+}
+
+void RecordingRenderDevice::attributeDivisor(unsigned int index, unsigned int divisor)
+{
+	record("attributeDivisor", { index, divisor });
+}
+
+unsigned int RecordingRenderDevice::createProgram(const char*, const char*,
+	const std::vector<std::pair<unsigned int, const char*>>&, std::string&)
+{
+	record("createProgram", { _nextId });
+	return _nextId++;
+}
+
+void RecordingRenderDevice::deleteProgram(unsigned int program)
+{
+	record("deleteProgram", { program });
+}
+
+void RecordingRenderDevice::useProgram(unsigned int program)
+{
+	record("useProgram", { program });
+	++counters.stateChanges;
+}
+
+int RecordingRenderDevice::uniformLocation(unsigned int, const char*)
+{
+	return 0;
+}
+
+void RecordingRenderDevice::uniform(int location, int value)
+{
+	record("uniform", { static_cast<size_t>(location), static_cast<size_t>(value) });
+}
+
+void RecordingRenderDevice::drawElements(Primitive primitive, size_t count, size_t firstIndex, int baseVertex)
+{
+	record("drawElements", { static_cast<size_t>(primitive), count, firstIndex, static_cast<size_t>(baseVertex) });
+	++counters.drawCalls;
+	counters.indices += count;
+}
+
+void RecordingRenderDevice::multiDrawElements(const int* counts, const void* const*, size_t drawCount, int baseVertex)
+{
+	size_t indices = 0;
+	for (size_t i = 0; i < drawCount; ++i) indices += counts[i];
+	record("multiDrawElements", { drawCount, indices, static_cast<size_t>(baseVertex) });
+	++counters.drawCalls;
+	counters.indices += indices;
+}
+
+void RecordingRenderDevice::drawElementsInstanced(size_t count, size_t firstIndex, size_t instances, int baseVertex)
+{
+	record("drawElementsInstanced", { count, firstIndex, instances, static_cast<size_t>(baseVertex) });
+	++counters.drawCalls;
+	++counters.instancedDraws;
+	counters.indices += count * instances;
+}
+
+void RecordingRenderDevice::drawArrays(Primitive primitive, size_t first, size_t count)
+{
+	record("drawArrays", { static_cast<size_t>(primitive), first, count });
+	++counters.drawCalls;
+	counters.indices += count;
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "types.h"
+#include "MipChain.h"
+
+// Everything the engine asks of the graphics API, one level above raw GL: buffers, textures, the fixed-function
+// state it uses, shader programs for instancing and the draw calls. Engine classes go through getInstance() instead
+// of calling GL, so installing a RecordingRenderDevice runs the whole frame pipeline without a context.
+// Indices are always 32-bit; offsets into bound buffers are in bytes.
+class RenderDevice
+{
+public:
+	enum class Buffer { Vertex, Index };
+	enum class Usage { Static, Stream };
+	enum class Capability { Texture2D, CullFace };
+	enum class ClientArray { Vertex, Normal, Color, TexCoord };
+	enum class ComponentType { Float, UnsignedByte };
+	enum class Primitive { Triangles, Lines };
+	enum class Wrap { Repeat, MirroredRepeat, Clamp };
+	enum class Filter { Nearest, Linear, NearestMipmapNearest, NearestMipmapLinear, LinearMipmapLinear };
+	enum class Feature { BaseVertex, Instancing };
+
+	virtual ~RenderDevice() = default;
+
+	// The device engine code draws through; a GLRenderDevice behind a CachingRenderDevice until another one is installed
+	static RenderDevice& getInstance();
+	static void install(std::unique_ptr<RenderDevice> device);
+
+	virtual bool supports(Feature feature) = 0;
+
+	virtual unsigned int createBuffer() = 0;
+	virtual void deleteBuffer(unsigned int id) = 0;
+	virtual void bindBuffer(Buffer target, unsigned int id) = 0;
+	virtual void bufferData(Buffer target, size_t size, const void* data, Usage usage) = 0;
+	virtual void bufferSubData(Buffer target, size_t offset, size_t size, const void* data) = 0;
+	virtual void copyBuffer(unsigned int from, unsigned int to, size_t fromOffset, size_t toOffset, size_t size) = 0;
+
+	virtual unsigned int createTexture() = 0;
+	virtual void deleteTexture(unsigned int id) = 0;
+	virtual void bindTexture(unsigned int id) = 0;
+	// One level of the bound texture; block-compressed when format is not None, channels-per-pixel bytes otherwise
+	virtual void textureImage(unsigned int level, unsigned int width, unsigned int height, unsigned int channels, BlockFormat format, const void* data, size_t size) = 0;
+	virtual void textureLevels(unsigned int base, unsigned int max) = 0;
+	virtual void textureSampler(Wrap wrap, Filter minFilter, Filter magFilter) = 0;
+
+	virtual void enable(Capability capability) = 0;
+	virtual void disable(Capability capability) = 0;
+	virtual bool isEnabled(Capability capability) = 0;
+	virtual void enableArray(ClientArray array) = 0;
+	virtual void disableArray(ClientArray array) = 0;
+	// Points a fixed-function array at offset bytes into the bound vertex buffer
+	virtual void arrayPointer(ClientArray array, int components, ComponentType type, size_t stride, size_t offset) = 0;
+	virtual void color(const color4& color) = 0;
+	virtual void lineWidth(float width) = 0;
+	virtual void loadMatrix(const mat4& matrix) = 0;
+	virtual void pushMatrix() = 0;
+	virtual void multMatrix(const mat4& matrix) = 0;
+	virtual void popMatrix() = 0;
+
+	virtual void enableAttribute(unsigned int index) = 0;
+	virtual void disableAttribute(unsigned int index) = 0;
+	virtual void attributePointer(unsigned int index, int components, size_t stride, size_t offset) = 0;
+	virtual void attributeDivisor(unsigned int index, unsigned int divisor) = 0;
+
+	// Compiles and links; 0 with the compiler or linker output in log on failure
+	virtual unsigned int createProgram(const char* vertexSource, const char* fragmentSource,
+		const std::vector<std::pair<unsigned int, const char*>>& attributes, std::string& log) = 0;
+	virtual void deleteProgram(unsigned int program) = 0;
+	virtual void useProgram(unsigned int program) = 0;
+	virtual int uniformLocation(unsigned int program, const char* name) = 0;
+	virtual void uniform(int location, int value) = 0;
+
+	virtual void drawElements(Primitive primitive, size_t count, size_t firstIndex, int baseVertex = 0) = 0;
+	virtual void multiDrawElements(const int* counts, const void* const* offsets, size_t drawCount, int baseVertex = 0) = 0;
+	virtual void drawElementsInstanced(size_t count, size_t firstIndex, size_t instances, int baseVertex = 0) = 0;
+	virtual void drawArrays(Primitive primitive, size_t first, size_t count) = 0;
+};
+
+class GLRenderDevice : public RenderDevice
+{
+	std::array<int, 2> _features{ -1, -1 };	// unknown until first asked, the context may not exist before that
+	std::vector<int> _baseVertices;
+
+public:
+	bool supports(Feature feature) override;
+
+	unsigned int createBuffer() override;
+	void deleteBuffer(unsigned int id) override;
+	void bindBuffer(Buffer target, unsigned int id) override;
+	void bufferData(Buffer target, size_t size, const void* data, Usage usage) override;
+	void bufferSubData(Buffer target, size_t offset, size_t size, const void* data) override;
+	void copyBuffer(unsigned int from, unsigned int to, size_t fromOffset, size_t toOffset, size_t size) override;
+
+	unsigned int createTexture() override;
+	void deleteTexture(unsigned int id) override;
+	void bindTexture(unsigned int id) override;
+	void textureImage(unsigned int level, unsigned int width, unsigned int height, unsigned int channels, BlockFormat format, const void* data, size_t size) override;
+	void textureLevels(unsigned int base, unsigned int max) override;
+	void textureSampler(Wrap wrap, Filter minFilter, Filter magFilter) override;
+
+	void enable(Capability capability) override;
+	void disable(Capability capability) override;
+	bool isEnabled(Capability capability) override;
+	void enableArray(ClientArray array) override;
+	void disableArray(ClientArray array) override;
+	void arrayPointer(ClientArray array, int components, ComponentType type, size_t stride, size_t offset) override;
+	void color(const color4& color) override;
+	void lineWidth(float width) override;
+	void loadMatrix(const mat4& matrix) override;
+	void pushMatrix() override;
+	void multMatrix(const mat4& matrix) override;
+	void popMatrix() override;
+
+	void enableAttribute(unsigned int index) override;
+	void disableAttribute(unsigned int index) override;
+	void attributePointer(unsigned int index, int components, size_t stride, size_t offset) override;
+	void attributeDivisor(unsigned int index, unsigned int divisor) override;
+
+	unsigned int createProgram(const char* vertexSource, const char* fragmentSource,
+		const std::vector<std::pair<unsigned int, const char*>>& attributes, std::string& log) override;
+	void deleteProgram(unsigned int program) override;
+	void useProgram(unsigned int program) override;
+	int uniformLocation(unsigned int program, const char* name) override;
+	void uniform(int location, int value) override;
+
+	void drawElements(Primitive primitive, size_t count, size_t firstIndex, int baseVertex) override;
+	void multiDrawElements(const int* counts, const void* const* offsets, size_t drawCount, int baseVertex) override;
+	void drawElementsInstanced(size_t count, size_t firstIndex, size_t instances, int baseVertex) override;
+	void drawArrays(Primitive primitive, size_t first, size_t count) override;
+};
+
+// Issues nothing. Hands out ids, keeps just enough state to answer isEnabled, and counts what a frame would have
+// cost: commands, draws, indices, uploaded bytes and state changes. With keepLog every command is also written
+// out as a line of text, for diffing the command stream of two runs.
+class RecordingRenderDevice : public RenderDevice
+{
+public:
+	struct Counters
+	{
+		size_t commands = 0;
+		size_t drawCalls = 0;
+		size_t instancedDraws = 0;
+		size_t indices = 0;			// indices (or vertices, for drawArrays) submitted, times instances
+		size_t bytesUploaded = 0;	// buffer and texture data handed to the device
+		size_t stateChanges = 0;	// enables, array toggles, colour, matrices and program switches
+		size_t bufferBinds = 0;
+		size_t textureBinds = 0;
+		size_t buffersCreated = 0;
+		size_t texturesCreated = 0;
+	};
+
+	Counters counters;
+	bool keepLog = false;
+	std::vector<std::string> log;
+	bool baseVertex = true;
+	bool instancing = true;
+
+	// Clears the counters and the log, keeps ids and enables
+	void reset();
+
+	bool supports(Feature feature) override;
+
+	unsigned int createBuffer() override;
+	void deleteBuffer(unsigned int id) override;
+	void bindBuffer(Buffer target, unsigned int id) override;
+	void bufferData(Buffer target, size_t size, const void* data, Usage usage) override;
+	void bufferSubData(Buffer target, size_t offset, size_t size, const void* data) override;
+	void copyBuffer(unsigned int from, unsigned int to, size_t fromOffset, size_t toOffset, size_t size) override;
+
+	unsigned int createTexture() override;
+	void deleteTexture(unsigned int id) override;
+	void bindTexture(unsigned int id) override;
+	void textureImage(unsigned int level, unsigned int width, unsigned int height, unsigned int channels, BlockFormat format, const void* data, size_t size) override;
+	void textureLevels(unsigned int base, unsigned int max) override;
+	void textureSampler(Wrap wrap, Filter minFilter, Filter magFilter) override;
+
+	void enable(Capability capability) override;
+	void disable(Capability capability) override;
+	bool isEnabled(Capability capability) override;
+	void enableArray(ClientArray array) override;
+	void disableArray(ClientArray array) override;
+	void arrayPointer(ClientArray array, int components, ComponentType type, size_t stride, size_t offset) override;
+	void color(const color4& color) override;
+	void lineWidth(float width) override;
+	void loadMatrix(const mat4& matrix) override;
+	void pushMatrix() override;
+	void multMatrix(const mat4& matrix) override;
+	void popMatrix() override;
+
+	void enableAttribute(unsigned int index) override;
+	void disableAttribute(unsigned int index) override;
+	void attributePointer(unsigned int index, int components, size_t stride, size_t offset) override;
+	void attributeDivisor(unsigned int index, unsigned int divisor) override;
+
+	unsigned int createProgram(const char* vertexSource, const char* fragmentSource,
+		const std::vector<std::pair<unsigned int, const char*>>& attributes, std::string& log) override;
+	void deleteProgram(unsigned int program) override;
+	void useProgram(unsigned int program) override;
+	int uniformLocation(unsigned int program, const char* name) override;
+	void uniform(int location, int value) override;
+
+	void drawElements(Primitive primitive, size_t count, size_t firstIndex, int baseVertex) override;
+	void multiDrawElements(const int* counts, const void* const* offsets, size_t drawCount, int baseVertex) override;
+	void drawElementsInstanced(size_t count, size_t firstIndex, size_t instances, int baseVertex) override;
+	void drawArrays(Primitive primitive, size_t first, size_t count) override;
+
+private:
+	unsigned int _nextId = 1;
+	std::unordered_set<int> _enabled;
+
+	void record(const char* command, std::initializer_list<size_t> args = {});
+};
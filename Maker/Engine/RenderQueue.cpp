@@ -0,0 +1,242 @@
+#include "RenderQueue.h"
+#include "Camera.h"
+#include "Image.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "ParallelFor.h"
+#include "Profiler.h"
+#include "RenderDevice.h"
+#include <algorithm>
+#include <array>
+
+void RenderQueue::begin(const mat4& view)
+{
+	_view = view;
+	_items.clear();
+	_matrices.clear();
+	_textureIds.clear();
+	_meshIds.clear();
+	_keys.clear();
+}
+
+uint64_t RenderQueue::makeKey(Layer layer, uint32_t texture, uint32_t mesh, double depth, double maxDepth)
+{
+	constexpr uint64_t depthMax = (uint64_t(1) << 24) - 1;
+	const uint64_t d = static_cast<uint64_t>(std::clamp(depth / maxDepth, 0.0, 1.0) * depthMax);
+	const uint64_t t = texture & 0xFFFFF;
+	const uint64_t m = mesh & 0x3FFFF;
+
+	if (layer == Transparent) return (uint64_t(layer) << 62) | ((depthMax - d) << 38) | (t << 18) | m;
+	return (uint64_t(layer) << 62) | (t << 42) | (m << 24) | d;
+}
+
+// Texture the draw ends up sampling: the mesh's checker wins over the material texture, as in Mesh::beginDraw
+static unsigned int drawTextureId(const Mesh& mesh, const Material* material)
+{
+	if (mesh.checker()) return mesh.checker()->id();
+	return material ? material->texture.id() : 0;
+}
+
+void RenderQueue::push(const Mesh& mesh, const Material* material, const mat4& modelMatrix, const Frustum& frustum)
+{
+	const unsigned int texture = drawTextureId(mesh, material);
+	const uint32_t textureId = texture ? _textureIds.emplace(texture, static_cast<uint32_t>(_textureIds.size() + 1)).first->second : 0;
+	const uint32_t meshId = _meshIds.emplace(&mesh, static_cast<uint32_t>(_meshIds.size())).first->second;
+
+	const vec4 viewPos = _view * modelMatrix * vec4(mesh.boundingBox().center(), 1.0);
+	const Layer layer = material && material->color.a < 255 ? Transparent : Opaque;
+
+	_keys.emplace_back(makeKey(layer, textureId, meshId, -viewPos.z, maxDepth), static_cast<uint32_t>(_items.size()));
+	_items.push_back({ &mesh, material, &frustum, static_cast<uint32_t>(_matrices.size()) });
+	_matrices.push_back(modelMatrix);
+}
+
+void RenderQueue::sortKeys(std::vector<std::pair<uint64_t, uint32_t>>& keys, std::vector<std::pair<uint64_t, uint32_t>>& scratch)
+{
+	PROFILE_SCOPE("RenderQueue::sort");
+	const size_t n = keys.size();
+	if (n < 2) return;
+
+	// All eight digit histograms in one read
+	std::array<std::array<size_t, 256>, 8> counts{};
+	for (const auto& entry : keys) {
+		for (int pass = 0; pass < 8; ++pass) ++counts[pass][(entry.first >> (pass * 8)) & 0xFF];
+	}
+
+	scratch.resize(n);
+	for (int pass = 0; pass < 8; ++pass) {
+		auto& count = counts[pass];
+		if (std::any_of(count.begin(), count.end(), [n](size_t c) { return c == n; })) continue;
+
+		size_t offset = 0;
+		for (auto& c : count) {
+			const size_t start = offset;
+			offset += c;
+			c = start;
+		}
+		for (const auto& entry : keys) scratch[count[(entry.first >> (pass * 8)) & 0xFF]++] = entry;
+		keys.swap(scratch);
+	}
+}
+
+void RenderQueue::buildRuns(const std::vector<std::pair<uint64_t, uint32_t>>& keys, const std::vector<DrawItem>& items, size_t minInstances,
+	std::vector<Run>& runs, std::vector<uint32_t>& order)
+{
+	runs.clear();
+	order.clear();
+	const size_t n = keys.size();
+	for (size_t i = 0; i < n;) {
+		const DrawItem& item = items[keys[i].second];
+		size_t end = i + 1;
+		// Transparent draws keep their back-to-front order, so only opaque ones are gathered
+		if ((keys[i].first >> 62) == Opaque) {
+			while (end < n && (keys[end].first >> 62) == Opaque && items[keys[end].second].mesh == item.mesh && items[keys[end].second].material == item.material) ++end;
+		}
+
+		if (minInstances > 1 && end - i >= minInstances) {
+			runs.push_back({ static_cast<uint32_t>(i), static_cast<uint32_t>(end - i), static_cast<uint32_t>(order.size()), true });
+			for (size_t k = i; k < end; ++k) order.push_back(items[keys[k].second].matrix);
+		}
+		else {
+			for (size_t k = i; k < end; ++k) runs.push_back({ static_cast<uint32_t>(k), 1, 0, false });
+		}
+		i = end;
+	}
+}
+
+void RenderQueue::packInstances(const std::vector<mat4>& matrices, const std::vector<uint32_t>& order, std::vector<glm::mat4>& packed)
+{
+	PROFILE_SCOPE("RenderQueue::packInstances");
+	packed.resize(order.size());
+	parallelFor(order.size(), 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) packed[i] = glm::mat4(matrices[order[i]]);
+	});
+}
+
+void RenderQueue::submit()
+{
+	PROFILE_SCOPE("RenderQueue::submit");
+	_stats = FrameStats();
+	_stats.items = _items.size();
+	sortKeys(_keys, _scratch);
+
+	const bool instancing = this->instancing && _instancer.available();
+	buildRuns(_keys, _items, instancing ? minInstances : 0, _runs, _instanceOrder);
+	if (!_instanceOrder.empty()) {
+		packInstances(_matrices, _instanceOrder, _instanceMatrices);
+		_instancer.upload(_instanceMatrices);
+	}
+
+	// What the previous draw left bound; the queue starts from a known state
+	auto& device = RenderDevice::getInstance();
+	device.disable(RenderDevice::Capability::Texture2D);
+	bool textureOn = false;
+	unsigned int boundTexture = 0;
+	int boundWrap = -1;
+	int boundFilter = -1;
+	bool colorSet = false;
+	color4 boundColor{};
+	std::array<bool, 4> arrays{};	// vertex, normal, color, texcoord
+	const RenderDevice::ClientArray arrayStates[4] = { RenderDevice::ClientArray::Vertex, RenderDevice::ClientArray::Normal, RenderDevice::ClientArray::Color, RenderDevice::ClientArray::TexCoord };
+	const void* boundArrays = nullptr;
+	bool instancerOn = false;
+	_stats.stateChanges = 1;
+
+	auto bindState = [&](const DrawItem& item) {
+		const Mesh& mesh = *item.mesh;
+		const Material* material = item.material;
+
+		const unsigned int texture = drawTextureId(mesh, material);
+		if (texture) {
+			if (!textureOn) {
+				device.enable(RenderDevice::Capability::Texture2D);
+				textureOn = true;
+				++_stats.stateChanges;
+			}
+			// The checker is bound as-is; material textures also carry their sampler settings
+			const bool checker = mesh.checker() != nullptr;
+			const int wrap = checker ? -1 : material->texture.wrapMode;
+			const int filter = checker ? -1 : material->texture.filter;
+			if (texture != boundTexture || wrap != boundWrap || filter != boundFilter) {
+				if (checker) mesh.checker()->bind();
+				else material->texture.bind();
+				boundTexture = texture;
+				boundWrap = wrap;
+				boundFilter = filter;
+				++_stats.textureBinds;
+			}
+			else ++_stats.skippedBinds;
+		}
+		else if (textureOn) {
+			device.disable(RenderDevice::Capability::Texture2D);
+			textureOn = false;
+			++_stats.stateChanges;
+		}
+
+		if (material) {
+			if (!colorSet || material->color != boundColor) {
+				device.color(material->color);
+				boundColor = material->color;
+				colorSet = true;
+				++_stats.stateChanges;
+			}
+		}
+
+		const std::array<bool, 4> wanted = { true, mesh.hasNormals(), mesh.hasColors(), mesh.hasTexCoords() };
+		for (int a = 0; a < 4; ++a) {
+			if (wanted[a] == arrays[a]) continue;
+			if (wanted[a]) device.enableArray(arrayStates[a]);
+			else device.disableArray(arrayStates[a]);
+			arrays[a] = wanted[a];
+			++_stats.stateChanges;
+		}
+
+		// Meshes in the shared arena all draw from the same arrays
+		if (mesh.arrayBinding() != boundArrays) {
+			mesh.bindArrays();
+			boundArrays = mesh.arrayBinding();
+			++_stats.meshBinds;
+		}
+		else ++_stats.skippedBinds;
+	};
+
+	for (const auto& run : _runs) {
+		const DrawItem& first = _items[_keys[run.begin].second];
+		bindState(first);
+
+		if (run.instanced) {
+			if (!instancerOn) {
+				// Instance matrices carry the model transform; the modelview is left at the view
+				device.loadMatrix(_view);
+				_instancer.begin();
+				instancerOn = true;
+				++_stats.stateChanges;
+			}
+			_instancer.draw(*first.mesh, run.firstInstance, run.count, textureOn);
+			++_stats.drawCalls;
+			++_stats.instancedDraws;
+			_stats.instances += run.count;
+			continue;
+		}
+
+		if (instancerOn) {
+			_instancer.end();
+			instancerOn = false;
+			++_stats.stateChanges;
+		}
+		const mat4& model = _matrices[first.matrix];
+		device.loadMatrix(_view * model);
+		_stats.drawCalls += first.mesh->drawBound(*first.frustum, model);
+	}
+	if (instancerOn) _instancer.end();
+
+	// Leave things as the per-object path does: arrays off, texturing off
+	for (int a = 0; a < 4; ++a) {
+		if (arrays[a]) device.disableArray(arrayStates[a]);
+	}
+	if (textureOn) {
+		device.disable(RenderDevice::Capability::Texture2D);
+		device.bindTexture(0);
+	}
+	device.loadMatrix(_view);
+}
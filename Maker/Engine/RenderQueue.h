@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "types.h"
+#include "InstancedDrawer.h"
+
+class Mesh;
+class Image;
+class Texture;
+struct Material;
+struct Frustum;
+
+// Collects the draws of a frame instead of issuing them while walking the scene, orders them by a 64-bit sort key
+// and submits them with as few state changes as possible: textures, material colours, client arrays and mesh
+// buffers are only touched when they differ from what the previous draw left bound. Opaque draws of the same mesh
+// with the same material end up next to each other after sorting; runs of at least minInstances of them are drawn
+// with one instanced call.
+//
+// Key layout, most significant bits first:
+//   opaque:      layer (2) | texture (20) | mesh (18) | depth front-to-back (24)
+//   transparent: layer (2) | depth back-to-front (24) | texture (20) | mesh (18)
+class RenderQueue
+{
+public:
+	enum Layer : uint64_t { Opaque = 0, Transparent = 1 };
+
+	struct DrawItem
+	{
+		const Mesh* mesh;
+		const Material* material;
+		const Frustum* frustum;	// submeshes / meshlets are culled against it at submit time
+		uint32_t matrix;		// index into the frame's model matrices
+	};
+
+	struct FrameStats
+	{
+		size_t items = 0;
+		size_t drawCalls = 0;
+		size_t textureBinds = 0;
+		size_t meshBinds = 0;		// vertex / index buffer and pointer setups
+		size_t stateChanges = 0;	// enables, disables and colour changes
+		size_t skippedBinds = 0;	// binds avoided because the state was already current
+		size_t instancedDraws = 0;	// draw calls that drew a whole run of instances
+		size_t instances = 0;		// items drawn through them
+	};
+
+	// A stretch of sorted keys drawn together: one item, or an instanced run of the same mesh and material
+	struct Run
+	{
+		uint32_t begin;		// into the sorted keys
+		uint32_t count;
+		uint32_t firstInstance;	// into the packed instance matrices, for instanced runs
+		bool instanced;
+	};
+
+	double maxDepth = 1000.0;	// distances beyond this share the last depth bucket
+	bool instancing = true;
+	size_t minInstances = 2;
+
+	// Starts a new frame; view is the matrix the scene is drawn with (the modelview before any object transform)
+	void begin(const mat4& view);
+	void push(const Mesh& mesh, const Material* material, const mat4& modelMatrix, const Frustum& frustum);
+	// Sorts and draws everything pushed since begin(), then leaves the modelview at view
+	void submit();
+
+	size_t size() const { return _items.size(); }
+	const FrameStats& stats() const { return _stats; }
+
+	static uint64_t makeKey(Layer layer, uint32_t texture, uint32_t mesh, double depth, double maxDepth);
+	// Least-significant-digit radix sort, 8 bits per pass; passes where every key has the same digit are skipped
+	static void sortKeys(std::vector<std::pair<uint64_t, uint32_t>>& keys, std::vector<std::pair<uint64_t, uint32_t>>& scratch);
+	// Splits sorted keys into runs; instanced runs get consecutive slots, and order lists the matrix of each slot
+	static void buildRuns(const std::vector<std::pair<uint64_t, uint32_t>>& keys, const std::vector<DrawItem>& items, size_t minInstances,
+		std::vector<Run>& runs, std::vector<uint32_t>& order);
+	// Converts the matrices of the instance slots to floats, spread over threads for large frames
+	static void packInstances(const std::vector<mat4>& matrices, const std::vector<uint32_t>& order, std::vector<glm::mat4>& packed);
+
+private:
+	mat4 _view{ 1.0 };
+	std::vector<DrawItem> _items;
+	std::vector<mat4> _matrices;
+	std::vector<std::pair<uint64_t, uint32_t>> _keys;
+	std::vector<std::pair<uint64_t, uint32_t>> _scratch;
+	std::vector<Run> _runs;
+	std::vector<uint32_t> _instanceOrder;
+	std::vector<glm::mat4> _instanceMatrices;
+	InstancedDrawer _instancer;
+	// Compact ids handed out per frame so texture and mesh fit their key fields
+	std::unordered_map<unsigned int, uint32_t> _textureIds;
+	std::unordered_map<const Mesh*, uint32_t> _meshIds;
+	FrameStats _stats;
+};
@@ -0,0 +1,255 @@
+#include "SceneGenerator.h"
+#include "GameObject.h"
+#include "ParallelFor.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <string>
+
+namespace
+{
+	constexpr double kPi = 3.14159265358979323846;
+
+	// One draw per statement: the order function arguments are evaluated in is up to the compiler
+	vec3 randomVector(SceneGenerator::Random& random, double min, double max)
+	{
+		const double x = random.range(min, max);
+		const double y = random.range(min, max);
+		const double z = random.range(min, max);
+		return vec3(x, y, z);
+	}
+
+	// Salts that give meshes and cluster centres streams apart from the objects'
+	constexpr uint64_t kMeshSalt = 0x6D657368ull;
+	constexpr uint64_t kClusterSalt = 0x636C7573ull;
+
+	// Shared, read-only state of one generate() call; populate() runs on several threads at once
+	struct Builder
+	{
+		Builder(const SceneGenerator::Settings& settings, const std::vector<std::shared_ptr<Mesh>>& meshes, std::vector<size_t> levels) :
+			settings(settings), meshes(meshes), levels(std::move(levels)) {}
+
+		const SceneGenerator::Settings& settings;
+		const std::vector<std::shared_ptr<Mesh>>& meshes;
+		std::vector<size_t> levels;
+		std::vector<size_t> offsets;	// index of the first object of each level, counting over all levels
+		std::vector<vec3> centres;
+		size_t gridSide = 1;
+		int firstId = 0;
+
+		size_t objectIndex(size_t level, size_t index) const { return offsets[level] + index; }
+		int objectId(size_t level, size_t index) const { return firstId + static_cast<int>(objectIndex(level, index)); }
+		std::string objectName(size_t level, size_t index) const { return "Object " + std::to_string(objectIndex(level, index)); }
+
+		vec3 firstLevelPosition(size_t index, SceneGenerator::Random& random) const
+		{
+			const double half = settings.extent * 0.5;
+			switch (settings.distribution) {
+			case SceneGenerator::Clustered: {
+				const vec3 centre = centres[random.index(centres.size())];
+				const double radius = settings.clusterRadius * settings.extent;
+				const double x = random.normal();
+				const double y = random.normal();
+				const double z = random.normal();
+				return centre + vec3(x, y, z) * radius;
+			}
+			case SceneGenerator::Grid: {
+				const double spacing = settings.extent / gridSide;
+				const vec3 cell(double(index % gridSide), double(index / gridSide % gridSide), double(index / (gridSide * gridSide)));
+				return vec3(-half) + (cell + 0.5) * spacing;
+			}
+			default:
+				return randomVector(random, -half, half);
+			}
+		}
+
+		// Sets up go, the object at index of level, then creates its subtree; returns how many of them are static
+		size_t populate(GameObject& go, size_t level, size_t index, bool isStatic) const
+		{
+			SceneGenerator::Random random(SceneGenerator::streamSeed(settings.seed, objectIndex(level, index)));
+			auto& transform = go.GetComponent<TransformComponent>()->transform();
+			if (level == 0) {
+				transform.SetPosition(firstLevelPosition(index, random));
+				transform.SetRotation(randomVector(random, -180.0, 180.0));
+				transform.SetScale(vec3(random.range(0.5, 2.0)));
+				isStatic = random.unit() < settings.staticFraction;
+			}
+			else {
+				transform.SetPosition(randomVector(random, -settings.childSpread, settings.childSpread));
+				transform.SetRotation(randomVector(random, -180.0, 180.0));
+				transform.SetScale(vec3(random.range(0.4, 0.9)));
+			}
+			go.isStatic = isStatic;
+
+			if (!meshes.empty()) {
+				const size_t meshIndex = random.index(meshes.size());
+				go.meshPath = "Generated " + std::to_string(meshIndex);
+				go.setMesh(meshes[meshIndex]);
+				go.AddComponent<MeshLoader>()->SetMesh(meshes[meshIndex]);
+			}
+
+			size_t statics = isStatic ? 1 : 0;
+			if (level + 1 == levels.size()) return statics;
+			const size_t fanOut = std::max(settings.fanOut, 1u);
+			const size_t end = std::min((index + 1) * fanOut, levels[level + 1]);
+			for (size_t child = index * fanOut; child < end; ++child) {
+				auto& childObject = go.emplaceChild(objectName(level + 1, child), objectId(level + 1, child));
+				statics += populate(childObject, level + 1, child, isStatic);
+			}
+			return statics;
+		}
+	};
+}
+
+const char* SceneGenerator::distributionName(Distribution distribution)
+{
+	switch (distribution) {
+	case Uniform: return "Uniform";
+	case Clustered: return "Clustered";
+	case Grid: return "Grid";
+	default: return "";
+	}
+}
+
+size_t SceneGenerator::Settings::meshCount() const
+{
+	if (!objects || !maxMeshes) return 0;
+	const double distinct = std::ceil(objects * (1.0 - std::clamp(meshSharing, 0.0, 1.0)));
+	return std::clamp<size_t>(static_cast<size_t>(distinct), 1, maxMeshes);
+}
+
+std::vector<size_t> SceneGenerator::levelSizes(size_t objects, unsigned int depth, unsigned int fanOut)
+{
+	std::vector<size_t> levels;
+	if (!objects) return levels;
+	depth = std::max(depth, 1u);
+	fanOut = std::max(fanOut, 1u);
+
+	// Objects under one first-level object, itself included, if every level were full
+	size_t perTree = 0;
+	size_t width = 1;
+	for (unsigned int level = 0; level < depth; ++level) {
+		perTree += width;
+		if (perTree >= objects) break;
+		width *= fanOut;
+	}
+
+	levels.push_back((objects + perTree - 1) / perTree);
+	size_t remaining = objects - levels.front();
+	while (remaining && levels.size() < depth) {
+		levels.push_back(std::min(levels.back() * fanOut, remaining));
+		remaining -= levels.back();
+	}
+	return levels;
+}
+
+MeshCpuData SceneGenerator::generateMeshData(uint64_t seed, unsigned int detail)
+{
+	Random random(seed);
+	const unsigned int rings = std::max(detail, 3u);
+	const unsigned int segments = rings * 2;
+
+	// Per-mesh lumps: a few low-frequency bumps on the radius, so meshes differ in shape and bounds
+	const double frequency = random.range(1.0, 4.0);
+	const double amplitude = random.range(0.05, 0.3);
+	const double phase = random.range(0.0, 2.0 * kPi);
+
+	MeshCpuData data;
+	data.vertices.reserve((rings + 1) * (segments + 1));
+	data.texCoords.reserve((rings + 1) * (segments + 1));
+	for (unsigned int ring = 0; ring <= rings; ++ring) {
+		const double theta = ring * kPi / rings;
+		for (unsigned int segment = 0; segment <= segments; ++segment) {
+			const double phi = segment * 2.0 * kPi / segments;
+			const double radius = 1.0 + amplitude * std::sin(frequency * theta + phase) * std::cos(frequency * phi);
+			data.vertices.emplace_back(radius * std::cos(phi) * std::sin(theta), radius * std::cos(theta), radius * std::sin(phi) * std::sin(theta));
+			data.texCoords.emplace_back(1.0f - float(segment) / segments, 1.0f - float(ring) / rings);
+		}
+	}
+
+	data.indices.reserve(rings * segments * 6);
+	for (unsigned int ring = 0; ring < rings; ++ring) {
+		for (unsigned int segment = 0; segment < segments; ++segment) {
+			const unsigned int first = ring * (segments + 1) + segment;
+			const unsigned int second = first + segments + 1;
+			data.indices.insert(data.indices.end(), { first, second, first + 1, second, second + 1, first + 1 });
+		}
+	}
+	return data;
+}
+
+std::shared_ptr<Mesh> SceneGenerator::generateMesh(uint64_t seed, unsigned int detail)
+{
+	auto data = generateMeshData(seed, detail);
+	auto mesh = std::make_shared<Mesh>();
+	mesh->load(std::move(data.vertices), std::move(data.indices));
+	mesh->loadTexCoords(std::move(data.texCoords));
+	return mesh;
+}
+
+std::vector<std::shared_ptr<Mesh>> SceneGenerator::generateMeshes(uint64_t seed, size_t count, unsigned int detail)
+{
+	PROFILE_FUNCTION();
+	std::vector<MeshCpuData> data(count);
+	parallelFor(count, 4, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) data[i] = generateMeshData(streamSeed(seed, i), detail);
+	});
+
+	// Uploads go through the render device, which belongs to this thread
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	meshes.reserve(count);
+	for (auto& arrays : data) {
+		auto mesh = std::make_shared<Mesh>();
+		mesh->load(std::move(arrays.vertices), std::move(arrays.indices));
+		mesh->loadTexCoords(std::move(arrays.texCoords));
+		meshes.push_back(std::move(mesh));
+	}
+	return meshes;
+}
+
+SceneGenerator::Result SceneGenerator::generate(GameObject& root, const Settings& settings)
+{
+	PROFILE_FUNCTION();
+	Result result;
+	result.meshes = generateMeshes(settings.seed ^ kMeshSalt, settings.meshCount(), settings.meshDetail);
+	result.levels = levelSizes(settings.objects, settings.depth, settings.fanOut);
+	if (result.levels.empty()) return result;
+
+	Builder builder(settings, result.meshes, result.levels);
+	size_t offset = 0;
+	for (size_t size : result.levels) {
+		builder.offsets.push_back(offset);
+		offset += size;
+	}
+	result.objects = offset;
+	builder.firstId = GameObject::reserveIds(static_cast<int>(result.objects));
+
+	if (settings.distribution == Clustered) {
+		Random random(streamSeed(settings.seed ^ kClusterSalt, 0));
+		const double half = settings.extent * 0.5;
+		for (size_t i = 0; i < std::max<size_t>(settings.clusters, 1); ++i) builder.centres.push_back(randomVector(random, -half, half));
+	}
+	while (builder.gridSide * builder.gridSide * builder.gridSide < result.levels.front()) ++builder.gridSide;
+
+	// Each chunk of first-level objects is built, subtrees and all, into a list of its own, then spliced under
+	// the root in chunk order, so the root's children come out in index order whichever thread built them
+	const size_t firstLevel = result.levels.front();
+	const size_t chunks = std::min<size_t>(firstLevel, 256);
+	std::vector<std::list<GameObject>> lists(chunks);
+	std::vector<size_t> statics(chunks, 0);
+	parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t chunk = begin; chunk < end; ++chunk) {
+			for (size_t index = chunk * firstLevel / chunks; index < (chunk + 1) * firstLevel / chunks; ++index) {
+				auto& go = lists[chunk].emplace_back(builder.objectName(0, index), builder.objectId(0, index));
+				statics[chunk] += builder.populate(go, 0, index, false);
+			}
+		}
+	});
+
+	for (size_t chunk = 0; chunk < chunks; ++chunk) {
+		root.adoptChildren(lists[chunk]);
+		result.staticObjects += statics[chunk];
+	}
+	return result;
+}
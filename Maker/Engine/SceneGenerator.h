@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Mesh.h"
+
+class GameObject;
+
+// Builds synthetic scenes for benchmarks, stress runs and culling tests. The same settings give the same scene on
+// every machine and compiler, however many threads build it: every object draws from a generator seeded with the
+// scene seed and its own index, and ids are handed out in index order. The numbers come from Random below rather
+// than the standard library distributions, whose output is left to the implementation.
+//
+// Objects are laid out level by level: the first level hangs off the root, and every object above the last level
+// gets fanOut children until the count runs out. Subtrees are built on worker threads straight into GameObject
+// lists and spliced under the root in order; only the mesh uploads stay on the calling thread.
+class SceneGenerator
+{
+public:
+	// SplitMix64; small, fast and good enough to place objects
+	class Random
+	{
+		uint64_t _state;
+
+	public:
+		explicit Random(uint64_t seed) : _state(seed) {}
+
+		uint64_t next()
+		{
+			uint64_t z = (_state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+		// [0, 1)
+		double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+		double range(double min, double max) { return min + (max - min) * unit(); }
+		// [0, count)
+		size_t index(size_t count) { return count ? static_cast<size_t>(next() % count) : 0; }
+		// Roughly normal with mean 0 and deviation 1 (sum of four uniforms), bounded to +-3.5
+		double normal() { return (unit() + unit() + unit() + unit() - 2.0) * 1.7320508075688772; }
+	};
+
+	enum Distribution { Uniform, Clustered, Grid, DistributionCount };
+
+	struct Settings
+	{
+		uint64_t seed = 1;
+		size_t objects = 1000;				// in total, over every level
+		unsigned int depth = 1;				// levels of objects under the root; 1 is a flat scene
+		unsigned int fanOut = 4;			// children of every object above the last level
+		double meshSharing = 0.99;			// fraction of objects that reuse a mesh another object has
+		size_t maxMeshes = 256;				// distinct meshes, at most
+		unsigned int meshDetail = 16;		// rings and segments of each generated mesh; triangles grow with its square
+		Distribution distribution = Uniform;	// where first-level objects go
+		double extent = 100.0;				// first-level objects are spread over a cube this wide, centred on the origin
+		size_t clusters = 16;				// Clustered: number of clusters
+		double clusterRadius = 0.05;		// Clustered: deviation around each centre, as a fraction of extent
+		double childSpread = 3.0;			// children sit within this distance of their parent, in its units
+		double staticFraction = 0.5;		// first-level objects flagged isStatic; their descendants follow them
+
+		size_t meshCount() const;
+	};
+
+	struct Result
+	{
+		std::vector<std::shared_ptr<Mesh>> meshes;
+		std::vector<size_t> levels;			// objects per level, first level first
+		size_t objects = 0;
+		size_t staticObjects = 0;
+	};
+
+	static const char* distributionName(Distribution distribution);
+
+	// A lumpy sphere with texture coordinates, different for every seed
+	static MeshCpuData generateMeshData(uint64_t seed, unsigned int detail);
+	static std::shared_ptr<Mesh> generateMesh(uint64_t seed, unsigned int detail);
+	// Generates the arrays in parallel, then loads them on the calling thread
+	static std::vector<std::shared_ptr<Mesh>> generateMeshes(uint64_t seed, size_t count, unsigned int detail);
+
+	// Appends settings.objects objects to root, each with a random transform and one of the generated meshes
+	static Result generate(GameObject& root, const Settings& settings);
+
+	// Objects per level for a layout of objects, depth and fanOut
+	static std::vector<size_t> levelSizes(size_t objects, unsigned int depth, unsigned int fanOut);
+	// Seed of the stream for item index of a scene, independent of the streams of its neighbours
+	static uint64_t streamSeed(uint64_t seed, uint64_t index) { return Random(seed ^ Random(index).next()).next(); }
+};
@@ -0,0 +1,362 @@
+#include "StaticBatcher.h"
+#include "GameObject.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "MeshLoader.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include "Log.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <set>
+#include <sstream>
+#include <tuple>
+
+namespace
+{
+	constexpr char kMagic[4] = { 'S', 'B', 'A', 'T' };
+	constexpr uint32_t kVersion = 1;
+
+	enum AttributeBits : unsigned int
+	{
+		HasTexCoords = 1 << 0,
+		HasColors = 1 << 1,
+		HasChecker = 1 << 2,
+	};
+
+	struct Member
+	{
+		GameObject* object;
+		std::shared_ptr<Mesh> mesh;
+		std::shared_ptr<Material> material;
+		mat4 world;
+	};
+
+	struct Group
+	{
+		Group(std::shared_ptr<Material> material, const glm::ivec3& cell, unsigned int attributes) :
+			material(std::move(material)), cell(cell), attributes(attributes) {}
+
+		std::shared_ptr<Material> material;
+		glm::ivec3 cell;
+		unsigned int attributes;
+		std::vector<Member> members;
+
+		uint64_t hash = 0;
+		std::string cachePath;
+		MeshCpuData merged;
+		std::vector<StaticBatchRange> ranges;
+		bool cached = false;
+		bool written = false;
+	};
+
+	void collect(GameObject& object, const mat4& parentMatrix, std::vector<Member>& members)
+	{
+		const mat4 world = parentMatrix * object.GetComponent<TransformComponent>()->transform().mat();
+		object.staticBatched = false;
+
+		if (object.isStatic && object.HasComponent<MeshLoader>()) {
+			const auto loader = object.GetComponent<MeshLoader>();
+			const auto mesh = loader->GetMesh();
+			// Meshes that dropped their arrays after upload have nothing left to merge
+			if (mesh && mesh->numIndices() && mesh->residency() != MeshResidency::DropAfterUpload) {
+				members.push_back({ &object, mesh, loader->GetMaterial(), world });
+			}
+		}
+
+		for (auto& child : object.getChildren()) collect(child, world, members);
+	}
+
+	template <typename T>
+	void writeArray(std::ostream& os, const std::vector<T>& values)
+	{
+		const uint64_t count = values.size();
+		os.write(reinterpret_cast<const char*>(&count), sizeof(count));
+		os.write(reinterpret_cast<const char*>(values.data()), count * sizeof(T));
+	}
+
+	// end is the stream's size: a count the rest of the file can't hold is a damaged file, not an allocation to make
+	template <typename T>
+	bool readArray(std::istream& is, std::vector<T>& values, uint64_t end)
+	{
+		uint64_t count = 0;
+		if (!is.read(reinterpret_cast<char*>(&count), sizeof(count))) return false;
+		const auto position = static_cast<uint64_t>(is.tellg());
+		if (position > end || count > (end - position) / sizeof(T)) return false;
+		values.resize(static_cast<size_t>(count));
+		return static_cast<bool>(is.read(reinterpret_cast<char*>(values.data()), count * sizeof(T)));
+	}
+
+	// Ranges are stored without object ids; those come from the scene the batch is rebuilt for
+	struct CachedRange
+	{
+		uint32_t indexOffset;
+		uint32_t indexCount;
+		BoundingBox bounds;
+	};
+
+	void writeCache(Group& group)
+	{
+		std::ofstream os(group.cachePath, std::ios::binary);
+		if (!os.is_open()) return;
+
+		std::vector<CachedRange> ranges;
+		for (const auto& range : group.ranges) ranges.push_back({ range.indexOffset, range.indexCount, range.bounds });
+
+		os.write(kMagic, sizeof(kMagic));
+		os.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+		writeArray(os, group.merged.vertices);
+		writeArray(os, group.merged.indices);
+		writeArray(os, group.merged.texCoords);
+		writeArray(os, group.merged.colors);
+		writeArray(os, ranges);
+		group.written = static_cast<bool>(os);
+	}
+
+	bool readCache(const std::string& path, MeshCpuData& data, std::vector<StaticBatchRange>* ranges)
+	{
+		std::ifstream is(path, std::ios::binary | std::ios::ate);
+		if (!is.is_open()) return false;
+		const auto end = static_cast<uint64_t>(is.tellg());
+		is.seekg(0);
+
+		char magic[4];
+		uint32_t version = 0;
+		is.read(magic, sizeof(magic));
+		is.read(reinterpret_cast<char*>(&version), sizeof(version));
+		if (!is || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion) return false;
+
+		std::vector<CachedRange> cachedRanges;
+		if (!readArray(is, data.vertices, end) || !readArray(is, data.indices, end) || !readArray(is, data.texCoords, end) ||
+			!readArray(is, data.colors, end) || !readArray(is, cachedRanges, end)) return false;
+
+		if (ranges) {
+			ranges->clear();
+			for (const auto& range : cachedRanges) ranges->push_back({ 0, range.indexOffset, range.indexCount, range.bounds });
+		}
+		return true;
+	}
+
+	// Whether a cache file read back lays the members out the way merge() would
+	bool matchesMembers(const Group& group)
+	{
+		if (group.ranges.size() != group.members.size()) return false;
+		size_t vertexCount = 0, indexCount = 0;
+		for (size_t i = 0; i < group.members.size(); ++i) {
+			const Mesh& mesh = *group.members[i].mesh;
+			const auto& range = group.ranges[i];
+			if (range.indexOffset != indexCount || range.indexCount != mesh.numIndices()) return false;
+			vertexCount += mesh.numVertices();
+			indexCount += mesh.numIndices();
+		}
+		const auto& merged = group.merged;
+		if (merged.vertices.size() != vertexCount || merged.indices.size() != indexCount) return false;
+		if (merged.texCoords.size() != ((group.attributes & HasTexCoords) ? vertexCount : 0)) return false;
+		if (merged.colors.size() != ((group.attributes & HasColors) ? vertexCount : 0)) return false;
+		return std::all_of(merged.indices.begin(), merged.indices.end(), [vertexCount](unsigned int index) { return index < vertexCount; });
+	}
+
+	// Bakes every member's world transform into one vertex / index array
+	void merge(Group& group)
+	{
+		auto& merged = group.merged;
+		size_t vertexCount = 0, indexCount = 0;
+		for (const auto& member : group.members) {
+			vertexCount += member.mesh->numVertices();
+			indexCount += member.mesh->numIndices();
+		}
+		merged.vertices.reserve(vertexCount);
+		merged.indices.reserve(indexCount);
+		if (group.attributes & HasTexCoords) merged.texCoords.reserve(vertexCount);
+		if (group.attributes & HasColors) merged.colors.reserve(vertexCount);
+
+		for (const auto& member : group.members) {
+			const Mesh& mesh = *member.mesh;
+			const auto& vertices = mesh.vertices();
+			const auto& indices = mesh.indices();
+			const glm::mat4 world(member.world);
+			const unsigned int baseVertex = static_cast<unsigned int>(merged.vertices.size());
+			const unsigned int indexOffset = static_cast<unsigned int>(merged.indices.size());
+
+			for (const auto& v : vertices) merged.vertices.push_back(glm::vec3(world * glm::vec4(v, 1.0f)));
+			for (const auto i : indices) merged.indices.push_back(baseVertex + i);
+
+			if (group.attributes & HasTexCoords) {
+				const auto& texCoords = mesh.texCoords();
+				if (texCoords.size() == vertices.size()) merged.texCoords.insert(merged.texCoords.end(), texCoords.begin(), texCoords.end());
+				else merged.texCoords.resize(merged.vertices.size(), glm::vec2(0));
+			}
+			if (group.attributes & HasColors) {
+				const auto& colors = mesh.colors();
+				if (colors.size() == vertices.size()) merged.colors.insert(merged.colors.end(), colors.begin(), colors.end());
+				else merged.colors.resize(merged.vertices.size(), glm::u8vec3(255));
+			}
+
+			group.ranges.push_back({ member.object->id, indexOffset, static_cast<unsigned int>(indices.size()), member.world * mesh.boundingBox() });
+		}
+	}
+}
+
+int StaticBatch::objectAtTriangle(size_t triangle) const
+{
+	const size_t index = triangle * 3;
+	const auto itr = std::upper_bound(ranges.begin(), ranges.end(), index, [](size_t value, const StaticBatchRange& range) { return value < range.indexOffset; });
+	if (itr == ranges.begin()) return 0;
+	const auto& range = *(itr - 1);
+	return index < static_cast<size_t>(range.indexOffset) + range.indexCount ? range.objectId : 0;
+}
+
+void StaticBatcher::build(GameObject& root)
+{
+	PROFILE_SCOPE("StaticBatcher::build");
+	const auto t0 = std::chrono::high_resolution_clock::now();
+	_batches.clear();
+	_stats = BuildStats();
+
+	std::vector<Member> members;
+	for (auto& child : root.getChildren()) collect(child, mat4(1.0), members);
+
+	// Same material, same cell, same vertex layout
+	std::map<std::tuple<const Material*, int, int, int, unsigned int>, size_t> groupIndex;
+	std::vector<Group> groups;
+	for (auto& member : members) {
+		const vec3 center = (member.world * member.mesh->boundingBox()).center();
+		const glm::ivec3 cell(std::floor(center.x / cellSize), std::floor(center.y / cellSize), std::floor(center.z / cellSize));
+		unsigned int attributes = 0;
+		if (member.mesh->hasTexCoords()) attributes |= HasTexCoords;
+		if (member.mesh->hasColors()) attributes |= HasColors;
+		if (member.mesh->checker()) attributes |= HasChecker;
+
+		const auto key = std::make_tuple(member.material.get(), cell.x, cell.y, cell.z, attributes);
+		const auto [itr, inserted] = groupIndex.emplace(key, groups.size());
+		if (inserted) groups.emplace_back(member.material, cell, attributes);
+		groups[itr->second].members.push_back(member);
+	}
+	// A batch of one saves nothing; those objects stay on the per-object path
+	groups.erase(std::remove_if(groups.begin(), groups.end(), [](const Group& group) { return group.members.size() < 2; }), groups.end());
+
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+	for (auto& group : groups) {
+		uint64_t hash = TextureCache::hashBytes(&kVersion, sizeof(kVersion));
+		hash = TextureCache::hashBytes(&group.attributes, sizeof(group.attributes), hash);
+		for (const auto& member : group.members) {
+			const uint64_t content = member.mesh->contentHash();
+			hash = TextureCache::hashBytes(&member.world, sizeof(member.world), hash);
+			hash = TextureCache::hashBytes(&content, sizeof(content), hash);
+		}
+		std::ostringstream name;
+		name << cacheDirectory << "/" << std::hex << hash << ".batch";
+		group.hash = hash;
+		group.cachePath = name.str();
+	}
+
+	auto& pool = ThreadPool::getInstance();
+	auto runAll = [&pool, &groups](auto task) {
+		std::vector<std::future<void>> pending;
+		for (auto& group : groups) pending.push_back(pool.submit([&group, &task]() { task(group); }));
+		for (auto& result : pending) result.wait();
+	};
+
+	// Cached groups are read back in parallel
+	runAll([](Group& group) {
+		group.cached = readCache(group.cachePath, group.merged, &group.ranges) && matchesMembers(group);
+		if (!group.cached) {
+			group.merged = MeshCpuData();
+			group.ranges.clear();
+		}
+	});
+
+	// Mesh arrays released after upload are read back here, on this thread, before the workers share them
+	std::set<Mesh*> reloaded;
+	for (auto& group : groups) {
+		if (group.cached) continue;
+		for (auto& member : group.members) {
+			if (member.mesh->isCpuResident()) continue;
+			member.mesh->vertices();
+			reloaded.insert(member.mesh.get());
+		}
+	}
+
+	runAll([](Group& group) {
+		if (group.cached) return;
+		merge(group);
+		writeCache(group);
+	});
+
+	for (Mesh* mesh : reloaded) mesh->releaseCpuData();
+
+	// Uploads stay on the main thread
+	for (auto& group : groups) {
+		StaticBatch batch;
+		batch.material = group.material;
+		batch.cell = group.cell;
+		batch.ranges = std::move(group.ranges);
+		for (size_t i = 0; i < group.members.size(); ++i) {
+			batch.ranges[i].objectId = group.members[i].object->id;
+			group.members[i].object->staticBatched = true;
+		}
+
+		auto& merged = group.merged;
+		batch.mesh = std::make_shared<Mesh>(std::move(merged.vertices), std::move(merged.texCoords), std::vector<glm::vec3>(), std::move(merged.colors), std::move(merged.indices));
+		std::vector<SubMesh> subMeshes;
+		for (const auto& range : batch.ranges) subMeshes.push_back({ range.indexOffset, range.indexCount, 0, 0, range.bounds });
+		batch.mesh->setSubMeshes(std::move(subMeshes));
+		batch.mesh->buildMeshlets();
+		if (group.attributes & HasChecker) batch.mesh->CheckerTexture();
+
+		// The cache file doubles as the CPU copy
+		if (group.cached || group.written) {
+			const std::string path = group.cachePath;
+			batch.mesh->setResidency(MeshResidency::ReloadOnDemand, [path](MeshCpuData& data) { return readCache(path, data, nullptr); });
+		}
+
+		_stats.objects += group.members.size();
+		_stats.cacheHits += group.cached;
+		_batches.push_back(std::move(batch));
+	}
+	_stats.batches = _batches.size();
+
+	// Caches of groups that no longer exist (content or layout changed) would otherwise pile up
+	std::set<std::string> current;
+	for (const auto& group : groups) current.insert(std::filesystem::path(group.cachePath).filename().string());
+	std::vector<std::filesystem::path> stale;
+	for (const auto& entry : std::filesystem::directory_iterator(cacheDirectory, error)) {
+		if (entry.path().extension() == ".batch" && !current.count(entry.path().filename().string())) stale.push_back(entry.path());
+	}
+	for (const auto& path : stale) _stats.cachesPruned += std::filesystem::remove(path, error);
+	_stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count();
+
+	LOG_INFO(Log::Render, "Static batching: %zu objects into %zu batches (%zu from cache, %zu stale caches removed) in %.1f ms",
+		_stats.objects, _stats.batches, _stats.cacheHits, _stats.cachesPruned, _stats.seconds * 1000.0);
+}
+
+void StaticBatcher::clear(GameObject& root)
+{
+	_batches.clear();
+	_stats = BuildStats();
+	std::vector<Member> members;
+	for (auto& child : root.getChildren()) collect(child, mat4(1.0), members);
+}
+
+void StaticBatcher::enqueue(RenderQueue& queue, const Frustum& frustum) const
+{
+	PROFILE_SCOPE("StaticBatcher::enqueue");
+	for (const auto& batch : _batches) {
+		if (frustum.ContainsBBox(batch.mesh->boundingBox()) == FRUSTUM_OUT) continue;
+		// Batched objects skip MeshLoader::Enqueue, so the streamer hears about their textures here
+		if (batch.material && batch.material->texture.image()) {
+			TextureStreamer::getInstance().noteUse(batch.material->texture.image().get(), batch.mesh->boundingBox());
+		}
+		queue.push(*batch.mesh, batch.material.get(), mat4(1.0), frustum);
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "BoundingBox.h"
+
+class GameObject;
+class Mesh;
+class RenderQueue;
+struct Material;
+struct Frustum;
+
+// One source object inside a batch: its triangles and world bounds. The merged mesh carries the ranges as
+// submeshes, so culling still works per object; picking maps a triangle back to the object through them.
+struct StaticBatchRange
+{
+	int objectId = 0;
+	unsigned int indexOffset = 0;
+	unsigned int indexCount = 0;
+	BoundingBox bounds;
+};
+
+struct StaticBatch
+{
+	std::shared_ptr<Mesh> mesh;
+	std::shared_ptr<Material> material;
+	glm::ivec3 cell{ 0 };
+	std::vector<StaticBatchRange> ranges;
+
+	// Id of the object the triangle came from, or 0
+	int objectAtTriangle(size_t triangle) const;
+};
+
+// Merges objects flagged isStatic into one mesh per (material, spatial cell), with their world transforms baked into
+// the vertices. Groups are merged on the ThreadPool and each merged group is cached under cacheDirectory, keyed by
+// its members' transforms and mesh contents, so the next load just reads it back; caches of groups that are gone
+// are deleted after each build. Merged objects are marked staticBatched and skipped by GameObject::enqueue; the
+// batches are queued instead.
+class StaticBatcher
+{
+public:
+	struct BuildStats
+	{
+		size_t objects = 0;
+		size_t batches = 0;
+		size_t cacheHits = 0;
+		size_t cachesPruned = 0;
+		double seconds = 0;
+	};
+
+	double cellSize = 32.0;
+	std::string cacheDirectory = "Library/Batches";
+
+	static StaticBatcher& getInstance()
+	{
+		static StaticBatcher instance;
+		return instance;
+	}
+
+	// Rebuilds every batch from the static objects under root (root's own transform is not applied, as when drawing)
+	void build(GameObject& root);
+	// Drops the batches and hands the objects back to the per-object path
+	void clear(GameObject& root);
+
+	void enqueue(RenderQueue& queue, const Frustum& frustum) const;
+
+	const std::vector<StaticBatch>& batches() const { return _batches; }
+	const BuildStats& stats() const { return _stats; }
+
+private:
+	std::vector<StaticBatch> _batches;
+	BuildStats _stats;
+};
@@ -1,42 +1,40 @@
-#include <GL/glew.h>
 #include "Texture.h"
+#include "RenderDevice.h"
 
 
-static auto GLWrapMode(Texture::WrapModes mode) {
+static auto DeviceWrapMode(Texture::WrapModes mode) {
 	switch (mode) {
-	case Texture::Repeat: return GL_REPEAT;
-	case Texture::MirroredRepeat: return GL_MIRRORED_REPEAT;
-	case Texture::Clamp: return GL_CLAMP_TO_EDGE;
-	default: return GL_REPEAT;
+	case Texture::Repeat: return RenderDevice::Wrap::Repeat;
+	case Texture::MirroredRepeat: return RenderDevice::Wrap::MirroredRepeat;
+	case Texture::Clamp: return RenderDevice::Wrap::Clamp;
+	default: return RenderDevice::Wrap::Repeat;
 	}
 }
 
-static auto GLMagFilter(Texture::Filters filter) {
+static auto DeviceMagFilter(Texture::Filters filter) {
 	switch (filter) {
-	case Texture::Nearest: return GL_NEAREST;
-	case Texture::Linear: return GL_LINEAR;
-	default: return GL_NEAREST;
+	case Texture::Nearest: return RenderDevice::Filter::Nearest;
+	case Texture::Linear: return RenderDevice::Filter::Linear;
+	default: return RenderDevice::Filter::Nearest;
 	}
 }
 
-static auto GLMinFilter(Texture::Filters filter) {
+static auto DeviceMinFilter(Texture::Filters filter) {
 	switch (filter) {
-	case Texture::Nearest: return GL_NEAREST_MIPMAP_NEAREST;
-	case Texture::Linear: return GL_LINEAR_MIPMAP_LINEAR;
-	default: return GL_NEAREST_MIPMAP_LINEAR;
+	case Texture::Nearest: return RenderDevice::Filter::NearestMipmapNearest;
+	case Texture::Linear: return RenderDevice::Filter::LinearMipmapLinear;
+	default: return RenderDevice::Filter::NearestMipmapLinear;
 	}
 }
 
 void Texture::bind() const {
-	glBindTexture(GL_TEXTURE_2D, _img_ptr->id());
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GLWrapMode(wrapMode));
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GLWrapMode(wrapMode));
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GLMinFilter(filter));
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GLMagFilter(filter));
+	auto& device = RenderDevice::getInstance();
+	device.bindTexture(_img_ptr->id());
+	device.textureSampler(DeviceWrapMode(wrapMode), DeviceMinFilter(filter), DeviceMagFilter(filter));
 }
 
 void Texture::unbind() const {
-	glBindTexture(GL_TEXTURE_2D, 0);
+	RenderDevice::getInstance().bindTexture(0);
 }
 
 
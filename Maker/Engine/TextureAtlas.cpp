@@ -0,0 +1,220 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+SkylinePacker::SkylinePacker(unsigned int width, unsigned int height) : _width(width), _height(height)
+{
+	_skyline.push_back({ 0, 0, width });
+}
+
+bool SkylinePacker::fitAt(size_t index, unsigned int width, unsigned int height, unsigned int& y) const
+{
+	if (_skyline[index].x + width > _width) return false;
+
+	y = _skyline[index].y;
+	unsigned int remaining = width;
+	for (size_t i = index; remaining > 0; ++i) {
+		y = std::max(y, _skyline[i].y);
+		if (y + height > _height) return false;
+		remaining -= std::min(remaining, _skyline[i].width);
+	}
+	return true;
+}
+
+bool SkylinePacker::insert(unsigned int width, unsigned int height, AtlasRect& rect)
+{
+	size_t best = _skyline.size();
+	unsigned int bestTop = std::numeric_limits<unsigned int>::max();
+	unsigned int bestWidth = std::numeric_limits<unsigned int>::max();
+	unsigned int bestY = 0;
+
+	for (size_t i = 0; i < _skyline.size(); ++i) {
+		unsigned int y;
+		if (!fitAt(i, width, height, y)) continue;
+		if (y + height < bestTop || (y + height == bestTop && _skyline[i].width < bestWidth)) {
+			best = i;
+			bestTop = y + height;
+			bestWidth = _skyline[i].width;
+			bestY = y;
+		}
+	}
+	if (best == _skyline.size()) return false;
+
+	rect = { _skyline[best].x, bestY, width, height };
+	_skyline.insert(_skyline.begin() + best, Segment{ rect.x, bestY + height, width });
+
+	// Cut away whatever the new segment now covers
+	for (size_t i = best + 1; i < _skyline.size();) {
+		const Segment& previous = _skyline[i - 1];
+		const unsigned int previousEnd = previous.x + previous.width;
+		if (_skyline[i].x >= previousEnd) break;
+
+		const unsigned int overlap = previousEnd - _skyline[i].x;
+		if (overlap >= _skyline[i].width) {
+			_skyline.erase(_skyline.begin() + i);
+			continue;
+		}
+		_skyline[i].x += overlap;
+		_skyline[i].width -= overlap;
+		break;
+	}
+
+	// Merge neighbours at the same height
+	for (size_t i = 0; i + 1 < _skyline.size();) {
+		if (_skyline[i].y == _skyline[i + 1].y) {
+			_skyline[i].width += _skyline[i + 1].width;
+			_skyline.erase(_skyline.begin() + i + 1);
+		}
+		else ++i;
+	}
+
+	_usedArea += static_cast<size_t>(width) * height;
+	return true;
+}
+
+unsigned int SkylinePacker::usedHeight() const
+{
+	unsigned int top = 0;
+	for (const auto& segment : _skyline) top = std::max(top, segment.y);
+	return top;
+}
+
+namespace TextureAtlas
+{
+	static unsigned int roundUp(unsigned int value, unsigned int multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	static unsigned int nextPowerOfTwo(unsigned int value)
+	{
+		unsigned int result = 1;
+		while (result < value) result <<= 1;
+		return result;
+	}
+
+	// 1 to 4 channels in, 3 or 4 out; luminance is spread over RGB as GL_LUMINANCE would
+	static void expandPixel(const unsigned char* src, unsigned int srcChannels, unsigned char* dst, unsigned int dstChannels)
+	{
+		switch (srcChannels) {
+		case 1: dst[0] = dst[1] = dst[2] = src[0]; if (dstChannels == 4) dst[3] = 255; break;
+		case 2: dst[0] = dst[1] = dst[2] = src[0]; if (dstChannels == 4) dst[3] = src[1]; break;
+		case 3: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; if (dstChannels == 4) dst[3] = 255; break;
+		default: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; if (dstChannels == 4) dst[3] = src[3]; break;
+		}
+	}
+
+	unsigned int mipLevelsForGutter(unsigned int gutter, MipFilter filter)
+	{
+		// A texel of level n covers 2^n level-0 texels, aligned with the cells while 2^n <= gutter. Each step down
+		// reads reach texels of the level above past that footprint, so by level n the taps have spread
+		// reach * (2^n - 1) level-0 texels out, which has to stay inside the gutter.
+		const uint64_t reach = MipGen::filterReach(filter);
+		unsigned int levels = 1;
+		for (uint64_t footprint = 2; footprint <= gutter && reach * (footprint - 1) <= gutter; footprint *= 2) ++levels;
+		return levels;
+	}
+
+	bool fitsSettings(const Source& source, const Settings& settings)
+	{
+		return source.pixels && source.width && source.height && source.channels >= 1 && source.channels <= 4
+			&& source.width <= settings.maxSourceSize && source.height <= settings.maxSourceSize
+			&& source.width + 2 * settings.gutter <= settings.pageSize && source.height + 2 * settings.gutter <= settings.pageSize;
+	}
+
+	bool fitsUnitSquare(const glm::vec2* uvs, size_t count)
+	{
+		// A hair outside is fine, the gutter covers it
+		constexpr float epsilon = 1e-3f;
+		for (size_t i = 0; i < count; ++i) {
+			if (uvs[i].x < -epsilon || uvs[i].x > 1 + epsilon || uvs[i].y < -epsilon || uvs[i].y > 1 + epsilon) return false;
+		}
+		return true;
+	}
+
+	void remapTexCoords(glm::vec2* uvs, size_t count, const glm::vec4& uvScaleOffset)
+	{
+		for (size_t i = 0; i < count; ++i) {
+			uvs[i] = uvs[i] * glm::vec2(uvScaleOffset.x, uvScaleOffset.y) + glm::vec2(uvScaleOffset.z, uvScaleOffset.w);
+		}
+	}
+
+	Atlas build(const std::vector<Source>& sources, const Settings& settings)
+	{
+		Atlas atlas;
+		atlas.placements.resize(sources.size());
+		const unsigned int gutter = std::max(1u, settings.gutter);
+
+		// Tallest first packs a skyline tightest; stable so equal sizes keep their input order
+		std::vector<size_t> order;
+		for (size_t i = 0; i < sources.size(); ++i) {
+			if (fitsSettings(sources[i], settings)) order.push_back(i);
+		}
+		auto cellWidth = [&](size_t i) { return roundUp(sources[i].width + 2 * gutter, gutter); };
+		auto cellHeight = [&](size_t i) { return roundUp(sources[i].height + 2 * gutter, gutter); };
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			if (cellHeight(a) != cellHeight(b)) return cellHeight(a) > cellHeight(b);
+			return cellWidth(a) > cellWidth(b);
+		});
+
+		// Cells are whole multiples of the gutter, so every cell starts on the gutter grid
+		std::vector<SkylinePacker> packers;
+		std::vector<AtlasRect> cells(sources.size());
+		for (size_t i : order) {
+			Placement& placement = atlas.placements[i];
+			for (size_t page = 0; page < packers.size() && !placement.packed; ++page) {
+				if (packers[page].insert(cellWidth(i), cellHeight(i), cells[i])) {
+					placement.packed = true;
+					placement.page = page;
+				}
+			}
+			if (!placement.packed) {
+				packers.emplace_back(settings.pageSize, settings.pageSize);
+				packers.back().insert(cellWidth(i), cellHeight(i), cells[i]);
+				placement.packed = true;
+				placement.page = packers.size() - 1;
+			}
+		}
+
+		// Trim each page to the power of two that holds its cells
+		atlas.pages.resize(packers.size());
+		for (size_t i : order) {
+			const Placement& placement = atlas.placements[i];
+			Page& page = atlas.pages[placement.page];
+			page.width = std::max(page.width, cells[i].x + cells[i].width);
+			page.height = std::max(page.height, cells[i].y + cells[i].height);
+			page.channels = std::max(page.channels, (sources[i].channels == 2 || sources[i].channels == 4) ? 4u : 3u);
+			page.sourceTexels += static_cast<size_t>(sources[i].width) * sources[i].height;
+		}
+		for (auto& page : atlas.pages) {
+			page.width = std::min(settings.pageSize, nextPowerOfTwo(page.width));
+			page.height = std::min(settings.pageSize, nextPowerOfTwo(page.height));
+			page.mipLevels = mipLevelsForGutter(gutter, settings.mipFilter);
+			page.pixels.assign(static_cast<size_t>(page.width) * page.height * page.channels, 0);
+		}
+
+		// Copy each source into its cell, repeating the edge texels out to the cell border
+		for (size_t i : order) {
+			const Source& source = sources[i];
+			Placement& placement = atlas.placements[i];
+			Page& page = atlas.pages[placement.page];
+			const AtlasRect& cell = cells[i];
+
+			for (unsigned int row = 0; row < cell.height; ++row) {
+				const unsigned int sy = static_cast<unsigned int>(std::clamp<int>(static_cast<int>(row) - static_cast<int>(gutter), 0, static_cast<int>(source.height) - 1));
+				unsigned char* dst = page.pixels.data() + ((static_cast<size_t>(cell.y) + row) * page.width + cell.x) * page.channels;
+				for (unsigned int col = 0; col < cell.width; ++col, dst += page.channels) {
+					const unsigned int sx = static_cast<unsigned int>(std::clamp<int>(static_cast<int>(col) - static_cast<int>(gutter), 0, static_cast<int>(source.width) - 1));
+					expandPixel(source.pixels + (static_cast<size_t>(sy) * source.width + sx) * source.channels, source.channels, dst, page.channels);
+				}
+			}
+
+			placement.rect = { cell.x + gutter, cell.y + gutter, source.width, source.height };
+			placement.uvScaleOffset = glm::vec4(
+				static_cast<float>(source.width) / page.width, static_cast<float>(source.height) / page.height,
+				static_cast<float>(placement.rect.x) / page.width, static_cast<float>(placement.rect.y) / page.height);
+		}
+		return atlas;
+	}
+}
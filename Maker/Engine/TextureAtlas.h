@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MipChain.h"
+
+struct AtlasRect
+{
+	unsigned int x = 0;
+	unsigned int y = 0;
+	unsigned int width = 0;
+	unsigned int height = 0;
+};
+
+// Skyline bottom-left rectangle packer: keeps the top edge of everything placed so far as a list of
+// horizontal segments and drops each new rectangle where it ends up lowest (ties go to the narrower fit).
+class SkylinePacker
+{
+	struct Segment
+	{
+		unsigned int x;
+		unsigned int y;
+		unsigned int width;
+	};
+
+	unsigned int _width;
+	unsigned int _height;
+	std::vector<Segment> _skyline;
+	size_t _usedArea = 0;
+
+	// Top of a width-wide rectangle resting on the skyline from segment index on, or false if it does not fit there
+	bool fitAt(size_t index, unsigned int width, unsigned int height, unsigned int& y) const;
+
+public:
+	SkylinePacker(unsigned int width, unsigned int height);
+
+	bool insert(unsigned int width, unsigned int height, AtlasRect& rect);
+
+	unsigned int width() const { return _width; }
+	unsigned int height() const { return _height; }
+	// Highest point reached so far
+	unsigned int usedHeight() const;
+	size_t usedArea() const { return _usedArea; }
+	double occupancy() const { return static_cast<double>(_usedArea) / (static_cast<double>(_width) * _height); }
+};
+
+// Packs many small textures into a few shared pages so that everything drawn from one page needs a single bind.
+// Each texture is surrounded by a gutter of repeated edge texels and placed on a grid of the gutter size, so the
+// first mipLevelsForGutter(gutter, filter) levels of a page never blend neighbouring textures together.
+namespace TextureAtlas
+{
+	struct Settings
+	{
+		unsigned int pageSize = 2048;
+		unsigned int maxSourceSize = 256;	// anything larger keeps its own texture
+		unsigned int gutter = 8;			// power of two
+		MipFilter mipFilter = MipFilter::Kaiser;	// what the pages' mips are built with (TextureImporter's filter)
+	};
+
+	struct Source
+	{
+		unsigned int width = 0;
+		unsigned int height = 0;
+		unsigned int channels = 0;
+		const unsigned char* pixels = nullptr;
+	};
+
+	struct Placement
+	{
+		bool packed = false;
+		size_t page = 0;
+		AtlasRect rect;						// texels of the source inside the page, gutter excluded
+		glm::vec4 uvScaleOffset{ 1, 1, 0, 0 };	// uv' = uv * xy + zw
+	};
+
+	struct Page
+	{
+		unsigned int width = 0;
+		unsigned int height = 0;
+		unsigned int channels = 0;
+		unsigned int mipLevels = 1;
+		size_t sourceTexels = 0;
+		std::vector<unsigned char> pixels;
+
+		double occupancy() const { return width && height ? static_cast<double>(sourceTexels) / (static_cast<double>(width) * height) : 0.0; }
+	};
+
+	struct Atlas
+	{
+		std::vector<Page> pages;
+		std::vector<Placement> placements;	// one per source, same order
+	};
+
+	// Levels whose texels, filter taps included, read nothing past their own cell's gutter
+	unsigned int mipLevelsForGutter(unsigned int gutter, MipFilter filter);
+
+	bool fitsSettings(const Source& source, const Settings& settings);
+
+	// UVs that wrap or mirror cannot be moved into an atlas
+	bool fitsUnitSquare(const glm::vec2* uvs, size_t count);
+	void remapTexCoords(glm::vec2* uvs, size_t count, const glm::vec4& uvScaleOffset);
+
+	// Sources that do not fit the settings come back with packed == false. Page layout only depends on the
+	// sources' sizes and order, so rebuilding from the same textures gives the same UVs.
+	Atlas build(const std::vector<Source>& sources, const Settings& settings = {});
+}
@@ -0,0 +1,212 @@
+#include "TextureCache.h"
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#define CHECKERS_HEIGHT 32
+#define CHECKERS_WIDTH 32
+
+uint64_t TextureCache::hashBytes(const void* data, size_t size, uint64_t seed)
+{
+	// FNV-1a, 64 bit
+	const auto* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static bool hashFile(const std::string& path, uint64_t& hash)
+{
+	std::ifstream is(path, std::ios::binary);
+	if (!is.is_open()) return false;
+
+	const std::vector<char> bytes((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+	hash = TextureCache::hashBytes(bytes.data(), bytes.size());
+	return true;
+}
+
+size_t TextureCache::imageBytes(const Image& image)
+{
+	return image.gpuBytes();
+}
+
+bool TextureCache::contentHash(const std::string& path, uint64_t& hash)
+{
+	std::error_code error;
+	const uintmax_t size = std::filesystem::file_size(path, error);
+	if (error) return false;
+	const auto modified = std::filesystem::last_write_time(path, error);
+	if (error) return false;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		const auto it = _files.find(path);
+		if (it != _files.end() && it->second.size == size && it->second.modified == modified) {
+			hash = it->second.hash;
+			return true;
+		}
+	}
+
+	if (!hashFile(path, hash)) return false;
+	std::lock_guard<std::mutex> lock(_mutex);
+	_files[path] = { size, modified, hash };
+	return true;
+}
+
+static std::shared_ptr<Image> loadDecoded(const std::string& path)
+{
+	auto img = std::make_shared<Image>();
+	img->LoadTexture(path);
+	return img;
+}
+
+std::shared_ptr<Image> TextureCache::image(const std::string& path)
+{
+	return image(path, Decoded, loadDecoded);
+}
+
+std::shared_ptr<Image> TextureCache::image(const std::string& path, Representation representation, const ImageLoader& loader)
+{
+	uint64_t hash;
+	if (!contentHash(path, hash)) return nullptr;
+	const ImageKey key(hash, representation);
+
+	std::promise<std::shared_ptr<Image>> loaded;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (auto cached = _images[key].lock()) {
+			++_hits;
+			return cached;
+		}
+		// Someone else is loading the same content: wait for theirs
+		const auto loading = _loading.find(key);
+		if (loading != _loading.end()) {
+			auto pending = loading->second;
+			lock.unlock();
+			++_hits;
+			return pending.get();
+		}
+		_loading[key] = loaded.get_future().share();
+		++_misses;
+	}
+
+	std::shared_ptr<Image> img;
+	try {
+		img = loader(path);
+	}
+	catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_loading.erase(key);
+		}
+		loaded.set_exception(std::current_exception());
+		throw;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_images[key] = img;
+		_loading.erase(key);
+	}
+	loaded.set_value(img);
+	return img;
+}
+
+std::shared_ptr<Image> TextureCache::find(const std::string& path, Representation representation)
+{
+	uint64_t hash;
+	if (!contentHash(path, hash)) return nullptr;
+	std::lock_guard<std::mutex> lock(_mutex);
+	const auto it = _images.find(ImageKey(hash, representation));
+	return it != _images.end() ? it->second.lock() : nullptr;
+}
+
+std::shared_ptr<Texture> TextureCache::texture(const std::string& path, Texture::WrapModes wrapMode, Texture::Filters filter)
+{
+	return texture(path, wrapMode, filter, Decoded, loadDecoded);
+}
+
+std::shared_ptr<Texture> TextureCache::texture(const std::string& path, Texture::WrapModes wrapMode, Texture::Filters filter, Representation representation, const ImageLoader& loader)
+{
+	uint64_t hash;
+	if (!contentHash(path, hash)) return nullptr;
+	const TextureKey key(hash, representation, wrapMode, filter);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (auto cached = _textures[key].lock()) {
+			++_hits;
+			return cached;
+		}
+	}
+
+	auto texture = std::make_shared<Texture>();
+	texture->wrapMode = wrapMode;
+	texture->filter = filter;
+	texture->setImage(image(path, representation, loader));
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_textures[key] = texture;
+	return texture;
+}
+
+std::shared_ptr<Image> TextureCache::checker()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (auto cached = _checker.lock()) {
+		++_hits;
+		return cached;
+	}
+
+	++_misses;
+	unsigned char checkerImage[CHECKERS_HEIGHT][CHECKERS_WIDTH][4];
+	for (int i = 0; i < CHECKERS_HEIGHT; i++) {
+		for (int j = 0; j < CHECKERS_WIDTH; j++) {
+			int c = ((((i & 0x8) == 0) ^ (((j & 0x8)) == 0))) * 255;
+			checkerImage[i][j][0] = (unsigned char)c;
+			checkerImage[i][j][1] = (unsigned char)c;
+			checkerImage[i][j][2] = (unsigned char)c;
+			checkerImage[i][j][3] = (unsigned char)255;
+		}
+	}
+
+	auto img = std::make_shared<Image>();
+	img->load(CHECKERS_WIDTH, CHECKERS_HEIGHT, 4, checkerImage);
+	_checker = img;
+	return img;
+}
+
+size_t TextureCache::residentBytes() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	size_t bytes = 0;
+	for (const auto& [hash, weak] : _images) {
+		if (auto img = weak.lock()) bytes += imageBytes(*img);
+	}
+	if (auto img = _checker.lock()) bytes += imageBytes(*img);
+	return bytes;
+}
+
+size_t TextureCache::residentImages() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	size_t count = _checker.expired() ? 0 : 1;
+	for (const auto& [hash, weak] : _images) {
+		if (!weak.expired()) ++count;
+	}
+	return count;
+}
+
+void TextureCache::purge()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto it = _images.begin(); it != _images.end();) {
+		it = it->second.expired() ? _images.erase(it) : std::next(it);
+	}
+	for (auto it = _textures.begin(); it != _textures.end();) {
+		it = it->second.expired() ? _textures.erase(it) : std::next(it);
+	}
+}
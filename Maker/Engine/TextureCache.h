@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include "Image.h"
+#include "Texture.h"
+
+// Process-wide cache of uploaded images, keyed by the hash of the source file's bytes and the representation the
+// loader turns them into (a raw decode and a block-compressed cook of the same file are different images).
+// Entries are weak: an image is decoded and uploaded once, shared by every material that asks for the
+// same content, and freed as soon as the last user lets go of it. A file is hashed again only when its
+// size or modification time changes, and loaders run without the cache locked; callers asking for content
+// that is already being loaded wait for that load instead of starting another.
+class TextureCache
+{
+public:
+	using ImageLoader = std::function<std::shared_ptr<Image>(const std::string& path)>;
+
+	// What a loader makes of a file. Loaders passed under the same representation must produce the same image.
+	enum Representation
+	{
+		Decoded,	// Image::LoadTexture: raw pixels with a full mip chain
+		Cooked,		// TextureImporter: the cooked mip chain, block-compressed where the GPU supports it
+		Streamed,	// TextureImporter::LoadTextureFromFile: a cooked .tex handed to the TextureStreamer
+	};
+
+	static TextureCache& getInstance()
+	{
+		static TextureCache instance;
+		return instance;
+	}
+
+	// Returns the Decoded image for the file's content, loading it with Image::LoadTexture on a miss.
+	// Returns nullptr if the file can't be read.
+	std::shared_ptr<Image> image(const std::string& path);
+	// Same, for images that loader makes in the given representation
+	std::shared_ptr<Image> image(const std::string& path, Representation representation, const ImageLoader& loader);
+	// The live image for the file's content in that representation, without loading anything; nullptr if there is none
+	std::shared_ptr<Image> find(const std::string& path, Representation representation);
+
+	// Same image, wrapped in a Texture with the given sampler settings. Textures are cached per (content, representation, sampler).
+	std::shared_ptr<Texture> texture(const std::string& path, Texture::WrapModes wrapMode = Texture::Repeat, Texture::Filters filter = Texture::Nearest);
+	std::shared_ptr<Texture> texture(const std::string& path, Texture::WrapModes wrapMode, Texture::Filters filter, Representation representation, const ImageLoader& loader);
+
+	// The 32x32 checker pattern used as the no-texture fallback, created on first use and shared by every mesh
+	std::shared_ptr<Image> checker();
+
+	// GPU bytes held by live images (base level plus mip chain)
+	size_t residentBytes() const;
+	size_t residentImages() const;
+	size_t hits() const { return _hits.load(std::memory_order_relaxed); }
+	size_t misses() const { return _misses.load(std::memory_order_relaxed); }
+
+	// Drops entries whose images have already been released
+	void purge();
+
+	static uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+private:
+	TextureCache() = default;
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	static size_t imageBytes(const Image& image);
+	// Hash of the file's bytes, reused while its size and modification time stay the same
+	bool contentHash(const std::string& path, uint64_t& hash);
+
+	struct FileStamp
+	{
+		uintmax_t size = 0;
+		std::filesystem::file_time_type modified{};
+		uint64_t hash = 0;
+	};
+
+	using ImageKey = std::pair<uint64_t, Representation>;
+	using TextureKey = std::tuple<uint64_t, Representation, Texture::WrapModes, Texture::Filters>;
+
+	mutable std::mutex _mutex;
+	std::map<std::string, FileStamp> _files;
+	std::map<ImageKey, std::weak_ptr<Image>> _images;
+	std::map<ImageKey, std::shared_future<std::shared_ptr<Image>>> _loading;
+	std::map<TextureKey, std::weak_ptr<Texture>> _textures;
+	std::weak_ptr<Image> _checker;
+	std::atomic<size_t> _hits{ 0 };
+	std::atomic<size_t> _misses{ 0 };
+};
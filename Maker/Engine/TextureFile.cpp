@@ -0,0 +1,146 @@
+#include "TextureFile.h"
+#include "Image.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <vector>
+
+namespace TextureFile
+{
+	static constexpr size_t kAlignment = 16;
+	// The most Image's unsigned short width and height can hold; past any GL texture size limit
+	static constexpr uint32_t kMaxSize = 0xFFFF;
+
+	static uint64_t alignUp(uint64_t value)
+	{
+		return (value + kAlignment - 1) & ~uint64_t(kAlignment - 1);
+	}
+
+	static bool validHeader(const Header& header)
+	{
+		return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion &&
+			header.channels >= 1 && header.channels <= 4 && header.levelCount > 0 && header.levelCount <= 32 &&
+			header.format <= static_cast<uint32_t>(BlockFormat::BC5) && header.width >= 1 && header.width <= kMaxSize &&
+			header.height >= 1 && header.height <= kMaxSize;
+	}
+
+	// A level no larger than the top one, holding exactly the bytes GL will read for it: whole 4x4 blocks when
+	// compressed, tightly packed pixels otherwise
+	static bool validLevel(const Header& header, const Level& level)
+	{
+		if (level.width < 1 || level.width > header.width || level.height < 1 || level.height > header.height) return false;
+		const auto format = static_cast<BlockFormat>(header.format);
+		const uint64_t expected = format == BlockFormat::None ? uint64_t(level.width) * level.height * header.channels :
+			BlockCompression::compressedSize(level.width, level.height, format);
+		return level.size == expected;
+	}
+
+	bool write(std::ostream& os, const MipChain& mips)
+	{
+		// A file without levels would not read back
+		if (mips.empty()) return false;
+
+		Header header{};
+		std::memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.version = kVersion;
+		header.width = mips.width;
+		header.height = mips.height;
+		header.channels = mips.channels;
+		header.levelCount = static_cast<uint32_t>(mips.levels.size());
+		header.flags = mips.srgb ? static_cast<uint32_t>(Srgb) : 0u;
+		header.format = static_cast<uint32_t>(mips.format);
+
+		std::vector<Level> table(mips.levels.size());
+		uint64_t offset = alignUp(sizeof(Header) + table.size() * sizeof(Level));
+		for (size_t i = 0; i < table.size(); ++i) {
+			table[i] = { mips.levels[i].width, mips.levels[i].height, offset, mips.levels[i].size };
+			offset = alignUp(offset + mips.levels[i].size);
+		}
+
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		os.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Level));
+
+		static const char padding[kAlignment] = {};
+		uint64_t written = sizeof(Header) + table.size() * sizeof(Level);
+		for (size_t i = 0; i < table.size(); ++i) {
+			os.write(padding, table[i].offset - written);
+			os.write(reinterpret_cast<const char*>(mips.level(i)), table[i].size);
+			written = table[i].offset + table[i].size;
+		}
+		return static_cast<bool>(os);
+	}
+
+	bool read(std::istream& is, MipChain& mips)
+	{
+		const std::streampos start = is.tellg();
+
+		Header header;
+		if (!is.read(reinterpret_cast<char*>(&header), sizeof(header)) || !validHeader(header)) return false;
+
+		std::vector<Level> table(header.levelCount);
+		if (!is.read(reinterpret_cast<char*>(table.data()), table.size() * sizeof(Level))) return false;
+		for (const auto& level : table) {
+			if (!validLevel(header, level)) return false;
+		}
+
+		mips = MipChain();
+		mips.width = header.width;
+		mips.height = header.height;
+		mips.channels = header.channels;
+		mips.srgb = (header.flags & Srgb) != 0;
+		mips.format = static_cast<BlockFormat>(header.format);
+
+		size_t total = 0;
+		for (const auto& level : table) {
+			mips.levels.push_back({ level.width, level.height, total, static_cast<size_t>(level.size) });
+			total += static_cast<size_t>(level.size);
+		}
+		mips.pixels.resize(total);
+		for (size_t i = 0; i < table.size(); ++i) {
+			is.seekg(start + static_cast<std::streamoff>(table[i].offset));
+			is.read(reinterpret_cast<char*>(mips.pixels.data() + mips.levels[i].offset), mips.levels[i].size);
+		}
+		return static_cast<bool>(is);
+	}
+
+	bool parse(const unsigned char* data, size_t size, Header& header, std::vector<MipLevel>& levels)
+	{
+		if (size < sizeof(Header)) return false;
+		std::memcpy(&header, data, sizeof(header));
+		if (!validHeader(header) || size < sizeof(Header) + header.levelCount * sizeof(Level)) return false;
+
+		levels.resize(header.levelCount);
+		for (uint32_t i = 0; i < header.levelCount; ++i) {
+			Level level;
+			std::memcpy(&level, data + sizeof(Header) + i * sizeof(Level), sizeof(level));
+			if (!validLevel(header, level) || level.offset > size || level.size > size - level.offset) return false;
+			levels[i] = { level.width, level.height, static_cast<size_t>(level.offset), static_cast<size_t>(level.size) };
+		}
+		return true;
+	}
+
+	bool load(const std::string& path, Image& image)
+	{
+		MappedFile file(path);
+		if (!file.isOpen()) return false;
+
+		Header header;
+		std::vector<MipLevel> levels;
+		if (parse(file.data(), file.size(), header, levels)) {
+			image.loadLevels(header.width, header.height, header.channels, levels.data(), levels.size(), file.data(), static_cast<BlockFormat>(header.format));
+			return true;
+		}
+
+		// Older single-level layout
+		unsigned short width, height;
+		unsigned char channels;
+		const size_t legacyHeader = sizeof(width) + sizeof(height) + sizeof(channels);
+		if (file.size() < legacyHeader) return false;
+		std::memcpy(&width, file.data(), sizeof(width));
+		std::memcpy(&height, file.data() + sizeof(width), sizeof(height));
+		std::memcpy(&channels, file.data() + sizeof(width) + sizeof(height), sizeof(channels));
+		if (channels < 1 || channels > 4 || file.size() < legacyHeader + size_t(width) * height * channels) return false;
+
+		image.load(width, height, channels, const_cast<unsigned char*>(file.data() + legacyHeader));
+		return true;
+	}
+}
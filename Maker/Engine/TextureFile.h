@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "MipChain.h"
+
+class Image;
+
+// Cooked texture container (.tex): a header, a level table, then every mip level back to back.
+// Level data starts 16-byte aligned and offsets are from the start of the file, so a loader can map the
+// file and hand each level to GL directly.
+namespace TextureFile
+{
+	constexpr char kMagic[4] = { 'T', 'E', 'X', 'M' };
+	constexpr uint32_t kVersion = 1;
+
+	enum Flags : uint32_t
+	{
+		Srgb = 1 << 0,
+	};
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t channels;
+		uint32_t levelCount;
+		uint32_t flags;
+		uint32_t format;	// BlockFormat of the level data; 0 (None) for raw pixels
+	};
+
+	struct Level
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// False, writing nothing, when mips has no levels (an image whose CPU copy was dropped)
+	bool write(std::ostream& os, const MipChain& mips);
+	// Header and level table of a .tex already in memory; level offsets stay relative to data
+	bool parse(const unsigned char* data, size_t size, Header& header, std::vector<MipLevel>& levels);
+	bool read(std::istream& is, MipChain& mips);
+
+	// Maps the file and uploads every level from the mapping. Files in the older single-level .tex layout
+	// (ushort width, ushort height, uchar channels, pixels) are still accepted and get their mips built on load.
+	bool load(const std::string& path, Image& image);
+}
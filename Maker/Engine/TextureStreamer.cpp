@@ -0,0 +1,290 @@
+#include "TextureStreamer.h"
+#include "Image.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+bool StreamSource::fromFile(const std::string& path, StreamSource& source)
+{
+	PROFILE_SCOPE("StreamSource::fromFile");
+	auto file = std::make_shared<MappedFile>(path);
+	if (!file->isOpen()) return false;
+
+	TextureFile::Header header;
+	std::vector<MipLevel> levels;
+	if (!TextureFile::parse(file->data(), file->size(), header, levels)) return false;
+
+	source.width = header.width;
+	source.height = header.height;
+	source.channels = header.channels;
+	source.format = static_cast<BlockFormat>(header.format);
+	source.levels = std::move(levels);
+	source.base = file->data();
+	source.owner = file;
+	return true;
+}
+
+StreamSource StreamSource::fromChain(MipChain&& chain)
+{
+	auto owned = std::make_shared<MipChain>(std::move(chain));
+	StreamSource source;
+	source.width = owned->width;
+	source.height = owned->height;
+	source.channels = owned->channels;
+	source.format = owned->format;
+	source.levels = owned->levels;
+	source.base = owned->pixels.data();
+	source.owner = owned;
+	return source;
+}
+
+size_t StreamSource::bytesFrom(unsigned int first) const
+{
+	size_t bytes = 0;
+	for (size_t i = first; i < levels.size(); ++i) bytes += levels[i].size;
+	return bytes;
+}
+
+void GLTextureUploader::upload(Image* image, const MipLevel* levels, size_t levelCount, const unsigned char* base, unsigned int channels, BlockFormat format)
+{
+	image->loadLevels(levels[0].width, levels[0].height, channels, levels, levelCount, base, format);
+}
+
+void RecordingTextureUploader::upload(Image* image, const MipLevel* levels, size_t levelCount, const unsigned char* /*base*/, unsigned int /*channels*/, BlockFormat /*format*/)
+{
+	Upload record{ image, levels[0].width, levels[0].height, levelCount, 0 };
+	for (size_t i = 0; i < levelCount; ++i) record.bytes += levels[i].size;
+	uploadedBytes += record.bytes;
+	uploads.push_back(record);
+}
+
+bool TextureStreamer::Entry::pendingReady() const
+{
+	return pending.valid() && pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+TextureStreamer::TextureStreamer(std::unique_ptr<TextureUploader> uploader, ThreadPool* pool) :
+	_uploader(std::move(uploader)),
+	_pool(pool ? pool : &ThreadPool::getInstance())
+{
+}
+
+bool TextureStreamer::add(const std::shared_ptr<Image>& image, StreamSource&& source)
+{
+	if (!image || source.levels.empty()) return false;
+
+	Entry& entry = _entries[image.get()];
+	entry = Entry();
+	entry.image = image;
+	entry.source = std::move(source);
+
+	const auto& levels = entry.source.levels;
+	entry.floorLevel = static_cast<unsigned int>(levels.size() - 1);
+	for (unsigned int i = 0; i < levels.size(); ++i) {
+		if (std::max(levels[i].width, levels[i].height) <= settings.initialSize) {
+			entry.floorLevel = i;
+			break;
+		}
+	}
+	entry.requestedLevel = entry.frameLevel = entry.floorLevel;
+	entry.lastNeededFrame = _frame;
+	makeResident(entry, entry.floorLevel);
+	return true;
+}
+
+void TextureStreamer::remove(const Image* image)
+{
+	_entries.erase(image);
+}
+
+void TextureStreamer::beginFrame(const vec3& eye, double fovY, int viewportHeight)
+{
+	++_frame;
+	_eye = eye;
+	_projectionScale = viewportHeight * 0.5 / std::tan(fovY * 0.5);
+}
+
+void TextureStreamer::noteUse(const Image* image, const BoundingBox& worldBox)
+{
+	if (!image || !_entries.count(image)) return;
+
+	const double radius = glm::length(worldBox.max - worldBox.min) * 0.5;
+	const double distance = glm::length(worldBox.center() - _eye);
+	const double pixels = distance <= radius ? std::numeric_limits<double>::infinity() : 2.0 * radius / distance * _projectionScale;
+	noteUse(image, pixels);
+}
+
+void TextureStreamer::noteUse(const Image* image, double screenPixels)
+{
+	const auto itr = _entries.find(image);
+	if (itr == _entries.end()) return;
+
+	Entry& entry = itr->second;
+	const auto& source = entry.source;
+	const unsigned int level = std::min(entry.floorLevel,
+		levelForScreenSize(source.width, source.height, static_cast<unsigned int>(source.levels.size()), screenPixels, settings.lodBias));
+	entry.frameLevel = entry.lastNeededFrame == _frame ? std::min(entry.frameLevel, level) : level;
+	entry.lastNeededFrame = _frame;
+}
+
+unsigned int TextureStreamer::levelForScreenSize(unsigned int width, unsigned int height, unsigned int levelCount, double screenPixels, int lodBias)
+{
+	if (levelCount == 0) return 0;
+	int level;
+	if (std::isinf(screenPixels)) level = 0;
+	else if (screenPixels <= 0) level = static_cast<int>(levelCount) - 1;
+	else level = static_cast<int>(std::floor(std::log2(std::max(1.0, std::max(width, height) / screenPixels))));
+	return static_cast<unsigned int>(std::clamp(level + lodBias, 0, static_cast<int>(levelCount) - 1));
+}
+
+void TextureStreamer::makeResident(Entry& entry, unsigned int level)
+{
+	const auto image = entry.image.lock();
+	if (!image) return;
+
+	const auto& source = entry.source;
+	_uploader->upload(image.get(), source.levels.data() + level, source.levels.size() - level, source.base, source.channels, source.format);
+	entry.residentLevel = level;
+}
+
+void TextureStreamer::uploadStaged(Entry& entry, Staged&& staged)
+{
+	// The texture may have been asked to stay coarser while the read was in flight
+	const unsigned int level = std::max(staged.firstLevel, entry.requestedLevel);
+	const auto image = entry.image.lock();
+	if (!image || level >= entry.residentLevel) return;
+
+	const size_t skip = level - staged.firstLevel;
+	_uploader->upload(image.get(), staged.levels.data() + skip, staged.levels.size() - skip, staged.bytes.data(), entry.source.channels, entry.source.format);
+	entry.residentLevel = level;
+}
+
+void TextureStreamer::update()
+{
+	PROFILE_SCOPE("TextureStreamer::update");
+	// Images that were released take their entries with them
+	for (auto itr = _entries.begin(); itr != _entries.end();) {
+		if (itr->second.image.expired()) itr = _entries.erase(itr);
+		else ++itr;
+	}
+
+	// What each texture wants this frame
+	for (auto& [image, entry] : _entries) {
+		if (entry.lastNeededFrame == _frame) entry.requestedLevel = entry.frameLevel;
+		else if (_frame - entry.lastNeededFrame > settings.idleFrames) entry.requestedLevel = entry.floorLevel;
+	}
+
+	// Finished reads, up to the per-frame upload allowance
+	size_t uploaded = 0;
+	for (auto& [image, entry] : _entries) {
+		if (uploaded >= settings.uploadBytesPerFrame) break;
+		if (!entry.pendingReady()) continue;
+		Staged staged = entry.pending.get();
+		uploaded += staged.bytes.size();
+		uploadStaged(entry, std::move(staged));
+	}
+
+	// Levels nobody asks for any more
+	for (auto& [image, entry] : _entries) {
+		if (entry.residentLevel < entry.requestedLevel) makeResident(entry, entry.requestedLevel);
+	}
+
+	// Over budget: the least recently needed textures give up their finest levels first
+	size_t resident = residentBytes();
+	if (resident > settings.budgetBytes) {
+		std::vector<Entry*> byAge;
+		for (auto& [image, entry] : _entries) byAge.push_back(&entry);
+		std::stable_sort(byAge.begin(), byAge.end(), [](const Entry* a, const Entry* b) { return a->lastNeededFrame < b->lastNeededFrame; });
+
+		for (Entry* entry : byAge) {
+			while (resident > settings.budgetBytes && entry->residentLevel < entry->floorLevel) {
+				const size_t before = entry->source.bytesFrom(entry->residentLevel);
+				makeResident(*entry, entry->residentLevel + 1);
+				resident -= before - entry->source.bytesFrom(entry->residentLevel);
+				entry->requestedLevel = std::max(entry->requestedLevel, entry->residentLevel);
+			}
+			if (resident <= settings.budgetBytes) break;
+		}
+	}
+
+	// New reads, most recently needed first, each trimmed to what still fits the budget
+	const size_t committed = resident + inflightBytes();
+	size_t available = committed < settings.budgetBytes ? settings.budgetBytes - committed : 0;
+
+	std::vector<Entry*> wanting;
+	for (auto& [image, entry] : _entries) {
+		if (!entry.pending.valid() && entry.requestedLevel < entry.residentLevel) wanting.push_back(&entry);
+	}
+	std::stable_sort(wanting.begin(), wanting.end(), [](const Entry* a, const Entry* b) { return a->lastNeededFrame > b->lastNeededFrame; });
+
+	for (Entry* entry : wanting) {
+		const size_t residentBytes = entry->source.bytesFrom(entry->residentLevel);
+		unsigned int level = entry->requestedLevel;
+		while (level < entry->residentLevel && entry->source.bytesFrom(level) - residentBytes > available) ++level;
+		if (level >= entry->residentLevel) continue;
+		available -= entry->source.bytesFrom(level) - residentBytes;
+
+		// Reading the levels on a worker is what pages them in from the mapped file
+		entry->pendingLevel = level;
+		entry->pending = _pool->submit([source = entry->source, level]() {
+			Staged staged;
+			staged.firstLevel = level;
+			for (size_t i = level; i < source.levels.size(); ++i) {
+				MipLevel copy = source.levels[i];
+				copy.offset = staged.bytes.size();
+				staged.bytes.insert(staged.bytes.end(), source.base + source.levels[i].offset, source.base + source.levels[i].offset + source.levels[i].size);
+				staged.levels.push_back(copy);
+			}
+			return staged;
+		});
+	}
+}
+
+void TextureStreamer::flush()
+{
+	for (auto& [image, entry] : _entries) {
+		if (entry.pending.valid()) uploadStaged(entry, entry.pending.get());
+	}
+}
+
+size_t TextureStreamer::inflightBytes() const
+{
+	size_t bytes = 0;
+	for (const auto& [image, entry] : _entries) {
+		if (entry.pending.valid()) bytes += entry.source.bytesFrom(entry.pendingLevel) - entry.source.bytesFrom(entry.residentLevel);
+	}
+	return bytes;
+}
+
+size_t TextureStreamer::residentBytes() const
+{
+	size_t bytes = 0;
+	for (const auto& [image, entry] : _entries) bytes += entry.source.bytesFrom(entry.residentLevel);
+	return bytes;
+}
+
+size_t TextureStreamer::requestedBytes() const
+{
+	size_t bytes = 0;
+	for (const auto& [image, entry] : _entries) bytes += entry.source.bytesFrom(entry.requestedLevel);
+	return bytes;
+}
+
+std::vector<TextureStreamer::TextureStats> TextureStreamer::stats() const
+{
+	std::vector<TextureStats> result;
+	result.reserve(_entries.size());
+	for (const auto& [image, entry] : _entries) {
+		const auto& source = entry.source;
+		result.push_back({ image, source.width, source.height, static_cast<unsigned int>(source.levels.size()),
+			entry.residentLevel, entry.requestedLevel, source.bytesFrom(entry.residentLevel), source.bytesFrom(entry.requestedLevel),
+			entry.lastNeededFrame, entry.pending.valid() });
+	}
+	return result;
+}
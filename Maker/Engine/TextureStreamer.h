@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "BoundingBox.h"
+#include "MipChain.h"
+
+class Image;
+class ThreadPool;
+
+// Where the levels of a streamed texture live: a level table plus the bytes at base + level.offset.
+// owner keeps base valid (a mapped .tex file, or a MipChain already in memory).
+struct StreamSource
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int channels = 0;
+	BlockFormat format = BlockFormat::None;
+	std::vector<MipLevel> levels;
+	const unsigned char* base = nullptr;
+	std::shared_ptr<const void> owner;
+
+	// Maps a cooked .tex; false for anything else (older single-level files included)
+	static bool fromFile(const std::string& path, StreamSource& source);
+	static StreamSource fromChain(MipChain&& chain);
+
+	// Bytes of levels [first, end)
+	size_t bytesFrom(unsigned int first) const;
+};
+
+// The upload layer the streamer talks to. Levels passed are the resident ones, finest first, so the texture is
+// re-specified with its finest resident level as GL level 0 and UVs are unaffected.
+class TextureUploader
+{
+public:
+	virtual ~TextureUploader() = default;
+	virtual void upload(Image* image, const MipLevel* levels, size_t levelCount, const unsigned char* base, unsigned int channels, BlockFormat format) = 0;
+};
+
+class GLTextureUploader : public TextureUploader
+{
+public:
+	void upload(Image* image, const MipLevel* levels, size_t levelCount, const unsigned char* base, unsigned int channels, BlockFormat format) override;
+};
+
+// CPU-only stand-in: records what would have been uploaded and never touches GL or the image
+class RecordingTextureUploader : public TextureUploader
+{
+public:
+	struct Upload
+	{
+		const Image* image;
+		unsigned int width;
+		unsigned int height;
+		size_t levelCount;
+		size_t bytes;
+	};
+
+	std::vector<Upload> uploads;
+	size_t uploadedBytes = 0;
+
+	void upload(Image* image, const MipLevel* levels, size_t levelCount, const unsigned char* base, unsigned int channels, BlockFormat format) override;
+};
+
+// Keeps only the mips each texture needs resident. Textures start with their coarse tail (levels no larger than
+// initialSize); every frame the renderer reports where each texture is used, the streamer turns the projected size
+// into a wanted level, and finer levels are read on the ThreadPool and uploaded on the main thread in update().
+// When the total goes over budgetBytes, the least recently needed textures give up their finest levels first.
+class TextureStreamer
+{
+public:
+	struct Settings
+	{
+		size_t budgetBytes = size_t(256) << 20;
+		size_t uploadBytesPerFrame = size_t(16) << 20;
+		unsigned int initialSize = 64;
+		uint64_t idleFrames = 120;	// frames unused before a texture falls back to its coarse tail
+		int lodBias = 0;			// added to every wanted level; positive trades sharpness for memory
+	};
+
+	struct TextureStats
+	{
+		const Image* image;
+		unsigned int width;
+		unsigned int height;
+		unsigned int levelCount;
+		unsigned int residentLevel;
+		unsigned int requestedLevel;
+		size_t residentBytes;
+		size_t requestedBytes;
+		uint64_t lastNeededFrame;
+		bool streaming;
+	};
+
+	Settings settings;
+
+	static TextureStreamer& getInstance()
+	{
+		static TextureStreamer instance(std::make_unique<GLTextureUploader>());
+		return instance;
+	}
+
+	explicit TextureStreamer(std::unique_ptr<TextureUploader> uploader, ThreadPool* pool = nullptr);
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Uploads the coarse tail right away and starts tracking the image
+	bool add(const std::shared_ptr<Image>& image, StreamSource&& source);
+	void remove(const Image* image);
+	bool contains(const Image* image) const { return _entries.count(image) > 0; }
+
+	// Camera used to turn bounding boxes into screen sizes for this frame
+	void beginFrame(const vec3& eye, double fovY, int viewportHeight);
+	// The image is drawn this frame covering worldBox; assumes its UVs span the object about once
+	void noteUse(const Image* image, const BoundingBox& worldBox);
+	void noteUse(const Image* image, double screenPixels);
+	// Main thread, once per frame after drawing: uploads finished reads, evicts over budget, starts new reads
+	void update();
+	// Waits for every read in flight and uploads it (tools and tests)
+	void flush();
+
+	size_t residentBytes() const;
+	size_t requestedBytes() const;
+	size_t textureCount() const { return _entries.size(); }
+	uint64_t frame() const { return _frame; }
+	std::vector<TextureStats> stats() const;
+
+	// Finest level worth having for a width x height texture covering screenPixels pixels
+	static unsigned int levelForScreenSize(unsigned int width, unsigned int height, unsigned int levelCount, double screenPixels, int lodBias = 0);
+
+private:
+	struct Staged
+	{
+		unsigned int firstLevel = 0;
+		std::vector<MipLevel> levels;
+		std::vector<unsigned char> bytes;
+	};
+
+	struct Entry
+	{
+		std::weak_ptr<Image> image;
+		StreamSource source;
+		unsigned int floorLevel = 0;	// coarse tail kept no matter what
+		unsigned int residentLevel = 0;
+		unsigned int requestedLevel = 0;
+		unsigned int frameLevel = 0;	// finest level asked for during the current frame
+		uint64_t lastNeededFrame = 0;
+		std::future<Staged> pending;
+		unsigned int pendingLevel = 0;
+		bool pendingReady() const;
+	};
+
+	std::unique_ptr<TextureUploader> _uploader;
+	ThreadPool* _pool;
+	std::map<const Image*, Entry> _entries;
+	uint64_t _frame = 0;
+	vec3 _eye{};
+	double _projectionScale = 0;	// screen pixels per unit of (size / distance)
+
+	void makeResident(Entry& entry, unsigned int level);
+	void uploadStaged(Entry& entry, Staged&& staged);
+	size_t inflightBytes() const;
+};
@@ -0,0 +1,38 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <string>
+
+ThreadPool::ThreadPool(size_t threads)
+{
+	_workers.reserve(threads);
+	for (size_t i = 0; i < threads; ++i) {
+		_workers.emplace_back([this, i]() { workerLoop(i); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	for (auto& worker : _workers) worker.join();
+}
+
+void ThreadPool::workerLoop(size_t index)
+{
+	PROFILE_THREAD("Worker " + std::to_string(index));
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+			if (_stopping && _tasks.empty()) return;
+			task = std::move(_tasks.front());
+			_tasks.pop();
+		}
+		PROFILE_SCOPE("ThreadPool task");
+		task();
+	}
+}
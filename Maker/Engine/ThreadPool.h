@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads pulling tasks from one queue. Meant for CPU-only work (decoding, cooking);
+// anything touching GL stays on the main thread. Tasks must not block waiting on other pool tasks.
+class ThreadPool
+{
+	std::vector<std::thread> _workers;
+	std::queue<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	bool _stopping = false;
+
+	void workerLoop(size_t index);
+
+public:
+	// Shared pool sized to the machine, one thread kept free for the caller; hardware_concurrency() may be 0
+	static ThreadPool& getInstance()
+	{
+		static ThreadPool instance(std::max(2u, std::thread::hardware_concurrency()) - 1);
+		return instance;
+	}
+
+	explicit ThreadPool(size_t threads);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t size() const { return _workers.size(); }
+
+	template <typename Fn>
+	auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>>
+	{
+		using Result = std::invoke_result_t<Fn>;
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+		auto future = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_tasks.emplace([task]() { (*task)(); });
+		}
+		_wake.notify_one();
+		return future;
+	}
+};
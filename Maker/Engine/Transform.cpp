@@ -8,13 +8,13 @@
 
 
 
-const vec3& Transform::GetRotation() const
+vec3 Transform::GetRotation() const
 {
-    // Calculate the rotation matrix from the _left, _up, and _fwd vectors
+    // Calculate the rotation matrix from the left, up, and fwd axes
     mat4 rotationMatrix = mat4(1.0);
-    rotationMatrix[0] = vec4(_left, 0.0);
-    rotationMatrix[1] = vec4(_up, 0.0);
-    rotationMatrix[2] = vec4(_fwd, 0.0);
+    rotationMatrix[0] = vec4(_axes.left, 0.0);
+    rotationMatrix[1] = vec4(_axes.up, 0.0);
+    rotationMatrix[2] = vec4(_axes.fwd, 0.0);
 
     // Extract Euler angles from the rotation matrix
     vec3 eulerAngles = glm::eulerAngles(glm::quat_cast(rotationMatrix));
@@ -25,12 +25,12 @@ const vec3& Transform::GetRotation() const
     return eulerAngles;
 }
 
-const vec3& Transform::GetScale() const
+vec3 Transform::GetScale() const
 {
     glm::vec3 left(_mat[0][0], _mat[0][1], _mat[0][2]);
     glm::vec3 up(_mat[1][0], _mat[1][1], _mat[1][2]);
     glm::vec3 forward(_mat[2][0], _mat[2][1], _mat[2][2]);
-    // Calculate the scale vector from the _left, _up, and _fwd vectors
+    // Calculate the scale vector from the left, up, and fwd axes
     vec3 scale;
     scale.x = glm::length(left);
     scale.y = glm::length(up);
@@ -49,16 +49,15 @@ void Transform::rotate(double rads, const vec3& v) {
 
 void Transform::alignCamera(const vec3& worldUp) {
 
-    vec3 fwd = glm::normalize(_fwd);
+    vec3 fwd = glm::normalize(_axes.fwd);
     vec3 right = glm::normalize(glm::cross(worldUp, fwd));
     vec3 up = glm::cross(fwd, right);
 
 
-    _left = right;
-    _up = up;
-    _fwd = fwd;
-    _pos = _pos;
-    _mat = mat4(vec4(_left, 0.0f), vec4(_up, 0.0f), vec4(_fwd, 0.0f), vec4(_pos, 1.0f));
+    _axes.left = right;
+    _axes.up = up;
+    _axes.fwd = fwd;
+    _mat = mat4(vec4(_axes.left, 0.0f), vec4(_axes.up, 0.0f), vec4(_axes.fwd, 0.0f), vec4(_axes.pos, 1.0f));
 }
 
 void Transform::SetRotation(const vec3& eulerAngles)
@@ -72,42 +71,42 @@ void Transform::SetRotation(const vec3& eulerAngles)
     // Convert quaternion to rotation matrix
     mat4 rotationMatrix = glm::toMat4(quaternion);
 
-    // Calculate the new _left, _up, and _fwd vectors and normalize them
-    _left = glm::normalize(vec3(rotationMatrix[0]));
-    _up = glm::normalize(vec3(rotationMatrix[1]));
-    _fwd = glm::normalize(vec3(rotationMatrix[2]));
+    // Calculate the new left, up, and fwd axes and normalize them
+    _axes.left = glm::normalize(vec3(rotationMatrix[0]));
+    _axes.up = glm::normalize(vec3(rotationMatrix[1]));
+    _axes.fwd = glm::normalize(vec3(rotationMatrix[2]));
 }
 
 void Transform::SetScale(const vec3& scale)
 {
-    // Normalize the _left, _up, and _fwd vectors
-    vec3 leftNormalized = glm::normalize(_left);
-    vec3 upNormalized = glm::normalize(_up);
-    vec3 fwdNormalized = glm::normalize(_fwd);
+    // Normalize the left, up, and fwd axes
+    vec3 leftNormalized = glm::normalize(_axes.left);
+    vec3 upNormalized = glm::normalize(_axes.up);
+    vec3 fwdNormalized = glm::normalize(_axes.fwd);
 
     // Scale the vectors by the provided scale
-    _left = leftNormalized * scale.x;
-    _up = upNormalized * scale.y;
-    _fwd = fwdNormalized * scale.z;
+    _axes.left = leftNormalized * scale.x;
+    _axes.up = upNormalized * scale.y;
+    _axes.fwd = fwdNormalized * scale.z;
 
     // Update the transformation matrix
-    _mat[0] = vec4(_left, 0.0);
-    _mat[1] = vec4(_up, 0.0);
-    _mat[2] = vec4(_fwd, 0.0);
+    _mat[0] = vec4(_axes.left, 0.0);
+    _mat[1] = vec4(_axes.up, 0.0);
+    _mat[2] = vec4(_axes.fwd, 0.0);
 }
 
 void Transform::lookAt(const vec3& target) {
-    _fwd = glm::normalize(_pos - target);
-    _left = glm::normalize(glm::cross(vec3(0, 1, 0), _fwd));
-    _up = glm::cross(_fwd, _left);
-    _mat[0] = vec4(_left, 0.0);
-    _mat[1] = vec4(_up, 0.0);
-    _mat[2] = vec4(-_fwd, 0.0);
-    _mat[3] = vec4(_pos, 1.0);
+    _axes.fwd = glm::normalize(_axes.pos - target);
+    _axes.left = glm::normalize(glm::cross(vec3(0, 1, 0), _axes.fwd));
+    _axes.up = glm::cross(_axes.fwd, _axes.left);
+    _mat[0] = vec4(_axes.left, 0.0);
+    _mat[1] = vec4(_axes.up, 0.0);
+    _mat[2] = vec4(-_axes.fwd, 0.0);
+    _mat[3] = vec4(_axes.pos, 1.0);
 }
 
 void Transform::SetPosition(const vec3& position) {
-    _pos = position;
+    _axes.pos = position;
     // Actualizar la matriz de transformacin con la nueva posicin
     _mat[3] = vec4(position, 1.0f);
 }
\ No newline at end of file
@@ -11,14 +11,17 @@
 
 class Transform {
 
+	// The columns of _mat. Named, since GCC does not allow members with constructors in an anonymous struct
+	struct Axes {
+		vec3 left; mat4::value_type left_w;
+		vec3 up; mat4::value_type up_w;
+		vec3 fwd; mat4::value_type fwd_w;
+		vec3 pos; mat4::value_type pos_w;
+	};
+
 	union {
 		mat4 _mat = mat4(1.0);
-		struct {
-			vec3 _left; mat4::value_type _left_w;
-			vec3 _up; mat4::value_type _up_w;
-			vec3 _fwd; mat4::value_type _fwd_w;
-			vec3 _pos; mat4::value_type _pos_w;
-		};
+		Axes _axes;
 	};
 
 public:
@@ -26,34 +29,34 @@ public:
 	Transform(Transform& transform)
 	{
 		_mat = transform._mat;
-		_left = transform._left;
-		_up = transform._up;
-		_fwd = transform._fwd;
-		_pos = transform._pos;
+		_axes.left = transform._axes.left;
+		_axes.up = transform._axes.up;
+		_axes.fwd = transform._axes.fwd;
+		_axes.pos = transform._axes.pos;
 
 	}
 
 	const auto& mat() const { return _mat; }
-	const auto& left() const { return _left; }
-	const auto& up() const { return _up; }
-	const auto& fwd() const { return _fwd; }
-	const auto& pos() const { return _pos; }
-	const vec3& GetRotation() const;
+	const auto& left() const { return _axes.left; }
+	const auto& up() const { return _axes.up; }
+	const auto& fwd() const { return _axes.fwd; }
+	const auto& pos() const { return _axes.pos; }
+	vec3 GetRotation() const;
 
-	const vec3& GetScale() const;
+	vec3 GetScale() const;
 
 	// Non-constant versions of GetRotation and GetScale
 	vec3& GetRotation() {
-		// Assuming the rotation is stored in _fwd
-		return _fwd;
+		// Assuming the rotation is stored in the fwd axis
+		return _axes.fwd;
 	}
 
 	vec3& GetScale() {
-		// Assuming the scale is stored in _up
-		return _up;
+		// Assuming the scale is stored in the up axis
+		return _axes.up;
 	}
 
-	auto& pos() { return _pos; }
+	auto& pos() { return _axes.pos; }
 
 	const auto* data() const { return &_mat[0][0]; }
 
@@ -66,10 +69,10 @@ public:
 	void SetScale(const vec3& scale);
 	void SetLocalMatrix(const mat4& localMatrix) {
 		_mat = localMatrix;
-		_left = vec3(_mat[0]);
-		_up = vec3(_mat[1]);
-		_fwd = vec3(_mat[2]);
-		_pos = vec3(_mat[3]);
+		_axes.left = vec3(_mat[0]);
+		_axes.up = vec3(_mat[1]);
+		_axes.fwd = vec3(_mat[2]);
+		_axes.pos = vec3(_mat[3]);
 	}
 
 	Transform& operator=(const glm::mat4& mat) {
@@ -30,6 +30,12 @@ public:
 		return _children.back();
 	}
 
+	// Moves every object of children to the end of this object's children, keeping their order and addresses
+	void adoptChildren(std::list<T>& children) {
+		for (auto& child : children) child._parent = static_cast<T*>(this);
+		_children.splice(_children.end(), children);
+	}
+
 	//template <typename ...Args>
     auto& setParent(T& newParent = *static_cast<T*>(nullptr)) {
         if (_parent == &newParent) {
@@ -1,9 +1,376 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <stdexcept>
+#include <vector>
 using namespace std;
 #include "Engine/GameObject.h"
+#include "Engine/Scene.h"
+#include "Engine/RenderDevice.h"
+#include "Engine/RenderQueue.h"
+#include "Engine/CachingRenderDevice.h"
+#include "Engine/FrameScheduler.h"
+#include "Engine/OffscreenContext.h"
+#include "Engine/StaticBatcher.h"
+#include "Engine/SceneGenerator.h"
+#include "Engine/Profiler.h"
+#include "Editor/SceneSerializator.h"
+
+// Runs the game without a window or GL context: loads a cooked scene (one saved from the editor) or generates one,
+// then steps the engine for a fixed number of ticks and reports how long they took.
+//
+//   Game [--scene path | --objects 10000 --seed 1 --depth 1 --fan-out 4] [--ticks 600] [--hz 60] [--warmup 30]
+//        [--realtime] [--trace trace.json] [--out game.json] [--render [--size 1280x720] [--dump dir] [--dump-every 60]]
+//
+// A tick runs the component updates, the cameras, then culls the scene into a render queue against the main camera:
+// everything a frame does short of submitting draws. Mesh uploads go to a RecordingRenderDevice. Ticks run back to
+// back unless --realtime paces them at hz, as a dedicated server would.
+//
+// --render draws every tick as well, into an OffscreenContext (EGL on a software rasterizer where there is no GPU),
+// still without a window: the queue is submitted and the GPU waited for, and each frame's draw calls and triangles are
+// counted. --dump writes every dump-every-th frame to dir as a PPM image, outside the timed part of the frame.
+
+using hrclock = chrono::steady_clock;
+
+GameObject mainCamera("Main Camera");
+
+namespace
+{
+	struct Options
+	{
+		string scenePath;
+		SceneGenerator::Settings scene;
+		size_t ticks = 600;
+		size_t warmup = 30;
+		double hz = 60.0;
+		bool realtime = false;
+		string tracePath;
+		string output;
+		bool render = false;
+		int width = 1280;
+		int height = 720;
+		string dumpDirectory;
+		size_t dumpEvery = 60;
+	};
+
+	enum Phase { Update, Cameras, Culling, Submit, Finish, Tick, PhaseCount };
+	const char* const kPhaseNames[PhaseCount] = { "Update", "Cameras", "Culling", "Submit", "Finish", "Tick" };
+
+	bool isRenderPhase(int phase) { return phase == Submit || phase == Finish; }
+
+	// Turns its object about its own up axis: the stand-in for gameplay code on objects that are not static
+	class Spinner : public Component
+	{
+		Transform& _transform;
+		double _speed;	// radians per second
+
+	public:
+		Spinner(std::weak_ptr<GameObject> owner, Transform& transform, double speed) : Component(owner), _transform(transform), _speed(speed) {}
+
+		void Update(double deltaTime) override { _transform.rotate(_speed * deltaTime, vec3(0, 1, 0)); }
+	};
+
+	size_t addSpinners(GameObject& gameObject)
+	{
+		size_t count = 0;
+		for (auto& child : gameObject.getChildren()) {
+			if (!child.isStatic) {
+				auto& transform = child.GetComponent<TransformComponent>()->transform();
+				child.AddComponent<Spinner>(transform, 0.5 + (child.getId() % 7) * 0.25);
+				++count;
+			}
+			count += addSpinners(child);
+		}
+		return count;
+	}
+
+	void updateCameras(GameObject& gameObject)
+	{
+		for (auto& child : gameObject.getChildren()) {
+			if (child.HasComponent<CameraComponent>()) {
+				child.GetComponent<CameraComponent>()->camera().UpdateCamera(child.GetComponent<TransformComponent>()->transform());
+			}
+			updateCameras(child);
+		}
+	}
+
+	// World matrices are built on the way down, so each object's bounds cost one transform
+	void cull(const GameObject& gameObject, const mat4& parentMatrix, const Frustum& frustum, RenderQueue& queue)
+	{
+		for (const auto& child : gameObject.children()) {
+			if (!child.active) continue;
+			const mat4 modelMatrix = parentMatrix * child.GetComponent<TransformComponent>()->transform().mat();
+			if (child.hasMesh() && child.HasComponent<MeshLoader>() && !child.staticBatched && frustum.ContainsBBox(modelMatrix * child.mesh().boundingBox()) != FRUSTUM_OUT) {
+				child.GetComponent<MeshLoader>()->Enqueue(queue, frustum, modelMatrix);
+			}
+			cull(child, modelMatrix, frustum, queue);
+		}
+	}
+
+	struct Summary
+	{
+		double mean = 0, p50 = 0, p90 = 0, p95 = 0, p99 = 0, max = 0;
+	};
+
+	template <typename T>
+	Summary summarize(const vector<T>& values)
+	{
+		vector<double> times(values.begin(), values.end());
+		Summary summary;
+		if (times.empty()) return summary;
+		std::sort(times.begin(), times.end());
+		for (double time : times) summary.mean += time;
+		summary.mean /= times.size();
+		summary.p50 = FrameScheduler::percentile(times, 0.50);
+		summary.p90 = FrameScheduler::percentile(times, 0.90);
+		summary.p95 = FrameScheduler::percentile(times, 0.95);
+		summary.p99 = FrameScheduler::percentile(times, 0.99);
+		summary.max = times.back();
+		return summary;
+	}
+
+	void printSummary(const char* name, const Summary& s, int decimals)
+	{
+		printf("%-8s %9.*f %9.*f %9.*f %9.*f %9.*f %9.*f\n", name, decimals, s.mean, decimals, s.p50, decimals, s.p90, decimals, s.p95,
+			decimals, s.p99, decimals, s.max);
+	}
+
+	void writeSummary(ostream& out, const char* name, const Summary& s, bool last)
+	{
+		out << "    \"" << name << "\": { \"mean\": " << s.mean << ", \"p50\": " << s.p50 << ", \"p90\": " << s.p90
+			<< ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << " }" << (last ? "\n" : ",\n");
+	}
+
+	bool parseArguments(int argc, char** argv, Options& options)
+	{
+		options.scene.objects = 10000;
+		for (int i = 1; i < argc; ++i) {
+			const string argument = argv[i];
+			if (argument == "--realtime" || argument == "--render") {
+				(argument == "--realtime" ? options.realtime : options.render) = true;
+				continue;
+			}
+			const char* value = i + 1 < argc ? argv[++i] : nullptr;
+			if (!value) {
+				cerr << "Missing value for " << argument << endl;
+				return false;
+			}
+			if (argument == "--scene") options.scenePath = value;
+			else if (argument == "--objects") options.scene.objects = strtoull(value, nullptr, 10);
+			else if (argument == "--seed") options.scene.seed = strtoull(value, nullptr, 10);
+			else if (argument == "--depth") options.scene.depth = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+			else if (argument == "--fan-out") options.scene.fanOut = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+			else if (argument == "--ticks") options.ticks = strtoull(value, nullptr, 10);
+			else if (argument == "--warmup") options.warmup = strtoull(value, nullptr, 10);
+			else if (argument == "--hz") options.hz = std::max(strtod(value, nullptr), 1.0);
+			else if (argument == "--trace") options.tracePath = value;
+			else if (argument == "--out") options.output = value;
+			else if (argument == "--size") {
+				if (sscanf(value, "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 || options.height <= 0) {
+					cerr << "Bad size " << value << ", expected WIDTHxHEIGHT" << endl;
+					return false;
+				}
+			}
+			else if (argument == "--dump") options.dumpDirectory = value;
+			else if (argument == "--dump-every") options.dumpEvery = std::max<size_t>(strtoull(value, nullptr, 10), 1);
+			else {
+				cerr << "Unknown argument " << argument << endl;
+				return false;
+			}
+		}
+		return true;
+	}
+}
 
 int main(int argc, char** argv)
 {
-	
+	Options options;
+	if (!parseArguments(argc, argv, options)) return 1;
+
+	Profiler::getInstance().enabled = !options.tracePath.empty();
+
+	// The context has to exist before the scene, whose meshes upload as they are created
+	unique_ptr<OffscreenContext> context;
+	if (options.render) {
+		try {
+			context = make_unique<OffscreenContext>(options.width, options.height);
+		}
+		catch (const exception& e) {
+			cerr << "Could not render offscreen: " << e.what() << endl;
+			return 1;
+		}
+		RenderDevice::install(nullptr);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_TEXTURE_2D);
+		glClearColor(0.5, 0.5, 0.5, 1.0);
+	}
+	else {
+		RenderDevice::install(std::make_unique<RecordingRenderDevice>());
+	}
+	auto* cache = dynamic_cast<CachingRenderDevice*>(&RenderDevice::getInstance());
+
+	if (!options.scenePath.empty()) {
+		SceneManager::loadScene(options.scenePath);
+		if (scene.getChildren().empty()) {
+			cerr << "No objects loaded from " << options.scenePath << endl;
+			return 1;
+		}
+	}
+	else {
+		SceneGenerator::generate(scene, options.scene);
+	}
+	const size_t spinners = addSpinners(scene);
+	// Static objects never move, so they are merged into batches once, as in the editor
+	StaticBatcher::getInstance().build(scene);
+
+	// The main camera circles the scene, so what is culled changes from tick to tick
+	const BoundingBox bounds = scene.boundingBox();
+	const vec3 centre = bounds.center();
+	const double radius = std::max(glm::length(bounds.max - bounds.min) * 0.5, 1.0);
+	auto& camera = mainCamera.GetComponent<CameraComponent>()->camera();
+	camera.zFar = radius * 4.0;
+	if (context) camera.aspect = context->aspect();
+
+	const double deltaTime = 1.0 / options.hz;
+	RenderQueue queue;
+	vector<double> times[PhaseCount];
+	vector<size_t> drawCalls;
+	vector<size_t> triangles;
+	size_t visible = 0;
+	auto deadline = hrclock::now();
+
+	for (size_t tick = 0; tick < options.warmup + options.ticks; ++tick) {
+		PROFILE_FRAME();
+		const auto tickStart = hrclock::now();
+		double phaseTimes[PhaseCount] = {};
+		if (cache) cache->beginFrame();
+
+		auto start = hrclock::now();
+		{
+			PROFILE_SCOPE("Update");
+			scene.Update(deltaTime);
+		}
+		auto end = hrclock::now();
+		phaseTimes[Update] = chrono::duration<double, milli>(end - start).count();
+
+		start = end;
+		{
+			PROFILE_SCOPE("Cameras");
+			const double angle = tick * deltaTime * 0.25;
+			camera.transform().pos() = centre + vec3(std::cos(angle), 0.3, std::sin(angle)) * radius * 1.2;
+			camera.transform().lookAt(centre);
+			camera.UpdateMainCamera();
+			updateCameras(scene);
+		}
+		end = hrclock::now();
+		phaseTimes[Cameras] = chrono::duration<double, milli>(end - start).count();
+
+		start = end;
+		{
+			PROFILE_SCOPE("Culling");
+			queue.begin(camera.view());
+			cull(scene, mat4(1.0), camera.frustum, queue);
+			StaticBatcher::getInstance().enqueue(queue, camera.frustum);
+			visible = queue.size();
+		}
+		end = hrclock::now();
+		phaseTimes[Culling] = chrono::duration<double, milli>(end - start).count();
+
+		if (context) {
+			start = end;
+			{
+				PROFILE_SCOPE("Submit");
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glMatrixMode(GL_PROJECTION);
+				glLoadMatrixd(&camera.projection()[0][0]);
+				glMatrixMode(GL_MODELVIEW);
+				queue.submit();
+			}
+			end = hrclock::now();
+			phaseTimes[Submit] = chrono::duration<double, milli>(end - start).count();
+
+			start = end;
+			{
+				PROFILE_SCOPE("Finish");
+				context->finish();
+			}
+			end = hrclock::now();
+			phaseTimes[Finish] = chrono::duration<double, milli>(end - start).count();
+		}
+		phaseTimes[Tick] = chrono::duration<double, milli>(end - tickStart).count();
+
+		if (tick >= options.warmup) {
+			for (int phase = 0; phase < PhaseCount; ++phase) times[phase].push_back(phaseTimes[phase]);
+			if (context && cache) {
+				drawCalls.push_back(cache->frame().drawCalls);
+				triangles.push_back(cache->frame().triangles);
+			}
+			const size_t frame = tick - options.warmup;
+			if (context && !options.dumpDirectory.empty() && frame % options.dumpEvery == 0) {
+				char name[32];
+				snprintf(name, sizeof(name), "/frame_%05zu.ppm", frame);
+				if (!context->savePpm(options.dumpDirectory + name)) cerr << "Could not write " << options.dumpDirectory + name << endl;
+			}
+		}
+
+		if (options.realtime) {
+			deadline += chrono::duration_cast<hrclock::duration>(chrono::duration<double>(deltaTime));
+			this_thread::sleep_until(deadline);
+		}
+	}
+
+	Summary summaries[PhaseCount];
+	for (int phase = 0; phase < PhaseCount; ++phase) summaries[phase] = summarize(times[phase]);
+	const Summary drawSummary = summarize(drawCalls);
+	const Summary triangleSummary = summarize(triangles);
+
+	printf("%zu ticks at %.0f Hz over %zu top-level objects (%zu updating), %zu visible on the last tick\n",
+		options.ticks, options.hz, scene.getChildren().size(), spinners, visible);
+	if (context) printf("Rendered at %dx%d on %s\n", options.width, options.height, context->renderer().c_str());
+	printf("%-8s %9s %9s %9s %9s %9s %9s  (ms)\n", "", "mean", "p50", "p90", "p95", "p99", "max");
+	for (int phase = 0; phase < PhaseCount; ++phase) {
+		if (!isRenderPhase(phase) || context) printSummary(kPhaseNames[phase], summaries[phase], 3);
+	}
+	if (context) {
+		printSummary("Draws", drawSummary, 0);
+		printSummary("Tris", triangleSummary, 0);
+	}
+
+	if (!options.tracePath.empty() && !Profiler::getInstance().exportChromeTrace(options.tracePath, Profiler::kFrames)) {
+		cerr << "Could not write " << options.tracePath << endl;
+	}
+
+	if (!options.output.empty()) {
+		ofstream out(options.output);
+		out << "{\n  \"scene\": \"" << (options.scenePath.empty() ? string("generated") : options.scenePath) << "\",\n  \"objects\": "
+			<< scene.getChildren().size() << ",\n  \"ticks\": " << options.ticks << ",\n  \"hz\": " << options.hz
+			<< ",\n  \"visible\": " << visible << ",\n";
+		if (context) {
+			out << "  \"width\": " << options.width << ",\n  \"height\": " << options.height << ",\n  \"renderer\": \"" << context->renderer() << "\",\n";
+		}
+		out << "  \"phases\": {\n";
+		for (int phase = 0; phase < PhaseCount; ++phase) {
+			if (!isRenderPhase(phase) || context) writeSummary(out, kPhaseNames[phase], summaries[phase], phase + 1 == PhaseCount);
+		}
+		out << "  }";
+		if (context) {
+			out << ",\n  \"frames\": {\n";
+			writeSummary(out, "drawCalls", drawSummary, false);
+			writeSummary(out, "triangles", triangleSummary, true);
+			out << "  }";
+		}
+		out << "\n}\n";
+		if (!out) {
+			cerr << "Could not write " << options.output << endl;
+			return 1;
+		}
+	}
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,181 @@
+#include "Check.h"
+#include "Engine/ArenaAllocator.h"
+#include "Engine/GeometryArena.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Free-block coalescing, best fit and compaction in ArenaAllocator, then the same through GeometryArena with
+// MockArenaBuffer standing in for GL buffers, checking that compaction and growth keep every mesh's bytes
+
+namespace
+{
+	void coalescing()
+	{
+		ArenaAllocator arena(30);
+		const auto a = arena.allocate(10);
+		const auto b = arena.allocate(10);
+		const auto c = arena.allocate(10);
+		CHECK(arena.offset(a) == 0 && arena.offset(b) == 10 && arena.offset(c) == 20);
+		CHECK(arena.allocate(1) == ArenaAllocator::kInvalid);
+
+		arena.free(b);
+		CHECK(!arena.valid(b));
+		CHECK(arena.stats().freeBlocks == 1);
+
+		// Freeing a merges it with b's block, and c's with both: one block in the end
+		arena.free(a);
+		CHECK(arena.stats().freeBlocks == 1);
+		CHECK(arena.stats().largestFree == 20);
+		arena.free(c);
+		CHECK(arena.stats().freeBlocks == 1);
+		CHECK(arena.stats().largestFree == 30);
+		CHECK(arena.stats().used == 0);
+		CHECK(arena.isCompact());
+
+		const auto whole = arena.allocate(30);
+		CHECK(arena.valid(whole) && arena.offset(whole) == 0);
+	}
+
+	void bestFit()
+	{
+		ArenaAllocator arena(100);
+		std::vector<ArenaAllocator::Handle> handles;
+		for (size_t size : { 10, 30, 10, 20, 10, 20 }) handles.push_back(arena.allocate(size));
+		arena.free(handles[1]);	// 30 at 10
+		arena.free(handles[3]);	// 20 at 50
+
+		// The smallest block that fits, not the first
+		const auto fit = arena.allocate(15);
+		CHECK(arena.offset(fit) == 50);
+		CHECK(arena.stats().freeBlocks == 2);
+		CHECK(arena.stats().freeSpace == 35);
+	}
+
+	void compaction()
+	{
+		ArenaAllocator arena(60);
+		std::vector<ArenaAllocator::Handle> handles;
+		for (int i = 0; i < 6; ++i) handles.push_back(arena.allocate(10));
+		arena.free(handles[0]);
+		arena.free(handles[2]);
+		arena.free(handles[3]);
+		CHECK(!arena.isCompact());
+		CHECK(arena.stats().fragmentation() > 0);
+
+		const auto moves = arena.compact();
+		CHECK(arena.isCompact());
+		CHECK(arena.stats().fragmentation() == 0);
+		CHECK(arena.stats().largestFree == 30);
+
+		// Order is kept, and [40, 60) slides down as one move
+		CHECK(arena.offset(handles[1]) == 0);
+		CHECK(arena.offset(handles[4]) == 10);
+		CHECK(arena.offset(handles[5]) == 20);
+		CHECK(moves.size() == 2);
+		if (moves.size() == 2) {
+			CHECK(moves[0].from == 10 && moves[0].to == 0 && moves[0].size == 10);
+			CHECK(moves[1].from == 40 && moves[1].to == 10 && moves[1].size == 20);
+		}
+
+		// Moves cover every live range, for copying into fresh storage; already compact, none of them shifts
+		for (const auto& move : arena.compact()) CHECK(move.from == move.to);
+	}
+
+	void growth()
+	{
+		ArenaAllocator arena(20);
+		const auto a = arena.allocate(15);
+		arena.grow(40);
+		CHECK(arena.offset(a) == 0);
+		// The free tail of the old capacity and the new space are one block
+		CHECK(arena.stats().freeBlocks == 1);
+		const auto b = arena.allocate(25);
+		CHECK(arena.valid(b) && arena.offset(b) == 15);
+	}
+
+	// A mesh whose position and index values all encode id, so a misplaced copy shows
+	struct TestMesh
+	{
+		GeometryArena::Allocation allocation;
+		std::vector<float> positions;
+		std::vector<unsigned int> indices;
+	};
+
+	TestMesh makeMesh(GeometryArena& arena, unsigned int id, size_t vertexCount, size_t indexCount)
+	{
+		TestMesh mesh;
+		mesh.allocation = arena.allocate(vertexCount, indexCount);
+		mesh.positions.resize(vertexCount * 3);
+		for (size_t i = 0; i < mesh.positions.size(); ++i) mesh.positions[i] = id * 1000.0f + i;
+		for (size_t i = 0; i < indexCount; ++i) mesh.indices.push_back(id * 1000 + static_cast<unsigned int>(i));
+		arena.write(mesh.allocation, GeometryArena::Positions, mesh.positions.data(), vertexCount);
+		arena.writeIndices(mesh.allocation, mesh.indices.data(), indexCount);
+		return mesh;
+	}
+
+	bool intact(const GeometryArena& arena, const TestMesh& mesh)
+	{
+		const auto& positions = static_cast<const MockArenaBuffer&>(*arena.buffer(GeometryArena::Positions));
+		const auto& indices = static_cast<const MockArenaBuffer&>(*arena.indexBuffer());
+		const size_t vertexBytes = mesh.positions.size() * sizeof(float);
+		const size_t indexBytes = mesh.indices.size() * sizeof(unsigned int);
+		const size_t vertexOffset = mesh.allocation.baseVertex() * GeometryArena::kStride[GeometryArena::Positions];
+		const size_t indexOffset = mesh.allocation.firstIndex() * sizeof(unsigned int);
+		return vertexOffset + vertexBytes <= positions.bytes.size() && indexOffset + indexBytes <= indices.bytes.size() &&
+			std::memcmp(positions.bytes.data() + vertexOffset, mesh.positions.data(), vertexBytes) == 0 &&
+			std::memcmp(indices.bytes.data() + indexOffset, mesh.indices.data(), indexBytes) == 0;
+	}
+
+	void geometryArena()
+	{
+		GeometryArena arena([](bool) { return std::make_unique<MockArenaBuffer>(); });
+		arena.settings.initialVertices = 16;
+		arena.settings.initialIndices = 24;
+
+		std::vector<TestMesh> meshes;
+		for (unsigned int id = 1; id <= 4; ++id) meshes.push_back(makeMesh(arena, id, 4, 6));
+		CHECK(arena.stats().vertices.freeSpace == 0);
+		CHECK(arena.stats().indices.freeSpace == 0);
+
+		// Two holes of 4 slots: 8 free in total, half of it outside the largest block
+		meshes[0].allocation.reset();
+		meshes[2].allocation.reset();
+		CHECK(arena.stats().vertices.freeBlocks == 2);
+
+		// 8 vertices fit once the holes are packed together, so the arena compacts instead of growing
+		meshes.push_back(makeMesh(arena, 5, 8, 12));
+		CHECK(arena.stats().compactions >= 1);
+		CHECK(arena.stats().grows == 0);
+		CHECK(meshes[1].allocation.baseVertex() == 0);
+		CHECK(meshes[3].allocation.baseVertex() == 4);
+		CHECK(intact(arena, meshes[1]));
+		CHECK(intact(arena, meshes[3]));
+		CHECK(intact(arena, meshes[4]));
+
+		// Full again, so the next mesh grows every buffer, keeping what is there
+		meshes.push_back(makeMesh(arena, 6, 4, 6));
+		CHECK(arena.stats().grows >= 1);
+		CHECK(arena.stats().vertices.capacity == 32);
+		for (size_t i : { 1, 3, 4, 5 }) CHECK(intact(arena, meshes[i]));
+
+		// defragment() packs the holes left by released meshes regardless of fragmentation
+		meshes[3].allocation.reset();
+		const size_t compactions = arena.stats().compactions;
+		arena.defragment();
+		CHECK(arena.stats().compactions > compactions);
+		CHECK(arena.stats().vertices.freeBlocks == 1);
+		CHECK(arena.stats().vertices.fragmentation() == 0);
+		for (size_t i : { 1, 4, 5 }) CHECK(intact(arena, meshes[i]));
+	}
+}
+
+int main()
+{
+	coalescing();
+	bestFit();
+	compaction();
+	growth();
+	geometryArena();
+	return Check::failures;
+}
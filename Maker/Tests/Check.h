@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal assertions for the test executables: a failed CHECK prints where and carries on, and main returns
+// the number of failures so CTest sees a non-zero exit.
+namespace Check
+{
+	inline int failures = 0;
+
+	inline bool report(bool passed, const char* expression, const char* file, int line)
+	{
+		if (!passed) {
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+			++failures;
+		}
+		return passed;
+	}
+}
+
+#define CHECK(expression) Check::report(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
@@ -0,0 +1,96 @@
+#include "Check.h"
+#include "Engine/Image.h"
+#include "Engine/TextureStreamer.h"
+#include <limits>
+#include <vector>
+
+// Budget eviction and re-residency, against the recording uploader so no GL context is needed
+
+namespace
+{
+	constexpr unsigned int kSize = 256;
+	constexpr double kClose = std::numeric_limits<double>::infinity();	// wants level 0
+
+	StreamSource makeSource()
+	{
+		std::vector<unsigned char> pixels(kSize * kSize * 3, 128);
+		return StreamSource::fromChain(MipGen::build(pixels.data(), kSize, kSize, 3));
+	}
+
+	TextureStreamer::TextureStats statsOf(const TextureStreamer& streamer, const Image* image)
+	{
+		for (const auto& stats : streamer.stats()) {
+			if (stats.image == image) return stats;
+		}
+		return {};
+	}
+
+	// One frame in which each image in used is drawn close to the camera
+	void frame(TextureStreamer& streamer, const std::vector<const Image*>& used)
+	{
+		streamer.beginFrame(vec3(0), 1.0, 720);
+		for (const Image* image : used) streamer.noteUse(image, kClose);
+		streamer.update();
+		streamer.flush();
+	}
+}
+
+int main()
+{
+	auto uploader = std::make_unique<RecordingTextureUploader>();
+	RecordingTextureUploader& recorded = *uploader;
+	TextureStreamer streamer(std::move(uploader));
+	streamer.settings.initialSize = 64;
+
+	auto a = std::make_shared<Image>();
+	auto b = std::make_shared<Image>();
+	CHECK(streamer.add(a, makeSource()));
+	CHECK(streamer.add(b, makeSource()));
+
+	// Both start with their coarse tail: 64x64 and below
+	const auto tail = statsOf(streamer, a.get());
+	CHECK(tail.residentLevel == 2);
+	CHECK(recorded.uploads.size() == 2);
+	CHECK(recorded.uploads.back().width == 64);
+
+	const StreamSource source = makeSource();
+	const size_t full = source.bytesFrom(0);
+	const size_t coarse = source.bytesFrom(2);
+
+	// Plenty of budget: both become fully resident
+	frame(streamer, { a.get(), b.get() });
+	CHECK(statsOf(streamer, a.get()).residentLevel == 0);
+	CHECK(statsOf(streamer, b.get()).residentLevel == 0);
+	CHECK(streamer.residentBytes() == 2 * full);
+
+	// b is drawn again, a is not; then the budget shrinks to one full texture plus a tail
+	frame(streamer, { b.get() });
+	const size_t uploadsBefore = recorded.uploads.size();
+	streamer.settings.budgetBytes = full + coarse;
+	frame(streamer, { b.get() });
+
+	// The least recently needed texture gives up its finest levels, the other keeps them
+	CHECK(statsOf(streamer, a.get()).residentLevel == 2);
+	CHECK(statsOf(streamer, b.get()).residentLevel == 0);
+	CHECK(streamer.residentBytes() <= streamer.settings.budgetBytes);
+	CHECK(recorded.uploads.size() > uploadsBefore);
+	CHECK(recorded.uploads.back().image == a.get());
+	CHECK(recorded.uploads.back().width == 64);
+
+	// With the budget back, a is needed again and streams its finest levels back in
+	streamer.settings.budgetBytes = 2 * full;
+	frame(streamer, { a.get(), b.get() });
+	CHECK(statsOf(streamer, a.get()).residentLevel == 0);
+	CHECK(statsOf(streamer, b.get()).residentLevel == 0);
+	CHECK(recorded.uploads.back().image == a.get());
+	CHECK(recorded.uploads.back().width == kSize);
+	CHECK(recorded.uploads.back().bytes == full);
+
+	// Released images leave the streamer on the next update
+	a.reset();
+	frame(streamer, { b.get() });
+	CHECK(streamer.textureCount() == 1);
+	CHECK(streamer.residentBytes() == full);
+
+	return Check::failures;
+}